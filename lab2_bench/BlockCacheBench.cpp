@@ -0,0 +1,310 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>    // std::nth_element
+#include <chrono>       // std::chrono::steady_clock
+#include <filesystem>   // std::filesystem::temp_directory_path, remove
+#include <random>       // std::mt19937_64
+#include <string>
+#include <vector>
+
+#include "lab2_library.hpp"
+
+namespace {
+
+constexpr size_t BENCH_BLOCK_SIZE = 4096;
+constexpr int BLOCKS_PER_THREAD = 64;
+constexpr int MAX_THREADS = 16;
+
+/// One cache shared by every benchmark thread, large enough to hold all blocks
+Lab2& sharedLab2() {
+    static Lab2 lab2(MAX_THREADS * BLOCKS_PER_THREAD, BENCH_BLOCK_SIZE);
+    return lab2;
+}
+
+std::string threadFile(int thread) {
+    return (std::filesystem::temp_directory_path()
+            / ("lab2_bench_" + std::to_string(::getpid()) + "_" + std::to_string(thread))).string();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Cache hits on distinct blocks: each thread reads its own file through the
+// shared Lab2, so throughput should grow with the thread count.
+static void BM_Lab2_SharedCacheHits(benchmark::State& state) {
+    Lab2& lab2 = sharedLab2();
+    const std::string path = threadFile(state.thread_index());
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(BENCH_BLOCK_SIZE, 'x');
+    for (int b = 0; b < BLOCKS_PER_THREAD; ++b) {
+        lab2.write(fd, buffer.data(), buffer.size());
+    }
+
+    std::mt19937_64 rng(state.thread_index());
+    for (auto _ : state) {
+        off_t block = static_cast<off_t>(rng() % BLOCKS_PER_THREAD);
+        lab2.lseek(fd, block * BENCH_BLOCK_SIZE, SEEK_SET);
+        benchmark::DoNotOptimize(lab2.read(fd, buffer.data(), 512));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_Lab2_SharedCacheHits)->ThreadRange(1, MAX_THREADS)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// Every read misses: the working set is four times the cache, read in order.
+// Measures the miss path (eviction, buffer reuse, pread) per block size.
+static void BM_Lab2_MissPath(benchmark::State& state) {
+    const auto blockSize = static_cast<size_t>(state.range(0));
+    constexpr size_t CAPACITY = 8;
+    constexpr size_t FILE_BLOCKS = 4 * CAPACITY;
+    Lab2 lab2(CAPACITY, blockSize);
+    const std::string path = threadFile(-1);
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(blockSize, 'x');
+    for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+        lab2.write(fd, buffer.data(), buffer.size());
+    }
+    lab2.fsync(fd);
+
+    size_t block = 0;
+    for (auto _ : state) {
+        lab2.lseek(fd, static_cast<off_t>(block * blockSize), SEEK_SET);
+        benchmark::DoNotOptimize(lab2.read(fd, buffer.data(), 64));
+        block = (block + 1) % FILE_BLOCKS;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(blockSize));
+
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_Lab2_MissPath)->RangeMultiplier(4)->Range(4096, 4 << 20);
+
+//------------------------------------------------------------------------------
+// Random reads and writes (one in four) over four times the cache. Without
+// the flusher a miss often has to write back a dirty victim first; compare
+// the p99 latency of both settings.
+static void BM_Lab2_MixedReadWrite(benchmark::State& state) {
+    constexpr size_t CAPACITY = 64;
+    constexpr size_t FILE_BLOCKS = 4 * CAPACITY;
+    WritebackConfig writeback;
+    writeback.enabled = state.range(0) != 0;
+    Lab2 lab2(CAPACITY, BENCH_BLOCK_SIZE, writeback);
+    const std::string path = threadFile(-2);
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(BENCH_BLOCK_SIZE, 'x');
+    for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+        lab2.write(fd, buffer.data(), buffer.size());
+    }
+    lab2.fsync(fd);
+
+    std::mt19937_64 rng(7);
+    std::vector<double> latencies;
+    for (auto _ : state) {
+        off_t block = static_cast<off_t>(rng() % FILE_BLOCKS);
+        bool write = rng() % 4 == 0;
+        auto start = std::chrono::steady_clock::now();
+        lab2.lseek(fd, block * BENCH_BLOCK_SIZE, SEEK_SET);
+        if (write) {
+            benchmark::DoNotOptimize(lab2.write(fd, buffer.data(), 512));
+        } else {
+            benchmark::DoNotOptimize(lab2.read(fd, buffer.data(), 512));
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (!latencies.empty()) {
+        auto p99 = latencies.begin() + static_cast<std::ptrdiff_t>(latencies.size() * 99 / 100);
+        std::nth_element(latencies.begin(), p99, latencies.end());
+        state.counters["p99_us"] = *p99;
+    }
+
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_Lab2_MixedReadWrite)->ArgName("flusher")->Arg(0)->Arg(1)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// Whole-block sequential rewrite of a file four times the cache, per block
+// size. Full blocks are not read before they are replaced, so disk traffic is
+// the write-back alone.
+static void BM_Lab2_SequentialOverwrite(benchmark::State& state) {
+    const auto blockSize = static_cast<size_t>(state.range(0));
+    constexpr size_t CAPACITY = 8;
+    constexpr size_t FILE_BLOCKS = 4 * CAPACITY;
+    WritebackConfig writeback;
+    writeback.enabled = false;
+    Lab2 lab2(CAPACITY, blockSize, writeback);
+    const std::string path = threadFile(-3);
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(blockSize, 'x');
+    for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+        lab2.write(fd, buffer.data(), buffer.size());
+    }
+    lab2.fsync(fd);
+
+    size_t block = 0;
+    for (auto _ : state) {
+        lab2.lseek(fd, static_cast<off_t>(block * blockSize), SEEK_SET);
+        benchmark::DoNotOptimize(lab2.write(fd, buffer.data(), buffer.size()));
+        block = (block + 1) % FILE_BLOCKS;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(blockSize));
+
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_Lab2_SequentialOverwrite)->RangeMultiplier(4)->Range(4096, 4 << 20);
+
+//------------------------------------------------------------------------------
+// 256 random 100-byte records from a file twice the cache, fetched with one
+// pread() each or with a single readBatch().
+static void BM_Lab2_RecordFetch(benchmark::State& state, bool batch) {
+    constexpr size_t CAPACITY = 128;
+    constexpr size_t FILE_BLOCKS = 2 * CAPACITY;
+    constexpr size_t RECORDS = 256;
+    constexpr size_t RECORD_SIZE = 100;
+    Lab2 lab2(CAPACITY, BENCH_BLOCK_SIZE);
+    const std::string path = threadFile(-4);
+    fd_t fd = lab2.open(path);
+    std::vector<char> block(BENCH_BLOCK_SIZE, 'r');
+    for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+        lab2.write(fd, block.data(), block.size());
+    }
+    lab2.fsync(fd);
+
+    std::mt19937_64 rng(11);
+    std::vector<char> records(RECORDS * RECORD_SIZE);
+    std::vector<ReadRequest> requests(RECORDS);
+    for (auto _ : state) {
+        for (size_t i = 0; i < RECORDS; ++i) {
+            off_t offset = static_cast<off_t>(rng() % (FILE_BLOCKS * BENCH_BLOCK_SIZE - RECORD_SIZE));
+            requests[i] = {fd, offset, records.data() + i * RECORD_SIZE, RECORD_SIZE};
+        }
+        if (batch) {
+            benchmark::DoNotOptimize(lab2.readBatch(requests.data(), requests.size()));
+        } else {
+            for (ReadRequest& request : requests) {
+                benchmark::DoNotOptimize(lab2.pread(fd, request.buffer, request.length, request.offset));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(RECORDS));
+
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK_CAPTURE(BM_Lab2_RecordFetch, pread, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_RecordFetch, batch, true)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// Scanning a cached 8 MiB file: pread() into a buffer; a fresh map() per pass,
+// whose pages fault in from the cache (one fault per block, the rest by
+// read-around); or one map() kept across passes, read in place.
+enum class ScanMode { PREAD, MAP_EACH_PASS, MAP_ONCE };
+
+static void BM_Lab2_MappedScan(benchmark::State& state, ScanMode mode) {
+    constexpr size_t BLOCK_SIZE = 256 * 1024;
+    constexpr size_t FILE_BLOCKS = 32;
+    constexpr size_t FILE_SIZE = FILE_BLOCKS * BLOCK_SIZE;
+    constexpr size_t CHUNK = 64 * 1024;
+    Lab2 lab2(FILE_BLOCKS, BLOCK_SIZE);
+    const std::string path = threadFile(-5);
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(BLOCK_SIZE, 'm');
+    for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+        lab2.write(fd, buffer.data(), buffer.size());
+    }
+
+    auto sum = [](const char* data, size_t size) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < size; i += 64) {
+            total += static_cast<unsigned char>(data[i]);
+        }
+        return total;
+    };
+    Lab2::MappedView kept;
+    if (mode == ScanMode::MAP_ONCE) {
+        kept = lab2.map(fd, 0, FILE_SIZE);
+    }
+    for (auto _ : state) {
+        uint64_t total = 0;
+        if (mode == ScanMode::PREAD) {
+            for (off_t offset = 0; offset < static_cast<off_t>(FILE_SIZE); offset += CHUNK) {
+                lab2.pread(fd, buffer.data(), CHUNK, offset);
+                total += sum(buffer.data(), CHUNK);
+            }
+        } else {
+            Lab2::MappedView fresh = mode == ScanMode::MAP_EACH_PASS ? lab2.map(fd, 0, FILE_SIZE) : Lab2::MappedView();
+            const Lab2::MappedView& view = mode == ScanMode::MAP_EACH_PASS ? fresh : kept;
+            if (!view) {
+                state.SkipWithError("map() failed; userfaultfd may not be available");
+                break;
+            }
+            total = sum(view.data(), view.size());
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(FILE_SIZE));
+
+    kept.unmap();
+    lab2.close(fd);
+    std::filesystem::remove(path);
+}
+BENCHMARK_CAPTURE(BM_Lab2_MappedScan, pread, ScanMode::PREAD)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_MappedScan, map_each_pass, ScanMode::MAP_EACH_PASS)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_MappedScan, map_once, ScanMode::MAP_ONCE)->UseRealTime();
+
+//------------------------------------------------------------------------------
+// A 16 MiB file of which one block in 16 holds data, the rest zeros: written
+// and fsync()ed, then read back cold, with CacheConfig::sparseFiles on and off.
+static void BM_Lab2_SparseFile(benchmark::State& state, bool sparse, bool write) {
+    constexpr size_t FILE_BLOCKS = 4096;
+    // A mostly-hole image: 64 KiB of data in every MiB
+    constexpr size_t DATA_EVERY = 256;
+    constexpr size_t DATA_RUN = 16;
+    CacheConfig config;
+    config.capacity = FILE_BLOCKS;
+    config.blockSize = BENCH_BLOCK_SIZE;
+    config.maxIdleFiles = 0; // close() drops the blocks, so every read pass starts cold
+    config.sparseFiles = sparse;
+    Lab2 lab2(config);
+    const std::string path = threadFile(-6);
+    std::vector<char> data(BENCH_BLOCK_SIZE, 's');
+    const std::vector<char> zeros(BENCH_BLOCK_SIZE, 0);
+    auto writeFile = [&] {
+        fd_t fd = lab2.open(path);
+        for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+            lab2.write(fd, (b % DATA_EVERY < DATA_RUN ? data : zeros).data(), BENCH_BLOCK_SIZE);
+        }
+        lab2.fsync(fd);
+        lab2.close(fd);
+    };
+    if (!write) {
+        writeFile();
+    }
+
+    for (auto _ : state) {
+        if (write) {
+            state.PauseTiming();
+            std::filesystem::remove(path);
+            state.ResumeTiming();
+            writeFile();
+            continue;
+        }
+        fd_t fd = lab2.open(path);
+        for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+            benchmark::DoNotOptimize(lab2.read(fd, data.data(), BENCH_BLOCK_SIZE));
+        }
+        lab2.close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(FILE_BLOCKS * BENCH_BLOCK_SIZE));
+    std::filesystem::remove(path);
+}
+BENCHMARK_CAPTURE(BM_Lab2_SparseFile, write_dense, false, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_SparseFile, write_sparse, true, true)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_SparseFile, read_dense, false, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_SparseFile, read_sparse, true, false)->UseRealTime();
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>    // std::find, std::shuffle
+#include <cstdint>
+#include <numeric>      // std::iota
+#include <random>       // std::mt19937_64
+#include <vector>
+
+#include "ClockRing.hpp"
+
+namespace {
+
+constexpr std::int64_t MIN_CAPACITY = 8;
+constexpr std::int64_t MAX_CAPACITY = 1 << 20;
+/// The O(n^2) baseline flush does not finish in reasonable time beyond this
+constexpr std::int64_t MAX_BASELINE_FLUSH_CAPACITY = 1 << 15;
+
+/**
+ * The bookkeeping BlockCache used before ClockRing: a vector of keys in
+ * insertion order, erased from the middle on eviction and searched linearly
+ * when an fd is flushed.
+ */
+class VectorClock {
+public:
+    explicit VectorClock(std::size_t capacity) : referenced_(capacity, false) {
+        order_.reserve(capacity);
+    }
+
+    void insert(std::uint32_t key) {
+        order_.push_back(key);
+        referenced_[key] = true;
+    }
+
+    void reference(std::uint32_t key) { referenced_[key] = true; }
+
+    std::uint32_t evict() {
+        for (;;) {
+            hand_ %= order_.size();
+            std::uint32_t key = order_[hand_];
+            if (!referenced_[key]) {
+                order_.erase(order_.begin() + hand_);
+                return key;
+            }
+            referenced_[key] = false;
+            ++hand_;
+        }
+    }
+
+    void remove(std::uint32_t key) {
+        auto it = std::find(order_.begin(), order_.end(), key);
+        std::size_t index = std::distance(order_.begin(), it);
+        order_.erase(it);
+        if (index < hand_ && hand_ > 0) {
+            --hand_;
+        }
+    }
+
+private:
+    std::vector<std::uint32_t> order_;
+    std::vector<bool> referenced_;
+    std::size_t hand_ = 0;
+};
+
+std::vector<std::uint32_t> shuffledKeys(std::size_t n) {
+    std::vector<std::uint32_t> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+    return keys;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Steady-state miss: evict one block and insert a new one into the freed slot,
+// with a cache hit on a random block between misses.
+static void BM_ClockRing_EvictInsert(benchmark::State& state) {
+    const auto capacity = static_cast<std::size_t>(state.range(0));
+    ClockRing ring(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+        ring.insert();
+    }
+    std::mt19937_64 rng(1);
+
+    for (auto _ : state) {
+        ring.reference(rng() % capacity);
+        std::size_t victim = ring.nextVictim();
+        ring.remove(victim);
+        benchmark::DoNotOptimize(ring.insert());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClockRing_EvictInsert)->RangeMultiplier(8)->Range(MIN_CAPACITY, MAX_CAPACITY);
+
+static void BM_VectorClock_EvictInsert(benchmark::State& state) {
+    const auto capacity = static_cast<std::size_t>(state.range(0));
+    VectorClock clock(capacity);
+    for (std::uint32_t i = 0; i < capacity; ++i) {
+        clock.insert(i);
+    }
+    std::mt19937_64 rng(1);
+
+    for (auto _ : state) {
+        clock.reference(static_cast<std::uint32_t>(rng() % capacity));
+        std::uint32_t victim = clock.evict();
+        clock.insert(victim);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_VectorClock_EvictInsert)->RangeMultiplier(8)->Range(MIN_CAPACITY, MAX_CAPACITY);
+
+//------------------------------------------------------------------------------
+// flushFd(): fill the cache, then drop every block in arbitrary order.
+static void BM_ClockRing_FillAndFlush(benchmark::State& state) {
+    const auto capacity = static_cast<std::size_t>(state.range(0));
+    ClockRing ring(capacity);
+    std::vector<std::uint32_t> order = shuffledKeys(capacity);
+    std::vector<std::size_t> slots(capacity);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            slots[i] = ring.insert();
+        }
+        for (std::uint32_t key : order) {
+            ring.remove(slots[key]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(capacity));
+}
+BENCHMARK(BM_ClockRing_FillAndFlush)->RangeMultiplier(8)->Range(MIN_CAPACITY, MAX_CAPACITY);
+
+static void BM_VectorClock_FillAndFlush(benchmark::State& state) {
+    const auto capacity = static_cast<std::size_t>(state.range(0));
+    VectorClock clock(capacity);
+    std::vector<std::uint32_t> order = shuffledKeys(capacity);
+
+    for (auto _ : state) {
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            clock.insert(i);
+        }
+        for (std::uint32_t key : order) {
+            clock.remove(key);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(capacity));
+}
+BENCHMARK(BM_VectorClock_FillAndFlush)->RangeMultiplier(8)->Range(MIN_CAPACITY, MAX_BASELINE_FLUSH_CAPACITY);
@@ -0,0 +1,256 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>      // open, O_DIRECT
+#include <unistd.h>     // pread, pwrite, fsync, close, getpid
+#include <algorithm>    // std::max, std::nth_element
+#include <chrono>       // std::chrono::steady_clock
+#include <cstdlib>      // posix_memalign, free
+#include <filesystem>   // std::filesystem::temp_directory_path, remove
+#include <fstream>      // std::ofstream
+#include <map>
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937_64
+#include <string>
+#include <vector>
+
+#include "lab2_library.hpp"
+
+// Lab2 against the two things it replaces: O_DIRECT pread/pwrite with no
+// cache at all, and plain buffered I/O through the kernel page cache (warm,
+// since the file was just written). Files go to the temporary directory, so
+// TMPDIR picks the file system, e.g. a tmpfs or a local disk.
+
+namespace {
+
+constexpr size_t MIN_CAPACITY = 4;
+/// Writes between two fsyncs in the write benchmark
+constexpr int WRITES_PER_FSYNC = 64;
+
+enum class Engine { LAB2, DIRECT, BUFFERED };
+enum class Pattern { SEQUENTIAL, RANDOM };
+
+/// Shared by the threads of one benchmark run, set up by setupRun()
+struct Run {
+    std::unique_ptr<Lab2> lab2;
+    int fd = -1;
+    size_t ioSize = 0;
+    size_t fileBytes = 0;
+} run;
+
+/// Test files by size, created on first use and removed at exit
+const std::string& fileOfSize(size_t bytes) {
+    static struct Files {
+        std::map<size_t, std::string> paths;
+        ~Files() {
+            for (const auto& [bytes, path] : paths) {
+                std::filesystem::remove(path);
+            }
+        }
+    } files;
+    auto it = files.paths.find(bytes);
+    if (it != files.paths.end()) {
+        return it->second;
+    }
+    std::string path = (std::filesystem::temp_directory_path()
+                        / ("lab2_bench_cmp_" + std::to_string(::getpid()) + "_" + std::to_string(bytes))).string();
+    std::ofstream out(path, std::ios::binary);
+    std::vector<char> chunk(1 << 20, 'c');
+    for (size_t written = 0; written < bytes; written += chunk.size()) {
+        out.write(chunk.data(), static_cast<std::streamsize>(std::min(chunk.size(), bytes - written)));
+    }
+    return files.paths.emplace(bytes, std::move(path)).first->second;
+}
+
+/// Arguments: I/O size (also Lab2's block size), working set in percent of the
+/// cache, and the cache size in MiB: Lab2's pool. The page cache is not limited.
+template <Engine engine>
+void setupRun(const benchmark::State& state) {
+    run.ioSize = static_cast<size_t>(state.range(0));
+    const size_t cacheBytes = static_cast<size_t>(state.range(2)) << 20;
+    const size_t capacity = std::max(cacheBytes / run.ioSize, MIN_CAPACITY);
+    run.fileBytes = capacity * run.ioSize * static_cast<size_t>(state.range(1)) / 100;
+    const std::string& path = fileOfSize(run.fileBytes);
+    switch (engine) {
+    case Engine::LAB2: {
+        CacheConfig config;
+        config.capacity = capacity;
+        config.blockSize = run.ioSize;
+        run.lab2 = std::make_unique<Lab2>(config);
+        run.fd = run.lab2->open(path);
+        break;
+    }
+    case Engine::DIRECT:
+        run.fd = ::open(path.c_str(), O_RDWR | O_DIRECT);
+        break;
+    case Engine::BUFFERED:
+        run.fd = ::open(path.c_str(), O_RDWR);
+        break;
+    }
+}
+
+template <Engine engine>
+void teardownRun(const benchmark::State&) {
+    if (engine == Engine::LAB2) {
+        run.lab2->close(run.fd);
+        run.lab2.reset();
+    } else {
+        ::close(run.fd);
+    }
+    run.fd = -1;
+}
+
+/// Aligned for O_DIRECT, whatever the engine
+struct IoBuffer {
+    explicit IoBuffer(size_t size) {
+        if (::posix_memalign(&data, 4096, size) != 0) {
+            data = nullptr;
+        }
+    }
+    ~IoBuffer() { std::free(data); }
+    void* data = nullptr;
+};
+
+template <Engine engine>
+ssize_t readAt(void* buffer, off_t offset) {
+    if (engine == Engine::LAB2) {
+        return run.lab2->pread(run.fd, buffer, run.ioSize, offset);
+    }
+    return ::pread(run.fd, buffer, run.ioSize, offset);
+}
+
+template <Engine engine>
+ssize_t writeAt(const void* buffer, off_t offset) {
+    if (engine == Engine::LAB2) {
+        return run.lab2->pwrite(run.fd, buffer, run.ioSize, offset);
+    }
+    return ::pwrite(run.fd, buffer, run.ioSize, offset);
+}
+
+template <Engine engine>
+int syncFile() {
+    return engine == Engine::LAB2 ? run.lab2->fsync(run.fd) : ::fsync(run.fd);
+}
+
+/// Sets the p50 and p99 counters, averaged over threads, from per-call latencies
+void reportLatency(benchmark::State& state, std::vector<double>& latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    auto at = [&](size_t percent) {
+        auto it = latencies.begin() + static_cast<std::ptrdiff_t>(latencies.size() * percent / 100);
+        std::nth_element(latencies.begin(), it, latencies.end());
+        return *it;
+    };
+    state.counters["p50_us"] = benchmark::Counter(at(50), benchmark::Counter::kAvgThreads);
+    state.counters["p99_us"] = benchmark::Counter(at(99), benchmark::Counter::kAvgThreads);
+}
+
+/// Cache sizes in MiB that every benchmark sweeps
+constexpr int64_t CACHE_MIB[] = {4, 16, 64};
+
+void readArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"io", "ws_pct", "cache_mib"});
+    for (int64_t cacheMib : CACHE_MIB) {
+        for (int64_t ioSize = 4 << 10; ioSize <= 4 << 20; ioSize *= 4) {
+            // Fits in the cache, and four times as large
+            benchmark->Args({ioSize, 50, cacheMib});
+            benchmark->Args({ioSize, 400, cacheMib});
+        }
+    }
+    benchmark->Threads(1)->Threads(4)->UseRealTime();
+}
+
+void writeArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"io", "ws_pct", "cache_mib"});
+    for (int64_t cacheMib : CACHE_MIB) {
+        for (int64_t ioSize = 4 << 10; ioSize <= 4 << 20; ioSize *= 4) {
+            benchmark->Args({ioSize, 50, cacheMib});
+        }
+    }
+    benchmark->UseRealTime();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// pread() of one I/O size per iteration over a file that fits in the cache or
+// is four times larger. Sequential threads each scan their own part of the
+// file; random ones read aligned units anywhere in it.
+template <Engine engine, Pattern pattern>
+static void BM_Compare_Read(benchmark::State& state) {
+    if (run.fd < 0) {
+        state.SkipWithError("open failed");
+        return;
+    }
+    IoBuffer buffer(run.ioSize);
+    const size_t units = run.fileBytes / run.ioSize;
+    const size_t threadUnits = std::max<size_t>(units / static_cast<size_t>(state.threads()), 1);
+    size_t unit = static_cast<size_t>(state.thread_index()) * threadUnits % units;
+    std::mt19937_64 rng(static_cast<uint64_t>(state.thread_index()) + 1);
+    std::vector<double> latencies;
+    for (auto _ : state) {
+        if (pattern == Pattern::RANDOM) {
+            unit = rng() % units;
+        }
+        auto start = std::chrono::steady_clock::now();
+        ssize_t result = readAt<engine>(buffer.data, static_cast<off_t>(unit * run.ioSize));
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (result < 0) {
+            state.SkipWithError("read failed");
+            break;
+        }
+        if (pattern == Pattern::SEQUENTIAL) {
+            unit = (unit + 1) % units;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(run.ioSize));
+    reportLatency(state, latencies);
+}
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::LAB2, Pattern::SEQUENTIAL)
+    ->Apply(readArgs)->Setup(setupRun<Engine::LAB2>)->Teardown(teardownRun<Engine::LAB2>);
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::DIRECT, Pattern::SEQUENTIAL)
+    ->Apply(readArgs)->Setup(setupRun<Engine::DIRECT>)->Teardown(teardownRun<Engine::DIRECT>);
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::BUFFERED, Pattern::SEQUENTIAL)
+    ->Apply(readArgs)->Setup(setupRun<Engine::BUFFERED>)->Teardown(teardownRun<Engine::BUFFERED>);
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::LAB2, Pattern::RANDOM)
+    ->Apply(readArgs)->Setup(setupRun<Engine::LAB2>)->Teardown(teardownRun<Engine::LAB2>);
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::DIRECT, Pattern::RANDOM)
+    ->Apply(readArgs)->Setup(setupRun<Engine::DIRECT>)->Teardown(teardownRun<Engine::DIRECT>);
+BENCHMARK_TEMPLATE(BM_Compare_Read, Engine::BUFFERED, Pattern::RANDOM)
+    ->Apply(readArgs)->Setup(setupRun<Engine::BUFFERED>)->Teardown(teardownRun<Engine::BUFFERED>);
+
+//------------------------------------------------------------------------------
+// Random pwrite() of one I/O size per iteration, with an fsync() every
+// WRITES_PER_FSYNC writes, so the numbers include getting the data to disk.
+template <Engine engine>
+static void BM_Compare_WriteFsync(benchmark::State& state) {
+    if (run.fd < 0) {
+        state.SkipWithError("open failed");
+        return;
+    }
+    IoBuffer buffer(run.ioSize);
+    std::fill_n(static_cast<char*>(buffer.data), run.ioSize, 'w');
+    const size_t units = run.fileBytes / run.ioSize;
+    std::mt19937_64 rng(3);
+    std::vector<double> latencies;
+    int writes = 0;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        ssize_t result = writeAt<engine>(buffer.data, static_cast<off_t>(rng() % units * run.ioSize));
+        if (++writes % WRITES_PER_FSYNC == 0 && syncFile<engine>() < 0) {
+            result = -1;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (result < 0) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(run.ioSize));
+    reportLatency(state, latencies);
+}
+BENCHMARK_TEMPLATE(BM_Compare_WriteFsync, Engine::LAB2)
+    ->Apply(writeArgs)->Setup(setupRun<Engine::LAB2>)->Teardown(teardownRun<Engine::LAB2>);
+BENCHMARK_TEMPLATE(BM_Compare_WriteFsync, Engine::DIRECT)
+    ->Apply(writeArgs)->Setup(setupRun<Engine::DIRECT>)->Teardown(teardownRun<Engine::DIRECT>);
+BENCHMARK_TEMPLATE(BM_Compare_WriteFsync, Engine::BUFFERED)
+    ->Apply(writeArgs)->Setup(setupRun<Engine::BUFFERED>)->Teardown(teardownRun<Engine::BUFFERED>);
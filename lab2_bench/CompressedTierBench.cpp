@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>      // int64_t
+#include <filesystem>   // std::filesystem::temp_directory_path, remove
+#include <iterator>     // std::size
+#include <random>       // std::mt19937
+#include <string>
+#include <unistd.h>     // getpid
+#include <vector>
+
+#include "Compression.hpp"
+#include "lab2_library.hpp"
+
+namespace {
+
+constexpr size_t TIER_BLOCK_SIZE = 256 * 1024;
+constexpr size_t TIER_FILE_BLOCKS = 32; // 8 MiB
+constexpr size_t TIER_CACHE_BLOCKS = 16;
+
+/// Log-like text: compresses about 3:1, like the data the tier is meant for
+std::vector<char> textData(size_t size) {
+    static const char* const WORDS[] = {"GET", "POST", "/index.html", "/api/v1/items", "200", "404", "user=",
+                                        "session=", "latency_ms=", "host=", "lab2", "\n"};
+    std::mt19937 rng(1);
+    std::vector<char> data;
+    data.reserve(size);
+    while (data.size() < size) {
+        const std::string word = std::string(WORDS[rng() % std::size(WORDS)]) + std::to_string(rng() % 1000) + ' ';
+        data.insert(data.end(), word.begin(), word.end());
+    }
+    data.resize(size);
+    return data;
+}
+
+std::vector<char> randomData(size_t size) {
+    std::mt19937 rng(2);
+    std::vector<char> data(size);
+    for (char& c : data) {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+const std::string TIER_FILE = (std::filesystem::temp_directory_path()
+                               / ("lab2_bench_tier_" + std::to_string(::getpid()))).string();
+
+/// Creates the file once per process
+const std::string& tierFile() {
+    static const bool created = [] {
+        Lab2 lab2(8, TIER_BLOCK_SIZE);
+        fd_t fd = lab2.open(TIER_FILE);
+        const std::vector<char> block = textData(TIER_BLOCK_SIZE);
+        for (size_t b = 0; b < TIER_FILE_BLOCKS; ++b) {
+            lab2.write(fd, block.data(), block.size());
+        }
+        lab2.close(fd);
+        return true;
+    }();
+    (void) created;
+    return TIER_FILE;
+}
+
+// Defined after TIER_FILE, so that it goes first on exit
+struct TierFileCleanup {
+    ~TierFileCleanup() { std::filesystem::remove(TIER_FILE); }
+} tierFileCleanup;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Codec throughput on one 4 MiB block, text and incompressible (where the
+// tier gives up once the output passes 3/4 of the input).
+static void BM_Compress(benchmark::State& state) {
+    const std::vector<char> block = state.range(0) != 0 ? textData(LAB2_BLOCK_SIZE) : randomData(LAB2_BLOCK_SIZE);
+    std::vector<unsigned char> out(LAB2_BLOCK_SIZE * 3 / 4);
+    size_t size = 0;
+    for (auto _ : state) {
+        size = compressBlock(block.data(), block.size(), out.data(), out.size());
+        benchmark::DoNotOptimize(size);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(LAB2_BLOCK_SIZE));
+    state.counters["ratio"] = size == 0 ? 0.0 : static_cast<double>(LAB2_BLOCK_SIZE) / static_cast<double>(size);
+    state.SetLabel(compressionCodec());
+}
+BENCHMARK(BM_Compress)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+
+static void BM_Decompress(benchmark::State& state) {
+    const std::vector<char> block = textData(LAB2_BLOCK_SIZE);
+    std::vector<unsigned char> compressed(compressBound(block.size()));
+    compressed.resize(compressBlock(block.data(), block.size(), compressed.data(), compressed.size()));
+    std::vector<char> out(LAB2_BLOCK_SIZE);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decompressBlock(compressed.data(), compressed.size(), out.data(), out.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(LAB2_BLOCK_SIZE));
+    state.SetLabel(compressionCodec());
+}
+BENCHMARK(BM_Decompress)->Unit(benchmark::kMillisecond);
+
+// Cyclic re-reads of a working set twice the size of the cache, without and
+// with a compressed tier as large as the cache; the argument is the tier
+// size in blocks.
+static void BM_Lab2_WorkingSetTwiceTheCache(benchmark::State& state) {
+    CacheConfig config;
+    config.capacity = TIER_CACHE_BLOCKS;
+    config.blockSize = TIER_BLOCK_SIZE;
+    config.compressedTierBytes = static_cast<size_t>(state.range(0)) * TIER_BLOCK_SIZE;
+    Lab2 lab2(config);
+    fd_t fd = lab2.open(tierFile());
+    std::vector<char> buffer(TIER_BLOCK_SIZE);
+    auto pass = [&] {
+        for (size_t b = 0; b < TIER_FILE_BLOCKS; ++b) {
+            benchmark::DoNotOptimize(lab2.pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(b * TIER_BLOCK_SIZE)));
+        }
+    };
+    pass(); // Warm up
+    const CacheStats before = lab2.stats();
+    for (auto _ : state) {
+        pass();
+    }
+    const CacheStats after = lab2.stats();
+    lab2.close(fd);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(TIER_FILE_BLOCKS * TIER_BLOCK_SIZE));
+    state.counters["disk_MiB_per_pass"] = static_cast<double>(after.bytesRead - before.bytesRead)
+                                          / static_cast<double>(state.iterations()) / (1024.0 * 1024.0);
+}
+BENCHMARK(BM_Lab2_WorkingSetTwiceTheCache)->Arg(0)->Arg(TIER_CACHE_BLOCKS)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>      // uint64_t
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937_64
+#include <unordered_map>
+#include <vector>
+
+#include "EvictionPolicy.hpp"
+
+namespace {
+
+constexpr size_t TRACE_CAPACITY = 1024;
+constexpr off_t TRACE_HOT_BLOCKS = 256;
+
+/**
+ * Hot set plus scans: phases of 4096 accesses, four in five to a random block
+ * of the hot set and the rest to blocks never seen again, each followed by a
+ * sequential scan of scanFactor times the cache.
+ */
+std::vector<off_t> scanHotsetTrace(size_t scanFactor) {
+    std::mt19937_64 rng(17);
+    std::vector<off_t> trace;
+    off_t cold = TRACE_HOT_BLOCKS;
+    for (int phase = 0; phase < 32; ++phase) {
+        for (int i = 0; i < 4096; ++i) {
+            trace.push_back(rng() % 5 != 0 ? static_cast<off_t>(rng() % TRACE_HOT_BLOCKS) : cold++);
+        }
+        for (size_t i = 0; i < scanFactor * TRACE_CAPACITY; ++i) {
+            trace.push_back(cold++);
+        }
+    }
+    return trace;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Replays the trace against one policy the way BlockCache drives it (no I/O)
+// and reports the hit ratio, overall and for the hot set alone. The argument
+// is the scan length in cache sizes; 0 leaves only the one-off blocks.
+static void BM_EvictionPolicy_ScanHotset(benchmark::State& state, EvictionPolicy::Kind kind) {
+    const std::vector<off_t> trace = scanHotsetTrace(static_cast<size_t>(state.range(0)));
+    uint64_t hits = 0;
+    uint64_t hotAccesses = 0;
+    uint64_t hotHits = 0;
+    for (auto _ : state) {
+        std::unique_ptr<EvictionPolicy> policy = EvictionPolicy::create(kind, TRACE_CAPACITY);
+        std::vector<CacheKey> keys(TRACE_CAPACITY);
+        std::unordered_map<CacheKey, size_t> slots;
+        slots.reserve(TRACE_CAPACITY);
+        hits = hotAccesses = hotHits = 0;
+        for (off_t block : trace) {
+            CacheKey key{0, block};
+            bool hot = block < TRACE_HOT_BLOCKS;
+            hotAccesses += hot;
+            auto it = slots.find(key);
+            if (it != slots.end()) {
+                policy->reference(it->second);
+                ++hits;
+                hotHits += hot;
+                continue;
+            }
+            size_t slot = policy->insert(key);
+            if (slot == EvictionPolicy::npos) {
+                slot = policy->nextVictim();
+                slots.erase(keys[slot]);
+                policy->replace(slot, key);
+            }
+            keys[slot] = key;
+            slots.emplace(key, slot);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(trace.size()));
+    state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(trace.size());
+    state.counters["hot_hit_ratio"] = static_cast<double>(hotHits) / static_cast<double>(hotAccesses);
+}
+BENCHMARK_CAPTURE(BM_EvictionPolicy_ScanHotset, clock, EvictionPolicy::Kind::CLOCK)->ArgName("scan")->Arg(0)->Arg(2);
+BENCHMARK_CAPTURE(BM_EvictionPolicy_ScanHotset, two_q, EvictionPolicy::Kind::TWO_Q)->ArgName("scan")->Arg(0)->Arg(2);
+BENCHMARK_CAPTURE(BM_EvictionPolicy_ScanHotset, arc, EvictionPolicy::Kind::ARC)->ArgName("scan")->Arg(0)->Arg(2);
+BENCHMARK_CAPTURE(BM_EvictionPolicy_ScanHotset, lru_k, EvictionPolicy::Kind::LRU_K)->ArgName("scan")->Arg(0)->Arg(2);
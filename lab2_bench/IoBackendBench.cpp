@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>      // open, O_DIRECT
+#include <unistd.h>     // close, getpid
+#include <filesystem>   // std::filesystem::temp_directory_path, remove
+#include <fstream>      // std::ofstream
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937_64
+#include <string>
+#include <vector>
+
+#include "BlockPool.hpp"
+#include "IoBackend.hpp"
+
+namespace {
+
+constexpr size_t BENCH_BLOCK_SIZE = 4096;
+constexpr size_t FILE_BLOCKS = 16384;   // 64 MiB
+constexpr size_t MAX_QUEUE_DEPTH = 64;
+
+/// Random-read target, created once and removed at exit
+const std::string& benchFile() {
+    static const struct File {
+        std::string path = (std::filesystem::temp_directory_path()
+                            / ("lab2_bench_io_" + std::to_string(::getpid()))).string();
+        File() {
+            std::ofstream out(path, std::ios::binary);
+            std::vector<char> block(BENCH_BLOCK_SIZE, 'x');
+            for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+                out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            }
+        }
+        ~File() { std::filesystem::remove(path); }
+    } file;
+    return file.path;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Random 4 KiB O_DIRECT reads, submitted in batches of the queue depth.
+// The sync backend is the one-at-a-time baseline.
+static void BM_IoBackend_RandomRead(benchmark::State& state, IoBackend::Kind kind) {
+    const auto queueDepth = static_cast<size_t>(state.range(0));
+    int fd = ::open(benchFile().c_str(), O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        state.SkipWithError("O_DIRECT open failed");
+        return;
+    }
+    BlockPool buffers(queueDepth, BENCH_BLOCK_SIZE, BlockPool::PageMode::NORMAL);
+    std::unique_ptr<IoBackend> io = IoBackend::create(kind, queueDepth, buffers.buffer(0),
+                                                      buffers.count() * buffers.stride());
+    state.SetLabel(io->name());
+
+    std::vector<IoRequest> requests(queueDepth);
+    std::mt19937_64 rng(42);
+    for (auto _ : state) {
+        for (size_t i = 0; i < queueDepth; ++i) {
+            off_t block = static_cast<off_t>(rng() % FILE_BLOCKS);
+            requests[i] = {IoRequest::Op::READ, fd, buffers.buffer(i), BENCH_BLOCK_SIZE,
+                           block * static_cast<off_t>(BENCH_BLOCK_SIZE)};
+        }
+        io->execute(requests.data(), requests.size());
+        benchmark::DoNotOptimize(requests.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(queueDepth));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(queueDepth * BENCH_BLOCK_SIZE));
+
+    ::close(fd);
+}
+BENCHMARK_CAPTURE(BM_IoBackend_RandomRead, sync, IoBackend::Kind::SYNC)
+    ->RangeMultiplier(2)->Range(1, MAX_QUEUE_DEPTH)->UseRealTime();
+BENCHMARK_CAPTURE(BM_IoBackend_RandomRead, threads, IoBackend::Kind::THREAD_POOL)
+    ->RangeMultiplier(2)->Range(1, MAX_QUEUE_DEPTH)->UseRealTime();
+BENCHMARK_CAPTURE(BM_IoBackend_RandomRead, io_uring, IoBackend::Kind::IO_URING)
+    ->RangeMultiplier(2)->Range(1, MAX_QUEUE_DEPTH)->UseRealTime();
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>      // uint64_t
+#include <cstdlib>      // posix_memalign, free
+#include <fcntl.h>      // open, O_DIRECT
+#include <filesystem>   // std::filesystem::temp_directory_path, remove
+#include <span>         // std::span
+#include <string>
+#include <unistd.h>     // pread, close
+#include <vector>
+
+#include "lab2_library.hpp"
+
+namespace {
+
+constexpr size_t SCAN_BLOCK_SIZE = 256 * 1024;
+constexpr size_t SCAN_FILE_BLOCKS = 256; // 64 MiB
+constexpr size_t SCAN_CACHE_BLOCKS = 64;
+
+/// Creates the scanned file once per process
+const std::string& scanFile() {
+    static const std::string path = [] {
+        std::string p = (std::filesystem::temp_directory_path()
+                         / ("lab2_bench_scan_" + std::to_string(::getpid()))).string();
+        Lab2 lab2(8, SCAN_BLOCK_SIZE);
+        fd_t fd = lab2.open(p);
+        std::vector<char> block(SCAN_BLOCK_SIZE, 's');
+        for (size_t b = 0; b < SCAN_FILE_BLOCKS; ++b) {
+            lab2.write(fd, block.data(), block.size());
+        }
+        lab2.close(fd);
+        return p;
+    }();
+    return path;
+}
+
+struct ScanFileCleanup {
+    ~ScanFileCleanup() { std::filesystem::remove(scanFile()); }
+} scanFileCleanup;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Full sequential scan through Lab2 (readahead on), 64 KiB reads.
+static void BM_Lab2_SequentialScan(benchmark::State& state) {
+    const size_t readSize = 64 * 1024;
+    std::vector<char> buffer(readSize);
+    for (auto _ : state) {
+        Lab2 lab2(SCAN_CACHE_BLOCKS, SCAN_BLOCK_SIZE);
+        fd_t fd = lab2.open(scanFile());
+        for (size_t offset = 0; offset < SCAN_FILE_BLOCKS * SCAN_BLOCK_SIZE; offset += readSize) {
+            benchmark::DoNotOptimize(lab2.read(fd, buffer.data(), readSize));
+        }
+        lab2.close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(SCAN_FILE_BLOCKS * SCAN_BLOCK_SIZE));
+}
+BENCHMARK(BM_Lab2_SequentialScan)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The same scan feeding a byte-sum "parser", through read() into a buffer or
+// straight from the cache through acquireRead() views.
+static void BM_Lab2_ScanChecksum(benchmark::State& state, bool views) {
+    const size_t readSize = 64 * 1024;
+    std::vector<char> buffer(readSize);
+    for (auto _ : state) {
+        Lab2 lab2(SCAN_CACHE_BLOCKS, SCAN_BLOCK_SIZE);
+        fd_t fd = lab2.open(scanFile());
+        uint64_t sum = 0;
+        for (size_t offset = 0; offset < SCAN_FILE_BLOCKS * SCAN_BLOCK_SIZE; offset += readSize) {
+            if (views) {
+                Lab2::ReadView view = lab2.acquireRead(fd, static_cast<off_t>(offset), readSize);
+                for (std::span<const char> span : view.spans()) {
+                    for (char c : span) {
+                        sum += static_cast<unsigned char>(c);
+                    }
+                }
+            } else {
+                ssize_t n = lab2.read(fd, buffer.data(), readSize);
+                for (ssize_t i = 0; i < n; ++i) {
+                    sum += static_cast<unsigned char>(buffer[i]);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        lab2.close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(SCAN_FILE_BLOCKS * SCAN_BLOCK_SIZE));
+}
+BENCHMARK_CAPTURE(BM_Lab2_ScanChecksum, copy, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Lab2_ScanChecksum, view, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Baseline: raw O_DIRECT pread of whole blocks, one at a time.
+static void BM_RawODirect_SequentialScan(benchmark::State& state) {
+    void* raw = nullptr;
+    if (::posix_memalign(&raw, 4096, SCAN_BLOCK_SIZE) != 0) {
+        state.SkipWithError("posix_memalign failed");
+        return;
+    }
+    for (auto _ : state) {
+        int fd = ::open(scanFile().c_str(), O_RDONLY | O_DIRECT);
+        for (size_t b = 0; b < SCAN_FILE_BLOCKS; ++b) {
+            benchmark::DoNotOptimize(::pread(fd, raw, SCAN_BLOCK_SIZE, static_cast<off_t>(b * SCAN_BLOCK_SIZE)));
+        }
+        ::close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(SCAN_FILE_BLOCKS * SCAN_BLOCK_SIZE));
+    std::free(raw);
+}
+BENCHMARK(BM_RawODirect_SequentialScan)->Unit(benchmark::kMillisecond)->UseRealTime();
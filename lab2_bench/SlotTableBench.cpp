@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>       // std::mt19937_64
+#include <unordered_map>
+#include <vector>
+
+#include "SlotTable.hpp"
+
+namespace {
+
+/// Buckets in the SlotTable under test; keys fill a state.range(0) percent of them
+constexpr std::size_t BUCKETS = 1 << 16;
+constexpr std::size_t LOOKUPS = 1 << 12;
+
+/// The keys BlockCache sees: a few files, blocks scattered over each
+std::vector<CacheKey> randomKeys(std::size_t n, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<CacheKey> keys(n);
+    for (CacheKey& key : keys) {
+        key = {static_cast<int>(3 + rng() % 8), static_cast<off_t>(rng() % (1u << 30))};
+    }
+    return keys;
+}
+
+std::size_t keysAt(const benchmark::State& state) {
+    return BUCKETS * static_cast<std::size_t>(state.range(0)) / 100;
+}
+
+/**
+ * Fills the table to the occupancy asked for, then looks up LOOKUPS keys per
+ * iteration: ones it holds when hit is set, fresh ones otherwise.
+ */
+template <typename Table, typename Insert, typename Find>
+void lookups(benchmark::State& state, Table& table, bool hit, Insert insert, Find find) {
+    std::vector<CacheKey> keys = randomKeys(keysAt(state), 1);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        insert(table, keys[i], i);
+    }
+    std::vector<CacheKey> probes = hit ? keys : randomKeys(keys.size(), 2);
+    probes.resize(LOOKUPS, probes.front());
+    std::mt19937_64 rng(3);
+    for (std::size_t i = probes.size(); i > 1; --i) {
+        std::swap(probes[i - 1], probes[rng() % i]);
+    }
+
+    for (auto _ : state) {
+        for (const CacheKey& key : probes) {
+            benchmark::DoNotOptimize(find(table, key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(probes.size()));
+}
+
+void slotTableLookups(benchmark::State& state, bool hit) {
+    // Rounds up to BUCKETS; even 87% stays under the 7/8 growth limit
+    SlotTable table(BUCKETS / 2);
+    lookups(state, table, hit,
+            [](SlotTable& t, const CacheKey& key, std::size_t slot) { t.insert(key, slot); },
+            [](const SlotTable& t, const CacheKey& key) { return t.find(key); });
+    state.counters["buckets"] = static_cast<double>(table.bucketCount());
+}
+
+void unorderedMapLookups(benchmark::State& state, bool hit) {
+    std::unordered_map<CacheKey, std::size_t> table;
+    table.reserve(keysAt(state));
+    lookups(state, table, hit,
+            [](auto& t, const CacheKey& key, std::size_t slot) { t.emplace(key, slot); },
+            [](const auto& t, const CacheKey& key) {
+                auto it = t.find(key);
+                return it == t.end() ? SlotTable::npos : it->second;
+            });
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Lookup cost per key at 25-87% occupancy of a 64K-entry table; the argument
+// is the occupancy in percent.
+static void BM_SlotTable_Hit(benchmark::State& state) {
+    slotTableLookups(state, true);
+}
+BENCHMARK(BM_SlotTable_Hit)->Arg(25)->Arg(50)->Arg(75)->Arg(87);
+
+static void BM_SlotTable_Miss(benchmark::State& state) {
+    slotTableLookups(state, false);
+}
+BENCHMARK(BM_SlotTable_Miss)->Arg(25)->Arg(50)->Arg(75)->Arg(87);
+
+static void BM_UnorderedMap_Hit(benchmark::State& state) {
+    unorderedMapLookups(state, true);
+}
+BENCHMARK(BM_UnorderedMap_Hit)->Arg(25)->Arg(50)->Arg(75)->Arg(87);
+
+static void BM_UnorderedMap_Miss(benchmark::State& state) {
+    unorderedMapLookups(state, false);
+}
+BENCHMARK(BM_UnorderedMap_Miss)->Arg(25)->Arg(50)->Arg(75)->Arg(87);
@@ -0,0 +1,52 @@
+#include "BinaryFormat.hpp"
+#include <fcntl.h>      // open
+#include <unistd.h>     // read, close
+#include <cerrno>       // errno, EINTR
+#include <stdexcept>    // runtime_error
+#include <system_error> // std::system_error
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint64_t getVarint(const std::vector<std::uint8_t>& data, std::size_t& position, const std::string& what) {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (position == data.size()) {
+            throw std::runtime_error("Truncated " + what);
+        }
+        std::uint8_t byte = data[position++];
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed varint in " + what);
+}
+
+std::vector<std::uint8_t> readWholeFile(const std::string& path, const std::string& what) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + what + " " + path);
+    }
+    std::vector<std::uint8_t> data;
+    std::uint8_t chunk[64 * 1024];
+    ssize_t result;
+    while ((result = ::read(fd, chunk, sizeof(chunk))) != 0) {
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "Cannot read " + what + " " + path);
+        }
+        data.insert(data.end(), chunk, chunk + result);
+    }
+    ::close(fd);
+    return data;
+}
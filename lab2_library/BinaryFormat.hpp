@@ -0,0 +1,31 @@
+#ifndef BINARY_FORMAT_HPP
+#define BINARY_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The encoding shared by the trace and the manifest files: LEB128 varints,
+// zigzag for values that can be negative, and files read whole into memory.
+
+/// Appends value as a LEB128 varint
+void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value);
+
+/// Decodes the varint at data[position] and moves position past it.
+/// Throws std::runtime_error naming what if the data ends or the varint is malformed.
+std::uint64_t getVarint(const std::vector<std::uint8_t>& data, std::size_t& position, const std::string& what);
+
+/// Maps small negative values to small unsigned ones, so that they stay short as varints
+inline std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+/// Reads all of path; throws std::system_error naming what if it cannot
+std::vector<std::uint8_t> readWholeFile(const std::string& path, const std::string& what);
+
+#endif // BINARY_FORMAT_HPP
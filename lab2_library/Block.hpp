@@ -1,32 +1,46 @@
 #ifndef BLOCK_HPP
 #define BLOCK_HPP
 
+#include <atomic>
 #include <cstddef>
-#include <memory>
-
+#include <sys/types.h>
+
+/**
+ * \class Block
+ * \brief One cached block: a buffer borrowed from BlockPool plus its metadata.
+ *
+ * The buffer is not owned; it stays attached to the same cache slot and is
+ * reused in place for whatever block occupies the slot next.
+ */
 class Block {
 public:
-    Block(std::size_t blockSize, off_t blockIndex);
-    ~Block();
+    Block() = default;
 
     // Accessors
-    void* data() { return data_.get(); }
-    const void* data() const { return data_.get(); }
+    void* data() { return data_; }
+    const void* data() const { return data_; }
 
-    bool isDirty() const { return dirty_; }
+    bool isDirty() const { return dirty_.load(std::memory_order_acquire); }
     off_t index() const { return blockIndex_; }
 
-    void setDirty(bool d) { dirty_ = d; }
+    void setDirty(bool d) { dirty_.store(d, std::memory_order_release); }
+    /// Sets the dirty flag; true if the block was clean before
+    bool markDirty() { return !dirty_.exchange(true, std::memory_order_acq_rel); }
+    /// Clears the dirty flag and returns its previous value. Write-back calls
+    /// this before writing, so a concurrent writer re-dirties the block.
+    bool clearDirty() { return dirty_.exchange(false, std::memory_order_acq_rel); }
+
+    /// Attaches the (aligned) buffer this block lives in
+    void attach(void* data) { data_ = static_cast<unsigned char*>(data); }
+    /// Reuses the buffer for another block. The contents are left as they
+    /// are: the caller overwrites them (pread plus zero-fill of the tail).
+    void reset(off_t blockIndex);
 
 private:
-    off_t blockIndex_;
-    bool dirty_;
-    // Aligned memory
-    std::unique_ptr<unsigned char[], void(*)(void*)> data_;
-    // Could store blockSize_ if needed
-
-    // Helper for allocation
-    static void deleter(void* p) { ::free(p); }
+    off_t blockIndex_ = -1;
+    std::atomic<bool> dirty_{false};
+    // Aligned memory, owned by BlockPool
+    unsigned char* data_ = nullptr;
 };
 
 #endif //BLOCK_HPP
@@ -1,194 +1,1273 @@
 #include "BlockCache.hpp"
-#include <unistd.h>     // pread, pwrite
 #include <fcntl.h>      // O_DIRECT, etc.
+#include <sys/stat.h>   // statx, fstat
+#include <unistd.h>     // lseek
+#include <bit>          // std::countr_zero
+#include <algorithm>    // std::min, std::max, std::sort, std::nth_element
 #include <cerrno>       // errno
 #include <cstring>      // memset, memcpy
-#include <iostream>     // debug printing, if needed
 #include <stdexcept>    // runtime_error
-#include <algorithm>    // std::remove_if
+#include <thread>       // std::this_thread::yield
+#include <chrono>       // std::chrono::steady_clock
+#include <limits>       // std::numeric_limits
+#include <numeric>      // std::iota
 
-BlockCache::BlockCache(std::size_t capacity, std::size_t blockSize)
+#include "Log.hpp"
+#include "ZeroScan.hpp"
+
+BlockCache::Handle& BlockCache::Handle::operator=(Handle&& other) noexcept {
+    if (this != &other) {
+        release();
+        cache_ = other.cache_;
+        entry_ = other.entry_;
+        lookup_ = other.lookup_;
+        other.entry_ = nullptr;
+    }
+    return *this;
+}
+
+void* BlockCache::Handle::data() const {
+    return entry_->block.data();
+}
+
+void BlockCache::Handle::markDirty() {
+    cache_->markDirty(*entry_, 0, cache_->blockSize_);
+}
+
+void BlockCache::Handle::markDirty(std::size_t offset, std::size_t length) {
+    cache_->markDirty(*entry_, offset, length);
+}
+
+void BlockCache::Handle::release() {
+    if (entry_ != nullptr) {
+        entry_->pins.fetch_sub(1, std::memory_order_release);
+        entry_ = nullptr;
+    }
+}
+
+BlockCache::BlockCache(std::size_t capacity, std::size_t blockSize,
+                       std::size_t shardCount, BlockPool::PageMode pageMode,
+                       IoBackend::Kind ioBackend, EvictionPolicy::Kind eviction)
     : capacity_(capacity)
     , blockSize_(blockSize)
+    , shardCount_(1)
+    , sectorWords_(((blockSize + SECTOR_SIZE - 1) / SECTOR_SIZE + 63) / 64)
+    , pool_(capacity, blockSize, pageMode)
+    // More transfers in flight than there are slots would never be used
+    , io_(IoBackend::create(ioBackend,
+                            std::min(IoBackend::DEFAULT_QUEUE_DEPTH, std::max<std::size_t>(capacity, 1)),
+                            pool_.buffer(0), pool_.count() * pool_.stride()))
+    , entries_(std::make_unique<CacheEntry[]>(capacity))
+    , dirtySectors_(std::make_unique<std::atomic<std::uint64_t>[]>(capacity * sectorWords_))
+    , policy_(EvictionPolicy::create(eviction, capacity))
+    , slotKeys_(capacity)
 {
-    evictionOrder_.reserve(capacity_);
+    // Shard selection masks the hash, so round the count up to a power of two
+    while (shardCount_ < shardCount) {
+        shardCount_ <<= 1;
+    }
+    shards_ = std::make_unique<Shard[]>(shardCount_);
+    for (std::size_t i = 0; i < shardCount_; ++i) {
+        shards_[i].entries = SlotTable(capacity_ / shardCount_ + 1);
+    }
+    for (std::size_t slot = 0; slot < capacity_; ++slot) {
+        entries_[slot].block.attach(pool_.buffer(slot));
+    }
+}
+
+BlockCache::Shard& BlockCache::shardFor(const CacheKey& key) {
+    // High hash bits, independent of the low ones SlotTable probes with
+    return shards_[(hashKey(key) >> 32) & (shardCount_ - 1)];
+}
+
+void BlockCache::linkFileBlock(int fd, std::size_t slot) {
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    FileBlocks& file = fileBlocks_[fd];
+    CacheEntry& entry = entries_[slot];
+    entry.filePrev = SlotTable::npos;
+    entry.fileNext = file.head;
+    if (file.head != SlotTable::npos) {
+        entries_[file.head].filePrev = slot;
+    }
+    file.head = slot;
+    ++file.count;
+}
+
+void BlockCache::unlinkFileBlock(int fd, std::size_t slot) {
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    auto it = fileBlocks_.find(fd);
+    CacheEntry& entry = entries_[slot];
+    if (entry.filePrev != SlotTable::npos) {
+        entries_[entry.filePrev].fileNext = entry.fileNext;
+    } else {
+        it->second.head = entry.fileNext;
+    }
+    if (entry.fileNext != SlotTable::npos) {
+        entries_[entry.fileNext].filePrev = entry.filePrev;
+    }
+    entry.filePrev = entry.fileNext = SlotTable::npos;
+    if (--it->second.count == 0) {
+        fileBlocks_.erase(it);
+    }
+}
+
+void BlockCache::fileBlocksIn(int fd, off_t firstBlock, off_t lastBlock, std::vector<off_t>& blocks) {
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    auto it = fileBlocks_.find(fd);
+    if (it == fileBlocks_.end()) {
+        return;
+    }
+    if (lastBlock - firstBlock < static_cast<off_t>(it->second.count)) {
+        // Short range: cheaper to look up every block than to walk the list
+        for (off_t blockIndex = firstBlock; blockIndex <= lastBlock; ++blockIndex) {
+            blocks.push_back(blockIndex);
+        }
+        return;
+    }
+    for (std::size_t slot = it->second.head; slot != SlotTable::npos; slot = entries_[slot].fileNext) {
+        const off_t blockIndex = entries_[slot].block.index();
+        if (blockIndex >= firstBlock && blockIndex <= lastBlock) {
+            blocks.push_back(blockIndex);
+        }
+    }
+}
+
+BlockCache::Handle BlockCache::pinOnly(std::size_t slot) {
+    CacheEntry& entry = entries_[slot];
+    entry.pins.fetch_add(1, std::memory_order_acquire);
+    return Handle(this, &entry, Lookup::MISS);
+}
+
+BlockCache::Handle BlockCache::pinLocked(std::size_t slot, Lookup lookup, bool reference) {
+    CacheEntry& entry = entries_[slot];
+    entry.pins.fetch_add(1, std::memory_order_acquire);
+    if (lookup != Lookup::MISS && entry.prefetched.exchange(false, std::memory_order_relaxed)) {
+        lookup = Lookup::READAHEAD_HIT;
+        readaheadCounters_.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (reference) {
+        policy_->reference(slot);
+    }
+    return Handle(this, &entry, lookup);
 }
 
-bool BlockCache::readBlock(int fd, off_t blockIndex) {
+void BlockCache::dropPrefetched(CacheEntry& entry) {
+    if (entry.prefetched.exchange(false, std::memory_order_relaxed)) {
+        readaheadCounters_.wasted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+BlockCache::Handle BlockCache::acquire(int fd, off_t blockIndex, bool noReuse) {
     if (capacity_ == 0) {
         throw std::runtime_error("BlockCache capacity is zero; invalid configuration");
     }
 
     CacheKey key{fd, blockIndex};
+    Shard& shard = shardFor(key);
 
     // Check if the block is already in the cache
-    auto it = cacheEntries_.find(key);
-    if (it != cacheEntries_.end()) {
-        // Block is in cache; update reference bit
-        std::cerr << "Block found in cache (fd=" << fd << ", blockIndex=" << blockIndex << "), setting reference bit to true.\n";
-        it->second.referenceBit = true;
+    Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const std::size_t slot = shard.entries.find(key);
+        if (slot != SlotTable::npos) {
+            // Block is in cache; pinning also sets the reference bit
+            LAB2_LOG_TRACE("Block found in cache (fd={}, blockIndex={}), setting reference bit to true.", fd, blockIndex);
+            handle = pinLocked(slot, Lookup::HIT, !noReuse);
+        }
+    }
+    if (handle) {
+        stats_.add(StripedStats::HITS);
+        return waitLoaded(std::move(handle));
+    }
+
+    return loadAndPin(key, LoadMode::ACQUIRE, noReuse);
+}
+
+bool BlockCache::overwrite(int fd, off_t blockIndex, const void* data, bool noReuse) {
+    if (capacity_ == 0) {
+        throw std::runtime_error("BlockCache capacity is zero; invalid configuration");
+    }
+
+    CacheKey key{fd, blockIndex};
+    Shard& shard = shardFor(key);
+
+    Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const std::size_t slot = shard.entries.find(key);
+        if (slot != SlotTable::npos) {
+            handle = pinLocked(slot, Lookup::HIT, !noReuse);
+        }
+    }
+    stats_.add(handle ? StripedStats::HITS : StripedStats::MISSES);
+    if (!handle) {
+        std::size_t slot = allocateSlot(key);
+        auto deadline = std::chrono::steady_clock::now() + PIN_WAIT_LIMIT;
+        while (slot == EvictionPolicy::npos && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+            slot = allocateSlot(key);
+        }
+        if (slot == EvictionPolicy::npos) {
+            LAB2_LOG_WARN("Failed to evict a block from cache (fd={}, blockIndex={}).", fd, blockIndex);
+            errno = ENOMEM;
+            return false;
+        }
+
+        bool inserted = false;
+        handle = insertLoading(key, slot, LoadMode::ACQUIRE, noReuse, inserted);
+        if (inserted) {
+            // Nothing of the old contents survives, so fill it in place of the read;
+            // readers waiting for the load see the new data
+            if (tier_) {
+                tier_->erase(key);
+            }
+            CacheEntry& entry = entries_[slot];
+            std::memcpy(entry.block.data(), data, blockSize_);
+            markDirty(entry, 0, blockSize_);
+            entry.loading.store(false, std::memory_order_release);
+            entry.loading.notify_all();
+            return true;
+        }
+    }
+
+    handle = waitLoaded(std::move(handle));
+    if (!handle) {
+        return false;
+    }
+    std::memcpy(handle.data(), data, blockSize_);
+    handle.markDirty();
+    return true;
+}
+
+bool BlockCache::prefetch(int fd, off_t blockIndex) {
+    return prefetch(fd, blockIndex, 1) == 1;
+}
+
+namespace {
+
+std::vector<off_t> blockRange(off_t firstBlock, std::size_t count) {
+    std::vector<off_t> blocks(count);
+    std::iota(blocks.begin(), blocks.end(), firstBlock);
+    return blocks;
+}
+
+} // namespace
+
+std::size_t BlockCache::prefetch(int fd, off_t firstBlock, std::size_t count) {
+    return loadBatch(fd, blockRange(firstBlock, count), LoadMode::PREFETCH);
+}
+
+std::size_t BlockCache::preload(int fd, off_t firstBlock, std::size_t count) {
+    return loadBatch(fd, blockRange(firstBlock, count), LoadMode::PRELOAD);
+}
+
+std::size_t BlockCache::preload(int fd, std::span<const off_t> blocks) {
+    return loadBatch(fd, blocks, LoadMode::PRELOAD);
+}
+
+BlockCache::Handle BlockCache::waitLoaded(Handle handle) {
+    CacheEntry& entry = *handle.entry_;
+    while (entry.loading.load(std::memory_order_acquire)) {
+        entry.loading.wait(true, std::memory_order_acquire);
+    }
+    if (entry.loadFailed.load(std::memory_order_acquire)) {
+        handle.release();
+        errno = EIO;
+        return {};
+    }
+    return handle;
+}
+
+std::size_t BlockCache::loadBatch(int fd, std::span<const off_t> blocks, LoadMode mode) {
+    if (capacity_ == 0) {
+        return 0;
+    }
+
+    struct PendingLoad {
+        CacheKey key;
+        std::size_t slot;
+        Handle handle;
+    };
+    std::vector<PendingLoad> loads;
+    std::vector<IoRequest> requests;
+    loads.reserve(std::min(blocks.size(), capacity_));
+    requests.reserve(loads.capacity());
+
+    std::size_t cached = 0;
+    for (off_t blockIndex : blocks) {
+        CacheKey key{fd, blockIndex};
+        {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.entries.contains(key)) {
+                ++cached;
+                continue;
+            }
+        }
+
+        // Blocks taken here stay pinned until the batch completes, so the
+        // policy cannot pick one of them to make room for the next
+        std::size_t slot = allocateSlot(key);
+        if (slot == EvictionPolicy::npos) {
+            break; // Everything else is pinned or loading; never wait here
+        }
+        bool inserted = false;
+        Handle handle = insertLoading(key, slot, mode, /* noReuse = */ true, inserted);
+        ++cached;
+        if (inserted) {
+            if (mode == LoadMode::PRELOAD) {
+                stats_.add(StripedStats::MISSES);
+            }
+            if (loadFromTier(key, slot) || loadHole(key, slot)) {
+                continue; // Loaded already; the handle unpins it
+            }
+            requests.push_back(readRequest(fd, entries_[slot].block));
+            loads.push_back({key, slot, std::move(handle)});
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    io_->execute(requests.data(), requests.size());
+    if (!requests.empty()) {
+        stats_.recordRead(std::chrono::steady_clock::now() - start, requests.size());
+    }
+
+    for (std::size_t i = 0; i < loads.size(); ++i) {
+        if (!finishLoad(loads[i].key, loads[i].slot, requests[i])) {
+            loads[i].handle.entry_ = nullptr; // finishLoad dropped the loader's pin
+            --cached;
+        }
+    }
+    return cached; // The handles unpin the loaded blocks on the way out
+}
+
+BlockCache::Handle BlockCache::loadAndPin(const CacheKey& key, LoadMode mode, bool noReuse) {
+    const int fd = key.fd;
+    const off_t blockIndex = key.blockIndex;
+
+    // If the block is not in the cache, take a slot (evicting if needed) and load it
+    std::size_t slot = allocateSlot(key);
+    if (slot == EvictionPolicy::npos) {
+        // Every block may be pinned by other threads for a moment; wait for
+        // one to be released
+        auto deadline = std::chrono::steady_clock::now() + PIN_WAIT_LIMIT;
+        while (slot == EvictionPolicy::npos && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+            slot = allocateSlot(key);
+        }
+    }
+    if (slot == EvictionPolicy::npos) {
+        LAB2_LOG_WARN("Failed to evict a block from cache (fd={}, blockIndex={}).", fd, blockIndex);
+        errno = ENOMEM; // Out of memory
+        return {};
+    }
+
+    bool inserted = false;
+    Handle handle = insertLoading(key, slot, mode, noReuse, inserted);
+    if (!inserted) {
+        // Another thread loaded the same block meanwhile, or is loading it now
+        stats_.add(StripedStats::HITS);
+        return waitLoaded(std::move(handle));
+    }
+    stats_.add(StripedStats::MISSES);
+    if (loadFromTier(key, slot) || loadHole(key, slot)) {
+        return handle;
+    }
+
+    IoRequest request = readRequest(fd, entries_[slot].block);
+    auto start = std::chrono::steady_clock::now();
+    io_->execute(request);
+    stats_.recordRead(std::chrono::steady_clock::now() - start);
+    if (!finishLoad(key, slot, request)) {
+        handle.entry_ = nullptr; // finishLoad dropped the loader's pin
+        errno = EIO;
+        return {};
+    }
+    return handle;
+}
+
+BlockCache::Handle BlockCache::insertLoading(const CacheKey& key, std::size_t slot, LoadMode mode, bool noReuse, bool& inserted) {
+    const int fd = key.fd;
+    const off_t blockIndex = key.blockIndex;
+    Shard& shard = shardFor(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const std::size_t existing = shard.entries.find(key);
+    if (existing != SlotTable::npos) {
+        // Its copy wins. Only a reader counts as the first use of a prefetched block.
+        releaseSlot(slot);
+        inserted = false;
+        return mode == LoadMode::ACQUIRE ? pinLocked(existing, Lookup::HIT, !noReuse) : pinOnly(existing);
+    }
+
+    // The slot is not published yet, so no other thread touches its entry.
+    // Its buffer is reused in place; the load overwrites all of it.
+    CacheEntry& entry = entries_[slot];
+    entry.block.reset(blockIndex);
+    entry.prefetched.store(mode == LoadMode::PREFETCH, std::memory_order_relaxed);
+    entry.loading.store(true, std::memory_order_relaxed);
+    shard.entries.insert(key, slot);
+    linkFileBlock(fd, slot);
+    inserted = true;
+
+    if (mode == LoadMode::PREFETCH) {
+        LAB2_LOG_TRACE("Prefetching block into cache (fd={}, blockIndex={}).", fd, blockIndex);
+        readaheadCounters_.issued.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (mode != LoadMode::ACQUIRE || noReuse) {
+        // Enters with a clear bit: first in line unless it is accessed again
+        LAB2_LOG_TRACE("Loading new block into cache (fd={}, blockIndex={}), leaving reference bit clear.", fd, blockIndex);
+        policy_->clearReference(slot);
+        return pinOnly(slot);
+    }
+
+    // The policy has already placed the new block; the load itself is not a hit
+    LAB2_LOG_TRACE("Loading new block into cache (fd={}, blockIndex={}).", fd, blockIndex);
+    return pinLocked(slot, Lookup::MISS, /* reference = */ false);
+}
+
+bool BlockCache::finishLoad(const CacheKey& key, std::size_t slot, const IoRequest& request) {
+    CacheEntry& entry = entries_[slot];
+    if (completeLoad(request)) {
+        stats_.add(StripedStats::BYTES_READ, static_cast<std::uint64_t>(request.result));
+        entry.loading.store(false, std::memory_order_release);
+        entry.loading.notify_all();
         return true;
     }
 
-    // If the block is not in the cache, load it
-    if (cacheEntries_.size() >= capacity_) {
-        // Evict one block if the cache is full
-        std::cerr << "Cache is full (capacity=" << capacity_ << "), attempting to evict a block.\n";
-        if (!evictOne()) {
-            std::cerr << "Failed to evict a block from cache (fd=" << fd << ", blockIndex=" << blockIndex << ").\n";
-            errno = ENOMEM; // Out of memory
+    LAB2_LOG_ERROR("Failed to load block from disk (fd={}, blockIndex={}).", key.fd, key.blockIndex);
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.erase(key);
+        unlinkFileBlock(key.fd, slot);
+    }
+    // Nobody can pin it any more; wake those who did and wait until they let go
+    entry.loadFailed.store(true, std::memory_order_relaxed);
+    entry.loading.store(false, std::memory_order_release);
+    entry.loading.notify_all();
+    while (entry.pins.load(std::memory_order_acquire) > 1) {
+        std::this_thread::yield();
+    }
+    entry.loadFailed.store(false, std::memory_order_relaxed);
+    entry.prefetched.store(false, std::memory_order_relaxed);
+    entry.pins.fetch_sub(1, std::memory_order_release);
+    releaseSlot(slot);
+    return false;
+}
+
+bool BlockCache::loadFromTier(const CacheKey& key, std::size_t slot) {
+    CacheEntry& entry = entries_[slot];
+    if (!tier_ || !tier_->take(key, entry.block.data())) {
+        return false;
+    }
+    LAB2_LOG_TRACE("Block loaded from the compressed tier (fd={}, blockIndex={}).", key.fd, key.blockIndex);
+    entry.loading.store(false, std::memory_order_release);
+    entry.loading.notify_all();
+    return true;
+}
+
+bool BlockCache::loadHole(const CacheKey& key, std::size_t slot) {
+    const off_t begin = key.blockIndex * static_cast<off_t>(blockSize_);
+    if (!sparseFiles_ || !inHole(key.fd, begin, begin + static_cast<off_t>(blockSize_))) {
+        return false;
+    }
+    LAB2_LOG_TRACE("Block lies in a hole, zero-filled (fd={}, blockIndex={}).", key.fd, key.blockIndex);
+    CacheEntry& entry = entries_[slot];
+    std::memset(entry.block.data(), 0, blockSize_);
+    stats_.add(StripedStats::HOLE_LOADS);
+    entry.loading.store(false, std::memory_order_release);
+    entry.loading.notify_all();
+    return true;
+}
+
+bool BlockCache::inHole(int fd, off_t begin, off_t end) {
+    std::uint64_t writes;
+    {
+        std::lock_guard<std::mutex> lock(fileIndexMutex_);
+        const FileExtents& extents = fileExtents_[fd];
+        if (begin >= extents.dataBegin && end <= extents.dataEnd) {
             return false;
         }
+        if (begin >= extents.holeBegin && end <= extents.holeEnd) {
+            return true;
+        }
+        writes = extents.writes;
+    }
+
+    // Moves the file offset, which nobody uses: every transfer is positional
+    constexpr off_t END = std::numeric_limits<off_t>::max();
+    FileExtents found;
+    off_t data = ::lseek(fd, begin, SEEK_DATA);
+    if (data < 0 && errno == ENXIO) {
+        found.holeBegin = begin; // No data from here to the end of the file
+        found.holeEnd = END;
+    } else if (data < 0) {
+        found.dataEnd = END; // No SEEK_DATA here; everything counts as data
+    } else if (data >= end) {
+        found.holeBegin = begin;
+        found.holeEnd = data;
+    } else {
+        const off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        found.dataBegin = data;
+        found.dataEnd = hole > data ? hole : END;
     }
 
-    // Load the block into the cache
-    CacheEntry newEntry;
-    newEntry.block = std::make_unique<Block>(blockSize_, blockIndex);
-    if (!loadBlockFromDisk(fd, blockIndex, *newEntry.block)) {
-        std::cerr << "Failed to load block from disk (fd=" << fd << ", blockIndex=" << blockIndex << ").\n";
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    FileExtents& extents = fileExtents_[fd];
+    if (extents.writes != writes) {
+        return false; // A write went out meanwhile; reading is always safe
+    }
+    if (found.dataEnd != found.dataBegin) {
+        extents.dataBegin = found.dataBegin;
+        extents.dataEnd = found.dataEnd;
+    }
+    if (found.holeEnd != found.holeBegin) {
+        extents.holeBegin = found.holeBegin;
+        extents.holeEnd = found.holeEnd;
+    }
+    return found.holeBegin <= begin && end <= found.holeEnd;
+}
+
+bool BlockCache::moveToTier(const CacheKey& key, std::size_t slot, std::unique_lock<std::mutex>& lock) {
+    // Pinned, nobody evicts or drops it meanwhile; a writer shows in dirtySince
+    CacheEntry& entry = entries_[slot];
+    const std::int64_t dirtySince = entry.dirtySince.load(std::memory_order_relaxed);
+    entry.pins.fetch_add(1, std::memory_order_acquire);
+    lock.unlock();
+    thread_local std::vector<unsigned char> compressed;
+    const bool compressible = tier_->compress(entry.block.data(), compressed);
+    lock.lock();
+    entry.pins.fetch_sub(1, std::memory_order_release);
+
+    Shard& shard = shardFor(key);
+    if (shard.entries.find(key) != slot || entry.pins.load(std::memory_order_acquire) > 0
+        || entry.block.isDirty() || entry.dirtySince.load(std::memory_order_relaxed) != dirtySince) {
         return false;
     }
+    // Stored before the shard lets go of the block, so that a miss on it finds it
+    if (compressible) {
+        tier_->store(key, compressed);
+    }
+    return true;
+}
 
-    std::cerr << "Loaded new block into cache (fd=" << fd << ", blockIndex=" << blockIndex << "), setting reference bit to true.\n";
-    newEntry.referenceBit = true;
+void BlockCache::markDirty(CacheEntry& entry, std::size_t offset, std::size_t length) {
+    if (length == 0) {
+        return;
+    }
+    // Sector bits first: whoever clears the flag takes the bits after it
+    const auto slot = static_cast<std::size_t>(&entry - entries_.get());
+    std::atomic<std::uint64_t>* words = &dirtySectors_[slot * sectorWords_];
+    const std::size_t first = offset / SECTOR_SIZE;
+    const std::size_t last = (offset + length - 1) / SECTOR_SIZE;
+    for (std::size_t word = first / 64; word <= last / 64; ++word) {
+        const std::size_t low = std::max(first, word * 64) - word * 64;
+        const std::size_t high = std::min(last, word * 64 + 63) - word * 64;
+        const std::uint64_t mask = high - low == 63 ? ~std::uint64_t{0}
+                                                    : ((std::uint64_t{1} << (high - low + 1)) - 1) << low;
+        words[word].fetch_or(mask, std::memory_order_release);
+    }
 
-    // Insert the new block into the cache
-    cacheEntries_[key] = std::move(newEntry);
-    evictionOrder_.push_back(key);
+    if (!entry.block.markDirty()) {
+        return; // Already dirty; keeps its original timestamp
+    }
+    entry.dirtySince.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    if (dirtyCount_.fetch_add(1, std::memory_order_relaxed) + 1 > dirtyLimit_ && onDirtyLimit_) {
+        onDirtyLimit_();
+    }
+}
 
+bool BlockCache::takeDirty(std::size_t slot, int fd, std::size_t granule, std::vector<DirtySegment>& segments) {
+    CacheEntry& entry = entries_[slot];
+    if (!entry.block.clearDirty()) {
+        return false;
+    }
+    dirtyCount_.fetch_sub(1, std::memory_order_relaxed);
+
+    // Turn the sector bits into extents; a sector dirtied from now on sets
+    // its bit again and re-dirties the block
+    const off_t blockOffset = entry.block.index() * static_cast<off_t>(blockSize_);
+    auto* data = static_cast<unsigned char*>(entry.block.data());
+    std::atomic<std::uint64_t>* words = &dirtySectors_[slot * sectorWords_];
+    std::size_t begin = 0;
+    std::size_t end = 0;    // Extent being built; empty while end == 0
+    auto flush = [&] {
+        if (end != 0) {
+            segments.push_back({fd, blockOffset + static_cast<off_t>(begin), data + begin, end - begin, slot, false});
+        }
+    };
+    for (std::size_t word = 0; word < sectorWords_; ++word) {
+        std::uint64_t bits = words[word].exchange(0, std::memory_order_acquire);
+        while (bits != 0) {
+            const std::size_t sector = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+            bits &= bits - 1;
+            const std::size_t sectorBegin = sector * SECTOR_SIZE / granule * granule;
+            const std::size_t sectorEnd = std::min(sectorBegin + granule, blockSize_);
+            if (end != 0 && sectorBegin <= end) {
+                end = std::max(end, sectorEnd);
+                continue;
+            }
+            flush();
+            begin = sectorBegin;
+            end = sectorEnd;
+        }
+    }
+    flush();
     return true;
 }
 
-void* BlockCache::blockData(int fd, off_t blockIndex) {
+void BlockCache::restoreDirty(const DirtySegment& segment) {
+    CacheEntry& entry = entries_[segment.slot];
+    markDirty(entry, static_cast<std::size_t>(segment.data - static_cast<unsigned char*>(entry.block.data())),
+              segment.length);
+}
+
+std::size_t BlockCache::writeGranule(int fd) const {
+#ifdef STATX_DIOALIGN
+    struct statx stx {};
+    if (::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN) != 0) {
+        const std::size_t align = std::max<std::size_t>({stx.stx_dio_offset_align, stx.stx_dio_mem_align, SECTOR_SIZE});
+        if (align % SECTOR_SIZE == 0 && blockSize_ % align == 0) {
+            return align;
+        }
+    }
+#endif
+    // Alignment unknown: whole blocks are always safe
+    return blockSize_;
+}
+
+std::size_t BlockCache::writeSegments(std::vector<DirtySegment>& segments) {
+    // Reused between calls, so that eviction writes back without allocating
+    thread_local std::vector<iovec> iovecs;
+    thread_local std::vector<IoRequest> writes;
+    thread_local std::vector<std::size_t> firstSegments;
+    iovecs.clear();
+    writes.clear();
+    firstSegments.clear();
+
+    std::sort(segments.begin(), segments.end(), [](const DirtySegment& a, const DirtySegment& b) {
+        return a.fd != b.fd ? a.fd < b.fd : a.offset < b.offset;
+    });
+    if (sparseFiles_ && punchHoles_.load(std::memory_order_relaxed)) {
+        splitZeroRuns(segments);
+    }
+
+    // One write (or punch) per run of contiguous extents; iov entries must not move once taken
+    iovecs.reserve(segments.size());
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        const DirtySegment& segment = segments[i];
+        const IoRequest::Op op = segment.punch ? IoRequest::Op::PUNCH_HOLE : IoRequest::Op::WRITE;
+        iovecs.push_back({segment.data, segment.length});
+        if (!writes.empty() && writes.back().fd == segment.fd && writes.back().op == op
+            && writes.back().offset + static_cast<off_t>(writes.back().length) == segment.offset
+            && i - firstSegments.back() < MAX_WRITEBACK_RUN) {
+            writes.back().length += segment.length;
+            continue;
+        }
+        IoRequest write;
+        write.op = op;
+        write.fd = segment.fd;
+        write.buffer = segment.data;
+        write.length = segment.length;
+        write.offset = segment.offset;
+        writes.push_back(write);
+        firstSegments.push_back(i);
+    }
+    firstSegments.push_back(segments.size());
+    auto vectorize = [](IoRequest& write, std::size_t count, const iovec* iov) {
+        if (count > 1) {
+            write.op = IoRequest::Op::WRITEV;
+            write.iov = iov;
+            write.iovCount = static_cast<int>(count);
+        }
+    };
+    for (std::size_t w = 0; w < writes.size(); ++w) {
+        if (writes[w].op == IoRequest::Op::WRITE) {
+            vectorize(writes[w], firstSegments[w + 1] - firstSegments[w], &iovecs[firstSegments[w]]);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    io_->execute(writes.data(), writes.size());
+
+    // A file system that cannot punch holes gets the zeros written after all
+    thread_local std::vector<std::size_t> retries;
+    retries.clear();
+    for (std::size_t w = 0; w < writes.size(); ++w) {
+        if (writes[w].op == IoRequest::Op::PUNCH_HOLE && writes[w].result < 0) {
+            if (writes[w].result == -EOPNOTSUPP && punchHoles_.exchange(false, std::memory_order_relaxed)) {
+                LAB2_LOG_INFO("Cannot punch holes (fd={}); writing zero blocks from now on.", writes[w].fd);
+            }
+            writes[w].op = IoRequest::Op::WRITE;
+            vectorize(writes[w], firstSegments[w + 1] - firstSegments[w], &iovecs[firstSegments[w]]);
+            retries.push_back(w);
+        }
+    }
+    for (std::size_t w : retries) {
+        io_->execute(writes[w]);
+    }
+    if (!writes.empty()) {
+        stats_.recordWrite(std::chrono::steady_clock::now() - start, writes.size());
+    }
+
+    {
+        // Data written may fill what an fd took for a hole
+        std::lock_guard<std::mutex> lock(fileIndexMutex_);
+        for (const IoRequest& write : writes) {
+            auto it = write.op == IoRequest::Op::PUNCH_HOLE ? fileExtents_.end() : fileExtents_.find(write.fd);
+            if (it == fileExtents_.end()) {
+                continue;
+            }
+            FileExtents& extents = it->second;
+            ++extents.writes;
+            if (write.offset < extents.holeEnd && extents.holeBegin < write.offset + static_cast<off_t>(write.length)) {
+                extents.holeBegin = extents.holeEnd = 0;
+            }
+        }
+    }
+
+    std::size_t lastWrittenSlot = EvictionPolicy::npos;
+    for (std::size_t w = 0; w < writes.size(); ++w) {
+        const bool written = completeWrite(writes[w]);
+        if (written) {
+            stats_.add(writes[w].op == IoRequest::Op::PUNCH_HOLE ? StripedStats::BYTES_PUNCHED : StripedStats::BYTES_WRITTEN,
+                       static_cast<std::uint64_t>(writes[w].result));
+        }
+        for (std::size_t i = firstSegments[w]; i < firstSegments[w + 1]; ++i) {
+            segments[i].written = written;
+            // A block's segments are adjacent after the sort
+            if (written && segments[i].slot != lastWrittenSlot) {
+                lastWrittenSlot = segments[i].slot;
+                stats_.add(StripedStats::WRITEBACKS);
+            }
+        }
+    }
+    return writes.size();
+}
+
+void BlockCache::splitZeroRuns(std::vector<DirtySegment>& segments) {
+    // Swapped with segments at the end, so both keep their capacity for the next call
+    thread_local std::vector<DirtySegment> split;
+    split.clear();
+    bool anyZero = false;
+    std::uint64_t skipped = 0;
+
+    std::size_t group = 0;
+    while (group < segments.size()) {
+        const int fd = segments[group].fd;
+        std::size_t groupEnd = group;
+        while (groupEnd < segments.size() && segments[groupEnd].fd == fd) {
+            ++groupEnd;
+        }
+        const std::size_t firstPiece = split.size();
+
+        // Holes can only be punched in whole file-system blocks
+        struct stat st {};
+        std::size_t unit = 0;
+        if (::fstat(fd, &st) == 0 && st.st_blksize > 0) {
+            unit = static_cast<std::size_t>(st.st_blksize);
+        }
+        off_t limit = st.st_size; // Punched zeros past it would not lengthen the file
+        for (std::size_t i = group; i < groupEnd; ++i) {
+            const DirtySegment& segment = segments[i];
+            const off_t end = segment.offset + static_cast<off_t>(segment.length);
+            const auto offUnit = static_cast<off_t>(unit);
+            const off_t first = unit == 0 ? end : (segment.offset + offUnit - 1) / offUnit * offUnit;
+            const off_t last = unit == 0 ? end : end / offUnit * offUnit;
+            auto piece = [&](off_t begin, off_t pieceEnd, bool punch) {
+                if (pieceEnd <= begin) {
+                    return;
+                }
+                if (split.size() > firstPiece) {
+                    // Pieces of one block are adjacent in memory too
+                    DirtySegment& previous = split.back();
+                    if (previous.slot == segment.slot && previous.punch == punch
+                        && previous.offset + static_cast<off_t>(previous.length) == begin) {
+                        previous.length += static_cast<std::size_t>(pieceEnd - begin);
+                        return;
+                    }
+                }
+                split.push_back({fd, begin, segment.data + (begin - segment.offset),
+                                 static_cast<std::size_t>(pieceEnd - begin), segment.slot, false, punch});
+            };
+            piece(segment.offset, std::min(first, end), false);
+            for (off_t offset = first; offset < last; offset += static_cast<off_t>(unit)) {
+                const bool zero = isZero(segment.data + (offset - segment.offset), unit);
+                anyZero = anyZero || zero;
+                piece(offset, offset + static_cast<off_t>(unit), zero);
+            }
+            piece(std::max(last, first), end, false);
+        }
+        for (std::size_t i = firstPiece; i < split.size(); ++i) {
+            if (!split[i].punch) {
+                limit = std::max(limit, split[i].offset + static_cast<off_t>(split[i].length));
+            }
+        }
+        // Zeros past the end of the file need no punch: the data beyond them
+        // leaves a hole there when it lengthens the file
+        std::size_t kept = firstPiece;
+        for (std::size_t i = firstPiece; i < split.size(); ++i) {
+            if (split[i].punch && split[i].offset + static_cast<off_t>(split[i].length) > limit) {
+                split[i].punch = false;
+            }
+            if (split[i].punch && split[i].offset >= st.st_size) {
+                skipped += split[i].length;
+                continue;
+            }
+            split[kept++] = split[i];
+        }
+        split.resize(kept);
+        group = groupEnd;
+    }
+    if (anyZero) {
+        segments.swap(split);
+    }
+    if (skipped > 0) {
+        stats_.add(StripedStats::BYTES_PUNCHED, skipped);
+    }
+}
+
+void BlockCache::setCompressedTier(std::size_t budgetBytes) {
+    tier_ = budgetBytes == 0 ? nullptr : std::make_unique<CompressedTier>(budgetBytes, blockSize_);
+}
+
+void BlockCache::setDirtyLimit(std::size_t limit, std::function<void()> callback) {
+    dirtyLimit_ = limit;
+    onDirtyLimit_ = std::move(callback);
+}
+
+std::size_t BlockCache::writeBack(std::chrono::steady_clock::time_point dirtiedBefore, std::size_t maxBlocks) {
+    struct Candidate {
+        CacheKey key;
+        std::size_t slot;
+        std::int64_t dirtySince;
+    };
+    const std::int64_t cutoff = dirtiedBefore.time_since_epoch().count();
+
+    // 1) Pin the idle dirty blocks old enough, so that they stay put while written
+    std::vector<Candidate> candidates;
+    for (std::size_t i = 0; i < shardCount_; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.forEach([&](const CacheKey& key, std::size_t slot) {
+            CacheEntry& entry = entries_[slot];
+            std::int64_t since = entry.dirtySince.load(std::memory_order_relaxed);
+            if (!entry.block.isDirty() || since >= cutoff || entry.pins.load(std::memory_order_acquire) > 0) {
+                return;
+            }
+            entry.pins.fetch_add(1, std::memory_order_acquire);
+            candidates.push_back({key, slot, since});
+        });
+    }
+
+    // 2) Keep the oldest maxBlocks, in file order
+    if (candidates.size() > maxBlocks) {
+        std::nth_element(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(maxBlocks), candidates.end(),
+                         [](const Candidate& a, const Candidate& b) { return a.dirtySince < b.dirtySince; });
+        for (std::size_t i = maxBlocks; i < candidates.size(); ++i) {
+            entries_[candidates[i].slot].pins.fetch_sub(1, std::memory_order_release);
+        }
+        candidates.resize(maxBlocks);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.key.fd != b.key.fd ? a.key.fd < b.key.fd : a.key.blockIndex < b.key.blockIndex;
+    });
+
+    // 3) Take their dirty extents and write them out, adjacent ones together
+    std::vector<DirtySegment> segments;
+    std::size_t taken = 0;
+    int granuleFd = -1;
+    std::size_t granule = blockSize_;
+    for (const Candidate& candidate : candidates) {
+        if (candidate.key.fd != granuleFd) {
+            granuleFd = candidate.key.fd;
+            granule = writeGranule(granuleFd);
+        }
+        if (takeDirty(candidate.slot, candidate.key.fd, granule, segments)) {
+            ++taken; // Otherwise written back by someone else since the scan
+        }
+    }
+    const std::size_t writes = writeSegments(segments);
+
+    // Keep the data of failed writes: the blocks get another chance on the
+    // next pass or eviction. A block's segments are adjacent after the sort.
+    std::size_t failed = 0;
+    std::size_t lastFailedSlot = EvictionPolicy::npos;
+    for (const DirtySegment& segment : segments) {
+        if (segment.written) {
+            continue;
+        }
+        restoreDirty(segment);
+        if (segment.slot != lastFailedSlot) {
+            lastFailedSlot = segment.slot;
+            ++failed;
+        }
+    }
+    const std::size_t written = taken - failed;
+    writebackCounters_.blocks.fetch_add(written, std::memory_order_relaxed);
+    writebackCounters_.writes.fetch_add(writes, std::memory_order_relaxed);
+
+    for (const Candidate& candidate : candidates) {
+        entries_[candidate.slot].pins.fetch_sub(1, std::memory_order_release);
+    }
+    return written;
+}
+
+bool BlockCache::flushFd(int fd) {
+    const bool flushed = dropBlocks(fd, 0, std::numeric_limits<off_t>::max(), /* waitForPins = */ true);
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    fileExtents_.erase(fd);
+    return flushed;
+}
+
+void BlockCache::discardFd(int fd) {
+    dropBlocks(fd, 0, std::numeric_limits<off_t>::max(), /* waitForPins = */ true, /* discardDirty = */ true);
+    std::lock_guard<std::mutex> lock(fileIndexMutex_);
+    fileExtents_.erase(fd);
+}
+
+bool BlockCache::syncRange(int fd, off_t firstBlock, off_t lastBlock) {
+    // 1) Pin the dirty blocks, in use or not: whatever was written before the
+    //    call has to reach the disk
+    std::vector<off_t> blocks;
+    fileBlocksIn(fd, firstBlock, lastBlock, blocks);
+    std::vector<std::size_t> pinned;
+    for (off_t blockIndex : blocks) {
+        CacheKey key{fd, blockIndex};
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const std::size_t slot = shard.entries.find(key);
+        if (slot != SlotTable::npos && entries_[slot].block.isDirty()) {
+            entries_[slot].pins.fetch_add(1, std::memory_order_acquire);
+            pinned.push_back(slot);
+        }
+    }
+    if (pinned.empty()) {
+        return true;
+    }
+
+    // 2) Write them out in one batch; writeSegments() sorts and merges them.
+    //    They stay cached, clean.
+    std::vector<DirtySegment> segments;
+    const std::size_t granule = writeGranule(fd);
+    for (std::size_t slot : pinned) {
+        takeDirty(slot, fd, granule, segments);
+    }
+    writeSegments(segments);
+    bool written = true;
+    for (const DirtySegment& segment : segments) {
+        if (!segment.written) {
+            LAB2_LOG_ERROR("Failed to write dirty block to disk (fd={}, offset={}).", segment.fd, segment.offset);
+            restoreDirty(segment);
+            written = false;
+        }
+    }
+
+    for (std::size_t slot : pinned) {
+        entries_[slot].pins.fetch_sub(1, std::memory_order_release);
+    }
+    if (!written) {
+        errno = EIO;
+    }
+    return written;
+}
+
+bool BlockCache::evictRange(int fd, off_t firstBlock, off_t lastBlock) {
+    return dropBlocks(fd, firstBlock, lastBlock, /* waitForPins = */ false);
+}
+
+void BlockCache::deprioritize(int fd, off_t blockIndex) {
     CacheKey key{fd, blockIndex};
-    auto it = cacheEntries_.find(key);
-    if (it == cacheEntries_.end()) {
-        return nullptr; // Not present
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const std::size_t slot = shard.entries.find(key);
+    if (slot != SlotTable::npos) {
+        policy_->clearReference(slot);
     }
-    return it->second.block->data();
 }
 
-void BlockCache::markDirty(int fd, off_t blockIndex) {
+bool BlockCache::contains(int fd, off_t blockIndex) {
     CacheKey key{fd, blockIndex};
-    auto it = cacheEntries_.find(key);
-    if (it != cacheEntries_.end()) {
-        it->second.block->setDirty(true);
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.entries.contains(key);
+}
+
+std::vector<BlockCache::ResidentBlock> BlockCache::residentBlocks() {
+    std::vector<ResidentBlock> blocks;
+    std::vector<std::size_t> slots;
+    {
+        std::lock_guard<std::mutex> lock(fileIndexMutex_);
+        for (const auto& [fd, file] : fileBlocks_) {
+            for (std::size_t slot = file.head; slot != SlotTable::npos; slot = entries_[slot].fileNext) {
+                blocks.push_back({fd, entries_[slot].block.index(), 0});
+                slots.push_back(slot);
+            }
+        }
     }
+
+    // The two locks are never held together; a slot that changed hands in between is left out
+    std::lock_guard<std::mutex> lock(policyMutex_);
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        if (slotKeys_[slots[i]] == CacheKey{blocks[i].fd, blocks[i].blockIndex}) {
+            blocks[kept] = blocks[i];
+            blocks[kept++].heat = policy_->heat(slots[i]);
+        }
+    }
+    blocks.resize(kept);
+    return blocks;
 }
 
-void BlockCache::flushFd(int fd) {
-    for (auto it = cacheEntries_.begin(); it != cacheEntries_.end();) {
-        if (it->first.fd == fd) {
-            if (it->second.block->isDirty()) {
-                if (!writeBlockToDisk(it->first.fd, *it->second.block)) {
-                    std::cerr << "Failed to write dirty block to disk (fd=" << fd << ", blockIndex=" << it->first.blockIndex << ").\n";
-                }
-                it->second.block->setDirty(false);
-            }
-            // Remove from evictionOrder_
-            auto evictIt = std::find(evictionOrder_.begin(), evictionOrder_.end(), it->first);
-            if (evictIt != evictionOrder_.end()) {
-                size_t index = std::distance(evictionOrder_.begin(), evictIt);
-                evictionOrder_.erase(evictIt);
-                // Adjust clockHand_ if necessary
-                if (index < clockHand_) {
-                    if (clockHand_ > 0) clockHand_--;
-                } else if (clockHand_ >= evictionOrder_.size()) {
-                    clockHand_ = 0;
+bool BlockCache::dropBlocks(int fd, off_t firstBlock, off_t lastBlock, bool waitForPins, bool discardDirty) {
+    std::vector<off_t> blocks;
+    std::vector<std::pair<CacheKey, std::size_t>> pinned;
+    std::vector<DirtySegment> segments;
+    std::size_t granule = 0;    // Looked up once something is dirty
+
+    for (;;) {
+        bool busy = false;
+
+        // 1) Pin every idle block in range, so that nobody evicts or frees it
+        //    while it is written back without the shard lock
+        pinned.clear();
+        auto pinIfIdle = [this, &pinned, &busy](const CacheKey& key, std::size_t slot) {
+            CacheEntry& entry = entries_[slot];
+            if (entry.pins.load(std::memory_order_acquire) > 0) {
+                busy = true; // In use, or an evictor is writing it back
+                return;
+            }
+            entry.pins.fetch_add(1, std::memory_order_acquire);
+            pinned.emplace_back(key, slot);
+        };
+        blocks.clear();
+        fileBlocksIn(fd, firstBlock, lastBlock, blocks);
+        for (off_t blockIndex : blocks) {
+            CacheKey key{fd, blockIndex};
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const std::size_t slot = shard.entries.find(key);
+            if (slot != SlotTable::npos) {
+                pinIfIdle(key, slot);
+            }
+        }
+
+        // 2) Write the dirty ones back as one batch; what could not be
+        //    written stays dirty, and so cached
+        segments.clear();
+        for (const auto& [key, slot] : pinned) {
+            if (granule == 0 && entries_[slot].block.isDirty()) {
+                granule = writeGranule(fd);
+            }
+            takeDirty(slot, key.fd, granule, segments);
+        }
+        bool failed = false;
+        if (!discardDirty) {
+            writeSegments(segments);
+            for (const DirtySegment& segment : segments) {
+                if (!segment.written) {
+                    LAB2_LOG_ERROR("Failed to write dirty block to disk (fd={}, offset={}).", segment.fd, segment.offset);
+                    restoreDirty(segment);
+                    failed = true;
                 }
             }
-            it = cacheEntries_.erase(it); // Remove the block
-        } else {
-            ++it;
         }
+
+        // 3) Drop them, unless somebody started using them meanwhile
+        for (const auto& [key, slot] : pinned) {
+            Shard& shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            CacheEntry& entry = entries_[slot];
+            entry.pins.fetch_sub(1, std::memory_order_release);
+            if (entry.pins.load(std::memory_order_acquire) > 0 || entry.block.isDirty()) {
+                busy = true;
+                continue;
+            }
+            dropPrefetched(entry);
+            shard.entries.erase(key);
+            unlinkFileBlock(key.fd, slot);
+            // Last: once free, another thread may take the slot and link it into its own fd's list
+            releaseSlot(slot); // The buffer stays with the slot
+        }
+
+        // A block left dirty by a failed write would keep the loop going forever
+        if (!busy || !waitForPins || failed) {
+            if (tier_) {
+                tier_->eraseRange(fd, firstBlock, lastBlock);
+            }
+            if (failed) {
+                errno = EIO;
+            }
+            return !failed;
+        }
+        std::this_thread::yield();
     }
 }
 
-bool BlockCache::evictOne() {
-    if (capacity_ == 0 || evictionOrder_.empty()) {
-        std::cerr << "Could not evict the block. Either the capacity is 0 or the eviction order is empty.\n";
-        return false;
+std::size_t BlockCache::allocateSlot(const CacheKey& key) {
+    {
+        std::lock_guard<std::mutex> lock(policyMutex_);
+        std::size_t slot = policy_->insert(key);
+        if (slot != EvictionPolicy::npos) {
+            slotKeys_[slot] = key;
+            return slot;
+        }
     }
 
-    size_t initialClockHand = clockHand_;
-    size_t checks = 0;
+    // Evict one block if the cache is full
+    LAB2_LOG_TRACE("Cache is full (capacity={}), attempting to evict a block.", capacity_);
+    return evictOne(key);
+}
 
-    while (checks < capacity_) {
-        if (evictionOrder_.empty()) {
-            std::cerr << "Eviction order is empty. Cannot evict.\n";
-            return false;
+CacheStats BlockCache::stats() {
+    CacheStats stats;
+    stats_.snapshot(stats);
+    std::lock_guard<std::mutex> lock(policyMutex_);
+    stats.secondChances = policy_->secondChances();
+    if (tier_) {
+        CompressedTier::Counters& tier = tier_->counters();
+        stats.tierHits = tier.hits.load(std::memory_order_relaxed);
+        stats.tierMisses = tier.misses.load(std::memory_order_relaxed);
+        stats.tierStored = tier.stored.load(std::memory_order_relaxed);
+        stats.tierRejected = tier.rejected.load(std::memory_order_relaxed);
+        stats.tierRawBytes = tier.rawBytes.load(std::memory_order_relaxed);
+        stats.tierCompressedBytes = tier.compressedBytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void BlockCache::releaseSlot(std::size_t slot) {
+    std::lock_guard<std::mutex> lock(policyMutex_);
+    policy_->remove(slot);
+}
+
+std::size_t BlockCache::evictOne(const CacheKey& newKey) {
+    std::size_t dirtySkips = 0;
+    // Two full rotations: the first one may only clear reference bits
+    for (std::size_t attempt = 0; attempt < 2 * capacity_ + MAX_DIRTY_SKIPS; ++attempt) {
+        std::size_t slot;
+        CacheKey currentKey;
+        {
+            // The policy reads (and may clear) reference bits while choosing;
+            // the candidate stays cached until it is handed over below
+            std::lock_guard<std::mutex> policyLock(policyMutex_);
+            slot = policy_->nextVictim();
+            if (slot == EvictionPolicy::npos) {
+                break;
+            }
+            currentKey = slotKeys_[slot];
         }
 
-        // Wrap around using modulo
-        clockHand_ %= evictionOrder_.size();
+        Shard& shard = shardFor(currentKey);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (shard.entries.find(currentKey) != slot) {
+            // Still being loaded, or the slot changed owner since the sweep
+            continue;
+        }
+
+        CacheEntry& entry = entries_[slot];
+        if (entry.pins.load(std::memory_order_acquire) > 0) {
+            continue;
+        }
 
-        CacheKey currentKey = evictionOrder_[clockHand_];
-        auto it = cacheEntries_.find(currentKey);
-        if (it != cacheEntries_.end()) {
-            if (!it->second.referenceBit) {
-                // Evict this block
-                std::cerr << "Evicting block (fd=" << currentKey.fd << ", blockIndex=" << currentKey.blockIndex << ").\n";
-                if (it->second.block->isDirty()) {
-                    if (!writeBlockToDisk(it->first.fd, *it->second.block)) {
-                        std::cerr << "Could not write dirty block to disk (fd=" << currentKey.fd << ", blockIndex=" << currentKey.blockIndex << ").\n";
-                        return false;
+        if (entry.block.isDirty() && onDirtyLimit_ && dirtySkips < MAX_DIRTY_SKIPS) {
+            // Its reference bit is clear now, so it is picked on the next lap
+            // unless the flusher has cleaned it by then; try for a clean one
+            lock.unlock();
+            if (dirtySkips++ == 0) {
+                onDirtyLimit_();
+            }
+            continue;
+        }
+
+        if (entry.block.isDirty()) {
+            // Pin it so nobody frees it, and write it back without the shard lock
+            entry.pins.fetch_add(1, std::memory_order_acquire);
+            lock.unlock();
+            LAB2_LOG_DEBUG("Writing back dirty block before eviction (fd={}, blockIndex={}).", currentKey.fd, currentKey.blockIndex);
+            thread_local std::vector<DirtySegment> segments;
+            segments.clear();
+            bool written = true;
+            if (takeDirty(slot, currentKey.fd, writeGranule(currentKey.fd), segments)) {
+                writeSegments(segments);
+                for (const DirtySegment& segment : segments) {
+                    if (!segment.written) {
+                        restoreDirty(segment);
+                        written = false;
                     }
                 }
-                // Remove from cacheEntries_ and evictionOrder_
-                cacheEntries_.erase(it);
-                evictionOrder_.erase(evictionOrder_.begin() + clockHand_);
-                std::cerr << "Successfully evicted block (fd=" << currentKey.fd << ", blockIndex=" << currentKey.blockIndex << ").\n";
-                // Do not advance clockHand_ since the current position now points to the next block
-                return true; // Eviction successful
-            } else {
-                // Give a second chance
-                it->second.referenceBit = false;
-                std::cerr << "Second chance given to block (fd=" << currentKey.fd << ", blockIndex=" << currentKey.blockIndex << ").\n";
-            }
-        } else {
-            std::cerr << "Block not found in cacheEntries_ during eviction (fd=" << currentKey.fd << ", blockIndex=" << currentKey.blockIndex << "). Removing from evictionOrder_.\n";
-            evictionOrder_.erase(evictionOrder_.begin() + clockHand_);
-            // Do not advance clockHand_ as the current position now points to the next block
+            }
+            lock.lock();
+            entry.pins.fetch_sub(1, std::memory_order_release);
+            if (!written) {
+                LAB2_LOG_ERROR("Could not write dirty block to disk (fd={}, blockIndex={}).", currentKey.fd, currentKey.blockIndex);
+                return EvictionPolicy::npos;
+            }
+
+            // The shard was unlocked, so the block may have been used or dropped meanwhile
+            if (shard.entries.find(currentKey) != slot
+                || entry.pins.load(std::memory_order_acquire) > 0 || entry.block.isDirty()) {
+                continue;
+            }
+        }
+
+        if (tier_ && !moveToTier(currentKey, slot, lock)) {
             continue;
         }
 
-        // Move clockHand_ forward
-        clockHand_++;
-        checks++;
+        LAB2_LOG_TRACE("Evicting block (fd={}, blockIndex={}).", currentKey.fd, currentKey.blockIndex);
+        dropPrefetched(entry);
+        shard.entries.erase(currentKey);
+        unlinkFileBlock(currentKey.fd, slot);
+        lock.unlock();
+
+        stats_.add(StripedStats::EVICTIONS);
+
+        // Hand the slot over to the new key without freeing it
+        std::lock_guard<std::mutex> policyLock(policyMutex_);
+        slotKeys_[slot] = newKey;
+        policy_->replace(slot, newKey);
+        return slot;
     }
 
-    std::cerr << "No block found for eviction after iterating through all blocks.\n";
-    return false; // Eviction failed
+    LAB2_LOG_DEBUG("No block found for eviction after iterating through all blocks.");
+    return EvictionPolicy::npos; // Eviction failed
 }
 
-bool BlockCache::loadBlockFromDisk(int fd, off_t blockIndex, Block& block) {
-    off_t offset = blockIndex * static_cast<off_t>(blockSize_);
+IoRequest BlockCache::readRequest(int fd, Block& block) const {
+    IoRequest request;
+    request.op = IoRequest::Op::READ;
+    request.fd = fd;
+    request.buffer = block.data();
     // We read exactly blockSize_ bytes from disk
-    ssize_t bytesRead = ::pread(fd, block.data(), blockSize_, offset);
-    if (bytesRead < 0) {
-        std::cerr << "Error reading from disk at offset "
-                  << offset << ": " << std::strerror(errno) << "\n";
+    request.length = blockSize_;
+    request.offset = block.index() * static_cast<off_t>(blockSize_);
+    return request;
+}
+
+bool BlockCache::completeLoad(const IoRequest& request) {
+    if (request.result < 0) {
+        LAB2_LOG_ERROR("Error reading from disk at offset {}: {}", request.offset, std::strerror(static_cast<int>(-request.result)));
         return false;
     }
     // If the file is smaller than blockSize_, zero-fill remainder
-    if (bytesRead < static_cast<ssize_t>(blockSize_)) {
-        std::memset(static_cast<char*>(block.data()) + bytesRead, 0,
-                    blockSize_ - bytesRead);
+    if (request.result < static_cast<ssize_t>(request.length)) {
+        std::memset(static_cast<char*>(request.buffer) + request.result, 0,
+                    request.length - request.result);
     }
     return true;
 }
 
-bool BlockCache::writeBlockToDisk(int fd, Block& block) {
-    off_t offset = block.index() * static_cast<off_t>(blockSize_);
-    ssize_t written = ::pwrite(fd, block.data(), blockSize_, offset);
-    if (written < 0) {
-        std::cerr << "Error writing to disk at offset "
-                  << offset << ": " << std::strerror(errno) << "\n";
+bool BlockCache::completeWrite(const IoRequest& request) {
+    if (request.result < 0) {
+        LAB2_LOG_ERROR("Error writing to disk at offset {}: {}", request.offset, std::strerror(static_cast<int>(-request.result)));
         return false;
     }
-    if (static_cast<size_t>(written) != blockSize_) {
-        std::cerr << "Partial write to disk at offset "
-                  << offset << ": wrote " << written << " bytes, expected " << blockSize_ << " bytes.\n";
+    if (static_cast<size_t>(request.result) != request.length) {
+        LAB2_LOG_ERROR("Partial write to disk at offset {}: wrote {} bytes, expected {} bytes.",
+                       request.offset, request.result, request.length);
         return false;
     }
     return true;
@@ -2,50 +2,426 @@
 #define BLOCK_CACHE_HPP
 
 #include <unordered_map>
-#include <deque>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <span>
 #include "Block.hpp"
+#include "BlockPool.hpp"
 #include "CacheKey.hpp"
+#include "CompressedTier.hpp"
+#include "EvictionPolicy.hpp"
+#include "IoBackend.hpp"
+#include "Readahead.hpp"
+#include "SlotTable.hpp"
+#include "Statistics.hpp"
 
 /**
  * \class BlockCache
- * \brief A fixed-size block cache implementing the Clock eviction policy.
+ * \brief A fixed-size block cache with a pluggable eviction policy (Clock by default).
+ *
+ * The cache is safe to share between threads. Lookups go through an open-addressing
+ * table (SlotTable) split into independently locked shards; the EvictionPolicy is serialized by
+ * its own mutex, while hits only set an atomic reference bit. A block is handed out
+ * pinned (see Handle) and is never evicted or freed while pinned.
+ *
+ * Block buffers come from a BlockPool sized capacity * blockSize at
+ * construction. Slot i always uses buffer i, and each shard's SlotTable is
+ * sized for its share of the capacity, so a miss in steady state hardly ever allocates.
+ *
+ * Disk transfers go through an IoBackend. Batched loads (prefetch(), preload())
+ * and write-back of a range (flushFd(), evictRange()) are submitted together,
+ * so up to the backend's queue depth of them are in flight at once. A block is
+ * published before its read is issued; a thread that wants it meanwhile waits
+ * for that read instead of issuing another one.
+ *
+ * The cache counts its dirty blocks and remembers when each turned dirty, so
+ * that a background flusher (WritebackFlusher) can write them back early with
+ * writeBack() and eviction mostly finds clean victims. Each block also keeps a
+ * bitmap of the SECTOR_SIZE sectors written since it was last clean, and
+ * write-back sends only those (rounded up to the direct I/O alignment of the
+ * file). A block overwritten as a whole (overwrite()) is never read.
+ *
+ * Every fd also has a list of its cached blocks, so that flushFd(), syncFd()
+ * and long evictRange() calls only visit that fd's blocks.
+ *
+ * With a CompressedTier (setCompressedTier()), clean victims are compressed
+ * on eviction and a later miss on them decompresses instead of reading.
+ *
+ * Sparse files (setSparseFiles()): write-back punches a hole for every
+ * file-system block of a dirty extent that is all zero rather than writing
+ * it, and a miss on a block that lies in a hole zero-fills it without a
+ * read. Each fd remembers the last data and hole extents lseek(SEEK_DATA /
+ * SEEK_HOLE) reported, so a miss only asks the file system again outside
+ * them; a write to the fd forgets the hole.
+ *
+ * Lock order: shard mutex, then policy mutex or file index mutex (never both).
+ * Nothing waits for a shard mutex while holding either of the others.
  */
 class BlockCache {
+ struct CacheEntry;
+
 public:
- BlockCache(std::size_t capacity, std::size_t blockSize);
+ static constexpr std::size_t DEFAULT_SHARD_COUNT = 16;
+ /// How long a miss waits for a pinned block to be released before ENOMEM
+ static constexpr std::chrono::milliseconds PIN_WAIT_LIMIT{1000};
+ /// Dirty victims one eviction passes over, leaving them to the flusher, before it writes one itself
+ static constexpr std::size_t MAX_DIRTY_SKIPS = 8;
+ /// Most dirty extents write-back puts in one vectored write
+ static constexpr std::size_t MAX_WRITEBACK_RUN = 64;
+ /// Granularity of dirty tracking within a block
+ static constexpr std::size_t SECTOR_SIZE = 512;
+
+ using Lookup = StreamDetector::Lookup;
+
+ /// Readahead effectiveness; misses are reported by the reader
+ struct ReadaheadCounters {
+  /// Blocks loaded by prefetch()
+  std::atomic<std::uint64_t> issued{0};
+  /// First accesses to a prefetched block
+  std::atomic<std::uint64_t> hits{0};
+  /// Blocks a sequential reader expected to be prefetched but had to load
+  std::atomic<std::uint64_t> misses{0};
+  /// Prefetched blocks dropped before anyone used them
+  std::atomic<std::uint64_t> wasted{0};
+ };
+
+ /// Background write-back done by writeBack()
+ struct WritebackCounters {
+  /// Blocks written back
+  std::atomic<std::uint64_t> blocks{0};
+  /// Write calls they took; lower than blocks when adjacent ones were coalesced
+  std::atomic<std::uint64_t> writes{0};
+ };
+
+ /**
+  * \class Handle
+  * \brief Pins one cached block for as long as the handle lives.
+  */
+ class Handle {
+ public:
+  Handle() = default;
+  Handle(Handle&& other) noexcept : cache_(other.cache_), entry_(other.entry_), lookup_(other.lookup_) { other.entry_ = nullptr; }
+  Handle& operator=(Handle&& other) noexcept;
+  Handle(const Handle&) = delete;
+  Handle& operator=(const Handle&) = delete;
+  ~Handle() { release(); }
+
+  explicit operator bool() const { return entry_ != nullptr; }
+  /// Whether acquire() found the block, found it prefetched, or loaded it
+  Lookup lookup() const { return lookup_; }
+
+  void* data() const;
+  /// Marks the whole block modified
+  void markDirty();
+  /// Marks only the bytes [offset, offset + length) of the block modified
+  void markDirty(std::size_t offset, std::size_t length);
+  /// Unpins the block early; the handle becomes empty.
+  void release();
+
+ private:
+  friend class BlockCache;
+  Handle(BlockCache* cache, CacheEntry* entry, Lookup lookup) : cache_(cache), entry_(entry), lookup_(lookup) {}
+
+  BlockCache* cache_ = nullptr;
+  CacheEntry* entry_ = nullptr;
+  Lookup lookup_ = Lookup::MISS;
+ };
+
+ BlockCache(std::size_t capacity, std::size_t blockSize,
+            std::size_t shardCount = DEFAULT_SHARD_COUNT,
+            BlockPool::PageMode pageMode = BlockPool::PageMode::TRANSPARENT_HUGE,
+            IoBackend::Kind ioBackend = IoBackend::Kind::AUTO,
+            EvictionPolicy::Kind eviction = EvictionPolicy::Kind::CLOCK);
  ~BlockCache() = default;
 
  std::size_t blockSize() const { return blockSize_; }
+ std::size_t capacity() const { return capacity_; }
+
+ /**
+  * Returns the block pinned, loading it from disk on a miss. On failure the
+  * handle is empty and errno is set (ENOMEM when every block stayed pinned
+  * for PIN_WAIT_LIMIT). With noReuse the access does not set the reference
+  * bit, so a block that nobody else touches is evicted first.
+  */
+ Handle acquire(int fd, off_t blockIndex, bool noReuse = false);
+ /**
+  * Replaces the whole block with blockSize() bytes from data and marks it
+  * dirty. On a miss the block is not read from disk first. Returns false
+  * with errno set if no slot could be had.
+  */
+ bool overwrite(int fd, off_t blockIndex, const void* data, bool noReuse = false);
+ /**
+  * Loads the block if it is not cached, without pinning it. The block enters
+  * with a clear reference bit, so it goes first if nobody reads it.
+  */
+ bool prefetch(int fd, off_t blockIndex);
+ /**
+  * Prefetches count blocks starting at firstBlock, reading the missing ones
+  * with a single batch. Stops early if no slot can be freed without waiting.
+  * Returns how many of the blocks are cached afterwards.
+  */
+ std::size_t prefetch(int fd, off_t firstBlock, std::size_t count);
+ /**
+  * Like prefetch(), for blocks the caller is about to acquire: they are not
+  * counted or flagged as readahead.
+  */
+ std::size_t preload(int fd, off_t firstBlock, std::size_t count);
+ /// preload() of any set of blocks, still read with a single batch.
+ std::size_t preload(int fd, std::span<const off_t> blocks);
+ /**
+  * Writes back every dirty block of fd and drops all of its blocks. False
+  * with errno EIO if a write failed; the blocks it was for stay cached, dirty.
+  */
+ bool flushFd(int fd);
+ /// Drops every block of fd without writing anything back, dirty or not; for an fd about to be closed
+ void discardFd(int fd);
+ /**
+  * Writes back the dirty blocks of fd in [firstBlock, lastBlock], in offset
+  * order with adjacent ones coalesced, and keeps every block cached. Costs
+  * time in the number of the fd's cached blocks (or of the range, if shorter),
+  * not the cache size. False with errno EIO if a write failed; the data it
+  * held stays dirty.
+  */
+ bool syncRange(int fd, off_t firstBlock, off_t lastBlock);
+ /// syncRange() over every block of fd
+ bool syncFd(int fd) { return syncRange(fd, 0, std::numeric_limits<off_t>::max()); }
+ /**
+  * Writes back and drops the blocks of fd in [firstBlock, lastBlock]; pinned
+  * blocks stay. False with errno EIO if a write failed, as for flushFd().
+  */
+ bool evictRange(int fd, off_t firstBlock, off_t lastBlock);
+ /// Clears the reference bit of a cached block so that it is the next to go.
+ void deprioritize(int fd, off_t blockIndex);
+ /// True if the block is cached right now (for tests and diagnostics).
+ bool contains(int fd, off_t blockIndex);
+
+ /// One cached block, see residentBlocks()
+ struct ResidentBlock {
+  int fd;
+  off_t blockIndex;
+  /// EvictionPolicy::heat() of its slot
+  unsigned heat;
+ };
+ /**
+  * Every block cached right now, those still loading included, with how hot
+  * the policy rates it; in no particular order. Costs time in the number of
+  * cached blocks. Blocks loaded or evicted meanwhile may or may not show.
+  */
+ std::vector<ResidentBlock> residentBlocks();
+
+ /**
+  * Writes back up to maxBlocks unpinned dirty blocks that turned dirty before
+  * dirtiedBefore, oldest first. They stay cached, clean. Adjacent dirty
+  * extents of one fd go out as a single vectored write. Returns the blocks
+  * written.
+  */
+ std::size_t writeBack(std::chrono::steady_clock::time_point dirtiedBefore, std::size_t maxBlocks);
+ std::size_t dirtyCount() const { return dirtyCount_.load(std::memory_order_relaxed); }
+ /**
+  * Installs a callback run by the writing thread whenever a block turns dirty
+  * while more than limit blocks are, and by an eviction that passes over a
+  * dirty victim. Without one, eviction writes dirty victims back right away.
+  * Must not race with other calls on the cache.
+  */
+ void setDirtyLimit(std::size_t limit, std::function<void()> callback);
+ /**
+  * Keeps clean evicted blocks compressed in up to budgetBytes of memory
+  * besides the cache itself; 0 turns the tier off. Must not race with other
+  * calls on the cache.
+  */
+ void setCompressedTier(std::size_t budgetBytes);
+ /// Null unless setCompressedTier() turned it on
+ CompressedTier* compressedTier() const { return tier_.get(); }
+ /**
+  * Turns hole punching for zeros and hole detection on misses on or off; on
+  * by default. Must not race with other calls on the cache.
+  */
+ void setSparseFiles(bool enabled) { sparseFiles_ = enabled; }
 
- bool readBlock(int fd, off_t blockIndex);
- void* blockData(int fd, off_t blockIndex);
- void markDirty(int fd, off_t blockIndex);
- void flushFd(int fd);
+ ReadaheadCounters& readaheadCounters() { return readaheadCounters_; }
+ WritebackCounters& writebackCounters() { return writebackCounters_; }
+ /**
+  * Lookups, evictions and disk traffic so far. A block preload() reads counts
+  * as a miss, and the acquire() that follows as a hit.
+  */
+ CacheStats stats();
+ const IoBackend& ioBackend() const { return *io_; }
+ const EvictionPolicy& evictionPolicy() const { return *policy_; }
 
 private:
  struct CacheEntry {
-  std::unique_ptr<Block> block;
-  bool referenceBit = false;
+  /// Attached to pool_ buffer of the same slot
+  Block block;
+  /// Number of live handles; eviction skips pinned entries
+  std::atomic<std::uint32_t> pins{0};
+  /// Loaded by prefetch() and not accessed since
+  std::atomic<bool> prefetched{false};
+  /// Published, but the read from disk has not completed; acquire() waits for it
+  std::atomic<bool> loading{false};
+  /// The read failed; set while waiters let go of the entry
+  std::atomic<bool> loadFailed{false};
+  /// steady_clock ticks when the block last turned dirty
+  std::atomic<std::int64_t> dirtySince{0};
+  /// Neighbours in the list of its fd's blocks, see fileBlocks_
+  std::size_t filePrev = SlotTable::npos;
+  std::size_t fileNext = SlotTable::npos;
+ };
+
+ /// Cached blocks of one fd, linked through their entries in no particular order
+ struct FileBlocks {
+  std::size_t head = SlotTable::npos;
+  std::size_t count = 0;
+ };
+
+ enum class LoadMode {
+  /// acquire(): the caller gets the block pinned
+  ACQUIRE,
+  /// prefetch(): counted and flagged as readahead
+  PREFETCH,
+  /// preload(): loaded for a caller that acquires it next
+  PRELOAD,
+ };
+
+ /// Dirty bytes of one block, taken for writing back
+ struct DirtySegment {
+  int fd;
+  off_t offset;
+  unsigned char* data;
+  std::size_t length;
+  /// Slot of the block the bytes belong to
+  std::size_t slot;
+  bool written;
+  /// All zero: punched out of the file instead of written
+  bool punch = false;
+ };
+
+ /// What lseek(SEEK_DATA/SEEK_HOLE) last reported for one fd; a range is empty when its begin and end are equal
+ struct FileExtents {
+  off_t dataBegin = 0;
+  off_t dataEnd = 0;
+  off_t holeBegin = 0;
+  off_t holeEnd = 0;
+  /// Writes issued to the fd; a hole that a write may have filled during the lseek is not recorded
+  std::uint64_t writes = 0;
+ };
+
+ struct alignas(64) Shard {
+  std::mutex mutex;
+  /// Cached blocks: CacheKey -> slot in entries_ and policy_
+  SlotTable entries;
  };
 
  std::size_t capacity_;
  std::size_t blockSize_;
+ std::size_t shardCount_;
+ /// 64-bit words of dirty sector bits per block
+ std::size_t sectorWords_;
+
+ BlockPool pool_;
+ std::unique_ptr<IoBackend> io_;
+ std::unique_ptr<Shard[]> shards_;
+ /// One entry per policy slot
+ std::unique_ptr<CacheEntry[]> entries_;
+ /// Dirty sector bits, sectorWords_ per slot; set before the block's dirty flag
+ std::unique_ptr<std::atomic<std::uint64_t>[]> dirtySectors_;
+
+ /// Guards policy_ (except reference bits) and slotKeys_
+ std::mutex policyMutex_;
+ /// Hands out the slots and picks victims; one slot per cached block
+ std::unique_ptr<EvictionPolicy> policy_;
+ /// Slot index -> key of the block occupying (or being loaded into) it
+ std::vector<CacheKey> slotKeys_;
+
+ /// Guards fileBlocks_, fileExtents_ and the list links of every entry
+ std::mutex fileIndexMutex_;
+ /// fd -> its published blocks, so that per-fd work skips the rest of the cache
+ std::unordered_map<int, FileBlocks> fileBlocks_;
+ /// fd -> extents known from the file system; dropped by flushFd(), before the fd number can be reused
+ std::unordered_map<int, FileExtents> fileExtents_;
+
+ bool sparseFiles_ = true;
+ /// Cleared when a file system does not support punching holes; its zeros are written from then on
+ std::atomic<bool> punchHoles_{true};
+
+ ReadaheadCounters readaheadCounters_;
+ WritebackCounters writebackCounters_;
+ StripedStats stats_;
+
+ std::atomic<std::size_t> dirtyCount_{0};
+ std::size_t dirtyLimit_ = SIZE_MAX;
+ std::function<void()> onDirtyLimit_;
+
+ std::unique_ptr<CompressedTier> tier_;
 
- /// Map of cache entries: CacheKey -> CacheEntry
- std::unordered_map<CacheKey, CacheEntry> cacheEntries_;
- // /// Order for the Clock algorithm
- // std::deque<CacheKey> evictionOrder_;
- /// Clock hand index for eviction
- std::size_t clockHand_ = 0;
- /// Vector of CacheKeys to maintain order
- std::vector<CacheKey> evictionOrder_;
-
- bool evictOne();
- bool loadBlockFromDisk(int fd, off_t blockIndex, Block& block);
- bool writeBlockToDisk(int fd, Block& block);
+ Shard& shardFor(const CacheKey& key);
+ /// Adds or removes a block in its fd's list; called with its shard locked, as it is published or unpublished
+ void linkFileBlock(int fd, std::size_t slot);
+ void unlinkFileBlock(int fd, std::size_t slot);
+ /// Appends the cached blocks of fd in [firstBlock, lastBlock] to blocks, or the whole range if it is shorter
+ void fileBlocksIn(int fd, off_t firstBlock, off_t lastBlock, std::vector<off_t>& blocks);
+ /// Dirty flag transitions; they keep dirtyCount_ and dirtySince up to date
+ void markDirty(CacheEntry& entry, std::size_t offset, std::size_t length);
+ /**
+  * Clears the dirty state of the block in slot and appends its dirty sectors,
+  * widened to granule-aligned extents, to segments. False if it was clean.
+  */
+ bool takeDirty(std::size_t slot, int fd, std::size_t granule, std::vector<DirtySegment>& segments);
+ /// Makes a segment that failed to write dirty again
+ void restoreDirty(const DirtySegment& segment);
+ /// Smallest aligned write the file accepts (its direct I/O alignment), capped at blockSize_
+ std::size_t writeGranule(int fd) const;
+ /// Writes segments, merging contiguous ones, and sets their written flags; returns the writes issued
+ std::size_t writeSegments(std::vector<DirtySegment>& segments);
+ /**
+  * Splits off the all-zero file-system blocks of sorted segments as punch
+  * segments. Zeros past the end of the file stay writes, unless data in the
+  * same batch lies beyond them, as punching does not extend the file; then
+  * they are dropped, as writing that data leaves a hole under them anyway.
+  */
+ void splitZeroRuns(std::vector<DirtySegment>& segments);
+ /// Whether [begin, end) of fd is known to lie in a hole, asking the file system if the extents of fd do not tell
+ bool inHole(int fd, off_t begin, off_t end);
+ /// Zero-fills a slot being loaded and completes the load if its block lies in a hole; false otherwise
+ bool loadHole(const CacheKey& key, std::size_t slot);
+ Handle pinOnly(std::size_t slot);
+ Handle pinLocked(std::size_t slot, Lookup lookup, bool reference);
+ /// Waits until a pinned block has been read; empty handle with EIO if the read failed
+ Handle waitLoaded(Handle handle);
+ Handle loadAndPin(const CacheKey& key, LoadMode mode, bool noReuse);
+ std::size_t loadBatch(int fd, std::span<const off_t> blocks, LoadMode mode);
+ /**
+  * Publishes a freshly allocated slot under key, marked loading and pinned for
+  * the loader, before its read is issued, so that nobody reads the block twice.
+  * If key is cached already, frees the slot and pins the existing block instead.
+  */
+ Handle insertLoading(const CacheKey& key, std::size_t slot, LoadMode mode, bool noReuse, bool& inserted);
+ /// Fills a slot being loaded from the compressed tier and completes the load; false if the tier does not have it
+ bool loadFromTier(const CacheKey& key, std::size_t slot);
+ /**
+  * Compresses an evicted clean block into the tier, with the shard lock
+  * released meanwhile. False if the block was used or changed during that,
+  * and is no victim any more. Pass the shard's lock, held.
+  */
+ bool moveToTier(const CacheKey& key, std::size_t slot, std::unique_lock<std::mutex>& lock);
+ /// Marks a load complete, or unpublishes the slot and frees it if the read failed
+ bool finishLoad(const CacheKey& key, std::size_t slot, const IoRequest& request);
+ void dropPrefetched(CacheEntry& entry);
+ /// Writes back (unless discardDirty) and drops the blocks of fd in range; false with errno EIO if a write failed
+ bool dropBlocks(int fd, off_t firstBlock, off_t lastBlock, bool waitForPins, bool discardDirty = false);
+ std::size_t allocateSlot(const CacheKey& key);
+ void releaseSlot(std::size_t slot);
+ std::size_t evictOne(const CacheKey& newKey);
+ IoRequest readRequest(int fd, Block& block) const;
+ /// Zero-fills what a short read left out; false if the read failed
+ bool completeLoad(const IoRequest& request);
+ bool completeWrite(const IoRequest& request);
 };
 
 #endif // BLOCK_CACHE_HPP
@@ -0,0 +1,54 @@
+#include "BlockPool.hpp"
+#include <sys/mman.h>   // mmap, madvise, munmap
+#include <stdexcept>    // runtime_error
+
+namespace {
+
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+BlockPool::BlockPool(std::size_t count, std::size_t blockSize, PageMode mode)
+    : count_(count)
+    , stride_(roundUp(blockSize, ALIGNMENT))
+    , mappedSize_(roundUp(count * stride_, ALIGNMENT))
+{
+    if (mappedSize_ == 0) {
+        return; // Empty cache, nothing to map
+    }
+
+    void* mapped = MAP_FAILED;
+    if (mode == PageMode::EXPLICIT_HUGE) {
+        std::size_t hugeSize = roundUp(mappedSize_, HUGE_PAGE_SIZE);
+        mapped = ::mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapped != MAP_FAILED) {
+            mappedSize_ = hugeSize;
+            hugeTlb_ = true;
+        }
+    }
+    if (mapped == MAP_FAILED) {
+        // Anonymous pages are zeroed by the kernel and only committed on first touch
+        mapped = ::mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("mmap failed in BlockPool constructor.");
+        }
+        if (mode != PageMode::NORMAL) {
+            // Only a hint: fails harmlessly when THP is disabled
+            ::madvise(mapped, mappedSize_, MADV_HUGEPAGE);
+        }
+    }
+    base_ = static_cast<unsigned char*>(mapped);
+}
+
+BlockPool::~BlockPool()
+{
+    if (base_ != nullptr) {
+        ::munmap(base_, mappedSize_);
+    }
+}
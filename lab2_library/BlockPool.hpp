@@ -0,0 +1,50 @@
+#ifndef BLOCK_POOL_HPP
+#define BLOCK_POOL_HPP
+
+#include <cstddef>
+
+/**
+ * \class BlockPool
+ * \brief One preallocated, page-aligned arena holding every block buffer of a cache.
+ *
+ * Buffer i lives at a fixed offset for the lifetime of the pool, so the cache
+ * reuses it in place when the block in slot i is evicted. Nothing is allocated
+ * or freed after construction.
+ */
+class BlockPool {
+public:
+    enum class PageMode {
+        /// Regular pages only
+        NORMAL,
+        /// Ask for transparent huge pages with madvise(MADV_HUGEPAGE)
+        TRANSPARENT_HUGE,
+        /// Try MAP_HUGETLB (needs reserved huge pages), fall back to TRANSPARENT_HUGE
+        EXPLICIT_HUGE,
+    };
+
+    /// Buffers are aligned for O_DIRECT
+    static constexpr std::size_t ALIGNMENT = 4096;
+
+    BlockPool(std::size_t count, std::size_t blockSize, PageMode mode = PageMode::TRANSPARENT_HUGE);
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* buffer(std::size_t index) const { return base_ + index * stride_; }
+
+    std::size_t count() const { return count_; }
+    /// Distance between two consecutive buffers (block size rounded up to ALIGNMENT)
+    std::size_t stride() const { return stride_; }
+    /// True if the arena is backed by MAP_HUGETLB pages
+    bool usesHugeTlb() const { return hugeTlb_; }
+
+private:
+    std::size_t count_;
+    std::size_t stride_;
+    std::size_t mappedSize_;
+    bool hugeTlb_ = false;
+    unsigned char* base_ = nullptr;
+};
+
+#endif // BLOCK_POOL_HPP
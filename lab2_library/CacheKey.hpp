@@ -3,8 +3,7 @@
 
 #include <functional> // for std::hash
 #include <cstddef>    // for std::size_t
-
-#define GOLDEN_RATIO_HASH_CONSTANT 0x9E3779B9
+#include <cstdint>    // for std::uint64_t
 
 /**
  * @struct CacheKey
@@ -25,15 +24,30 @@ struct CacheKey {
     }
 };
 
+/**
+ * 64-bit hash of a key, with every input bit reaching every output bit.
+ * The block index is spread by an odd multiplier, so two blocks of one file
+ * never collide before the final mix, which is the MurmurHash3 finalizer.
+ * Both halves of the result are usable on their own: SlotTable takes the low
+ * bits, BlockCache picks shards from the high ones.
+ */
+inline std::uint64_t hashKey(const CacheKey& key) {
+    std::uint64_t h = static_cast<std::uint64_t>(key.blockIndex) * 0x9E3779B97F4A7C15ull
+                      ^ static_cast<std::uint32_t>(key.fd);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
 // Hash specialization for std::unordered_map
 namespace std {
     template <>
     struct hash<CacheKey> {
         size_t operator()(const CacheKey& key) const noexcept {
-            // Combine hashes of `fd` and `blockIndex` using a simple hash combining technique
-            size_t h1 = std::hash<int>()(key.fd);
-            size_t h2 = std::hash<off_t>()(key.blockIndex);
-            return h1 ^ (h2 + GOLDEN_RATIO_HASH_CONSTANT + (h1 << 6) + (h1 >> 2)); // Inspired by boost::hash_combine
+            return static_cast<size_t>(hashKey(key));
         }
     };
 }
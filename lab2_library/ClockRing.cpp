@@ -0,0 +1,75 @@
+#include "ClockRing.hpp"
+#include <bit>          // std::countr_zero, std::popcount
+#include <stdexcept>    // runtime_error
+
+ClockRing::ClockRing(std::size_t capacity)
+    : capacity_(capacity)
+    , occupied_((capacity + 63) / 64, 0)
+    , referenced_(std::make_unique<std::atomic<std::uint64_t>[]>((capacity + 63) / 64))
+{
+    freeSlots_.reserve(capacity_);
+    // Push in reverse so that the lowest slots are handed out first
+    for (std::size_t slot = capacity_; slot > 0; --slot) {
+        freeSlots_.push_back(slot - 1);
+    }
+}
+
+std::size_t ClockRing::insert(bool referenced) {
+    if (freeSlots_.empty()) {
+        return npos;
+    }
+    std::size_t slot = freeSlots_.back();
+    freeSlots_.pop_back();
+
+    occupied_[slot >> 6] |= bit(slot);
+    if (referenced) {
+        reference(slot);
+    } else {
+        clearReference(slot);
+    }
+    ++size_;
+    return slot;
+}
+
+void ClockRing::remove(std::size_t slot) {
+    if (slot >= capacity_ || !isOccupied(slot)) {
+        throw std::runtime_error("ClockRing::remove called on a free slot");
+    }
+    occupied_[slot >> 6] &= ~bit(slot);
+    clearReference(slot);
+    freeSlots_.push_back(slot);
+    --size_;
+}
+
+std::size_t ClockRing::nextVictim() {
+    if (size_ == 0) {
+        return npos;
+    }
+
+    // Terminates within one full rotation plus one word: the first rotation
+    // clears every reference bit it passes over.
+    for (;;) {
+        std::size_t word = hand_ >> 6;
+        std::uint64_t fromHand = ~std::uint64_t{0} << (hand_ & 63);
+        std::uint64_t swept = occupied_[word] & fromHand;
+        std::uint64_t candidates = swept & ~referenced_[word].load(std::memory_order_relaxed);
+
+        if (candidates != 0) {
+            std::size_t slot = (word << 6) + static_cast<std::size_t>(std::countr_zero(candidates));
+            // Slots the hand passed before reaching the victim lose their bit
+            const std::uint64_t passed = swept & (bit(slot) - 1);
+            const std::uint64_t before = referenced_[word].fetch_and(~passed, std::memory_order_relaxed);
+            secondChances_ += static_cast<std::uint64_t>(std::popcount(before & passed));
+            hand_ = slot + 1 < capacity_ ? slot + 1 : 0;
+            return slot;
+        }
+
+        // Second chance for every occupied slot of this word the hand passed
+        const std::uint64_t before = referenced_[word].fetch_and(~swept, std::memory_order_relaxed);
+        secondChances_ += static_cast<std::uint64_t>(std::popcount(before & swept));
+        hand_ = (word + 1) << 6;
+        if (hand_ >= capacity_) {
+            hand_ = 0;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef CLOCK_RING_HPP
+#define CLOCK_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * \class ClockRing
+ * \brief Fixed-slot ring for the Clock (second chance) eviction policy.
+ *
+ * Every cached block occupies one slot for its whole lifetime in the cache.
+ * Occupancy and reference bits are packed into 64-bit words, so the sweep
+ * skips whole words of empty or freshly referenced slots at once. Insertion
+ * and removal are O(1) (free slots are kept on a stack), eviction is
+ * amortized O(1).
+ *
+ * Reference bits are atomic so that cache hits can set them without a lock.
+ * Everything else (insert, remove, the sweep) must be serialized by the owner.
+ */
+class ClockRing {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    explicit ClockRing(std::size_t capacity);
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == capacity_; }
+
+    /// Takes a free slot and returns its index, or npos if the ring is full.
+    std::size_t insert(bool referenced = true);
+    /// Releases an occupied slot.
+    void remove(std::size_t slot);
+
+    void reference(std::size_t slot) {
+        std::atomic<std::uint64_t>& word = referenced_[slot >> 6];
+        // Check first so that hot blocks do not keep bouncing the cache line
+        if ((word.load(std::memory_order_relaxed) & bit(slot)) == 0) {
+            word.fetch_or(bit(slot), std::memory_order_relaxed);
+        }
+    }
+    void clearReference(std::size_t slot) {
+        referenced_[slot >> 6].fetch_and(~bit(slot), std::memory_order_relaxed);
+    }
+
+    bool isOccupied(std::size_t slot) const { return (occupied_[slot >> 6] & bit(slot)) != 0; }
+    bool isReferenced(std::size_t slot) const {
+        return (referenced_[slot >> 6].load(std::memory_order_relaxed) & bit(slot)) != 0;
+    }
+
+    /**
+     * Sweeps the clock hand forward, clearing reference bits on the way,
+     * and returns the first occupied slot whose reference bit was already
+     * clear. The hand is left just past the returned slot. Returns npos only
+     * when the ring is empty.
+     */
+    std::size_t nextVictim();
+    /// Referenced slots the hand has passed over so far
+    std::uint64_t secondChances() const { return secondChances_; }
+
+private:
+    static std::uint64_t bit(std::size_t slot) { return std::uint64_t{1} << (slot & 63); }
+
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+    /// Clock hand: slot index the next sweep starts from
+    std::size_t hand_ = 0;
+    std::vector<std::uint64_t> occupied_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> referenced_;
+    /// Stack of free slot indices
+    std::vector<std::size_t> freeSlots_;
+    std::uint64_t secondChances_ = 0;
+};
+
+#endif // CLOCK_RING_HPP
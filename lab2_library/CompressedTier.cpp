@@ -0,0 +1,104 @@
+#include "CompressedTier.hpp"
+#include <algorithm>    // std::clamp
+#include <iterator>     // std::prev
+#include "Compression.hpp"
+#include "Log.hpp"
+
+CompressedTier::CompressedTier(std::size_t budgetBytes, std::size_t blockSize, double maxRatio)
+    : budget_(budgetBytes)
+    , blockSize_(blockSize)
+    , keepLimit_(static_cast<std::size_t>(std::clamp(maxRatio, 0.0, 1.0) * static_cast<double>(blockSize))) {
+}
+
+bool CompressedTier::compress(const void* block, std::vector<unsigned char>& out) {
+    // Room for keepLimit_ bytes only, so that the codec gives up on a block as
+    // soon as it is clear that it will not shrink enough
+    out.resize(keepLimit_);
+    const std::size_t size = keepLimit_ == 0 ? 0 : compressBlock(block, blockSize_, out.data(), out.size());
+    if (size == 0) {
+        counters_.rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    out.resize(size);
+    return true;
+}
+
+void CompressedTier::store(const CacheKey& key, const std::vector<unsigned char>& compressed) {
+    if (compressed.size() > budget_) {
+        return;
+    }
+    counters_.stored.fetch_add(1, std::memory_order_relaxed);
+    counters_.rawBytes.fetch_add(blockSize_, std::memory_order_relaxed);
+    counters_.compressedBytes.fetch_add(compressed.size(), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        eraseLocked(it);
+    }
+    while (bytes_ + compressed.size() > budget_) {
+        LAB2_LOG_TRACE("Compressed tier is full, dropping block (fd={}, blockIndex={}).",
+                       lru_.front().fd, lru_.front().blockIndex);
+        eraseLocked(entries_.find(lru_.front()));
+    }
+    lru_.push_back(key);
+    entries_.emplace(key, Entry{compressed, std::prev(lru_.end())});
+    bytes_ += compressed.size();
+}
+
+bool CompressedTier::take(const CacheKey& key, void* block) {
+    std::vector<unsigned char> compressed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            counters_.misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        compressed = std::move(it->second.data);
+        bytes_ -= compressed.size();
+        lru_.erase(it->second.age);
+        entries_.erase(it);
+    }
+
+    // Decompressed outside the lock; the block is the caller's alone by now
+    if (!decompressBlock(compressed.data(), compressed.size(), block, blockSize_)) {
+        LAB2_LOG_ERROR("Corrupt block in the compressed tier (fd={}, blockIndex={}).", key.fd, key.blockIndex);
+        counters_.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    counters_.hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CompressedTier::erase(const CacheKey& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        eraseLocked(it);
+    }
+}
+
+void CompressedTier::eraseRange(int fd, off_t firstBlock, off_t lastBlock) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.lower_bound({fd, firstBlock});
+    while (it != entries_.end() && it->first.fd == fd && it->first.blockIndex <= lastBlock) {
+        eraseLocked(it++);
+    }
+}
+
+std::size_t CompressedTier::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::size_t CompressedTier::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void CompressedTier::eraseLocked(std::map<CacheKey, Entry>::iterator it) {
+    bytes_ -= it->second.data.size();
+    lru_.erase(it->second.age);
+    entries_.erase(it);
+}
@@ -0,0 +1,95 @@
+#ifndef COMPRESSED_TIER_HPP
+#define COMPRESSED_TIER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "CacheKey.hpp"
+
+/**
+ * \class CompressedTier
+ * \brief Clean blocks evicted from a BlockCache, kept LZ4-compressed in a byte budget of their own.
+ *
+ * Like zswap for the page cache: a block the cache evicts clean goes here if
+ * it compresses to at most maxRatio of its size, and a miss on it later is a
+ * decompression instead of a disk read. Past the budget the least recently
+ * stored blocks are dropped; they are clean, so nothing is lost.
+ *
+ * A block is in the cache or in the tier, never both: BlockCache stores it as
+ * it unpublishes it, and takes it back out when it publishes it again.
+ * The tier only has its own lock, taken after a shard lock if any.
+ */
+class CompressedTier {
+public:
+    /// Blocks that do not compress to at most this share of their size are not kept
+    static constexpr double DEFAULT_MAX_RATIO = 0.75;
+
+    struct Counters {
+        /// Misses served from the tier
+        std::atomic<std::uint64_t> hits{0};
+        /// Misses it could not serve either
+        std::atomic<std::uint64_t> misses{0};
+        /// Evicted blocks stored, and the ones that compressed too poorly to keep
+        std::atomic<std::uint64_t> stored{0};
+        std::atomic<std::uint64_t> rejected{0};
+        /// Size of the stored blocks before and after compression
+        std::atomic<std::uint64_t> rawBytes{0};
+        std::atomic<std::uint64_t> compressedBytes{0};
+    };
+
+    CompressedTier(std::size_t budgetBytes, std::size_t blockSize, double maxRatio = DEFAULT_MAX_RATIO);
+
+    CompressedTier(const CompressedTier&) = delete;
+    CompressedTier& operator=(const CompressedTier&) = delete;
+
+    /**
+     * Compresses a block into out (resized to fit). False if it did not get
+     * down to maxRatio; that is counted as rejected. Takes no lock.
+     */
+    bool compress(const void* block, std::vector<unsigned char>& out);
+    /// Keeps a compressed copy of key's block in place of any older one, dropping the oldest copies past the budget
+    void store(const CacheKey& key, const std::vector<unsigned char>& compressed);
+    /// Decompresses key's block into block (blockSize bytes) and forgets it; false if the tier does not have it
+    bool take(const CacheKey& key, void* block);
+    /// Forgets key's block, for a caller that replaces it without reading it
+    void erase(const CacheKey& key);
+    /// Forgets the blocks of fd in [firstBlock, lastBlock]
+    void eraseRange(int fd, off_t firstBlock, off_t lastBlock);
+
+    std::size_t budget() const { return budget_; }
+    /// Compressed bytes held right now
+    std::size_t bytes() const;
+    /// Blocks held right now
+    std::size_t size() const;
+    Counters& counters() { return counters_; }
+
+private:
+    struct Entry {
+        std::vector<unsigned char> data;
+        /// Position in lru_
+        std::list<CacheKey>::iterator age;
+    };
+
+    std::size_t budget_;
+    std::size_t blockSize_;
+    /// Largest compressed size worth keeping
+    std::size_t keepLimit_;
+
+    mutable std::mutex mutex_;
+    /// Ordered, so that eraseRange() finds a file's blocks without a scan
+    std::map<CacheKey, Entry> entries_;
+    /// Keys by store time, oldest first
+    std::list<CacheKey> lru_;
+    std::size_t bytes_ = 0;
+
+    Counters counters_;
+
+    /// Removes it; the caller holds mutex_
+    void eraseLocked(std::map<CacheKey, Entry>::iterator it);
+};
+
+#endif // COMPRESSED_TIER_HPP
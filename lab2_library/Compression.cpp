@@ -0,0 +1,260 @@
+#include "Compression.hpp"
+#include <algorithm>    // std::min
+#include <bit>          // std::countr_zero, std::endian
+#include <climits>      // INT_MAX
+#include <cstdint>      // std::uint32_t
+#include <cstring>      // memcpy
+
+#if LAB2_HAVE_LZ4
+#include <lz4.h>
+
+std::size_t compressBound(std::size_t n) {
+    return n > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE) ? 0 : static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(n)));
+}
+
+std::size_t compressBlock(const void* src, std::size_t n, void* dst, std::size_t dstCapacity) {
+    if (n > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE)) {
+        return 0;
+    }
+    const int result = LZ4_compress_default(static_cast<const char*>(src), static_cast<char*>(dst), static_cast<int>(n),
+                                            static_cast<int>(std::min<std::size_t>(dstCapacity, INT_MAX)));
+    return result > 0 ? static_cast<std::size_t>(result) : 0;
+}
+
+bool decompressBlock(const void* src, std::size_t srcSize, void* dst, std::size_t n) {
+    if (srcSize > INT_MAX || n > INT_MAX) {
+        return false;
+    }
+    const int result = LZ4_decompress_safe(static_cast<const char*>(src), static_cast<char*>(dst),
+                                           static_cast<int>(srcSize), static_cast<int>(n));
+    return result >= 0 && static_cast<std::size_t>(result) == n;
+}
+
+const char* compressionCodec() {
+    return "liblz4";
+}
+
+#else
+
+namespace {
+
+constexpr std::size_t MIN_MATCH = 4;
+/// The format ends every block with this many literals...
+constexpr std::size_t LAST_LITERALS = 5;
+/// ...and starts no match closer than this to the end
+constexpr std::size_t MATCH_FIND_LIMIT = 12;
+constexpr std::size_t MAX_OFFSET = 65535;
+/// Positions remembered, one per hash of the 4 bytes there; 16 KiB of table
+constexpr unsigned HASH_BITS = 12;
+/// After 2^SKIP_SHIFT positions without a match the search takes bigger steps
+constexpr unsigned SKIP_SHIFT = 6;
+/// Short copies in decompression move this many bytes at once where both buffers have room
+constexpr std::size_t FAST_COPY = 16;
+
+std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint64_t read64(const unsigned char* p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/// How far a and b agree, up to limit bytes; eight at a time while it can
+std::size_t commonLength(const unsigned char* a, const unsigned char* b, std::size_t limit) {
+    std::size_t length = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        for (; length + sizeof(std::uint64_t) <= limit; length += sizeof(std::uint64_t)) {
+            const std::uint64_t diff = read64(a + length) ^ read64(b + length);
+            if (diff != 0) {
+                return length + static_cast<std::size_t>(std::countr_zero(diff)) / 8;
+            }
+        }
+    }
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+std::uint32_t hash(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// The rest of a length whose 4 bits in the token were all ones: bytes of 255, then one below that
+unsigned char* writeLength(unsigned char* op, std::size_t length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+}
+
+/**
+ * Appends one sequence: literalCount literals, then a match of matchLength
+ * bytes offset back, or nothing for the last sequence (matchLength == 0).
+ * Null if it might not fit before outEnd.
+ */
+unsigned char* writeSequence(unsigned char* op, unsigned char* outEnd, const unsigned char* literals,
+                             std::size_t literalCount, std::size_t offset, std::size_t matchLength) {
+    const std::size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+    const std::size_t worst = 1 + literalCount / 255 + 1 + literalCount + 2 + matchCode / 255 + 1;
+    if (static_cast<std::size_t>(outEnd - op) < worst) {
+        return nullptr;
+    }
+
+    unsigned char* token = op++;
+    *token = static_cast<unsigned char>(std::min<std::size_t>(literalCount, 15) << 4);
+    if (literalCount >= 15) {
+        op = writeLength(op, literalCount - 15);
+    }
+    std::memcpy(op, literals, literalCount);
+    op += literalCount;
+    if (matchLength == 0) {
+        return op;
+    }
+
+    *op++ = static_cast<unsigned char>(offset & 0xFF);
+    *op++ = static_cast<unsigned char>(offset >> 8);
+    *token |= static_cast<unsigned char>(std::min<std::size_t>(matchCode, 15));
+    if (matchCode >= 15) {
+        op = writeLength(op, matchCode - 15);
+    }
+    return op;
+}
+
+} // namespace
+
+std::size_t compressBound(std::size_t n) {
+    return n + n / 255 + 16;
+}
+
+std::size_t compressBlock(const void* src, std::size_t n, void* dst, std::size_t dstCapacity) {
+    if (n > UINT32_MAX) {
+        return 0; // Positions in the table are 32-bit
+    }
+    const auto* const in = static_cast<const unsigned char*>(src);
+    const unsigned char* const inEnd = in + n;
+    auto* const out = static_cast<unsigned char*>(dst);
+    unsigned char* const outEnd = out + dstCapacity;
+    unsigned char* op = out;
+    const unsigned char* anchor = in; // First byte not written out yet
+
+    if (n > MATCH_FIND_LIMIT) {
+        std::uint32_t table[std::size_t{1} << HASH_BITS] = {};
+        const unsigned char* const matchFindLimit = inEnd - MATCH_FIND_LIMIT;
+        const unsigned char* const matchEnd = inEnd - LAST_LITERALS;
+        const unsigned char* ip = in;
+        std::size_t misses = 0;
+        while (ip < matchFindLimit) {
+            const std::uint32_t sequence = read32(ip);
+            std::uint32_t& slot = table[hash(sequence)];
+            const unsigned char* ref = in + slot;
+            slot = static_cast<std::uint32_t>(ip - in);
+            if (ref >= ip || static_cast<std::size_t>(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+                ip += 1 + (misses++ >> SKIP_SHIFT);
+                continue;
+            }
+            misses = 0;
+
+            // The match may also cover literals just before it
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const std::size_t length = MIN_MATCH + commonLength(ip + MIN_MATCH, ref + MIN_MATCH,
+                                                                static_cast<std::size_t>(matchEnd - ip) - MIN_MATCH);
+            op = writeSequence(op, outEnd, anchor, static_cast<std::size_t>(ip - anchor),
+                               static_cast<std::size_t>(ip - ref), length);
+            if (op == nullptr) {
+                return 0;
+            }
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, outEnd, anchor, static_cast<std::size_t>(inEnd - anchor), 0, 0);
+    return op == nullptr ? 0 : static_cast<std::size_t>(op - out);
+}
+
+bool decompressBlock(const void* src, std::size_t srcSize, void* dst, std::size_t n) {
+    const auto* ip = static_cast<const unsigned char*>(src);
+    const unsigned char* const inEnd = ip + srcSize;
+    auto* const out = static_cast<unsigned char*>(dst);
+    unsigned char* op = out;
+    unsigned char* const outEnd = out + n;
+
+    auto readLength = [&ip, inEnd](std::size_t& length) {
+        unsigned char byte;
+        do {
+            if (ip == inEnd) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < inEnd) {
+        const unsigned token = *ip++;
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !readLength(literals)) {
+            return false;
+        }
+        if (literals > static_cast<std::size_t>(inEnd - ip) || literals > static_cast<std::size_t>(outEnd - op)) {
+            return false;
+        }
+        if (literals <= FAST_COPY && static_cast<std::size_t>(inEnd - ip) >= FAST_COPY
+            && static_cast<std::size_t>(outEnd - op) >= FAST_COPY) {
+            std::memcpy(op, ip, FAST_COPY); // Most sequences are short; a fixed size copy is two moves
+        } else {
+            std::memcpy(op, ip, literals);
+        }
+        ip += literals;
+        op += literals;
+        if (ip == inEnd) {
+            break; // The last sequence has no match
+        }
+
+        if (inEnd - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | static_cast<std::size_t>(ip[1]) << 8;
+        ip += 2;
+        if (offset == 0 || offset > static_cast<std::size_t>(op - out)) {
+            return false;
+        }
+        std::size_t length = token & 15;
+        if (length == 15 && !readLength(length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (length > static_cast<std::size_t>(outEnd - op)) {
+            return false;
+        }
+        const unsigned char* ref = op - offset;
+        if (offset >= FAST_COPY && length <= FAST_COPY && static_cast<std::size_t>(outEnd - op) >= FAST_COPY) {
+            std::memcpy(op, ref, FAST_COPY);
+        } else if (offset >= length) {
+            std::memcpy(op, ref, length);
+        } else {
+            // Overlapping: the match repeats its last offset bytes
+            for (std::size_t i = 0; i < length; ++i) {
+                op[i] = ref[i];
+            }
+        }
+        op += length;
+    }
+    return op == outEnd;
+}
+
+const char* compressionCodec() {
+    return "bundled";
+}
+
+#endif
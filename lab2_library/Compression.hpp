@@ -0,0 +1,29 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstddef>
+
+/*
+ * LZ4 block compression, for CompressedTier. Uses liblz4 when the build found
+ * it (LAB2_HAVE_LZ4), otherwise a bundled codec that writes the same block
+ * format: it takes a single hash probe per position, so it compresses a
+ * little worse than liblz4, at about the same speed.
+ */
+
+/// Largest compressed size of n bytes
+std::size_t compressBound(std::size_t n);
+
+/**
+ * Compresses n bytes of src into dst. Returns the compressed size, or 0 if
+ * it would take more than dstCapacity bytes; a small dstCapacity thus gives up
+ * early on data that does not compress well.
+ */
+std::size_t compressBlock(const void* src, std::size_t n, void* dst, std::size_t dstCapacity);
+
+/// Decompresses srcSize bytes of src into exactly n bytes at dst; false if src is not such a block
+bool decompressBlock(const void* src, std::size_t srcSize, void* dst, std::size_t n);
+
+/// "liblz4" or "bundled", for diagnostics
+const char* compressionCodec();
+
+#endif // COMPRESSION_HPP
@@ -0,0 +1,410 @@
+#include "EvictionPolicy.hpp"
+#include <algorithm>    // std::max, std::min
+#include <cstdint>      // std::uint64_t, std::uint8_t
+#include <stdexcept>    // runtime_error
+#include <vector>
+#include "ClockRing.hpp"
+#include "PolicyLists.hpp"
+
+namespace {
+
+/// Classic Clock on a ClockRing. New blocks enter referenced.
+class ClockPolicy final : public EvictionPolicy {
+public:
+    explicit ClockPolicy(std::size_t capacity) : ring_(capacity) {}
+
+    const char* name() const override { return "clock"; }
+    std::size_t capacity() const override { return ring_.capacity(); }
+    std::size_t size() const override { return ring_.size(); }
+
+    std::size_t insert(const CacheKey&) override { return ring_.insert(/* referenced = */ true); }
+    void remove(std::size_t slot) override { ring_.remove(slot); }
+    std::size_t nextVictim() override { return ring_.nextVictim(); }
+    void replace(std::size_t slot, const CacheKey&) override { ring_.reference(slot); }
+
+    void reference(std::size_t slot) override { ring_.reference(slot); }
+    void clearReference(std::size_t slot) override { ring_.clearReference(slot); }
+    unsigned heat(std::size_t slot) const override { return ring_.isReferenced(slot) ? 1 : 0; }
+
+    std::uint64_t secondChances() const override { return ring_.secondChances(); }
+
+private:
+    ClockRing ring_;
+};
+
+/**
+ * Slot bookkeeping shared by the policies below: free slots, the key held by
+ * every slot (needed for the ghost lists) and the reference bits.
+ */
+class SlotPolicy : public EvictionPolicy {
+public:
+    explicit SlotPolicy(std::size_t capacity)
+        : capacity_(capacity), keys_(capacity), refs_(capacity)
+    {
+        freeSlots_.reserve(capacity);
+        // Push in reverse so that the lowest slots are handed out first
+        for (std::size_t slot = capacity; slot > 0; --slot) {
+            freeSlots_.push_back(slot - 1);
+        }
+    }
+
+    std::size_t capacity() const override { return capacity_; }
+    std::size_t size() const override { return capacity_ - freeSlots_.size(); }
+
+    std::size_t insert(const CacheKey& key) override {
+        if (freeSlots_.empty()) {
+            return npos;
+        }
+        std::size_t slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        admit(slot, key);
+        return slot;
+    }
+
+    void remove(std::size_t slot) override {
+        unlink(slot);
+        refs_.clear(slot);
+        freeSlots_.push_back(slot);
+    }
+
+    void replace(std::size_t slot, const CacheKey& key) override {
+        evict(slot);
+        admit(slot, key);
+    }
+
+    void reference(std::size_t slot) override { refs_.set(slot); }
+    void clearReference(std::size_t slot) override { refs_.clear(slot); }
+
+    std::uint64_t secondChances() const override { return secondChances_; }
+
+protected:
+    /// Starts tracking key in slot and stores it in keys_
+    virtual void admit(std::size_t slot, const CacheKey& key) = 0;
+    /// Stops tracking slot without keeping history
+    virtual void unlink(std::size_t slot) = 0;
+    /// Stops tracking slot and remembers its key as recently evicted
+    virtual void evict(std::size_t slot) = 0;
+
+    std::size_t capacity_;
+    std::vector<CacheKey> keys_;
+    ReferenceBits refs_;
+    std::uint64_t secondChances_ = 0;
+
+private:
+    std::vector<std::size_t> freeSlots_;
+};
+
+/**
+ * 2Q (Johnson and Shasha). A new block goes to the FIFO A1in and leaves it in
+ * order, hits or not; its key is then kept in A1out. Only a block missed again
+ * while in A1out is admitted to Am, a Clock of blocks that proved reused. A
+ * scan thus passes through A1in without touching Am.
+ */
+class TwoQPolicy final : public SlotPolicy {
+public:
+    explicit TwoQPolicy(std::size_t capacity)
+        : SlotPolicy(capacity)
+        , inLimit_(std::max<std::size_t>(capacity / 4, 1))
+        , outLimit_(std::max<std::size_t>(capacity / 2, 1))
+        , in_(capacity), main_(capacity), out_(outLimit_), where_(capacity, NONE) {}
+
+    const char* name() const override { return "2q"; }
+    unsigned heat(std::size_t slot) const override { return (refs_.test(slot) ? 1 : 0) + (where_[slot] == MAIN ? 1 : 0); }
+
+    std::size_t nextVictim() override {
+        if (!in_.empty() && (in_.size() > inLimit_ || main_.empty())) {
+            std::size_t slot = in_.front();
+            in_.moveToBack(slot);
+            return slot;
+        }
+        if (main_.empty()) {
+            return npos;
+        }
+        // Second chance; two laps clear every bit unless hits keep coming
+        std::size_t slot = main_.front();
+        for (std::size_t step = 0; step < 2 * main_.size(); ++step) {
+            slot = main_.front();
+            main_.moveToBack(slot);
+            if (!refs_.take(slot)) {
+                break;
+            }
+            ++secondChances_;
+        }
+        return slot;
+    }
+
+protected:
+    void admit(std::size_t slot, const CacheKey& key) override {
+        keys_[slot] = key;
+        refs_.clear(slot);
+        if (out_.erase(key)) {
+            main_.pushBack(slot);
+            where_[slot] = MAIN;
+        } else {
+            in_.pushBack(slot);
+            where_[slot] = IN;
+        }
+    }
+
+    void unlink(std::size_t slot) override {
+        switch (where_[slot]) {
+        case IN: in_.remove(slot); break;
+        case MAIN: main_.remove(slot); break;
+        default: throw std::runtime_error("TwoQPolicy: slot is not occupied");
+        }
+        where_[slot] = NONE;
+    }
+
+    void evict(std::size_t slot) override {
+        if (where_[slot] == IN) {
+            out_.pushBack(keys_[slot]); // Holds outLimit_ keys, dropping the oldest
+        }
+        unlink(slot);
+    }
+
+private:
+    enum Where : std::uint8_t { NONE, IN, MAIN };
+
+    std::size_t inLimit_;
+    std::size_t outLimit_;
+    SlotList in_;
+    SlotList main_;
+    GhostList out_;
+    std::vector<Where> where_;
+};
+
+/**
+ * CAR (Bansal and Modha): ARC with its two LRU lists replaced by Clocks, so
+ * that a hit only sets a bit. T1 holds blocks seen once, T2 blocks seen
+ * again; B1 and B2 remember keys evicted from each. A miss that finds its key
+ * in B1 means T1 was too small and grows the target p, one found in B2
+ * shrinks it.
+ */
+class CarPolicy final : public SlotPolicy {
+public:
+    explicit CarPolicy(std::size_t capacity)
+        : SlotPolicy(capacity), t1_(capacity), t2_(capacity), b1_(capacity), b2_(2 * capacity), where_(capacity, NONE) {}
+
+    const char* name() const override { return "arc"; }
+    unsigned heat(std::size_t slot) const override { return (refs_.test(slot) ? 1 : 0) + (where_[slot] == T2 ? 1 : 0); }
+
+    std::size_t nextVictim() override {
+        std::size_t slot = npos;
+        // Every referenced slot loses its bit (and T1 ones move to T2), so
+        // this ends within two laps unless hits keep coming
+        for (std::size_t step = 0; step < 2 * size() + 1; ++step) {
+            if (!t1_.empty() && (t1_.size() >= std::max<std::size_t>(target_, 1) || t2_.empty())) {
+                slot = t1_.front();
+                if (refs_.take(slot)) {
+                    ++secondChances_;
+                    t1_.remove(slot);
+                    t2_.pushBack(slot);
+                    where_[slot] = T2;
+                    continue;
+                }
+                t1_.moveToBack(slot);
+                return slot;
+            }
+            if (t2_.empty()) {
+                return npos;
+            }
+            slot = t2_.front();
+            t2_.moveToBack(slot);
+            if (!refs_.take(slot)) {
+                return slot;
+            }
+            ++secondChances_;
+        }
+        return slot;
+    }
+
+protected:
+    void admit(std::size_t slot, const CacheKey& key) override {
+        keys_[slot] = key;
+        refs_.clear(slot);
+        // Sizes before the key is taken out of its ghost list
+        const std::size_t b1 = b1_.size();
+        const std::size_t b2 = b2_.size();
+        if (b1_.erase(key)) {
+            target_ = std::min(target_ + std::max<std::size_t>(b2 / b1, 1), capacity_);
+            t2_.pushBack(slot);
+            where_[slot] = T2;
+            return;
+        }
+        if (b2_.erase(key)) {
+            std::size_t step = std::max<std::size_t>(b1 / b2, 1);
+            target_ = target_ > step ? target_ - step : 0;
+            t2_.pushBack(slot);
+            where_[slot] = T2;
+            return;
+        }
+        // A new key: keep |T1| + |B1| <= c and the whole directory <= 2c
+        if (t1_.size() + b1 >= capacity_ && b1 > 0) {
+            b1_.popFront();
+        } else if (t1_.size() + t2_.size() + b1 + b2 >= 2 * capacity_ && b2 > 0) {
+            b2_.popFront();
+        }
+        t1_.pushBack(slot);
+        where_[slot] = T1;
+    }
+
+    void unlink(std::size_t slot) override {
+        switch (where_[slot]) {
+        case T1: t1_.remove(slot); break;
+        case T2: t2_.remove(slot); break;
+        default: throw std::runtime_error("CarPolicy: slot is not occupied");
+        }
+        where_[slot] = NONE;
+    }
+
+    void evict(std::size_t slot) override {
+        (where_[slot] == T1 ? b1_ : b2_).pushBack(keys_[slot]);
+        unlink(slot);
+    }
+
+private:
+    enum Where : std::uint8_t { NONE, T1, T2 };
+
+    SlotList t1_;
+    SlotList t2_;
+    GhostList b1_;
+    GhostList b2_;
+    std::vector<Where> where_;
+    /// Target size of T1
+    std::size_t target_ = 0;
+};
+
+/**
+ * LRU-2 (O'Neil et al.): the victim is the block whose second-to-last access
+ * is the oldest, and a block accessed only once goes before any other. Time
+ * is a counter that ticks on every miss; hits are read from the reference
+ * bits when a slot is looked at. The victim is the best of a sample of
+ * SAMPLE_SIZE slots rather than of the whole cache, and evicted keys keep
+ * their last access time for a while so a block that comes back is known.
+ */
+class LruKPolicy final : public SlotPolicy {
+public:
+    static constexpr std::size_t SAMPLE_SIZE = 16;
+
+    explicit LruKPolicy(std::size_t capacity)
+        : SlotPolicy(capacity)
+        , position_(capacity, npos), last_(capacity, 0), previous_(capacity, 0), considered_(capacity, 0)
+        , history_(capacity)
+    {
+        members_.reserve(capacity);
+    }
+
+    const char* name() const override { return "lru-k"; }
+    unsigned heat(std::size_t slot) const override { return (refs_.test(slot) ? 1 : 0) + (previous_[slot] != 0 ? 1 : 0); }
+
+    std::size_t nextVictim() override {
+        const std::size_t count = members_.size();
+        if (count == 0) {
+            return npos;
+        }
+        if (cursor_ >= count) {
+            cursor_ = 0;
+        }
+        std::size_t best = npos;
+        std::size_t sampled = 0;
+        // Skip candidates already returned since the last replacement; if all
+        // of them were, start over
+        for (std::size_t step = 0; step < count && sampled < SAMPLE_SIZE; ++step) {
+            std::size_t slot = members_[cursor_];
+            cursor_ = (cursor_ + 1) % count;
+            if (considered_[slot] == round_) {
+                continue;
+            }
+            if (harvest(slot)) {
+                ++secondChances_;
+            }
+            ++sampled;
+            if (best == npos || older(slot, best)) {
+                best = slot;
+            }
+        }
+        if (best == npos) {
+            ++round_;
+            return nextVictim();
+        }
+        considered_[best] = round_;
+        return best;
+    }
+
+protected:
+    void admit(std::size_t slot, const CacheKey& key) override {
+        ++now_;
+        ++round_;
+        keys_[slot] = key;
+        refs_.clear(slot);
+        std::uint64_t seen = 0;
+        previous_[slot] = history_.erase(key, &seen) ? seen : 0;
+        last_[slot] = now_;
+        position_[slot] = members_.size();
+        members_.push_back(slot);
+    }
+
+    void unlink(std::size_t slot) override {
+        std::size_t position = position_[slot];
+        if (position == npos) {
+            throw std::runtime_error("LruKPolicy: slot is not occupied");
+        }
+        members_[position] = members_.back();
+        position_[members_[position]] = position;
+        members_.pop_back();
+        position_[slot] = npos;
+        ++round_;
+    }
+
+    void evict(std::size_t slot) override {
+        harvest(slot);
+        history_.pushBack(keys_[slot], last_[slot]); // Holds capacity_ keys, dropping the oldest
+        unlink(slot);
+    }
+
+private:
+    /// Turns a hit recorded since the last look into an access at now_; false if there was none
+    bool harvest(std::size_t slot) {
+        if (!refs_.take(slot)) {
+            return false;
+        }
+        previous_[slot] = last_[slot];
+        last_[slot] = now_;
+        return true;
+    }
+
+    /// Whether a should be evicted before b
+    bool older(std::size_t a, std::size_t b) const {
+        if (previous_[a] != previous_[b]) {
+            return previous_[a] < previous_[b];
+        }
+        return last_[a] < last_[b];
+    }
+
+    /// Occupied slots, densely packed for sampling
+    std::vector<std::size_t> members_;
+    std::vector<std::size_t> position_;
+    std::vector<std::uint64_t> last_;
+    std::vector<std::uint64_t> previous_;
+    std::vector<std::uint64_t> considered_;
+    GhostList history_;
+    std::uint64_t now_ = 0;
+    std::uint64_t round_ = 1;
+    std::size_t cursor_ = 0;
+};
+
+} // namespace
+
+std::unique_ptr<EvictionPolicy> EvictionPolicy::create(Kind kind, std::size_t capacity) {
+    switch (kind) {
+    case Kind::CLOCK:
+        return std::make_unique<ClockPolicy>(capacity);
+    case Kind::TWO_Q:
+        return std::make_unique<TwoQPolicy>(capacity);
+    case Kind::ARC:
+        return std::make_unique<CarPolicy>(capacity);
+    case Kind::LRU_K:
+        return std::make_unique<LruKPolicy>(capacity);
+    }
+    return std::make_unique<ClockPolicy>(capacity);
+}
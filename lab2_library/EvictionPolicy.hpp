@@ -0,0 +1,73 @@
+#ifndef EVICTION_POLICY_HPP
+#define EVICTION_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "CacheKey.hpp"
+
+/**
+ * \class EvictionPolicy
+ * \brief Decides which cached block BlockCache gives up on a miss.
+ *
+ * The policy owns the slot numbers: insert() hands out a free slot while the
+ * cache is not full, after that every miss asks nextVictim() for a candidate
+ * and, once the cache has made sure the block can go, gives its slot to the
+ * new key with replace(). Dropping a block (flush, failed load) is remove();
+ * unlike eviction it leaves no history behind.
+ *
+ * reference() and clearReference() are lock-free, so that hits do not
+ * serialize; the policies only look at these bits when they need a victim.
+ * Every other call must be serialized by the owner.
+ */
+class EvictionPolicy {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    enum class Kind {
+        /// Second chance over one ring; a scan larger than the cache flushes it
+        CLOCK,
+        /// New blocks wait in a FIFO; only those seen again after leaving it reach the main clock
+        TWO_Q,
+        /// ARC adapted to reference bits (CAR): balances recency and frequency on its own
+        ARC,
+        /// Evicts the block whose second-to-last access is oldest, remembering evicted blocks (K = 2)
+        LRU_K,
+    };
+
+    static std::unique_ptr<EvictionPolicy> create(Kind kind, std::size_t capacity);
+
+    virtual ~EvictionPolicy() = default;
+
+    virtual const char* name() const = 0;
+    virtual std::size_t capacity() const = 0;
+    virtual std::size_t size() const = 0;
+
+    /// Takes a free slot for key and returns it, or npos if every slot is taken.
+    virtual std::size_t insert(const CacheKey& key) = 0;
+    /// Frees an occupied slot.
+    virtual void remove(std::size_t slot) = 0;
+    /**
+     * Returns the next eviction candidate, or npos if nothing is cached. The
+     * candidate stays cached; calling again moves on to another one.
+     */
+    virtual std::size_t nextVictim() = 0;
+    /// Evicts the block in slot (normally the last candidate) and gives the slot to key.
+    virtual void replace(std::size_t slot, const CacheKey& key) = 0;
+
+    /// Records a hit.
+    virtual void reference(std::size_t slot) = 0;
+    /// Forgets the hits on slot since it was last considered, so it goes as early as the policy allows.
+    virtual void clearReference(std::size_t slot) = 0;
+    /**
+     * How much the block in slot is worth keeping, for ranking blocks across
+     * a restart: 1 for its reference bit, plus 1 if the policy has seen it
+     * reused (Clock cannot tell). Reads the bit without clearing it.
+     */
+    virtual unsigned heat(std::size_t slot) const = 0;
+
+    /// Referenced blocks nextVictim() has passed over (or promoted) instead of offering them
+    virtual std::uint64_t secondChances() const = 0;
+};
+
+#endif // EVICTION_POLICY_HPP
@@ -0,0 +1,64 @@
+#include "IoBackend.hpp"
+#include <fcntl.h>      // fallocate, FALLOC_FL_*
+#include <unistd.h>     // pread, pwrite
+#include <sys/uio.h>    // preadv, pwritev
+#include <cerrno>       // errno
+#include <system_error> // std::system_error
+
+#include "IoUringBackend.hpp"
+#include "Log.hpp"
+#include "ThreadPoolIoBackend.hpp"
+
+std::unique_ptr<IoBackend> IoBackend::create(Kind kind, std::size_t queueDepth,
+                                             void* registeredBase, std::size_t registeredSize) {
+    switch (kind) {
+    case Kind::SYNC:
+        return std::make_unique<SyncIoBackend>();
+    case Kind::THREAD_POOL:
+        return std::make_unique<ThreadPoolIoBackend>(queueDepth);
+    case Kind::AUTO:
+    case Kind::IO_URING:
+        try {
+            return std::make_unique<IoUringBackend>(queueDepth, registeredBase, registeredSize);
+        } catch (const std::system_error& e) {
+            // Old kernel, seccomp filter or io_uring_disabled sysctl
+            LAB2_LOG_INFO("io_uring is not available ({}), using worker threads.", e.what());
+        }
+        return std::make_unique<ThreadPoolIoBackend>(queueDepth);
+    }
+    return std::make_unique<SyncIoBackend>();
+}
+
+void SyncIoBackend::execute(IoRequest* requests, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        run(requests[i]);
+    }
+}
+
+void SyncIoBackend::run(IoRequest& request) {
+    ssize_t result = -1;
+    do {
+        switch (request.op) {
+        case IoRequest::Op::READ:
+            result = ::pread(request.fd, request.buffer, request.length, request.offset);
+            break;
+        case IoRequest::Op::WRITE:
+            result = ::pwrite(request.fd, request.buffer, request.length, request.offset);
+            break;
+        case IoRequest::Op::READV:
+            result = ::preadv(request.fd, request.iov, request.iovCount, request.offset);
+            break;
+        case IoRequest::Op::WRITEV:
+            result = ::pwritev(request.fd, request.iov, request.iovCount, request.offset);
+            break;
+        case IoRequest::Op::PUNCH_HOLE:
+            result = ::fallocate(request.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, request.offset,
+                                 static_cast<off_t>(request.length));
+            if (result == 0) {
+                result = static_cast<ssize_t>(request.length);
+            }
+            break;
+        }
+    } while (result < 0 && errno == EINTR);
+    request.result = result < 0 ? -errno : result;
+}
@@ -0,0 +1,98 @@
+#ifndef IO_BACKEND_HPP
+#define IO_BACKEND_HPP
+
+#include <cstddef>
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>    // iovec
+
+/**
+ * @struct IoRequest
+ * One positional transfer between a file and a memory buffer, or a list of
+ * buffers for the vectored operations (preadv/pwritev). PUNCH_HOLE frees
+ * length bytes at offset instead (fallocate(FALLOC_FL_PUNCH_HOLE), keeping
+ * the file size), so that they read back as zeros.
+ */
+struct IoRequest {
+    enum class Op { READ, WRITE, READV, WRITEV, PUNCH_HOLE };
+
+    Op op = Op::READ;
+    int fd = -1;
+    /// READ/WRITE only
+    void* buffer = nullptr;
+    std::size_t length = 0;
+    off_t offset = 0;
+
+    /// Set on completion: bytes transferred (short at EOF; length for a punched hole), or -errno
+    ssize_t result = 0;
+
+    /// READV/WRITEV only; must stay valid until execute() returns
+    const iovec* iov = nullptr;
+    int iovCount = 0;
+};
+
+/**
+ * \class IoBackend
+ * \brief Executes batches of block transfers for BlockCache.
+ *
+ * execute() keeps up to queueDepth() requests of a batch in flight and returns
+ * once all of them have completed. Several threads may call execute() at once.
+ */
+class IoBackend {
+public:
+    enum class Kind {
+        /// io_uring when the kernel allows it, the thread pool otherwise
+        AUTO,
+        /// pread/pwrite on the calling thread, one at a time
+        SYNC,
+        /// pread/pwrite on a pool of worker threads
+        THREAD_POOL,
+        /// io_uring, submitted in batches
+        IO_URING,
+    };
+
+    static constexpr std::size_t DEFAULT_QUEUE_DEPTH = 32;
+
+    /**
+     * Creates a backend of the given kind. [registeredBase, registeredBase +
+     * registeredSize) is memory that most transfers use (the BlockPool arena);
+     * io_uring registers it as fixed buffers. Falls back to the thread pool if
+     * io_uring is requested but unavailable.
+     */
+    static std::unique_ptr<IoBackend> create(Kind kind,
+                                             std::size_t queueDepth = DEFAULT_QUEUE_DEPTH,
+                                             void* registeredBase = nullptr,
+                                             std::size_t registeredSize = 0);
+
+    virtual ~IoBackend() = default;
+
+    /// Runs every request; a failure shows in its result (-errno), never as an exception
+    virtual void execute(IoRequest* requests, std::size_t count) = 0;
+
+    virtual std::size_t queueDepth() const = 0;
+    virtual const char* name() const = 0;
+
+    /// Single transfer; returns its result
+    ssize_t execute(IoRequest& request) {
+        execute(&request, 1);
+        return request.result;
+    }
+};
+
+/**
+ * \class SyncIoBackend
+ * \brief Blocking pread/pwrite on the caller's thread (queue depth 1).
+ */
+class SyncIoBackend : public IoBackend {
+public:
+    void execute(IoRequest* requests, std::size_t count) override;
+    using IoBackend::execute;
+
+    std::size_t queueDepth() const override { return 1; }
+    const char* name() const override { return "sync"; }
+
+    /// Runs one request with pread/pwrite; shared with the thread pool workers
+    static void run(IoRequest& request);
+};
+
+#endif // IO_BACKEND_HPP
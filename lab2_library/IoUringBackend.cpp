@@ -0,0 +1,420 @@
+#include "IoUringBackend.hpp"
+#include <fcntl.h>          // FALLOC_FL_*
+#include <linux/io_uring.h> // io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/mman.h>       // mmap, munmap
+#include <sys/syscall.h>    // __NR_io_uring_*
+#include <unistd.h>         // syscall, close
+#include <algorithm>        // std::min, std::max
+#include <atomic>           // std::atomic_ref
+#include <cerrno>           // errno
+#include <chrono>           // std::chrono::milliseconds
+#include <cstdint>          // std::uint64_t
+#include <cstring>          // memset, strerror
+#include <system_error>     // std::system_error
+#include <thread>           // std::this_thread::sleep_for, std::thread::hardware_concurrency
+
+#include "Log.hpp"
+
+namespace {
+
+/// The kernel rejects a single registered buffer larger than 1 GiB
+constexpr std::size_t MAX_FIXED_BUFFER = std::size_t{1} << 30;
+
+// Linux 6.12; older headers do not have it
+#ifndef IORING_REGISTER_CLONE_BUFFERS
+constexpr unsigned IORING_REGISTER_CLONE_BUFFERS = 30;
+#endif
+
+/// The argument of IORING_REGISTER_CLONE_BUFFERS; all zeros but src_fd clones the whole table
+struct CloneBuffers {
+    std::uint32_t srcFd;
+    std::uint32_t flags;
+    std::uint32_t srcOff;
+    std::uint32_t dstOff;
+    std::uint32_t nr;
+    std::uint32_t pad[3];
+};
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ringFd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+
+unsigned loadAcquire(const unsigned* p) {
+    return std::atomic_ref<const unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned* p, unsigned value) {
+    std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+}
+
+} // namespace
+
+/**
+ * One submission/completion queue pair. Used by one thread at a time; the
+ * kernel is the only other party touching the shared ring indices.
+ */
+class IoUringBackend::Ring {
+public:
+    explicit Ring(unsigned entries);
+    ~Ring();
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    /// Registers buffers as this ring's fixed buffers. Optional: fails with
+    /// ENOMEM under a low RLIMIT_MEMLOCK, and plain reads still work
+    bool registerBuffers(const std::vector<iovec>& buffers);
+    /// Shares the fixed buffers of source, without pinning their pages again; false before Linux 6.12
+    bool cloneBuffers(const Ring& source);
+    bool fixedBuffers() const { return fixedBuffers_; }
+    /**
+     * Runs the requests to completion. False if the ring stopped working
+     * part of the way: every request not completed then has its result set
+     * to -errno, nothing is in flight any more, and the ring must be closed.
+     */
+    bool execute(IoRequest* requests, std::size_t count, const IoUringBackend& backend);
+
+private:
+    int fd_ = -1;
+    unsigned entries_ = 0;
+    bool fixedBuffers_ = false;
+
+    void* sqRing_ = MAP_FAILED;
+    std::size_t sqRingSize_ = 0;
+    void* cqRing_ = MAP_FAILED;
+    std::size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqesSize_ = 0;
+
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    void unmap();
+    /// Takes the completions in the queue; returns how many there were
+    unsigned reap(IoRequest* requests);
+    /// Waits for the inFlight requests the kernel took, then sets -error as the result of every request not run
+    void fail(IoRequest* requests, std::size_t count, std::size_t queued, unsigned inFlight, int error);
+};
+
+IoUringBackend::Ring::Ring(unsigned entries) {
+    io_uring_params params {};
+    fd_ = ioUringSetup(entries, &params);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+    entries_ = params.sq_entries;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd_, IORING_OFF_SQ_RING);
+    cqRing_ = singleMmap ? sqRing_
+                         : ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  fd_, IORING_OFF_CQ_RING);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd_, IORING_OFF_SQES);
+    if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes == MAP_FAILED) {
+        int error = errno;
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize_);
+        }
+        unmap();
+        ::close(fd_);
+        throw std::system_error(error, std::generic_category(), "io_uring mmap");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<unsigned char*>(sqRing_);
+    auto* cq = static_cast<unsigned char*>(cqRing_);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+bool IoUringBackend::Ring::registerBuffers(const std::vector<iovec>& buffers) {
+    fixedBuffers_ = !buffers.empty()
+                    && ioUringRegister(fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                                       static_cast<unsigned>(buffers.size())) == 0;
+    return fixedBuffers_;
+}
+
+bool IoUringBackend::Ring::cloneBuffers(const Ring& source) {
+    CloneBuffers clone {};
+    clone.srcFd = static_cast<std::uint32_t>(source.fd_);
+    fixedBuffers_ = ioUringRegister(fd_, IORING_REGISTER_CLONE_BUFFERS, &clone, 1) == 0;
+    return fixedBuffers_;
+}
+
+IoUringBackend::Ring::~Ring() {
+    // Closing the ring also unregisters its buffers
+    ::munmap(sqes_, sqesSize_);
+    unmap();
+    ::close(fd_);
+}
+
+void IoUringBackend::Ring::unmap() {
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+}
+
+bool IoUringBackend::Ring::execute(IoRequest* requests, std::size_t count, const IoUringBackend& backend) {
+    std::size_t next = 0;       // First request not queued yet
+    std::size_t completed = 0;
+    unsigned inFlight = 0;      // Queued, completion not reaped yet
+    unsigned unsubmitted = 0;   // Queued, not consumed by the kernel yet
+
+    while (completed < count) {
+        // Fill the submission queue; the completion queue holds twice as many entries
+        unsigned tail = *sqTail_;
+        while (next < count && inFlight < entries_) {
+            IoRequest& request = requests[next];
+            unsigned index = tail & sqMask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            const bool read = request.op == IoRequest::Op::READ || request.op == IoRequest::Op::READV;
+            if (request.op == IoRequest::Op::PUNCH_HOLE) {
+                // The length goes in addr and the mode in len, as for fallocate(2)
+                sqe.opcode = IORING_OP_FALLOCATE;
+                sqe.addr = request.length;
+                sqe.len = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+            } else if (request.op == IoRequest::Op::READV || request.op == IoRequest::Op::WRITEV) {
+                sqe.opcode = read ? IORING_OP_READV : IORING_OP_WRITEV;
+                sqe.addr = reinterpret_cast<std::uint64_t>(request.iov);
+                sqe.len = static_cast<unsigned>(request.iovCount);
+            } else {
+                int bufferIndex = fixedBuffers_ ? backend.fixedIndex(request.buffer, request.length) : -1;
+                if (bufferIndex >= 0) {
+                    sqe.opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                    sqe.buf_index = static_cast<__u16>(bufferIndex);
+                } else {
+                    sqe.opcode = read ? IORING_OP_READ : IORING_OP_WRITE;
+                }
+                sqe.addr = reinterpret_cast<std::uint64_t>(request.buffer);
+                sqe.len = static_cast<unsigned>(request.length);
+            }
+            sqe.fd = request.fd;
+            sqe.off = static_cast<std::uint64_t>(request.offset);
+            sqe.user_data = next;
+            sqArray_[index] = index;
+            request.result = -EINPROGRESS; // Until its completion is reaped
+
+            ++tail;
+            ++next;
+            ++inFlight;
+            ++unsubmitted;
+        }
+        storeRelease(sqTail_, tail);
+
+        int submitted = ioUringEnter(fd_, unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The kernel has not consumed these entries, so take them back and
+            // run them here; completions of earlier ones are still reaped below
+            int error = errno;
+            storeRelease(sqTail_, tail - unsubmitted);
+            for (std::size_t i = next - unsubmitted; i < next; ++i) {
+                SyncIoBackend::run(requests[i]);
+            }
+            completed += unsubmitted;
+            inFlight -= unsubmitted;
+            unsubmitted = 0;
+            // A full completion queue (EBUSY) or a shortage (EAGAIN) clears up as completions are reaped below
+            if (inFlight > 0 && ioUringEnter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR
+                && errno != EAGAIN && errno != EBUSY) {
+                fail(requests, count, next, inFlight, error);
+                return false;
+            }
+        } else {
+            unsubmitted -= static_cast<unsigned>(submitted);
+        }
+
+        const unsigned reaped = reap(requests);
+        inFlight -= reaped;
+        completed += reaped;
+    }
+    return true;
+}
+
+unsigned IoUringBackend::Ring::reap(IoRequest* requests) {
+    unsigned head = *cqHead_;
+    const unsigned cqTail = loadAcquire(cqTail_);
+    unsigned reaped = 0;
+    for (; head != cqTail; ++head, ++reaped) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        IoRequest& request = requests[cqe.user_data];
+        // fallocate reports 0; the request counts as transferred in full
+        request.result = request.op == IoRequest::Op::PUNCH_HOLE && cqe.res == 0
+                             ? static_cast<ssize_t>(request.length)
+                             : cqe.res;
+    }
+    storeRelease(cqHead_, head);
+    return reaped;
+}
+
+void IoUringBackend::Ring::fail(IoRequest* requests, std::size_t count, std::size_t queued, unsigned inFlight,
+                                int error) {
+    LAB2_LOG_ERROR("io_uring_enter failed: {}; closing the ring.", std::strerror(error));
+    // Closing the ring does not wait for these, and the caller is about to
+    // reuse their buffers, so the kernel must be done with them first
+    inFlight -= reap(requests);
+    while (inFlight > 0) {
+        if (ioUringEnter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            // Completions are posted without io_uring_enter() too; poll for them
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        inFlight -= reap(requests);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i >= queued || requests[i].result == -EINPROGRESS) {
+            requests[i].result = -error;
+        }
+    }
+}
+
+IoUringBackend::IoUringBackend(std::size_t queueDepth, void* registeredBase, std::size_t registeredSize)
+    : queueDepth_(std::max<std::size_t>(queueDepth, 1))
+    , maxRings_(std::max(std::thread::hardware_concurrency(), 1u))
+{
+    auto* base = static_cast<unsigned char*>(registeredBase);
+    for (std::size_t offset = 0; base != nullptr && offset < registeredSize; offset += MAX_FIXED_BUFFER) {
+        buffers_.push_back({base + offset, std::min(MAX_FIXED_BUFFER, registeredSize - offset)});
+    }
+
+    // Creating the first ring up front tells the caller whether io_uring works at all
+    auto ring = std::make_unique<Ring>(static_cast<unsigned>(queueDepth_));
+    if (!buffers_.empty()) {
+        auto table = std::make_unique<Ring>(1);
+        if (table->registerBuffers(buffers_)) {
+            if (ring->cloneBuffers(*table)) {
+                bufferTable_ = std::move(table);
+            } else {
+                // An older kernel: each ring pins the buffers for itself
+                table.reset();
+                ring->registerBuffers(buffers_);
+            }
+        }
+    }
+    fixedBuffers_ = ring->fixedBuffers();
+    if (!fixedBuffers_) {
+        buffers_.clear(); // Later rings would fail the same way
+    }
+    idleRings_.push_back(std::move(ring));
+    rings_ = 1;
+}
+
+IoUringBackend::~IoUringBackend() = default;
+
+std::size_t IoUringBackend::ringCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rings_;
+}
+
+void IoUringBackend::execute(IoRequest* requests, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::unique_ptr<Ring> ring;
+    try {
+        ring = takeRing();
+    } catch (const std::system_error&) {
+        // No ring to spare (e.g. out of locked memory); do this batch the slow way
+        SyncIoBackend().execute(requests, count);
+        return;
+    }
+    // A broken ring has drained what it took, but is closed instead of
+    // going back to the pool
+    if (ring->execute(requests, count, *this)) {
+        returnRing(std::move(ring));
+    } else {
+        dropRing(std::move(ring));
+    }
+}
+
+std::unique_ptr<IoUringBackend::Ring> IoUringBackend::newRing() {
+    auto ring = std::make_unique<Ring>(static_cast<unsigned>(queueDepth_));
+    if (bufferTable_) {
+        ring->cloneBuffers(*bufferTable_);
+    } else {
+        ring->registerBuffers(buffers_);
+    }
+    return ring;
+}
+
+std::unique_ptr<IoUringBackend::Ring> IoUringBackend::takeRing() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ringReturned_.wait(lock, [this] { return !idleRings_.empty() || rings_ < maxRings_; });
+    if (!idleRings_.empty()) {
+        std::unique_ptr<Ring> ring = std::move(idleRings_.back());
+        idleRings_.pop_back();
+        return ring;
+    }
+    // Every ring is busy with another caller, and there is room for one more
+    ++rings_;
+    lock.unlock();
+    try {
+        return newRing();
+    } catch (const std::system_error&) {
+        lock.lock();
+        --rings_;
+        ringReturned_.notify_one();
+        throw;
+    }
+}
+
+void IoUringBackend::returnRing(std::unique_ptr<Ring> ring) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idleRings_.push_back(std::move(ring));
+    }
+    ringReturned_.notify_one();
+}
+
+void IoUringBackend::dropRing(std::unique_ptr<Ring> ring) {
+    ring.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --rings_;
+    }
+    ringReturned_.notify_one();
+}
+
+int IoUringBackend::fixedIndex(const void* buffer, std::size_t length) const {
+    auto* p = static_cast<const unsigned char*>(buffer);
+    for (std::size_t i = 0; i < buffers_.size(); ++i) {
+        auto* begin = static_cast<const unsigned char*>(buffers_[i].iov_base);
+        if (p >= begin && p + length <= begin + buffers_[i].iov_len) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
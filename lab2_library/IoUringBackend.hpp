@@ -0,0 +1,74 @@
+#ifndef IO_URING_BACKEND_HPP
+#define IO_URING_BACKEND_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/uio.h>    // iovec
+
+#include "IoBackend.hpp"
+
+/**
+ * \class IoUringBackend
+ * \brief io_uring backend driven through the raw system calls (no liburing).
+ *
+ * Each execute() borrows a ring from a pool, so concurrent callers never
+ * share one and each reaps only its own completions. Rings are created on
+ * demand, up to maxRings(); callers past that wait for one to come back.
+ * The memory given at construction is registered as fixed buffers once, on a
+ * ring that does no I/O, and every pool ring clones that buffer table, so its
+ * pages are pinned once however many rings there are. Transfers into it use
+ * READ_FIXED/WRITE_FIXED and skip the per-request page pinning. Kernels that
+ * cannot clone a buffer table (before 6.12) register it on each ring instead.
+ */
+class IoUringBackend : public IoBackend {
+public:
+    /// Throws std::system_error if the kernel refuses to set up a ring
+    IoUringBackend(std::size_t queueDepth, void* registeredBase, std::size_t registeredSize);
+    ~IoUringBackend() override;
+
+    void execute(IoRequest* requests, std::size_t count) override;
+    using IoBackend::execute;
+
+    std::size_t queueDepth() const override { return queueDepth_; }
+    const char* name() const override { return "io_uring"; }
+
+    /// True if the rings registered the memory given at construction
+    bool usesFixedBuffers() const { return fixedBuffers_; }
+
+    /// The most rings the pool creates: one per hardware thread
+    std::size_t maxRings() const { return maxRings_; }
+    /// Rings in the pool, idle or lent out
+    std::size_t ringCount();
+
+private:
+    class Ring;
+
+    std::size_t queueDepth_;
+    std::size_t maxRings_;
+    /// The registered memory, split into chunks the kernel accepts as one buffer each
+    std::vector<iovec> buffers_;
+    bool fixedBuffers_ = false;
+    /// Owns the registered buffer table the pool rings clone; null if the kernel cannot clone one
+    std::unique_ptr<Ring> bufferTable_;
+
+    /// Guards idleRings_ and rings_
+    std::mutex mutex_;
+    std::condition_variable ringReturned_;
+    std::vector<std::unique_ptr<Ring>> idleRings_;
+    std::size_t rings_ = 0;
+
+    /// A new pool ring, with the buffer table if there is one; throws std::system_error
+    std::unique_ptr<Ring> newRing();
+    /// Waits while maxRings() rings are lent out
+    std::unique_ptr<Ring> takeRing();
+    void returnRing(std::unique_ptr<Ring> ring);
+    /// Closes a broken ring, making room for a new one
+    void dropRing(std::unique_ptr<Ring> ring);
+    /// Index of the registered chunk holding all of [buffer, buffer + length), or -1
+    int fixedIndex(const void* buffer, std::size_t length) const;
+};
+
+#endif // IO_URING_BACKEND_HPP
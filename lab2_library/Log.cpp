@@ -0,0 +1,184 @@
+#include "Log.hpp"
+#include <unistd.h>     // write, STDERR_FILENO
+#include <algorithm>    // std::min
+#include <bit>          // std::bit_ceil
+#include <cerrno>       // EINTR
+#include <charconv>     // std::to_chars
+#include <cstring>      // std::memcpy
+
+std::atomic<LogLevel> Log::level_{LogLevel::TRACE};
+std::atomic<RingLogger*> Log::sink_{nullptr};
+
+namespace {
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::TRACE: return "TRACE";
+    case LogLevel::DEBUG: return "DEBUG";
+    case LogLevel::INFO: return "INFO";
+    case LogLevel::WARN: return "WARN";
+    case LogLevel::ERROR: return "ERROR";
+    case LogLevel::OFF: break;
+    }
+    return "?";
+}
+
+template <typename T>
+void appendNumber(std::string& out, T value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+/// Writes all of text to fd, as one write(2) unless it is cut short
+void writeAll(int fd, const std::string& text) {
+    std::size_t done = 0;
+    while (done < text.size()) {
+        ssize_t result = ::write(fd, text.data() + done, text.size() - done);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // Nowhere left to report it
+        }
+        done += static_cast<std::size_t>(result);
+    }
+}
+
+} // namespace
+
+void LogRecord::addText(std::string_view arg) {
+    if (argCount == MAX_ARGS) {
+        return;
+    }
+    const std::size_t length = std::min(arg.size(), TEXT_BYTES - textUsed);
+    std::memcpy(text + textUsed, arg.data(), length);
+    types[argCount] = ArgType::TEXT;
+    values[argCount].text.offset = textUsed;
+    values[argCount].text.length = static_cast<std::uint8_t>(length);
+    ++argCount;
+    textUsed = static_cast<std::uint8_t>(textUsed + length);
+}
+
+void LogRecord::render(std::string& out) const {
+    appendNumber(out, timeNs / 1000000000);
+    out += '.';
+    const std::string micros = std::to_string(timeNs % 1000000000 / 1000);
+    out.append(6 - micros.size(), '0');
+    out += micros;
+    out += ' ';
+    out += levelName(level);
+    out += ' ';
+
+    std::size_t arg = 0;
+    for (const char* p = format; *p != '\0'; ++p) {
+        if (p[0] != '{' || p[1] != '}' || arg == argCount) {
+            out += *p;
+            continue;
+        }
+        switch (types[arg]) {
+        case ArgType::INT: appendNumber(out, values[arg].i); break;
+        case ArgType::UINT: appendNumber(out, values[arg].u); break;
+        case ArgType::DOUBLE: appendNumber(out, values[arg].d); break;
+        case ArgType::TEXT: out.append(text + values[arg].text.offset, values[arg].text.length); break;
+        }
+        ++arg;
+        ++p;
+    }
+    out += '\n';
+}
+
+std::uint64_t Log::now() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+void Log::detach(RingLogger* logger) {
+    RingLogger* expected = logger;
+    sink_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+void Log::submit(const LogRecord& record) {
+    RingLogger* logger = sink_.load(std::memory_order_acquire);
+    if (logger != nullptr) {
+        logger->push(record);
+        return;
+    }
+    thread_local std::string line;
+    line.clear();
+    record.render(line);
+    writeAll(STDERR_FILENO, line);
+}
+
+RingLogger::RingLogger(int fd, std::size_t capacity, std::chrono::milliseconds interval)
+    : fd_(fd)
+    , mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+    , interval_(interval)
+    , slots_(std::make_unique<Slot[]>(mask_ + 1))
+{
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker_ = std::thread(&RingLogger::run, this);
+}
+
+RingLogger::~RingLogger() {
+    Log::detach(this);
+    stopping_.store(true, std::memory_order_release);
+    wakeup_.release();
+    worker_.join();
+    drain();
+}
+
+bool RingLogger::push(const LogRecord& record) {
+    // Bounded MPMC queue after Dmitry Vyukov: claim a position, fill its slot, publish
+    std::size_t position = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[position & mask_];
+        const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence - position);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = head_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if (position - tail_.load(std::memory_order_relaxed) > mask_ / 2 && !kicked_.exchange(true, std::memory_order_acq_rel)) {
+        wakeup_.release();
+    }
+    return true;
+}
+
+void RingLogger::drain() {
+    thread_local std::string text;
+    text.clear();
+    std::size_t position = tail_.load(std::memory_order_relaxed);
+    for (;; ++position) {
+        Slot& slot = slots_[position & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            break;
+        }
+        slot.record.render(text);
+        // Hand the slot back to producers one lap later
+        slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+    }
+    tail_.store(position, std::memory_order_relaxed);
+    writeAll(fd_, text);
+}
+
+void RingLogger::run() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        (void)wakeup_.try_acquire_for(interval_);
+        kicked_.store(false, std::memory_order_release);
+        drain();
+    }
+}
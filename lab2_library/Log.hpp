@@ -0,0 +1,207 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <semaphore>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Levels for LAB2_LOG_LEVEL, the lowest one compiled in. Calls below it are
+// removed by the preprocessor, arguments and all.
+#define LAB2_LOG_LEVEL_TRACE 0
+#define LAB2_LOG_LEVEL_DEBUG 1
+#define LAB2_LOG_LEVEL_INFO 2
+#define LAB2_LOG_LEVEL_WARN 3
+#define LAB2_LOG_LEVEL_ERROR 4
+#define LAB2_LOG_LEVEL_OFF 5
+
+#ifndef LAB2_LOG_LEVEL
+#define LAB2_LOG_LEVEL LAB2_LOG_LEVEL_WARN
+#endif
+
+enum class LogLevel : std::uint8_t { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+
+/**
+ * @struct LogRecord
+ * One log call, not formatted yet: the format string (a literal, kept by
+ * pointer) and the arguments in binary. Each "{}" in the format stands for
+ * the next argument. Strings are copied, cut short at TEXT_BYTES in total.
+ */
+struct LogRecord {
+    static constexpr std::size_t MAX_ARGS = 6;
+    static constexpr std::size_t TEXT_BYTES = 96;
+
+    enum class ArgType : std::uint8_t { INT, UINT, DOUBLE, TEXT };
+
+    std::uint64_t timeNs = 0;
+    const char* format = "";
+    LogLevel level = LogLevel::INFO;
+    std::uint8_t argCount = 0;
+    std::uint8_t textUsed = 0;
+    ArgType types[MAX_ARGS] = {};
+    /// The value, or for TEXT the offset of the string in text and its length
+    union Value {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        struct { std::uint8_t offset, length; } text;
+    } values[MAX_ARGS] = {};
+    char text[TEXT_BYTES] = {};
+
+    template <typename T>
+    void add(const T& arg) {
+        if (argCount == MAX_ARGS) {
+            return;
+        }
+        if constexpr (std::is_same_v<T, bool>) {
+            addText(arg ? "true" : "false");
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            types[argCount] = ArgType::INT;
+            values[argCount++].i = static_cast<std::int64_t>(arg);
+        } else if constexpr (std::is_integral_v<T>) {
+            types[argCount] = ArgType::UINT;
+            values[argCount++].u = static_cast<std::uint64_t>(arg);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            types[argCount] = ArgType::DOUBLE;
+            values[argCount++].d = static_cast<double>(arg);
+        } else if constexpr (std::is_pointer_v<T>) {
+            addText(arg != nullptr ? std::string_view(arg) : std::string_view("(null)"));
+        } else {
+            addText(std::string_view(arg));
+        }
+    }
+    void addText(std::string_view arg);
+
+    /// Appends "<seconds since epoch> <LEVEL> <message>\n" to out
+    void render(std::string& out) const;
+};
+
+class RingLogger;
+
+/**
+ * \class Log
+ * \brief Where the LAB2_LOG_* macros go.
+ *
+ * Without a RingLogger attached, a record is formatted on the calling thread
+ * and written to stderr with a single write(2), so lines of concurrent
+ * threads never interleave. With one attached, the caller only copies the
+ * record into the ring and the logger's thread does the rest.
+ */
+class Log {
+public:
+    /// Lowest level written at run time; levels compiled out stay out whatever this says
+    static void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    static LogLevel level() { return level_.load(std::memory_order_relaxed); }
+    static bool enabled(LogLevel level) { return level >= Log::level(); }
+
+    /// Sends records to logger until detach(); null goes back to stderr
+    static void attach(RingLogger* logger) { sink_.store(logger, std::memory_order_release); }
+    static void detach(RingLogger* logger);
+
+    template <typename... Args>
+    static void write(LogLevel level, const char* format, const Args&... args) {
+        if (!enabled(level)) {
+            return;
+        }
+        LogRecord record;
+        record.timeNs = now();
+        record.format = format;
+        record.level = level;
+        (record.add(args), ...);
+        submit(record);
+    }
+
+private:
+    static std::uint64_t now();
+    static void submit(const LogRecord& record);
+
+    static std::atomic<LogLevel> level_;
+    static std::atomic<RingLogger*> sink_;
+};
+
+/**
+ * \class RingLogger
+ * \brief Bounded lock-free queue of LogRecords, written out by a background thread.
+ *
+ * Any number of threads push; a full ring drops the record (and counts it)
+ * rather than block the caller. Every interval, or as soon as the ring is
+ * half full, the thread formats what is queued and writes it to fd in one go.
+ * Whatever is left is written out by the destructor.
+ *
+ * Detach the logger (or let the destructor do it) only once no thread can
+ * still be in the middle of a log call.
+ */
+class RingLogger {
+public:
+    /// capacity is rounded up to a power of two; fd stays open, owned by the caller
+    explicit RingLogger(int fd, std::size_t capacity = 4096,
+                        std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+    ~RingLogger();
+
+    RingLogger(const RingLogger&) = delete;
+    RingLogger& operator=(const RingLogger&) = delete;
+
+    /// Queues record; false if the ring was full and the record was dropped
+    bool push(const LogRecord& record);
+
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        /// Equals the position of the slot's next push, or that plus one once its record is ready
+        std::atomic<std::size_t> sequence;
+        LogRecord record;
+    };
+
+    int fd_;
+    std::size_t mask_;
+    std::chrono::milliseconds interval_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    /// Next position to write out; only the logger's thread (or destructor) advances it
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> kicked_{false};
+    std::counting_semaphore<> wakeup_{0};
+    std::thread worker_;
+
+    void run();
+    /// Writes out the records queued so far
+    void drain();
+};
+
+#if LAB2_LOG_LEVEL <= LAB2_LOG_LEVEL_TRACE
+#define LAB2_LOG_TRACE(...) ::Log::write(::LogLevel::TRACE, __VA_ARGS__)
+#else
+#define LAB2_LOG_TRACE(...) ((void)0)
+#endif
+#if LAB2_LOG_LEVEL <= LAB2_LOG_LEVEL_DEBUG
+#define LAB2_LOG_DEBUG(...) ::Log::write(::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LAB2_LOG_DEBUG(...) ((void)0)
+#endif
+#if LAB2_LOG_LEVEL <= LAB2_LOG_LEVEL_INFO
+#define LAB2_LOG_INFO(...) ::Log::write(::LogLevel::INFO, __VA_ARGS__)
+#else
+#define LAB2_LOG_INFO(...) ((void)0)
+#endif
+#if LAB2_LOG_LEVEL <= LAB2_LOG_LEVEL_WARN
+#define LAB2_LOG_WARN(...) ::Log::write(::LogLevel::WARN, __VA_ARGS__)
+#else
+#define LAB2_LOG_WARN(...) ((void)0)
+#endif
+#if LAB2_LOG_LEVEL <= LAB2_LOG_LEVEL_ERROR
+#define LAB2_LOG_ERROR(...) ::Log::write(::LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LAB2_LOG_ERROR(...) ((void)0)
+#endif
+
+#endif // LOG_HPP
@@ -0,0 +1,129 @@
+#include "Manifest.hpp"
+#include <fcntl.h>      // open
+#include <unistd.h>     // write, fsync, close, unlink
+#include <cerrno>       // errno, EINTR
+#include <cstdint>      // INT64_MAX
+#include <cstdio>       // rename
+#include <cstring>      // memcmp
+#include <stdexcept>    // runtime_error
+#include <system_error> // std::system_error
+
+#include "BinaryFormat.hpp"
+
+namespace {
+
+/// Reads varints off a manifest held in memory
+class Cursor {
+public:
+    explicit Cursor(const std::vector<std::uint8_t>& data) : data_(data), position_(sizeof(MANIFEST_MAGIC)) {}
+
+    std::uint64_t varint() { return getVarint(data_, position_, "manifest"); }
+
+    /// A count of items that take at least one byte each, so that a corrupt one cannot ask for huge allocations
+    std::size_t count() {
+        std::uint64_t value = varint();
+        if (value > data_.size() - position_) {
+            throw std::runtime_error("Truncated manifest");
+        }
+        return static_cast<std::size_t>(value);
+    }
+
+    std::string string() {
+        std::size_t length = count();
+        std::string value(reinterpret_cast<const char*>(data_.data() + position_), length);
+        position_ += length;
+        return value;
+    }
+
+private:
+    const std::vector<std::uint8_t>& data_;
+    std::size_t position_;
+};
+
+void writeAll(int fd, const std::vector<std::uint8_t>& data, const std::string& path) {
+    std::size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot write manifest " + path);
+        }
+        written += static_cast<std::size_t>(result);
+    }
+}
+
+} // namespace
+
+void writeManifest(const std::string& path, const std::vector<ManifestFile>& files) {
+    std::vector<std::uint8_t> data(MANIFEST_MAGIC, MANIFEST_MAGIC + sizeof(MANIFEST_MAGIC));
+    putVarint(data, files.size());
+    for (const ManifestFile& file : files) {
+        putVarint(data, file.path.size());
+        data.insert(data.end(), file.path.begin(), file.path.end());
+        putVarint(data, file.dev);
+        putVarint(data, file.ino);
+        putVarint(data, zigzag(file.size));
+        putVarint(data, zigzag(file.mtimeNs));
+        putVarint(data, file.blockSize);
+        putVarint(data, file.blocks.size());
+        std::int64_t previous = -1;
+        for (const ManifestFile::Block& block : file.blocks) {
+            putVarint(data, static_cast<std::uint64_t>(block.blockIndex - previous - 1));
+            putVarint(data, block.heat);
+            previous = block.blockIndex;
+        }
+    }
+
+    const std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create manifest " + temporary);
+    }
+    try {
+        writeAll(fd, data, temporary);
+        if (::fsync(fd) < 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot sync manifest " + temporary);
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw;
+    }
+    ::close(fd);
+    if (std::rename(temporary.c_str(), path.c_str()) < 0) {
+        int error = errno;
+        ::unlink(temporary.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot replace manifest " + path);
+    }
+}
+
+std::vector<ManifestFile> readManifest(const std::string& path) {
+    const std::vector<std::uint8_t> data = readWholeFile(path, "manifest");
+    if (data.size() < sizeof(MANIFEST_MAGIC) || std::memcmp(data.data(), MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a Lab2 manifest");
+    }
+    Cursor cursor(data);
+    std::vector<ManifestFile> files(cursor.count());
+    for (ManifestFile& file : files) {
+        file.path = cursor.string();
+        file.dev = cursor.varint();
+        file.ino = cursor.varint();
+        file.size = unzigzag(cursor.varint());
+        file.mtimeNs = unzigzag(cursor.varint());
+        file.blockSize = cursor.varint();
+        file.blocks.resize(cursor.count());
+        std::int64_t previous = -1;
+        for (ManifestFile::Block& block : file.blocks) {
+            const std::uint64_t gap = cursor.varint();
+            if (gap > static_cast<std::uint64_t>(INT64_MAX - previous - 1)) {
+                throw std::runtime_error(path + " is not a Lab2 manifest");
+            }
+            block.blockIndex = previous + 1 + static_cast<std::int64_t>(gap);
+            block.heat = static_cast<std::uint32_t>(cursor.varint());
+            previous = block.blockIndex;
+        }
+    }
+    return files;
+}
@@ -0,0 +1,52 @@
+#ifndef MANIFEST_HPP
+#define MANIFEST_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ManifestFile
+ * One file's cached blocks as recorded in a manifest, see writeManifest().
+ */
+struct ManifestFile {
+    /// The path the file was first opened by
+    std::string path;
+    std::uint64_t dev = 0;
+    std::uint64_t ino = 0;
+    /// Size and mtime on disk when the manifest was written; a file that no longer matches is skipped
+    std::int64_t size = 0;
+    std::int64_t mtimeNs = 0;
+    /// Block size the file was cached with; blockIndex below counts blocks of this size
+    std::uint64_t blockSize = 0;
+
+    struct Block {
+        std::int64_t blockIndex = 0;
+        /// EvictionPolicy::heat() when it was recorded
+        std::uint32_t heat = 0;
+    };
+    /// In ascending blockIndex order
+    std::vector<Block> blocks;
+};
+
+/**
+ * A manifest is the resident set of a cache, saved so that the next process
+ * can load it again before anyone asks (see Lab2::saveManifest()). The file
+ * starts with MANIFEST_MAGIC and a varint count of files; then, for every
+ * file, the length and bytes of its path, varints of dev, ino, size, mtime,
+ * block size and block count, and per block the gap to the previous block
+ * index and its heat. Two bytes or so per block.
+ */
+constexpr char MANIFEST_MAGIC[8] = {'L', '2', 'M', 'A', 'N', 'I', 'F', '1'};
+
+/**
+ * Writes files to path. The data goes to a temporary file renamed over path
+ * at the end, so a crash leaves the old manifest or the new one, never half
+ * of one. Throws std::system_error on failure.
+ */
+void writeManifest(const std::string& path, const std::vector<ManifestFile>& files);
+
+/// Throws std::system_error if path cannot be read, std::runtime_error if it is not a manifest or is truncated
+std::vector<ManifestFile> readManifest(const std::string& path);
+
+#endif // MANIFEST_HPP
@@ -0,0 +1,157 @@
+#ifndef POLICY_LISTS_HPP
+#define POLICY_LISTS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CacheKey.hpp"
+#include "SlotTable.hpp"
+
+// Building blocks shared by the list-based eviction policies
+
+/**
+ * \class ReferenceBits
+ * \brief One atomic hit bit per slot, set without a lock like ClockRing's.
+ */
+class ReferenceBits {
+public:
+    explicit ReferenceBits(std::size_t capacity)
+        : words_(std::make_unique<std::atomic<std::uint64_t>[]>((capacity + 63) / 64)) {}
+
+    void set(std::size_t slot) {
+        std::atomic<std::uint64_t>& word = words_[slot >> 6];
+        // Check first so that hot blocks do not keep bouncing the cache line
+        if ((word.load(std::memory_order_relaxed) & bit(slot)) == 0) {
+            word.fetch_or(bit(slot), std::memory_order_relaxed);
+        }
+    }
+    void clear(std::size_t slot) { words_[slot >> 6].fetch_and(~bit(slot), std::memory_order_relaxed); }
+    bool test(std::size_t slot) const { return (words_[slot >> 6].load(std::memory_order_relaxed) & bit(slot)) != 0; }
+    /// Clears the bit and returns whether it was set
+    bool take(std::size_t slot) {
+        if ((words_[slot >> 6].load(std::memory_order_relaxed) & bit(slot)) == 0) {
+            return false;
+        }
+        return (words_[slot >> 6].fetch_and(~bit(slot), std::memory_order_relaxed) & bit(slot)) != 0;
+    }
+
+private:
+    static std::uint64_t bit(std::size_t slot) { return std::uint64_t{1} << (slot & 63); }
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+};
+
+/**
+ * \class SlotList
+ * \brief Intrusive doubly linked list of slot numbers, O(1) everywhere.
+ *
+ * A slot can be in one list at a time; the links live in arrays indexed by
+ * slot, so nothing is allocated after construction.
+ */
+class SlotList {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    explicit SlotList(std::size_t capacity) : prev_(capacity, npos), next_(capacity, npos) {}
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::size_t front() const { return head_; }
+
+    void pushBack(std::size_t slot) {
+        prev_[slot] = tail_;
+        next_[slot] = npos;
+        (tail_ == npos ? head_ : next_[tail_]) = slot;
+        tail_ = slot;
+        ++size_;
+    }
+    void remove(std::size_t slot) {
+        (prev_[slot] == npos ? head_ : next_[prev_[slot]]) = next_[slot];
+        (next_[slot] == npos ? tail_ : prev_[next_[slot]]) = prev_[slot];
+        --size_;
+    }
+    /// Moves slot to the back, e.g. after giving it a second chance
+    void moveToBack(std::size_t slot) {
+        remove(slot);
+        pushBack(slot);
+    }
+
+private:
+    std::vector<std::size_t> prev_;
+    std::vector<std::size_t> next_;
+    std::size_t head_ = npos;
+    std::size_t tail_ = npos;
+    std::size_t size_ = 0;
+};
+
+/**
+ * \class GhostList
+ * \brief FIFO of keys recently evicted, each with a value the policy needs later.
+ *
+ * Holds at most capacity keys; pushing one more drops the oldest. Keys and
+ * values live in arrays linked by a SlotList and are found through a
+ * SlotTable sized with room to spare, so eviction does not allocate.
+ */
+class GhostList {
+public:
+    explicit GhostList(std::size_t capacity)
+        : keys_(capacity), values_(capacity), order_(capacity), index_(2 * capacity) {
+        free_.reserve(capacity);
+        for (std::size_t entry = capacity; entry > 0; --entry) {
+            free_.push_back(entry - 1);
+        }
+    }
+
+    std::size_t size() const { return order_.size(); }
+    bool contains(const CacheKey& key) const { return index_.contains(key); }
+
+    void pushBack(const CacheKey& key, std::uint64_t value = 0) {
+        erase(key);
+        if (free_.empty()) {
+            if (order_.empty()) {
+                return; // No room at all
+            }
+            popFront();
+        }
+        const std::size_t entry = free_.back();
+        free_.pop_back();
+        keys_[entry] = key;
+        values_[entry] = value;
+        order_.pushBack(entry);
+        index_.insert(key, entry);
+    }
+    void popFront() {
+        const std::size_t entry = order_.front();
+        index_.erase(keys_[entry]);
+        order_.remove(entry);
+        free_.push_back(entry);
+    }
+    /// Removes key; false if it was not there. Its value goes to *value.
+    bool erase(const CacheKey& key, std::uint64_t* value = nullptr) {
+        const std::size_t entry = index_.find(key);
+        if (entry == SlotTable::npos) {
+            return false;
+        }
+        if (value != nullptr) {
+            *value = values_[entry];
+        }
+        index_.erase(key);
+        order_.remove(entry);
+        free_.push_back(entry);
+        return true;
+    }
+
+private:
+    std::vector<CacheKey> keys_;
+    std::vector<std::uint64_t> values_;
+    /// Entries in use, oldest first
+    SlotList order_;
+    /// Entries not in use
+    std::vector<std::size_t> free_;
+    /// Key -> entry
+    SlotTable index_;
+};
+
+#endif // POLICY_LISTS_HPP
@@ -0,0 +1,144 @@
+#include "Readahead.hpp"
+#include <algorithm>    // std::min, std::max
+#include <sys/stat.h>   // fstat
+
+#include "BlockCache.hpp"
+
+StreamDetector::StreamDetector(std::size_t maxWindow)
+    : maxWindow_(std::max(maxWindow, MIN_WINDOW))
+    , window_(std::min(INITIAL_WINDOW, maxWindow_))
+{
+}
+
+void StreamDetector::setPattern(Pattern pattern) {
+    pattern_ = pattern;
+    window_ = pattern_ == Pattern::SEQUENTIAL ? 2 * maxWindow_ : std::min(INITIAL_WINDOW, maxWindow_);
+    lastBlock_ = -1;
+    runLength_ = 0;
+    prefetchedUntil_ = -1;
+}
+
+StreamDetector::Range StreamDetector::onAccess(off_t blockIndex, Lookup lookup) {
+    if (blockIndex == lastBlock_) {
+        return {};
+    }
+
+    if (lastBlock_ >= 0 && blockIndex == lastBlock_ + 1) {
+        ++runLength_;
+    } else {
+        // Random jump: start over
+        runLength_ = 1;
+        if (pattern_ != Pattern::SEQUENTIAL) {
+            window_ = std::min(INITIAL_WINDOW, maxWindow_);
+        }
+        prefetchedUntil_ = -1;
+    }
+    lastBlock_ = blockIndex;
+
+    if (!sequential()) {
+        return {};
+    }
+
+    // Feedback only for blocks that readahead was supposed to bring in;
+    // a forced sequential pattern keeps the widest window
+    if (pattern_ == Pattern::NORMAL && blockIndex <= prefetchedUntil_) {
+        if (lookup == Lookup::READAHEAD_HIT) {
+            window_ = std::min(window_ * 2, maxWindow_);
+        } else if (lookup == Lookup::MISS) {
+            window_ = std::max(window_ / 2, MIN_WINDOW);
+        }
+    }
+
+    off_t first = std::max(blockIndex + 1, prefetchedUntil_ + 1);
+    off_t last = blockIndex + static_cast<off_t>(window_);
+    if (last < first) {
+        return {};
+    }
+    prefetchedUntil_ = last;
+    return {first, static_cast<std::size_t>(last - first + 1)};
+}
+
+Prefetcher::Prefetcher(BlockCache& cache)
+    : cache_(cache)
+    , worker_(&Prefetcher::run, this)
+{
+}
+
+Prefetcher::~Prefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    pending_.release();
+    worker_.join();
+}
+
+void Prefetcher::submit(int fd, StreamDetector::Range range) {
+    if (range.count == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = 0; i < range.count; ++i) {
+            queue_.push_back({fd, range.first + static_cast<off_t>(i)});
+        }
+    }
+    pending_.release(static_cast<std::ptrdiff_t>(range.count));
+}
+
+void Prefetcher::cancel(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                                    [fd](const Request& request) { return request.fd == fd; }),
+                     queue_.end());
+    }
+    // A request taken before the erase may still be loading
+    while (inFlightFd_.load(std::memory_order_acquire) == fd) {
+        inFlightFd_.wait(fd, std::memory_order_acquire);
+    }
+}
+
+void Prefetcher::run() {
+    for (;;) {
+        pending_.acquire();
+        Request request{};
+        std::size_t count = 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            if (queue_.empty()) {
+                continue; // Permit of a cancelled request
+            }
+            request = queue_.front();
+            queue_.pop_front();
+            // Take the rest of the run along, so it is read as one batch
+            const std::size_t batchLimit = cache_.ioBackend().queueDepth();
+            while (count < batchLimit && !queue_.empty()
+                   && queue_.front().fd == request.fd
+                   && queue_.front().blockIndex == request.blockIndex + static_cast<off_t>(count)
+                   && pending_.try_acquire()) {
+                queue_.pop_front();
+                ++count;
+            }
+            inFlightFd_.store(request.fd, std::memory_order_release);
+        }
+
+        // Reading past EOF would only cache zeroes
+        struct stat st {};
+        const auto blockSize = static_cast<off_t>(cache_.blockSize());
+        if (::fstat(request.fd, &st) == 0) {
+            off_t endBlock = (st.st_size + blockSize - 1) / blockSize;
+            if (request.blockIndex < endBlock) {
+                count = std::min(count, static_cast<std::size_t>(endBlock - request.blockIndex));
+                cache_.prefetch(request.fd, request.blockIndex, count);
+            }
+        }
+
+        inFlightFd_.store(-1, std::memory_order_release);
+        inFlightFd_.notify_all();
+    }
+}
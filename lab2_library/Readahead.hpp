@@ -0,0 +1,114 @@
+#ifndef READAHEAD_HPP
+#define READAHEAD_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <semaphore>
+#include <sys/types.h>
+#include <thread>
+
+class BlockCache;
+
+/**
+ * \class StreamDetector
+ * \brief Per-fd sequential access detector with an adaptive readahead window.
+ *
+ * Fed with every block a reader moves to. Once SEQUENTIAL_THRESHOLD
+ * consecutive blocks have been read, it asks for the next window() blocks
+ * to be prefetched. The window doubles when the reader hits a prefetched
+ * block and halves when it misses one it should have found.
+ *
+ * The access pattern can be forced (see Lab2::advice()): SEQUENTIAL treats
+ * every access as part of a stream with twice the usual maximum window,
+ * RANDOM turns readahead off.
+ */
+class StreamDetector {
+public:
+    static constexpr std::size_t MIN_WINDOW = 1;
+    static constexpr std::size_t INITIAL_WINDOW = 4;
+    static constexpr std::size_t SEQUENTIAL_THRESHOLD = 2;
+
+    /// How the block was found in the cache
+    enum class Lookup { HIT, READAHEAD_HIT, MISS };
+
+    enum class Pattern { NORMAL, SEQUENTIAL, RANDOM };
+
+    /// Blocks [first, first + count) to prefetch; count == 0 means nothing
+    struct Range {
+        off_t first = 0;
+        std::size_t count = 0;
+    };
+
+    explicit StreamDetector(std::size_t maxWindow);
+
+    /**
+     * Records an access to blockIndex. Repeated accesses to the same block
+     * are ignored. Returns the blocks that should be prefetched now.
+     */
+    Range onAccess(off_t blockIndex, Lookup lookup);
+
+    /// True if blockIndex was expected to be prefetched already
+    bool expected(off_t blockIndex) const { return sequential() && blockIndex <= prefetchedUntil_; }
+    bool sequential() const {
+        return pattern_ != Pattern::RANDOM
+            && runLength_ >= (pattern_ == Pattern::SEQUENTIAL ? 1 : SEQUENTIAL_THRESHOLD);
+    }
+    std::size_t window() const { return window_; }
+
+    Pattern pattern() const { return pattern_; }
+    /// Forces an access pattern and starts over
+    void setPattern(Pattern pattern);
+
+private:
+    Pattern pattern_ = Pattern::NORMAL;
+    std::size_t maxWindow_;
+    std::size_t window_ = INITIAL_WINDOW;
+    off_t lastBlock_ = -1;
+    std::size_t runLength_ = 0;
+    /// Last block already handed out for prefetching in the current run
+    off_t prefetchedUntil_ = -1;
+};
+
+/**
+ * \class Prefetcher
+ * \brief Background thread that loads readahead blocks into a BlockCache.
+ *
+ * Consecutive blocks of one fd are loaded as a single batch of up to the
+ * cache's I/O queue depth. Blocks at or past the on-disk end of file are skipped.
+ */
+class Prefetcher {
+public:
+    explicit Prefetcher(BlockCache& cache);
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    void submit(int fd, StreamDetector::Range range);
+    /// Drops queued requests for fd and waits until none is running.
+    /// Must be called before fd is flushed and closed.
+    void cancel(int fd);
+
+private:
+    struct Request {
+        int fd;
+        off_t blockIndex;
+    };
+
+    BlockCache& cache_;
+    /// Guards queue_ and stopping_
+    std::mutex mutex_;
+    std::deque<Request> queue_;
+    bool stopping_ = false;
+    /// One permit per submitted request (cancelled ones leave stale permits)
+    std::counting_semaphore<> pending_{0};
+    /// fd of the request being loaded right now, -1 if none
+    std::atomic<int> inFlightFd_{-1};
+    std::thread worker_;
+
+    void run();
+};
+
+#endif // READAHEAD_HPP
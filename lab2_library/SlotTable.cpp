@@ -0,0 +1,140 @@
+#include "SlotTable.hpp"
+#include <bit>          // std::bit_ceil, std::countr_zero
+#include <cstring>      // memset
+#include <utility>      // std::swap
+
+#if defined(__SSE2__)
+#include <emmintrin.h>  // _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+namespace {
+
+/// Groups for expected keys at no more than 7/8 load, a power of two
+std::size_t groupsFor(std::size_t expected) {
+    const std::size_t entries = expected + expected / 7 + 1;
+    return std::bit_ceil((entries + SlotTable::GROUP_SIZE - 1) / SlotTable::GROUP_SIZE);
+}
+
+} // namespace
+
+SlotTable::SlotTable(std::size_t expected)
+    : groupCount_(groupsFor(expected))
+    , groups_(std::make_unique<Group[]>(groupCount_))
+    , entries_(std::make_unique<Entry[]>(groupCount_ * GROUP_SIZE))
+{
+    std::memset(groups_.get(), static_cast<unsigned char>(EMPTY), groupCount_ * sizeof(Group));
+}
+
+std::uint32_t SlotTable::match(const Group& group, std::int8_t value) {
+#if defined(__SSE2__)
+    const __m128i control = _mm_load_si128(reinterpret_cast<const __m128i*>(group.control));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(value))));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+        bits |= static_cast<std::uint32_t>(group.control[i] == value) << i;
+    }
+    return bits;
+#endif
+}
+
+std::uint32_t SlotTable::matchFree(const Group& group) {
+#if defined(__SSE2__)
+    // Empty and deleted are the only negative control bytes
+    const __m128i control = _mm_load_si128(reinterpret_cast<const __m128i*>(group.control));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(control));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+        bits |= static_cast<std::uint32_t>(group.control[i] < 0) << i;
+    }
+    return bits;
+#endif
+}
+
+std::size_t SlotTable::locate(const CacheKey& key, std::uint64_t hash) const {
+    const auto tag = static_cast<std::int8_t>(hash & 0x7F);
+    const std::size_t mask = groupCount_ - 1;
+    std::size_t group = (hash >> 7) & mask;
+    for (std::size_t step = 1; step <= groupCount_; ++step) {
+        for (std::uint32_t bits = match(groups_[group], tag); bits != 0; bits &= bits - 1) {
+            const std::size_t i = group * GROUP_SIZE + static_cast<std::size_t>(std::countr_zero(bits));
+            if (entries_[i].key == key) {
+                return i;
+            }
+        }
+        // An empty entry ends every probe sequence that reached this group
+        if (match(groups_[group], EMPTY) != 0) {
+            return npos;
+        }
+        group = (group + step) & mask;
+    }
+    return npos;
+}
+
+std::size_t SlotTable::find(const CacheKey& key) const {
+    const std::size_t i = locate(key, hashKey(key));
+    return i == npos ? npos : entries_[i].slot;
+}
+
+void SlotTable::place(const CacheKey& key, std::size_t slot, std::uint64_t hash) {
+    const std::size_t mask = groupCount_ - 1;
+    std::size_t group = (hash >> 7) & mask;
+    for (std::size_t step = 1;; ++step) {
+        const std::uint32_t bits = matchFree(groups_[group]);
+        if (bits != 0) {
+            const std::size_t i = group * GROUP_SIZE + static_cast<std::size_t>(std::countr_zero(bits));
+            if (control(i) == DELETED) {
+                --deleted_;
+            }
+            setControl(i, static_cast<std::int8_t>(hash & 0x7F));
+            entries_[i] = {key, slot};
+            ++size_;
+            return;
+        }
+        group = (group + step) & mask;
+    }
+}
+
+void SlotTable::insert(const CacheKey& key, std::size_t slot) {
+    if ((size_ + deleted_ + 1) * 8 > bucketCount() * 7) {
+        // Mostly tombstones: clean up in place; otherwise grow
+        rehash(size_ * 2 < bucketCount() ? groupCount_ : groupCount_ * 2);
+    }
+    place(key, slot, hashKey(key));
+}
+
+bool SlotTable::erase(const CacheKey& key) {
+    const std::size_t i = locate(key, hashKey(key));
+    if (i == npos) {
+        return false;
+    }
+    // If the group has an empty entry, no probe ever went past it, so this
+    // one can be empty too; otherwise a tombstone keeps later keys reachable
+    if (match(groups_[i / GROUP_SIZE], EMPTY) != 0) {
+        setControl(i, EMPTY);
+    } else {
+        setControl(i, DELETED);
+        ++deleted_;
+    }
+    --size_;
+    return true;
+}
+
+void SlotTable::rehash(std::size_t groupCount) {
+    std::unique_ptr<Group[]> oldGroups = std::make_unique<Group[]>(groupCount);
+    std::unique_ptr<Entry[]> oldEntries = std::make_unique<Entry[]>(groupCount * GROUP_SIZE);
+    std::swap(oldGroups, groups_);
+    std::swap(oldEntries, entries_);
+    const std::size_t oldBuckets = groupCount_ * GROUP_SIZE;
+
+    groupCount_ = groupCount;
+    size_ = 0;
+    deleted_ = 0;
+    std::memset(groups_.get(), static_cast<unsigned char>(EMPTY), groupCount_ * sizeof(Group));
+    for (std::size_t i = 0; i < oldBuckets; ++i) {
+        if (isFull(oldGroups[i / GROUP_SIZE].control[i % GROUP_SIZE])) {
+            place(oldEntries[i].key, oldEntries[i].slot, hashKey(oldEntries[i].key));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef SLOT_TABLE_HPP
+#define SLOT_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "CacheKey.hpp"
+
+/**
+ * \class SlotTable
+ * \brief Open-addressing hash table from CacheKey to a cache slot, laid out like a Swiss table.
+ *
+ * Entries live in one flat array, split into groups of GROUP_SIZE. Each entry
+ * has a control byte: empty, deleted, or the low 7 bits of its key's hash. A
+ * lookup compares the control bytes of a whole group with the wanted hash at
+ * once (one SSE2 compare where available) and only looks at the keys that
+ * match, so a miss rarely touches a key at all. Groups are probed
+ * triangularly, which visits every group of the power-of-two table.
+ *
+ * Insertions never allocate unless the table has to grow past 7/8 full.
+ * Not thread-safe; BlockCache guards each shard's table with the shard mutex.
+ */
+class SlotTable {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    static constexpr std::size_t GROUP_SIZE = 16;
+
+    /// Room for expected keys without growing
+    explicit SlotTable(std::size_t expected = 0);
+
+    std::size_t size() const { return size_; }
+    /// Entries the table has room for, counting empty and deleted ones
+    std::size_t bucketCount() const { return groupCount_ * GROUP_SIZE; }
+
+    /// The slot stored for key, or npos
+    std::size_t find(const CacheKey& key) const;
+    bool contains(const CacheKey& key) const { return find(key) != npos; }
+    /// Adds key, which must not be in the table yet
+    void insert(const CacheKey& key, std::size_t slot);
+    /// Removes key; false if it was not in the table
+    bool erase(const CacheKey& key);
+
+    /// Calls f(key, slot) for every entry; f must not change the table
+    template <typename F>
+    void forEach(F&& f) const {
+        for (std::size_t i = 0; i < groupCount_ * GROUP_SIZE; ++i) {
+            if (isFull(control(i))) {
+                f(entries_[i].key, entries_[i].slot);
+            }
+        }
+    }
+
+private:
+    static constexpr std::int8_t EMPTY = -128;
+    static constexpr std::int8_t DELETED = -2;
+
+    struct Entry {
+        CacheKey key;
+        std::size_t slot;
+    };
+    struct alignas(GROUP_SIZE) Group {
+        std::int8_t control[GROUP_SIZE];
+    };
+
+    static bool isFull(std::int8_t control) { return control >= 0; }
+    std::int8_t control(std::size_t i) const { return groups_[i / GROUP_SIZE].control[i % GROUP_SIZE]; }
+    void setControl(std::size_t i, std::int8_t value) { groups_[i / GROUP_SIZE].control[i % GROUP_SIZE] = value; }
+
+    /// Bit i set where control byte i of group equals value
+    static std::uint32_t match(const Group& group, std::int8_t value);
+    /// Bit i set where control byte i of group is empty or deleted
+    static std::uint32_t matchFree(const Group& group);
+
+    /// Index of key's entry, or npos
+    std::size_t locate(const CacheKey& key, std::uint64_t hash) const;
+    /// Puts key in the first free entry of its probe sequence, without checking the load
+    void place(const CacheKey& key, std::size_t slot, std::uint64_t hash);
+    void rehash(std::size_t groupCount);
+
+    std::size_t groupCount_;
+    std::size_t size_ = 0;
+    /// Deleted control bytes; they count against the load like entries
+    std::size_t deleted_ = 0;
+    std::unique_ptr<Group[]> groups_;
+    std::unique_ptr<Entry[]> entries_;
+};
+
+#endif // SLOT_TABLE_HPP
@@ -0,0 +1,113 @@
+#include "Statistics.hpp"
+#include <algorithm>    // std::max
+#include <bit>          // std::bit_width
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t ns) {
+    if (ns < SUB_BUCKETS) {
+        return static_cast<std::size_t>(ns);
+    }
+    // The top SUB_BUCKET_BITS + 1 bits of the value pick the bucket
+    const std::size_t shift = static_cast<std::size_t>(std::bit_width(ns)) - 1 - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<std::size_t>((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t LatencyHistogram::upperBound(std::size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const std::size_t shift = bucket / SUB_BUCKETS - 1;
+    const std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+std::uint64_t LatencyHistogram::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    // Rank of the value, counted from 1
+    auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return upperBound(bucket);
+        }
+    }
+    return upperBound(counts.size() - 1);
+}
+
+std::uint64_t LatencyHistogram::countAtMost(std::uint64_t ns) const {
+    std::uint64_t total = 0;
+    for (std::size_t bucket = 0; bucket < counts.size() && upperBound(bucket) <= ns; ++bucket) {
+        total += counts[bucket];
+    }
+    return total;
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) {
+    for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        counts[bucket] += other.counts[bucket];
+    }
+    count += other.count;
+    sumNs += other.sumNs;
+    return *this;
+}
+
+CacheStats& CacheStats::operator+=(const CacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    writebacks += other.writebacks;
+    secondChances += other.secondChances;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    holeLoads += other.holeLoads;
+    bytesPunched += other.bytesPunched;
+    tierHits += other.tierHits;
+    tierMisses += other.tierMisses;
+    tierStored += other.tierStored;
+    tierRejected += other.tierRejected;
+    tierRawBytes += other.tierRawBytes;
+    tierCompressedBytes += other.tierCompressedBytes;
+    diskReads += other.diskReads;
+    diskWrites += other.diskWrites;
+    return *this;
+}
+
+StripedStats::Stripe& StripedStats::stripe() {
+    // Threads take stripes in turn as they first count something
+    static std::atomic<std::size_t> nextStripe{0};
+    thread_local const std::size_t index = nextStripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+    return stripes_[index];
+}
+
+void StripedStats::record(Histogram& histogram, std::chrono::nanoseconds latency, std::size_t transfers) {
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+    histogram.counts[LatencyHistogram::bucketOf(ns)].fetch_add(transfers, std::memory_order_relaxed);
+    histogram.sumNs.fetch_add(ns * transfers, std::memory_order_relaxed);
+}
+
+void StripedStats::addTo(const Histogram& histogram, LatencyHistogram& snapshot) {
+    for (std::size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        const std::uint64_t count = histogram.counts[bucket].load(std::memory_order_relaxed);
+        snapshot.counts[bucket] += count;
+        snapshot.count += count;
+    }
+    snapshot.sumNs += histogram.sumNs.load(std::memory_order_relaxed);
+}
+
+void StripedStats::snapshot(CacheStats& stats) const {
+    for (std::size_t i = 0; i < STRIPES; ++i) {
+        const Stripe& stripe = stripes_[i];
+        stats.hits += stripe.counters[HITS].load(std::memory_order_relaxed);
+        stats.misses += stripe.counters[MISSES].load(std::memory_order_relaxed);
+        stats.evictions += stripe.counters[EVICTIONS].load(std::memory_order_relaxed);
+        stats.writebacks += stripe.counters[WRITEBACKS].load(std::memory_order_relaxed);
+        stats.bytesRead += stripe.counters[BYTES_READ].load(std::memory_order_relaxed);
+        stats.bytesWritten += stripe.counters[BYTES_WRITTEN].load(std::memory_order_relaxed);
+        stats.holeLoads += stripe.counters[HOLE_LOADS].load(std::memory_order_relaxed);
+        stats.bytesPunched += stripe.counters[BYTES_PUNCHED].load(std::memory_order_relaxed);
+        addTo(stripe.reads, stats.diskReads);
+        addTo(stripe.writes, stats.diskWrites);
+    }
+}
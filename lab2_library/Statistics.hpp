@@ -0,0 +1,121 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @struct LatencyHistogram
+ * Durations in log-linear buckets, as in HdrHistogram: below SUB_BUCKETS ns
+ * every value has its own bucket, above that each power of two is split into
+ * SUB_BUCKETS equal buckets, so a bucket is never wider than 1/SUB_BUCKETS of
+ * the values in it.
+ */
+struct LatencyHistogram {
+    static constexpr std::size_t SUB_BUCKET_BITS = 3;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static std::size_t bucketOf(std::uint64_t ns);
+    /// Largest value that falls into bucket
+    static std::uint64_t upperBound(std::size_t bucket);
+
+    /// Upper bound of the bucket holding the q-quantile (0 <= q <= 1); 0 if empty
+    std::uint64_t quantile(double q) const;
+    /// How many values are at most ns, counting whole buckets
+    std::uint64_t countAtMost(std::uint64_t ns) const;
+
+    LatencyHistogram& operator+=(const LatencyHistogram& other);
+
+    std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(BUCKET_COUNT);
+    std::uint64_t count = 0;
+    std::uint64_t sumNs = 0;
+};
+
+/// Snapshot of what a BlockCache has done, see Lab2::stats()
+struct CacheStats {
+    /// Block lookups served from the cache
+    std::uint64_t hits = 0;
+    /// Block lookups that had to go to disk (or, for a whole-block write, just take a slot)
+    std::uint64_t misses = 0;
+    /// Blocks evicted to make room for others
+    std::uint64_t evictions = 0;
+    /// Dirty blocks written back, by eviction, the flusher or fsync
+    std::uint64_t writebacks = 0;
+    /// Referenced blocks the eviction policy passed over
+    std::uint64_t secondChances = 0;
+    std::uint64_t bytesRead = 0;
+    std::uint64_t bytesWritten = 0;
+    /// Misses on blocks that lie in a hole of a sparse file, zero-filled without a read
+    std::uint64_t holeLoads = 0;
+    /// Dirty bytes found all zero and left a hole in the file instead of written
+    std::uint64_t bytesPunched = 0;
+    /// Misses the compressed tier served without a disk read, and the ones it could not serve
+    std::uint64_t tierHits = 0;
+    std::uint64_t tierMisses = 0;
+    /// Clean evicted blocks the tier kept, and the ones that compressed too poorly to keep
+    std::uint64_t tierStored = 0;
+    std::uint64_t tierRejected = 0;
+    /// Size of the kept blocks before and after compression; their ratio is the compression ratio
+    std::uint64_t tierRawBytes = 0;
+    std::uint64_t tierCompressedBytes = 0;
+    /// How long disk reads and writes kept their caller waiting; a batch counts for each of its transfers
+    LatencyHistogram diskReads;
+    LatencyHistogram diskWrites;
+
+    /// Adds up the stats of several caches
+    CacheStats& operator+=(const CacheStats& other);
+};
+
+/**
+ * \class StripedStats
+ * \brief The counters behind CacheStats, cheap enough to bump on every access.
+ *
+ * Each thread updates its own stripe (threads are spread over STRIPES of
+ * them), so counting does not bounce a shared cache line; snapshot() adds
+ * the stripes up.
+ */
+class StripedStats {
+public:
+    static constexpr std::size_t STRIPES = 16;
+
+    enum Counter { HITS, MISSES, EVICTIONS, WRITEBACKS, BYTES_READ, BYTES_WRITTEN, HOLE_LOADS, BYTES_PUNCHED, COUNTER_COUNT };
+
+    StripedStats() : stripes_(std::make_unique<Stripe[]>(STRIPES)) {}
+
+    void add(Counter counter, std::uint64_t n = 1) {
+        stripe().counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+    void recordRead(std::chrono::nanoseconds latency, std::size_t transfers = 1) {
+        record(stripe().reads, latency, transfers);
+    }
+    void recordWrite(std::chrono::nanoseconds latency, std::size_t transfers = 1) {
+        record(stripe().writes, latency, transfers);
+    }
+
+    /// Adds everything recorded so far to stats
+    void snapshot(CacheStats& stats) const;
+
+private:
+    struct Histogram {
+        std::atomic<std::uint64_t> counts[LatencyHistogram::BUCKET_COUNT] = {};
+        std::atomic<std::uint64_t> sumNs{0};
+    };
+    struct alignas(64) Stripe {
+        std::atomic<std::uint64_t> counters[COUNTER_COUNT] = {};
+        Histogram reads;
+        Histogram writes;
+    };
+
+    Stripe& stripe();
+    static void record(Histogram& histogram, std::chrono::nanoseconds latency, std::size_t transfers);
+    static void addTo(const Histogram& histogram, LatencyHistogram& snapshot);
+
+    std::unique_ptr<Stripe[]> stripes_;
+};
+
+#endif // STATISTICS_HPP
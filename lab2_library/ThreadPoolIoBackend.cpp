@@ -0,0 +1,68 @@
+#include "ThreadPoolIoBackend.hpp"
+#include <algorithm>    // std::max
+
+ThreadPoolIoBackend::ThreadPoolIoBackend(std::size_t queueDepth)
+{
+    std::size_t threads = std::max<std::size_t>(queueDepth, 1);
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&ThreadPoolIoBackend::run, this);
+    }
+}
+
+ThreadPoolIoBackend::~ThreadPoolIoBackend() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pending_.release(static_cast<std::ptrdiff_t>(workers_.size()));
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPoolIoBackend::execute(IoRequest* requests, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        // Nothing to overlap; skip the round trip through the queue
+        SyncIoBackend::run(requests[0]);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->remaining.store(count, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = 0; i < count; ++i) {
+            queue_.push_back({&requests[i], batch});
+        }
+    }
+    pending_.release(static_cast<std::ptrdiff_t>(count));
+
+    std::size_t remaining;
+    while ((remaining = batch->remaining.load(std::memory_order_acquire)) != 0) {
+        batch->remaining.wait(remaining, std::memory_order_acquire);
+    }
+}
+
+void ThreadPoolIoBackend::run() {
+    for (;;) {
+        pending_.acquire();
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        SyncIoBackend::run(*task.request);
+        if (task.batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            task.batch->remaining.notify_all();
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_IO_BACKEND_HPP
+#define THREAD_POOL_IO_BACKEND_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+#include "IoBackend.hpp"
+
+/**
+ * \class ThreadPoolIoBackend
+ * \brief Portable asynchronous backend: queueDepth workers doing pread/pwrite.
+ */
+class ThreadPoolIoBackend : public IoBackend {
+public:
+    explicit ThreadPoolIoBackend(std::size_t queueDepth);
+    ~ThreadPoolIoBackend() override;
+
+    void execute(IoRequest* requests, std::size_t count) override;
+    using IoBackend::execute;
+
+    std::size_t queueDepth() const override { return workers_.size(); }
+    const char* name() const override { return "threads"; }
+
+private:
+    /// Shared with the workers so that the last one can still notify after the caller returned
+    struct Batch {
+        std::atomic<std::size_t> remaining;
+    };
+
+    struct Task {
+        IoRequest* request;
+        std::shared_ptr<Batch> batch;
+    };
+
+    std::mutex mutex_;
+    std::deque<Task> queue_;
+    bool stopping_ = false;
+    /// One permit per queued task, plus one per worker on shutdown
+    std::counting_semaphore<> pending_{0};
+    std::vector<std::thread> workers_;
+
+    void run();
+};
+
+#endif // THREAD_POOL_IO_BACKEND_HPP
@@ -0,0 +1,117 @@
+#include "Trace.hpp"
+#include <fcntl.h>      // open
+#include <unistd.h>     // write, close
+#include <cerrno>       // errno, EINTR
+#include <cstring>      // memcmp, strerror
+#include <stdexcept>    // runtime_error
+#include <system_error> // std::system_error
+
+#include "BinaryFormat.hpp"
+#include "Log.hpp"
+
+TraceWriter::TraceWriter(const std::string& path)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+    , origin_(std::chrono::steady_clock::now())
+{
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create trace file " + path);
+    }
+    buffer_.reserve(FLUSH_THRESHOLD + 256);
+    buffer_.insert(buffer_.end(), TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+    ::close(fd_);
+}
+
+std::uint64_t TraceWriter::now() const {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count());
+}
+
+void TraceWriter::record(const TraceEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_.push_back(static_cast<std::uint8_t>(event.op));
+    // Events from several threads need not arrive in start order
+    putVarint(buffer_, zigzag(static_cast<std::int64_t>(event.timeNs - lastTimeNs_)));
+    lastTimeNs_ = event.timeNs;
+    putVarint(buffer_, event.durationNs);
+    putVarint(buffer_, zigzag(event.fd));
+    putVarint(buffer_, zigzag(event.offset));
+    putVarint(buffer_, event.length);
+    putVarint(buffer_, zigzag(event.result));
+    if (event.op == TraceEvent::Op::OPEN) {
+        putVarint(buffer_, event.path.size());
+        buffer_.insert(buffer_.end(), event.path.begin(), event.path.end());
+    }
+    if (event.op == TraceEvent::Op::SYNC_RANGE) {
+        putVarint(buffer_, event.flags);
+    }
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flushLocked();
+    }
+}
+
+void TraceWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+void TraceWriter::flushLocked() {
+    std::size_t written = 0;
+    while (written < buffer_.size()) {
+        ssize_t result = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            // Losing the tail of a trace must not fail the traced call
+            LAB2_LOG_ERROR("Error writing trace: {}", std::strerror(errno));
+            break;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+    buffer_.clear();
+}
+
+TraceReader::TraceReader(const std::string& path) : data_(readWholeFile(path, "trace file")) {
+    if (data_.size() < sizeof(TraceWriter::TRACE_MAGIC)
+        || std::memcmp(data_.data(), TraceWriter::TRACE_MAGIC, sizeof(TraceWriter::TRACE_MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a Lab2 trace");
+    }
+    position_ = sizeof(TraceWriter::TRACE_MAGIC);
+}
+
+bool TraceReader::next(TraceEvent& event) {
+    if (position_ == data_.size()) {
+        return false;
+    }
+    std::uint8_t op = data_[position_++];
+    if (op > static_cast<std::uint8_t>(TraceEvent::Op::SYNC_RANGE)) {
+        throw std::runtime_error("Unknown trace event type " + std::to_string(op));
+    }
+    event.op = static_cast<TraceEvent::Op>(op);
+    lastTimeNs_ += static_cast<std::uint64_t>(unzigzag(readVarint()));
+    event.timeNs = lastTimeNs_;
+    event.durationNs = readVarint();
+    event.fd = static_cast<int>(unzigzag(readVarint()));
+    event.offset = unzigzag(readVarint());
+    event.length = readVarint();
+    event.result = unzigzag(readVarint());
+    event.path.clear();
+    if (event.op == TraceEvent::Op::OPEN) {
+        std::uint64_t length = readVarint();
+        if (length > data_.size() - position_) {
+            throw std::runtime_error("Truncated trace event");
+        }
+        event.path.assign(reinterpret_cast<const char*>(data_.data() + position_), length);
+        position_ += length;
+    }
+    event.flags = event.op == TraceEvent::Op::SYNC_RANGE ? static_cast<std::uint32_t>(readVarint()) : 0;
+    return true;
+}
+
+std::uint64_t TraceReader::readVarint() {
+    return getVarint(data_, position_, "trace event");
+}
@@ -0,0 +1,146 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct TraceEvent
+ * One call on Lab2 as recorded in a trace.
+ */
+struct TraceEvent {
+    enum class Op : std::uint8_t { OPEN, CLOSE, READ, WRITE, LSEEK, FSYNC, PREAD, PWRITE, FDATASYNC, SYNC_RANGE };
+
+    Op op = Op::OPEN;
+    /// When the call started, relative to the start of the trace
+    std::uint64_t timeNs = 0;
+    /// How long it took
+    std::uint64_t durationNs = 0;
+    int fd = -1;
+    /// PREAD/PWRITE/LSEEK/SYNC_RANGE only
+    std::int64_t offset = 0;
+    /// Byte count; the whence of LSEEK
+    std::uint64_t length = 0;
+    /// What the call returned (the fd for OPEN)
+    std::int64_t result = 0;
+    /// OPEN only
+    std::string path;
+    /// SYNC_RANGE only
+    std::uint32_t flags = 0;
+};
+
+/**
+ * \class TraceWriter
+ * \brief Appends TraceEvents to a file in a compact binary format.
+ *
+ * The file starts with TRACE_MAGIC; every event after it is its op byte
+ * followed by LEB128 varints (zigzag-encoded where the value can be
+ * negative), then for OPEN the length and bytes of the path, and for
+ * SYNC_RANGE a varint of its flags. Times are stored
+ * as the difference from the previous event. Safe to share between threads;
+ * events are buffered and written out in large chunks.
+ */
+class TraceWriter {
+public:
+    static constexpr char TRACE_MAGIC[8] = {'L', '2', 'T', 'R', 'A', 'C', 'E', '1'};
+
+    /// Creates or truncates path; throws std::system_error if that fails
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /// Clock the event times are taken from; its epoch is the writer's creation
+    std::uint64_t now() const;
+
+    void record(const TraceEvent& event);
+    /// Writes out what is buffered
+    void flush();
+
+private:
+    static constexpr std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    void flushLocked();
+
+    int fd_;
+    std::chrono::steady_clock::time_point origin_;
+    std::mutex mutex_;
+    std::vector<std::uint8_t> buffer_;
+    std::uint64_t lastTimeNs_ = 0;
+};
+
+/**
+ * \class TraceReader
+ * \brief Reads back what TraceWriter wrote, one event at a time.
+ */
+class TraceReader {
+public:
+    /// Throws std::system_error if path cannot be read, std::runtime_error if it is not a trace
+    explicit TraceReader(const std::string& path);
+
+    /// Returns false at the end of the trace; throws std::runtime_error on a truncated event
+    bool next(TraceEvent& event);
+
+private:
+    std::uint64_t readVarint();
+
+    std::vector<std::uint8_t> data_;
+    std::size_t position_ = 0;
+    std::uint64_t lastTimeNs_ = 0;
+};
+
+/**
+ * \class TraceScope
+ * \brief Records one Lab2 call, if tracing is on, when it goes out of scope.
+ *
+ * Every return of a traced call passes its value through done().
+ */
+class TraceScope {
+public:
+    TraceScope(TraceWriter* writer, TraceEvent::Op op, int fd, std::int64_t offset = 0, std::uint64_t length = 0)
+        : writer_(writer) {
+        if (writer_ != nullptr) {
+            event_.op = op;
+            event_.fd = fd;
+            event_.offset = offset;
+            event_.length = length;
+            event_.timeNs = writer_->now();
+        }
+    }
+    ~TraceScope() {
+        if (writer_ != nullptr) {
+            event_.durationNs = writer_->now() - event_.timeNs;
+            writer_->record(event_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void setPath(const std::string& path) {
+        if (writer_ != nullptr) {
+            event_.path = path;
+        }
+    }
+
+    void setFlags(std::uint32_t flags) {
+        event_.flags = flags;
+    }
+
+    template <typename Result>
+    Result done(Result result) {
+        event_.result = static_cast<std::int64_t>(result);
+        return result;
+    }
+
+private:
+    TraceWriter* writer_;
+    TraceEvent event_;
+};
+
+#endif // TRACE_HPP
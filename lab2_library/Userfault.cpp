@@ -0,0 +1,260 @@
+#include "Userfault.hpp"
+#include <fcntl.h>              // O_CLOEXEC, O_NONBLOCK
+#include <linux/userfaultfd.h>  // uffdio_*, UFFD_*
+#include <poll.h>               // poll
+#include <sys/eventfd.h>        // eventfd
+#include <sys/ioctl.h>          // ioctl
+#include <sys/mman.h>           // mmap, munmap, madvise
+#include <sys/syscall.h>        // SYS_userfaultfd
+#include <unistd.h>             // syscall, read, write, close, sysconf
+#include <algorithm>            // std::min
+#include <bit>                  // std::countr_zero
+#include <cerrno>               // errno
+#include <cstring>              // memcpy, strerror
+#include <system_error>         // std::system_error
+
+#include "BlockCache.hpp"
+#include "Log.hpp"
+
+namespace {
+
+/// A userfaultfd with its API handshake done; -1 if the kernel refuses
+int openUserfaultfd(std::uint64_t features) {
+    // Faults from inside the kernel (a syscall reading a mapped buffer) need
+    // the privilege; fall back to user faults only where it is missing
+    int fd = static_cast<int>(::syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+    if (fd < 0 && errno == EPERM) {
+        fd = static_cast<int>(::syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    uffdio_api api{};
+    api.api = UFFD_API;
+    api.features = features;
+    if (::ioctl(fd, UFFDIO_API, &api) < 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+UserfaultMapper::UserfaultMapper() : zeroPage_(pageSize(), 0) {
+    uffd_ = openUserfaultfd(UFFD_FEATURE_PAGEFAULT_FLAG_WP);
+    writeProtect_ = uffd_ >= 0;
+    if (uffd_ < 0 && errno == EINVAL) {
+        uffd_ = openUserfaultfd(0); // A kernel without write-protect support
+    }
+    if (uffd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open a userfaultfd");
+    }
+    stopFd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (stopFd_ < 0) {
+        int error = errno;
+        ::close(uffd_);
+        throw std::system_error(error, std::generic_category(), "Cannot create an eventfd");
+    }
+    worker_ = std::thread(&UserfaultMapper::run, this);
+}
+
+UserfaultMapper::~UserfaultMapper() {
+    const std::uint64_t one = 1;
+    (void)::write(stopFd_, &one, sizeof(one));
+    worker_.join();
+    for (auto &[start, region] : regions_) {
+        // A view left open; its pointer dangles from here on
+        ::munmap(region->base, region->mappedLength);
+        region->base = nullptr;
+    }
+    ::close(stopFd_);
+    ::close(uffd_);
+}
+
+std::size_t UserfaultMapper::pageSize() {
+    static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+std::shared_ptr<MappedRegion> UserfaultMapper::map(BlockCache &cache, int fd, off_t offset, std::size_t size) {
+    const std::size_t page = pageSize();
+    const std::size_t pages = (size + page - 1) / page;
+    auto region = std::make_shared<MappedRegion>();
+    region->size = size;
+    region->mappedLength = pages * page;
+    region->cache = &cache;
+    region->fd = fd;
+    region->offset = offset;
+    region->dirty = std::make_unique<std::atomic<std::uint64_t>[]>((pages + 63) / 64);
+
+    void *base = ::mmap(nullptr, region->mappedLength, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    region->base = static_cast<char *>(base);
+    // UFFDIO_COPY fills small pages; a huge page would have to be filled at once
+    (void)::madvise(base, region->mappedLength, MADV_NOHUGEPAGE);
+
+    uffdio_register reg{};
+    reg.range.start = reinterpret_cast<std::uintptr_t>(base);
+    reg.range.len = region->mappedLength;
+    reg.mode = UFFDIO_REGISTER_MODE_MISSING | (writeProtect_ ? UFFDIO_REGISTER_MODE_WP : 0);
+    if (::ioctl(uffd_, UFFDIO_REGISTER, &reg) < 0) {
+        int error = errno;
+        ::munmap(base, region->mappedLength);
+        errno = error;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_[reg.range.start] = region;
+    return region;
+}
+
+bool UserfaultMapper::sync(MappedRegion &region) {
+    const std::size_t page = pageSize();
+    const std::size_t blockSize = region.cache->blockSize();
+    const std::size_t words = (region.mappedLength / page + 63) / 64;
+    bool ok = true;
+    for (std::size_t word = 0; word < words; ++word) {
+        // Without write faults nothing says a page is clean again
+        std::uint64_t bits = writeProtect_ ? region.dirty[word].exchange(0, std::memory_order_acq_rel)
+                                           : region.dirty[word].load(std::memory_order_acquire);
+        for (; bits != 0; bits &= bits - 1) {
+            const std::size_t pageIndex = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+            char *address = region.base + pageIndex * page;
+            if (writeProtect_) {
+                // Before the copy: a write from here on faults and dirties the page again
+                setProtection(reinterpret_cast<std::uintptr_t>(address), page, true);
+            }
+            const off_t fileOffset = region.offset + static_cast<off_t>(pageIndex * page);
+            BlockCache::Handle block = region.cache->acquire(region.fd, fileOffset / static_cast<off_t>(blockSize));
+            if (!block) {
+                region.dirty[word].fetch_or(std::uint64_t{1} << (pageIndex % 64), std::memory_order_acq_rel);
+                ok = false;
+                continue;
+            }
+            // The last page may run past the end of the file
+            const std::size_t length = std::min(page, region.size - pageIndex * page);
+            const std::size_t inBlock = static_cast<std::size_t>(fileOffset) % blockSize;
+            std::memcpy(static_cast<char *>(block.data()) + inBlock, address, length);
+            block.markDirty(inBlock, length);
+        }
+    }
+    return ok;
+}
+
+void UserfaultMapper::unmap(MappedRegion &region) {
+    const auto start = reinterpret_cast<std::uintptr_t>(region.base);
+    {
+        // Waits for a fault being served in the range, so that it does not land in whatever is mapped there next
+        std::lock_guard<std::mutex> lock(mutex_);
+        uffdio_range range{start, region.mappedLength};
+        (void)::ioctl(uffd_, UFFDIO_UNREGISTER, &range);
+        ::munmap(region.base, region.mappedLength);
+        regions_.erase(start);
+    }
+    region.base = nullptr;
+}
+
+void UserfaultMapper::run() {
+    pollfd fds[2] = {{uffd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+    uffd_msg messages[16];
+    for (;;) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LAB2_LOG_ERROR("Polling the userfaultfd failed: {}", std::strerror(errno));
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        const ssize_t bytes = ::read(uffd_, messages, sizeof(messages));
+        if (bytes < 0) {
+            continue; // EAGAIN: another wakeup took the message
+        }
+        for (std::size_t i = 0; i < static_cast<std::size_t>(bytes) / sizeof(uffd_msg); ++i) {
+            if (messages[i].event == UFFD_EVENT_PAGEFAULT) {
+                handleFault(messages[i].arg.pagefault.address, messages[i].arg.pagefault.flags);
+            }
+        }
+    }
+}
+
+void UserfaultMapper::handleFault(std::uintptr_t address, std::uint64_t flags) {
+    const std::size_t page = pageSize();
+    const std::uintptr_t pageAddress = address & ~static_cast<std::uintptr_t>(page - 1);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = regions_.upper_bound(pageAddress);
+    if (it == regions_.begin()) {
+        return;
+    }
+    MappedRegion &region = *(--it)->second;
+    const auto start = reinterpret_cast<std::uintptr_t>(region.base);
+    if (pageAddress >= start + region.mappedLength) {
+        return;
+    }
+    const std::size_t pageIndex = (pageAddress - start) / page;
+    auto markDirty = [&region, pageIndex] {
+        region.dirty[pageIndex / 64].fetch_or(std::uint64_t{1} << (pageIndex % 64), std::memory_order_acq_rel);
+    };
+
+    if ((flags & UFFD_PAGEFAULT_FLAG_WP) != 0) {
+        markDirty();
+        setProtection(pageAddress, page, false); // Also wakes the writer
+        return;
+    }
+
+    const std::size_t blockSize = region.cache->blockSize();
+    const off_t fileOffset = region.offset + static_cast<off_t>(pageIndex * page);
+    const std::size_t inBlock = static_cast<std::size_t>(fileOffset) % blockSize;
+    BlockCache::Handle block = region.cache->acquire(region.fd, fileOffset / static_cast<off_t>(blockSize));
+    if (!block) {
+        // The faulting thread cannot be failed; it reads zeros
+        LAB2_LOG_ERROR("Cannot load block for a mapped page (fd={}, offset={}).", region.fd, fileOffset);
+    }
+    const char *source = block ? static_cast<const char *>(block.data()) + inBlock : zeroPage_.data();
+    const bool write = (flags & UFFD_PAGEFAULT_FLAG_WRITE) != 0;
+    if (write || !writeProtect_) {
+        markDirty();
+    }
+    if (!copy(pageAddress, source, page, writeProtect_ && !write)) {
+        // Mapped in by the read-around of another fault; the thread just needs waking
+        uffdio_range range{pageAddress, page};
+        (void)::ioctl(uffd_, UFFDIO_WAKE, &range);
+        return;
+    }
+
+    // Read-around: the rest of the block, protected, so that a reader faults
+    // once per block. Without write faults it would all count as written.
+    if (block && writeProtect_) {
+        const std::size_t rest = std::min(blockSize - inBlock, region.mappedLength - pageIndex * page) - page;
+        if (rest > 0) {
+            (void)copy(pageAddress + page, source + page, rest, true);
+        }
+    }
+}
+
+bool UserfaultMapper::copy(std::uintptr_t destination, const void *source, std::size_t length, bool protect) {
+    uffdio_copy request{};
+    request.dst = destination;
+    request.src = reinterpret_cast<std::uintptr_t>(source);
+    request.len = length;
+    request.mode = protect ? UFFDIO_COPY_MODE_WP : 0;
+    // EEXIST stops a read-around at the first page already there, which is fine
+    return ::ioctl(uffd_, UFFDIO_COPY, &request) == 0;
+}
+
+void UserfaultMapper::setProtection(std::uintptr_t address, std::size_t length, bool protect) {
+    uffdio_writeprotect request{};
+    request.range.start = address;
+    request.range.len = length;
+    request.mode = protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+    (void)::ioctl(uffd_, UFFDIO_WRITEPROTECT, &request);
+}
@@ -0,0 +1,98 @@
+#ifndef USERFAULT_HPP
+#define USERFAULT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+class BlockCache;
+
+/**
+ * @struct MappedRegion
+ * A file range mapped by UserfaultMapper::map(). The pages start out missing
+ * and are filled from the cache when touched.
+ */
+struct MappedRegion {
+    char *base = nullptr;
+    /// Bytes of the file it covers; the mapping itself is rounded up to whole pages
+    std::size_t size = 0;
+    std::size_t mappedLength = 0;
+    BlockCache *cache = nullptr;
+    int fd = -1;
+    /// File offset of base
+    off_t offset = 0;
+    /// One bit per page, set when the page is written; sync() takes them
+    std::unique_ptr<std::atomic<std::uint64_t>[]> dirty;
+};
+
+/**
+ * \class UserfaultMapper
+ * \brief Memory mappings of cached file ranges, served by a userfaultfd(2) thread.
+ *
+ * map() reserves anonymous memory and registers it with a userfaultfd. The
+ * first touch of a page faults to the thread, which acquires the block under
+ * it and copies the page in with UFFDIO_COPY, along with the rest of the
+ * block, so that a reader faults once per block rather than once per page.
+ *
+ * Pages are copied in write-protected. A write to one faults again; the
+ * thread sets its dirty bit and lifts the protection, so a page faults for
+ * writing once between syncs. sync() protects the dirty pages again and
+ * copies them into their blocks, marking those dirty. Without write-protect
+ * support in the kernel, every page touched counts as written.
+ */
+class UserfaultMapper {
+public:
+    /// Throws std::system_error if the kernel offers no userfaultfd
+    UserfaultMapper();
+    ~UserfaultMapper();
+
+    UserfaultMapper(const UserfaultMapper &) = delete;
+    UserfaultMapper &operator=(const UserfaultMapper &) = delete;
+
+    static std::size_t pageSize();
+
+    /**
+     * Maps size bytes of fd from offset, a multiple of the page size, as
+     * cached in cache. Null with errno set on failure.
+     */
+    std::shared_ptr<MappedRegion> map(BlockCache &cache, int fd, off_t offset, std::size_t size);
+    /**
+     * Copies the pages written since the last sync into their blocks. False
+     * with errno set if a block could not be had; its pages stay dirty.
+     */
+    bool sync(MappedRegion &region);
+    /// Unmaps without syncing; the caller syncs first
+    void unmap(MappedRegion &region);
+
+    bool writeProtect() const { return writeProtect_; }
+
+private:
+    int uffd_ = -1;
+    /// Written to by the destructor to stop the thread
+    int stopFd_ = -1;
+    /// Write faults are reported (UFFDIO_REGISTER_MODE_WP)
+    bool writeProtect_ = false;
+    /// Source of pages the cache cannot provide
+    std::vector<char> zeroPage_;
+
+    /// Guards regions_, and is held while a fault is served so that unmap() cannot pull the range away meanwhile
+    std::mutex mutex_;
+    /// Start address -> region
+    std::map<std::uintptr_t, std::shared_ptr<MappedRegion>> regions_;
+
+    std::thread worker_;
+
+    void run();
+    void handleFault(std::uintptr_t address, std::uint64_t flags);
+    /// UFFDIO_COPY; false if the kernel refused (the page is there already, or the range went away)
+    bool copy(std::uintptr_t destination, const void *source, std::size_t length, bool protect);
+    void setProtection(std::uintptr_t address, std::size_t length, bool protect);
+};
+
+#endif // USERFAULT_HPP
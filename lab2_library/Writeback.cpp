@@ -0,0 +1,86 @@
+#include "Writeback.hpp"
+#include <algorithm>    // std::clamp
+#include <cerrno>       // errno
+#include <cstdint>      // SIZE_MAX
+
+#include "BlockCache.hpp"
+
+WritebackFlusher::WritebackFlusher(BlockCache& cache, double dirtyRatio,
+                                   std::chrono::milliseconds maxDirtyAge, std::chrono::milliseconds interval)
+    : cache_(cache)
+    , dirtyLimit_(static_cast<std::size_t>(std::clamp(dirtyRatio, 0.0, 1.0) * static_cast<double>(cache.capacity())))
+    , maxDirtyAge_(maxDirtyAge)
+    , interval_(interval)
+    , worker_(&WritebackFlusher::run, this)
+{
+    cache_.setDirtyLimit(dirtyLimit_, [this] { kick(); });
+}
+
+WritebackFlusher::~WritebackFlusher() {
+    cache_.setDirtyLimit(SIZE_MAX, nullptr);
+    stopping_.store(true, std::memory_order_release);
+    wakeup_.release();
+    worker_.join();
+}
+
+void WritebackFlusher::kick() {
+    if (!kicked_.exchange(true, std::memory_order_acq_rel)) {
+        wakeup_.release();
+    }
+}
+
+void WritebackFlusher::run() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        (void)wakeup_.try_acquire_for(interval_);
+        kicked_.store(false, std::memory_order_release);
+
+        if (maxDirtyAge_.count() > 0) {
+            cache_.writeBack(std::chrono::steady_clock::now() - maxDirtyAge_, SIZE_MAX);
+        }
+
+        // Over the limit: write the oldest back until half of it is left, so
+        // that the next few writes do not wake us again one block at a time
+        std::size_t dirty;
+        while (!stopping_.load(std::memory_order_acquire) && (dirty = cache_.dirtyCount()) > dirtyLimit_) {
+            if (cache_.writeBack(std::chrono::steady_clock::time_point::max(), dirty - dirtyLimit_ / 2) == 0) {
+                break; // Everything left is pinned; try again on the next wakeup
+            }
+        }
+    }
+}
+
+int GroupCommit::sync(const std::function<int()>& flush) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!next_) {
+        next_ = std::make_shared<Round>();
+    }
+    const std::shared_ptr<Round> round = next_;
+
+    while (!round->done) {
+        if (!running_ && next_ == round) {
+            // Lead the round: later callers start the next one
+            running_ = true;
+            next_.reset();
+            lock.unlock();
+            const int error = flush() == 0 ? 0 : errno;
+            lock.lock();
+            round->error = error;
+            round->done = true;
+            running_ = false;
+            finished_.fetch_add(1, std::memory_order_release);
+            finished_.notify_all();
+            break;
+        }
+        // Another round is being flushed; wait for it to finish
+        const std::uint64_t seen = finished_.load(std::memory_order_acquire);
+        lock.unlock();
+        finished_.wait(seen, std::memory_order_acquire);
+        lock.lock();
+    }
+
+    if (round->error != 0) {
+        errno = round->error;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#ifndef WRITEBACK_HPP
+#define WRITEBACK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+
+class BlockCache;
+
+/**
+ * \class WritebackFlusher
+ * \brief Background thread that writes dirty blocks of a BlockCache back early.
+ *
+ * Every interval it writes back blocks that have been dirty for longer than
+ * maxDirtyAge. When more than dirtyRatio of the cache is dirty, it is woken
+ * right away and writes back the oldest blocks until half of that limit is
+ * left, so that eviction rarely has to write a victim back itself.
+ */
+class WritebackFlusher {
+public:
+    /// A zero maxDirtyAge turns the age limit off
+    WritebackFlusher(BlockCache& cache, double dirtyRatio,
+                     std::chrono::milliseconds maxDirtyAge, std::chrono::milliseconds interval);
+    ~WritebackFlusher();
+
+    WritebackFlusher(const WritebackFlusher&) = delete;
+    WritebackFlusher& operator=(const WritebackFlusher&) = delete;
+
+    /// Wakes the thread before the interval is up
+    void kick();
+
+private:
+    BlockCache& cache_;
+    std::size_t dirtyLimit_;
+    std::chrono::milliseconds maxDirtyAge_;
+    std::chrono::milliseconds interval_;
+
+    std::atomic<bool> stopping_{false};
+    /// Set while a wakeup is pending, so that writers post at most one
+    std::atomic<bool> kicked_{false};
+    std::counting_semaphore<> wakeup_{0};
+    std::thread worker_;
+
+    void run();
+};
+
+/**
+ * \class GroupCommit
+ * \brief Merges concurrent device flushes (fsync/fdatasync) of one file into one.
+ *
+ * A caller whose data has already been written joins the next round. A round
+ * starts once the one before it has finished, so its flush covers everything
+ * its callers wrote; the first caller to find the device idle runs it for the
+ * whole round and the others take its result. N threads syncing at once thus
+ * cost at most two flushes instead of N.
+ */
+class GroupCommit {
+public:
+    /**
+     * Waits for a flush that starts after this call, running it if nobody
+     * else does. flush returns 0, or -1 with errno set like fsync(2); so does
+     * sync(), for every caller the flush covered.
+     */
+    int sync(const std::function<int()>& flush);
+
+private:
+    struct Round {
+        bool done = false;
+        int error = 0;
+    };
+
+    std::mutex mutex_;
+    /// The round callers join; null until someone asks for a flush
+    std::shared_ptr<Round> next_;
+    bool running_ = false;
+    /// Counts finished rounds; waiters sleep on it
+    std::atomic<std::uint64_t> finished_{0};
+};
+
+#endif // WRITEBACK_HPP
@@ -0,0 +1,32 @@
+#include "ZeroScan.hpp"
+#include <cstdint>      // std::uint64_t
+#include <cstring>      // memcpy
+
+namespace {
+
+constexpr std::size_t LINE = 64;
+constexpr std::size_t WORDS = LINE / sizeof(std::uint64_t);
+
+} // namespace
+
+bool isZero(const void* data, std::size_t n) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    std::size_t i = 0;
+    for (; i + LINE <= n; i += LINE) {
+        std::uint64_t words[WORDS];
+        std::memcpy(words, bytes + i, LINE);
+        std::uint64_t any = 0;
+        for (std::size_t w = 0; w < WORDS; ++w) {
+            any |= words[w];
+        }
+        if (any != 0) {
+            return false;
+        }
+    }
+    for (; i < n; ++i) {
+        if (bytes[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
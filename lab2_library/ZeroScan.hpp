@@ -0,0 +1,17 @@
+#ifndef ZERO_SCAN_HPP
+#define ZERO_SCAN_HPP
+
+#include <cstddef>
+
+/*
+ * All-zero detection for write-back, which punches holes for zero runs
+ * instead of writing them. The scan ORs 64-byte lines together a word at a
+ * time and tests each line once; the compiler turns the line into vector
+ * ORs (SSE2 on the x86-64 baseline, wider with -march), so a zero block is
+ * checked at memory speed and a data block usually fails on its first line.
+ */
+
+/// True if all n bytes at data are zero
+bool isZero(const void* data, std::size_t n);
+
+#endif // ZERO_SCAN_HPP
@@ -1,29 +1,287 @@
 #include "lab2_library.hpp"
 #include <fcntl.h>
 #include <unistd.h>
+#include <climits>
 #include <cstring>
 #include <stdexcept>
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include "BlockCache.hpp"
+#include "Log.hpp"
+#include "Manifest.hpp"
+#include "Readahead.hpp"
+#include "Trace.hpp"
+#include "Userfault.hpp"
+#include "Writeback.hpp"
 
-struct  Lab2::BlockCacheWrapper {
+struct Lab2::Inode {
+    /// The path of the first open, for saveManifest()
+    std::string path;
+    dev_t dev;
+    ino_t ino;
+    /// A dup of the first open's fd. The cache keys the file's blocks by it and
+    /// does all of its I/O through it, so the blocks outlive any one open, and
+    /// no other file can get the number while they are cached.
+    fd_t cacheFd;
+    /// Held shared by reads and writes, which pin the blocks they touch and grow size atomically,
+    /// so that they run in parallel; held exclusively by whatever changes the block size, the
+    /// opens or the cached blocks of the file as a whole (open, close, sync, advice, map)
+    std::shared_mutex mutex;
+    /// Logical file size, including writes still in the cache. The file on
+    /// disk can be shorter, or padded up to the write alignment until fsync.
+    std::atomic<off_t> size;
+    /// The block size the file uses; changed only under an exclusive mutex
+    SizeClass *sizeClass;
+    /// Device flushes of this file, shared between concurrent syncs when CacheConfig::groupCommit is set;
+    /// an fdatasync round would not do for an fsync, so each kind has its own
+    GroupCommit fsyncs;
+    GroupCommit fdatasyncs;
+    /// Opens of the file; guarded by openFilesMutex_
+    size_t openCount = 0;
+    /// The file as the last close left it, to tell whether someone else changed it before the next open
+    timespec closedMtime{};
+    off_t closedSize = 0;
+    /// Live MappedViews of the file; its block size does not change while there are any. Guarded by mutex
+    size_t mappings = 0;
+    /// Live ReadViews and WriteViews, which pin its blocks; the same goes for them.
+    /// Taken under mutex, but given back by the views without it
+    std::atomic<size_t> views{0};
+    /// The opens of the file, whose per-fd state follows a change of block size. Guarded by mutex
+    std::vector<OpenFile *> opens;
+
+    Inode(std::string path, const struct stat &st, fd_t cacheFd, SizeClass &sizeClass)
+        : path(std::move(path)), dev(st.st_dev), ino(st.st_ino), cacheFd(cacheFd), size(st.st_size)
+        , sizeClass(&sizeClass) {}
+    Inode(const Inode &) = delete;
+    Inode &operator=(const Inode &) = delete;
+    ~Inode() { ::close(cacheFd); }
+
+    /// Moves size up to end, if it is not there already
+    void grow(off_t end) {
+        off_t current = size.load(std::memory_order_relaxed);
+        while (current < end && !size.compare_exchange_weak(current, end, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+struct Lab2::OpenFile {
+    /// The file behind the fd, shared with its other opens
+    std::shared_ptr<Inode> inode;
+    /// Held for the whole of read/write/readv/writev/lseek on the fd, so that each sees and moves offset at once.
+    /// Taken before inode->mutex
+    std::mutex offsetMutex;
+    off_t offset = 0;
+    /// Guards readahead against concurrent reads of the fd; advice() and moveFile() replace it under an exclusive
+    /// inode->mutex instead
+    std::mutex readaheadMutex;
+    StreamDetector readahead;
+    /// Changed under an exclusive inode->mutex, like everything below.
+    /// SEQUENTIAL advice: deprioritize blocks once they have been read to the end
+    bool dropBehind = false;
+    /// NOREUSE advice: blocks [noReuseFirst, noReuseLast] skip the reference bit
+    off_t noReuseFirst = 0;
+    off_t noReuseLast = -1;
+
+    OpenFile(std::shared_ptr<Inode> inode, size_t maxReadahead): inode(std::move(inode)), readahead(maxReadahead) {}
+
+    bool noReuse(off_t blockIndex) const { return blockIndex >= noReuseFirst && blockIndex <= noReuseLast; }
+};
+
+struct Lab2::PinnedBlocks {
+    /// One handle per block of the range, in file order
+    std::vector<BlockCache::Handle> blocks;
+    /// Set once a view holds the blocks, and counted in its Inode::views
+    std::shared_ptr<Inode> inode;
+    /// WriteView only: the file grows to end on release
+    off_t end = 0;
+
+    PinnedBlocks() = default;
+    PinnedBlocks(const PinnedBlocks &) = delete;
+    PinnedBlocks &operator=(const PinnedBlocks &) = delete;
+    ~PinnedBlocks() {
+        if (inode) {
+            inode->views.fetch_sub(1, std::memory_order_release);
+        }
+    }
+};
+
+namespace {
+
+/// Cuts [offset, offset + len) into one span per pinned block
+template <typename Char>
+void fillSpans(const std::vector<BlockCache::Handle> &blocks, off_t offset, size_t len, size_t blockSize,
+               std::vector<std::span<Char>> &spans) {
+    spans.reserve(blocks.size());
+    off_t blockStart = offset / static_cast<off_t>(blockSize) * static_cast<off_t>(blockSize);
+    const off_t end = offset + static_cast<off_t>(len);
+    for (const BlockCache::Handle &block : blocks) {
+        const off_t begin = std::max(offset, blockStart);
+        const off_t blockEnd = std::min<off_t>(end, blockStart + static_cast<off_t>(blockSize));
+        spans.emplace_back(static_cast<Char *>(block.data()) + (begin - blockStart), static_cast<size_t>(blockEnd - begin));
+        blockStart += static_cast<off_t>(blockSize);
+    }
+}
+
+/// The configuration of the short constructor; the rest stays at its defaults
+CacheConfig basicConfig(size_t cacheCapacity, size_t blockSize, const WritebackConfig &writeback) {
+    CacheConfig config;
+    config.capacity = cacheCapacity;
+    config.blockSize = blockSize;
+    config.eviction = EvictionPolicy::Kind::CLOCK;
+    config.writeback = writeback;
+    return config;
+}
+
+int64_t mtimeNs(const struct stat &st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+}
+
+/// Upper bounds of the histogram buckets in metrics(): 1 us up to about 4 s, each 4 times the last
+constexpr uint64_t METRIC_FIRST_BOUND_NS = 1000;
+constexpr int METRIC_BUCKETS = 12;
+
+void writeMetric(std::ostream &out, const char *name, const char *type, const char *help, uint64_t value) {
+    out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n'
+        << name << ' ' << value << '\n';
+}
+
+void writeHistogram(std::ostream &out, const char *name, const char *help, const LatencyHistogram &histogram) {
+    out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " histogram\n";
+    uint64_t bound = METRIC_FIRST_BOUND_NS;
+    for (int i = 0; i < METRIC_BUCKETS; ++i, bound *= 4) {
+        out << name << "_bucket{le=\"" << static_cast<double>(bound) / 1e9 << "\"} " << histogram.countAtMost(bound) << '\n';
+    }
+    out << name << "_bucket{le=\"+Inf\"} " << histogram.count << '\n'
+        << name << "_sum " << static_cast<double>(histogram.sumNs) / 1e9 << '\n'
+        << name << "_count " << histogram.count << '\n';
+}
+
+} // namespace
+
+struct Lab2::SizeClass {
     BlockCache cache_;
+    // Declared after cache_ so that they stop before the cache goes away
+    Prefetcher prefetcher_;
+    std::unique_ptr<WritebackFlusher> flusher_; // Null if disabled
+
+    SizeClass(const CacheConfig &config, size_t capacity, size_t blockSize, size_t tierBytes)
+        : cache_(capacity, blockSize, BlockCache::DEFAULT_SHARD_COUNT,
+                 BlockPool::PageMode::TRANSPARENT_HUGE, IoBackend::Kind::AUTO, config.eviction)
+        , prefetcher_(cache_) {
+        cache_.setCompressedTier(tierBytes);
+        cache_.setSparseFiles(config.sparseFiles);
+        const WritebackConfig &writeback = config.writeback;
+        if (writeback.enabled) {
+            flusher_ = std::make_unique<WritebackFlusher>(cache_, writeback.dirtyRatio,
+                                                          std::chrono::milliseconds(writeback.maxDirtyAgeMs),
+                                                          std::chrono::milliseconds(writeback.intervalMs));
+        }
+    }
 
-    BlockCacheWrapper(size_t cacheCapacity, size_t blockSize): cache_(cacheCapacity, blockSize) {}
+    /// Readahead never claims more than a quarter of the cache for one stream
+    size_t maxReadahead() const { return std::max<size_t>(cache_.capacity() / 4, 1); }
 };
 
-Lab2::Lab2(size_t cacheCapacity, size_t blockSize):
-    fileOffsets_(),
-    cacheWrapper_(std::make_unique<BlockCacheWrapper>(cacheCapacity, blockSize)) {
-    // Any additional initialization
+struct  Lab2::BlockCacheWrapper {
+    std::unique_ptr<SizeClass> large_;
+    std::unique_ptr<SizeClass> small_; // Null unless CacheConfig::smallBlocks is set
+    off_t smallFileLimit_ = 0;
+
+    explicit BlockCacheWrapper(const CacheConfig &config) {
+        const size_t budget = config.capacityBytes != 0 ? config.capacityBytes : config.capacity * config.blockSize;
+        size_t largeBytes = budget;
+        size_t largeTierBytes = config.compressedTierBytes;
+        const SmallBlockConfig &small = config.smallBlocks;
+        if (small.blockSize != 0 && small.blockSize < config.blockSize) {
+            // Each side gets at least one block, so that neither runs dry; the tier splits the same way
+            const double share = std::clamp(small.share, 0.0, 1.0);
+            const auto smallBytes = static_cast<size_t>(share * static_cast<double>(budget));
+            const auto smallTierBytes = static_cast<size_t>(share * static_cast<double>(config.compressedTierBytes));
+            small_ = std::make_unique<SizeClass>(config, std::max<size_t>(smallBytes / small.blockSize, 1), small.blockSize,
+                                                 smallTierBytes);
+            smallFileLimit_ = small.fileSizeLimit != 0 ? small.fileSizeLimit : static_cast<off_t>(config.blockSize);
+            largeBytes = budget - std::min(budget, smallBytes);
+            largeTierBytes -= std::min(largeTierBytes, smallTierBytes);
+        }
+        const size_t largeCapacity = largeBytes / config.blockSize;
+        large_ = std::make_unique<SizeClass>(config, small_ ? std::max<size_t>(largeCapacity, 1) : largeCapacity,
+                                             config.blockSize, largeTierBytes);
+    }
+
+    SizeClass &forNewFile(off_t size) { return small_ && size < smallFileLimit_ ? *small_ : *large_; }
+
+    template <typename F>
+    void forEach(F f) const {
+        f(*large_);
+        if (small_) {
+            f(*small_);
+        }
+    }
+};
+
+struct Lab2::WarmUp {
+    /// Guards thread
+    std::mutex mutex;
+    std::thread thread;
+    /// Set by the destructor: the thread stops after the file it is loading
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> skippedFiles{0};
+    std::atomic<uint64_t> blocks{0};
+};
+
+Lab2::Lab2(size_t cacheCapacity, size_t blockSize, const WritebackConfig &writeback):
+    Lab2(basicConfig(cacheCapacity, blockSize, writeback)) {
 }
 
-Lab2::~Lab2() = default; // Defined in the .cpp file
+Lab2::Lab2(const CacheConfig &config):
+    openFiles_(),
+    maxIdleFiles_(config.maxIdleFiles),
+    cacheWrapper_(std::make_unique<BlockCacheWrapper>(config)),
+    groupCommit_(config.groupCommit),
+    warmUp_(std::make_unique<WarmUp>()),
+    manifestPath_(config.manifestPath) {
+    if (!config.tracePath.empty()) {
+        trace_ = std::make_unique<TraceWriter>(config.tracePath);
+    }
+    if (!manifestPath_.empty() && loadManifest(manifestPath_) != 0 && errno != ENOENT) {
+        LAB2_LOG_WARN("Cannot load manifest {}: {}", manifestPath_, std::strerror(errno));
+    }
+}
+
+Lab2::~Lab2() {
+    warmUp_->stopping.store(true, std::memory_order_relaxed);
+    waitForWarmUp();
+    if (!manifestPath_.empty()) {
+        saveManifest(manifestPath_);
+    }
+}
+
+std::shared_ptr<Lab2::OpenFile> Lab2::findFile(fd_t fd) const {
+    std::shared_lock<std::shared_mutex> lock(openFilesMutex_);
+    auto it = openFiles_.find(fd);
+    if (it == openFiles_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
 
 fd_t Lab2::open(const std::string &filename) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::OPEN, -1);
+    trace.setPath(filename);
     // Open with O_DIRECT to bypass page cache
     // (the file must be aligned for reads/writes).
     // Using O_RDWR for both read & write in this example:
@@ -33,64 +291,249 @@ fd_t Lab2::open(const std::string &filename) {
     int realFd = ::open(filename.c_str(), O_RDWR | O_DIRECT | O_CREAT, ACCESS_RIGHTS);
     if (realFd < 0) {
         // In production code, handle errors properly (set errno, throw, etc.)
-        std::cerr << "Failed to open file: " << filename << "\n";
-        return -1;
+        LAB2_LOG_WARN("Failed to open file: {}", filename);
+        return trace.done(-1);
     }
 
+    struct stat st {};
+    if (::fstat(realFd, &st) < 0) {
+        LAB2_LOG_WARN("Failed to stat file: {}", filename);
+        ::close(realFd);
+        return trace.done(-1);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(openFilesMutex_);
+    std::shared_ptr<Inode> &inode = inodes_[{st.st_dev, st.st_ino}];
+    if (!inode) {
+        // The cache needs an fd of its own: this one goes away on close()
+        const fd_t cacheFd = ::dup(realFd);
+        if (cacheFd < 0) {
+            LAB2_LOG_WARN("Failed to dup fd of file: {}", filename);
+            inodes_.erase({st.st_dev, st.st_ino});
+            ::close(realFd);
+            return trace.done(-1);
+        }
+        inode = std::make_shared<Inode>(filename, st, cacheFd, cacheWrapper_->forNewFile(st.st_size));
+    } else if (inode->openCount == 0) {
+        // Back from the idle list. Its blocks are clean; if the file changed
+        // while nobody had it open here, they may also be stale.
+        idleInodes_.remove(inode);
+        std::lock_guard<std::shared_mutex> inodeLock(inode->mutex);
+        if (st.st_size != inode->closedSize || st.st_mtim.tv_sec != inode->closedMtime.tv_sec
+            || st.st_mtim.tv_nsec != inode->closedMtime.tv_nsec) {
+            if (!inode->sizeClass->cache_.flushFd(inode->cacheFd)) {
+                // Left over from a failed close; the file changed since anyway
+                LAB2_LOG_ERROR("Writes to {} were lost when it changed on disk.", filename);
+                inode->sizeClass->cache_.discardFd(inode->cacheFd);
+            }
+            inode->size = st.st_size;
+        }
+    }
+    ++inode->openCount;
     // Initialize the file offset to 0
-    fileOffsets_[realFd] = 0;
-    return realFd; // Return the same as "fake fd" for simplicity
+    auto file = std::make_shared<OpenFile>(inode, inode->sizeClass->maxReadahead());
+    {
+        std::lock_guard<std::shared_mutex> inodeLock(inode->mutex);
+        inode->opens.push_back(file.get());
+    }
+    openFiles_[realFd] = std::move(file);
+    return trace.done(realFd); // Return the same as "fake fd" for simplicity
 }
 
 int Lab2::close(fd_t fd) {
-    auto it = fileOffsets_.find(fd);
-    if (it == fileOffsets_.end()) {
-        // No such FD
-        errno = EBADF;
-        return -1;
+    TraceScope trace(trace_.get(), TraceEvent::Op::CLOSE, fd);
+    std::shared_ptr<OpenFile> file;
+    {
+        std::unique_lock<std::shared_mutex> lock(openFilesMutex_);
+        auto it = openFiles_.find(fd);
+        if (it == openFiles_.end()) {
+            // No such FD
+            errno = EBADF;
+            return trace.done(-1);
+        }
+        file = it->second;
+        openFiles_.erase(it);
+    }
+
+    // Wait for a read/write still running on the file, then write back and
+    // flush what it left dirty. The blocks stay cached for the next open.
+    Inode &inode = *file->inode;
+    int error = 0;
+    {
+        std::lock_guard<std::shared_mutex> inodeLock(inode.mutex);
+        std::erase(inode.opens, file.get());
+        if (writeBackFile(inode, 0, 0) < 0 || flushFile(inode, SyncLevel::FULL) < 0) {
+            error = errno;
+        }
+    }
+
+    std::shared_ptr<Inode> retired;
+    {
+        std::unique_lock<std::shared_mutex> lock(openFilesMutex_);
+        if (--inode.openCount == 0) {
+            std::lock_guard<std::shared_mutex> inodeLock(inode.mutex);
+            inode.sizeClass->prefetcher_.cancel(inode.cacheFd);
+            struct stat st {};
+            if (::fstat(inode.cacheFd, &st) == 0) {
+                inode.closedMtime = st.st_mtim;
+                inode.closedSize = st.st_size;
+            }
+            retired = parkIdle(file->inode);
+        }
+    }
+    if (retired) {
+        dropIdle(*retired);
+    }
+
+    // The fd goes either way; the first error is the one reported
+    if (::close(fd) < 0 && error == 0) {
+        error = errno;
     }
+    if (error != 0) {
+        errno = error;
+        return trace.done(-1);
+    }
+    return trace.done(0);
+}
 
-    // Make sure to flush blocks belonging to this fd
-    fsync(fd);
+std::shared_ptr<Lab2::Inode> Lab2::parkIdle(std::shared_ptr<Inode> inode) {
+    idleInodes_.push_back(std::move(inode));
+    if (idleInodes_.size() <= maxIdleFiles_) {
+        return nullptr;
+    }
+    std::shared_ptr<Inode> retired = std::move(idleInodes_.front());
+    idleInodes_.pop_front();
+    inodes_.erase({retired->dev, retired->ino});
+    return retired;
+}
 
-    fileOffsets_.erase(it);
-    return ::close(fd);
+void Lab2::dropIdle(Inode &retired) {
+    // Drop its blocks while its cacheFd still keeps the number from being reused
+    std::lock_guard<std::shared_mutex> inodeLock(retired.mutex);
+    retired.sizeClass->prefetcher_.cancel(retired.cacheFd);
+    if (!retired.sizeClass->cache_.flushFd(retired.cacheFd)) {
+        // Nobody has the file open to see an error; the blocks cannot outlive the fd
+        LAB2_LOG_ERROR("Writes to {} were lost when its blocks were dropped.", retired.path);
+        retired.sizeClass->cache_.discardFd(retired.cacheFd);
+    }
 }
 
 ssize_t Lab2::read(fd_t fd, void *buf, size_t count) {
-    auto it = fileOffsets_.find(fd);
-    if (it == fileOffsets_.end()) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::READ, fd, 0, count);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+
+    std::lock_guard<std::mutex> offsetLock(file->offsetMutex);
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return trace.done(readAt(file->inode->cacheFd, *file, file->offset, buf, count));
+}
+
+ssize_t Lab2::pread(fd_t fd, void *buf, size_t count, off_t offset) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::PREAD, fd, offset, count);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return trace.done(-1);
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return trace.done(readAt(file->inode->cacheFd, *file, offset, buf, count));
+}
+
+ssize_t Lab2::readv(fd_t fd, const iovec *iov, int iovcnt) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
         errno = EBADF;
         return -1;
     }
 
-    off_t &offset = it->second;
+    std::lock_guard<std::mutex> offsetLock(file->offsetMutex);
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return transferv(file->inode->cacheFd, *file, file->offset, iov, iovcnt, /* write = */ false);
+}
+
+ssize_t Lab2::preadv(fd_t fd, const iovec *iov, int iovcnt, off_t offset) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return transferv(file->inode->cacheFd, *file, offset, iov, iovcnt, /* write = */ false);
+}
+
+ssize_t Lab2::readAt(fd_t fd, OpenFile &file, off_t &offset, void *buf, size_t count) {
     size_t bytesRead = 0;
     char *outPtr = static_cast<char *>(buf);
 
+    // Short read at the end of the file
+    const off_t size = file.inode->size.load(std::memory_order_relaxed);
+    count = offset < size ? std::min<size_t>(count, size - offset) : 0;
+
+    if (count > 0) {
+        // Load the missing blocks of a multi-block read as one batch instead
+        // of one transfer per iteration below; leave room for other readers
+        BlockCache &cache = file.inode->sizeClass->cache_;
+        off_t firstBlock = offset / cache.blockSize();
+        off_t lastBlock = (offset + count - 1) / cache.blockSize();
+        if (lastBlock > firstBlock) {
+            size_t blocks = std::min<size_t>(lastBlock - firstBlock + 1, std::max<size_t>(cache.capacity() / 2, 1));
+            cache.preload(fd, firstBlock, blocks);
+        }
+    }
+
+    BlockCache &cache = file.inode->sizeClass->cache_;
     while (bytesRead < count) {
         // Calculate which block we need to read
-        off_t blockIndex = offset / cacheWrapper_->cache_.blockSize();
-        size_t offsetInBlock = offset % cacheWrapper_->cache_.blockSize();
+        off_t blockIndex = offset / cache.blockSize();
+        size_t offsetInBlock = offset % cache.blockSize();
 
         // Amount we can read from this block
-        size_t canRead = cacheWrapper_->cache_.blockSize() - offsetInBlock;
+        size_t canRead = cache.blockSize() - offsetInBlock;
         size_t left = count - bytesRead;
         size_t toReadNow = std::min(left, canRead);
 
-        // Fetch data from the cache (or handle sparse gaps)
-        if (!cacheWrapper_->cache_.readBlock(fd, blockIndex)) {
-            // Treat this block as a zero-filled gap
-            std::memset(outPtr + bytesRead, 0, toReadNow);
-        } else {
-            // Copy from cache to user buffer
-            const char *blockData = static_cast<const char *>(cacheWrapper_->cache_.blockData(fd, blockIndex));
-            if (!blockData) {
-                // Something is wrong, e.g., block not found
+        // Fetch data from the cache; holes come back as blocks of zeros
+        BlockCache::Handle block = cache.acquire(fd, blockIndex, file.noReuse(blockIndex));
+        if (!block) {
+            // A read or memory error: what was read so far, or -1 with errno set by acquire()
+            if (bytesRead == 0) {
                 return -1;
             }
+            break;
+        }
+
+        // Feed the stream detector so the next blocks are loaded while we copy
+        StreamDetector::Range ahead;
+        {
+            std::lock_guard<std::mutex> readaheadLock(file.readaheadMutex);
+            if (block.lookup() == BlockCache::Lookup::MISS && file.readahead.expected(blockIndex)) {
+                cache.readaheadCounters().misses.fetch_add(1, std::memory_order_relaxed);
+            }
+            ahead = file.readahead.onAccess(blockIndex, block.lookup());
+        }
+        file.inode->sizeClass->prefetcher_.submit(fd, ahead);
+
+        // Copy from cache to user buffer; the handle keeps the block pinned
+        const char *blockData = static_cast<const char *>(block.data());
+        std::memcpy(outPtr + bytesRead, blockData + offsetInBlock, toReadNow);
 
-            std::memcpy(outPtr + bytesRead, blockData + offsetInBlock, toReadNow);
+        if (file.dropBehind && offsetInBlock + toReadNow == cache.blockSize()) {
+            // A sequential reader will not come back to this block
+            block.release();
+            cache.deprioritize(fd, blockIndex);
         }
 
         // Update counters
@@ -103,100 +546,972 @@ ssize_t Lab2::read(fd_t fd, void *buf, size_t count) {
 
 
 ssize_t Lab2::write(fd_t fd, const void *buf, size_t count) {
-    auto it = fileOffsets_.find(fd);
-    if (it == fileOffsets_.end()) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::WRITE, fd, 0, count);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+
+    std::lock_guard<std::mutex> offsetLock(file->offsetMutex);
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return trace.done(writeAt(file->inode->cacheFd, *file, file->offset, buf, count));
+}
+
+ssize_t Lab2::pwrite(fd_t fd, const void *buf, size_t count, off_t offset) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::PWRITE, fd, offset, count);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return trace.done(-1);
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return trace.done(writeAt(file->inode->cacheFd, *file, offset, buf, count));
+}
+
+ssize_t Lab2::writev(fd_t fd, const iovec *iov, int iovcnt) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
         errno = EBADF;
         return -1;
     }
 
-    off_t &offset = it->second;
+    std::lock_guard<std::mutex> offsetLock(file->offsetMutex);
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return transferv(file->inode->cacheFd, *file, file->offset, iov, iovcnt, /* write = */ true);
+}
+
+ssize_t Lab2::pwritev(fd_t fd, const iovec *iov, int iovcnt, off_t offset) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return -1;
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    return transferv(file->inode->cacheFd, *file, offset, iov, iovcnt, /* write = */ true);
+}
+
+ssize_t Lab2::transferv(fd_t fd, OpenFile &file, off_t &offset, const iovec *iov, int iovcnt, bool write) {
+    if (iovcnt < 0 || iovcnt > IOV_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        ssize_t done = write ? writeAt(fd, file, offset, iov[i].iov_base, iov[i].iov_len)
+                             : readAt(fd, file, offset, iov[i].iov_base, iov[i].iov_len);
+        if (done < 0) {
+            return total > 0 ? total : -1;
+        }
+        // A short count includes what got done before an error, which offset has moved past
+        total += done;
+        if (static_cast<size_t>(done) < iov[i].iov_len) {
+            break; // End of file, or an error part of the way
+        }
+    }
+    return total;
+}
+
+ssize_t Lab2::writeAt(fd_t fd, OpenFile &file, off_t &offset, const void *buf, size_t count) {
     size_t bytesWritten = 0;
     const char *inPtr = static_cast<const char *>(buf);
 
+    BlockCache &cache = file.inode->sizeClass->cache_;
     while (bytesWritten < count) {
-        off_t blockIndex = offset / cacheWrapper_->cache_.blockSize();
-        size_t offsetInBlock = offset % cacheWrapper_->cache_.blockSize();
+        off_t blockIndex = offset / cache.blockSize();
+        size_t offsetInBlock = offset % cache.blockSize();
 
-        size_t canWrite = cacheWrapper_->cache_.blockSize() - offsetInBlock;
+        size_t canWrite = cache.blockSize() - offsetInBlock;
         size_t left = count - bytesWritten;
         size_t toWriteNow = (left < canWrite) ? left : canWrite;
 
-        // Fetch the block in case we need partial update, or we do read-modify-write
-        if (!cacheWrapper_->cache_.readBlock(fd, blockIndex)) {
-            // Could not load block
-            return -1;
+        if (toWriteNow == cache.blockSize()) {
+            // The whole block is replaced, so there is nothing to read first
+            if (!cache.overwrite(fd, blockIndex, inPtr + bytesWritten, file.noReuse(blockIndex))) {
+                break;
+            }
+            bytesWritten += toWriteNow;
+            offset += toWriteNow;
+            file.inode->grow(offset);
+            continue;
         }
-        // Mark block as "dirty" after we copy data in
-        char *blockData = static_cast<char *>(cacheWrapper_->cache_.blockData(fd, blockIndex));
-        if (!blockData) {
-            // Something is wrong
-            return -1;
+
+        // Partial update: read-modify-write
+        BlockCache::Handle block = cache.acquire(fd, blockIndex, file.noReuse(blockIndex));
+        if (!block) {
+            break; // Could not load the block
         }
 
         // Copy user data to cache
+        char *blockData = static_cast<char *>(block.data());
         std::memcpy(blockData + offsetInBlock,
                     inPtr + bytesWritten,
                     toWriteNow);
 
-        cacheWrapper_->cache_.markDirty(fd, blockIndex); // Mark as dirty in the cache
+        // Mark as dirty after we copy data in; only these sectors are written back
+        block.markDirty(offsetInBlock, toWriteNow);
 
         bytesWritten += toWriteNow;
         offset += toWriteNow;
+        file.inode->grow(offset);
     }
 
+    // Like readAt(): the offset and size cover what was written, so report that much
+    if (bytesWritten == 0 && count > 0) {
+        return -1; // errno set by overwrite() or acquire()
+    }
     return bytesWritten;
 }
 
+size_t Lab2::readBatch(ReadRequest *requests, size_t count) {
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [requests](size_t a, size_t b) {
+        return requests[a].fd != requests[b].fd ? requests[a].fd < requests[b].fd
+                                                : requests[a].offset < requests[b].offset;
+    });
+
+    size_t succeeded = 0;
+    for (size_t begin = 0; begin < count;) {
+        size_t end = begin;
+        while (end < count && requests[order[end]].fd == requests[order[begin]].fd) {
+            ++end;
+        }
+        succeeded += readBatchFile(requests[order[begin]].fd, requests, &order[begin], end - begin);
+        begin = end;
+    }
+    return succeeded;
+}
+
+size_t Lab2::readBatchFile(fd_t userFd, ReadRequest *requests, const size_t *order, size_t count) {
+    std::shared_ptr<OpenFile> file = findFile(userFd);
+    if (!file) {
+        for (size_t i = 0; i < count; ++i) {
+            requests[order[i]].result = -EBADF;
+        }
+        return 0;
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    const fd_t fd = file->inode->cacheFd;
+    BlockCache &cache = file->inode->sizeClass->cache_;
+    const off_t blockSize = static_cast<off_t>(cache.blockSize());
+    // Pinned at once, like a view: leave the other half to everybody else
+    const size_t maxBlocks = std::max<size_t>(cache.capacity() / 2, 1);
+
+    // Blocks of the current chunk, sorted and unique, and their handles
+    std::vector<off_t> blocks;
+    std::vector<BlockCache::Handle> handles;
+    std::vector<int> errors;
+    size_t succeeded = 0;
+
+    // Loads and pins the chunk's blocks, then copies out requests [from, to)
+    auto serve = [&](size_t from, size_t to) {
+        cache.preload(fd, blocks);
+        for (off_t blockIndex : blocks) {
+            handles.push_back(cache.acquire(fd, blockIndex, file->noReuse(blockIndex)));
+            errors.push_back(errno);
+        }
+        for (size_t i = from; i < to; ++i) {
+            ReadRequest &request = requests[order[i]];
+            if (request.result <= 0) {
+                continue; // Failed validation, or nothing to read
+            }
+            const size_t length = static_cast<size_t>(request.result);
+            size_t copied = 0;
+            while (copied < length) {
+                const off_t position = request.offset + static_cast<off_t>(copied);
+                const auto slot = static_cast<size_t>(std::lower_bound(blocks.begin(), blocks.end(), position / blockSize) - blocks.begin());
+                if (!handles[slot]) {
+                    request.result = -errors[slot];
+                    break;
+                }
+                const size_t offsetInBlock = static_cast<size_t>(position % blockSize);
+                const size_t toCopy = std::min(length - copied, static_cast<size_t>(blockSize) - offsetInBlock);
+                std::memcpy(static_cast<char *>(request.buffer) + copied,
+                            static_cast<const char *>(handles[slot].data()) + offsetInBlock, toCopy);
+                copied += toCopy;
+            }
+            if (request.result >= 0) {
+                ++succeeded;
+            }
+        }
+        blocks.clear();
+        handles.clear();
+        errors.clear();
+    };
+
+    size_t chunkStart = 0;
+    for (size_t i = 0; i < count; ++i) {
+        ReadRequest &request = requests[order[i]];
+        if (request.offset < 0) {
+            request.result = -EINVAL;
+            continue;
+        }
+        // Short read at the end of the file; result holds the length until served
+        const size_t length = request.offset < file->inode->size
+                              ? std::min<size_t>(request.length, file->inode->size - request.offset) : 0;
+        request.result = static_cast<ssize_t>(length);
+        if (length == 0) {
+            ++succeeded;
+            continue;
+        }
+
+        const off_t firstBlock = request.offset / blockSize;
+        const off_t lastBlock = (request.offset + static_cast<off_t>(length) - 1) / blockSize;
+        if (static_cast<size_t>(lastBlock - firstBlock) + 1 > maxBlocks) {
+            // Too long to pin at once; read() copes with any length
+            serve(chunkStart, i);
+            chunkStart = i + 1;
+            off_t offset = request.offset;
+            request.result = readAt(file->inode->cacheFd, *file, offset, request.buffer, length);
+            if (request.result < 0) {
+                request.result = -errno;
+            } else {
+                ++succeeded;
+            }
+            continue;
+        }
+
+        // Requests come in offset order, so only blocks past the last one are new
+        const off_t firstNew = blocks.empty() ? firstBlock : std::max(firstBlock, blocks.back() + 1);
+        const size_t newBlocks = lastBlock >= firstNew ? static_cast<size_t>(lastBlock - firstNew) + 1 : 0;
+        if (blocks.size() + newBlocks > maxBlocks) {
+            serve(chunkStart, i);
+            chunkStart = i;
+        }
+        for (off_t blockIndex = blocks.empty() ? firstBlock : std::max(firstBlock, blocks.back() + 1);
+             blockIndex <= lastBlock; ++blockIndex) {
+            blocks.push_back(blockIndex);
+        }
+    }
+    serve(chunkStart, count);
+    return succeeded;
+}
+
 off_t Lab2::lseek(fd_t fd, off_t offset, int whence) {
-    auto it = fileOffsets_.find(fd);
-    if (it == fileOffsets_.end()) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::LSEEK, fd, offset, static_cast<uint64_t>(whence));
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
         errno = EBADF;
-        return static_cast<off_t>(-1);
+        return trace.done(static_cast<off_t>(-1));
     }
 
+    std::lock_guard<std::mutex> offsetLock(file->offsetMutex);
+
     off_t newOffset = 0;
 
     if (whence == SEEK_SET) {
         newOffset = offset;
     } else if (whence == SEEK_CUR) {
-        newOffset = it->second + offset;
+        newOffset = file->offset + offset;
     } else if (whence == SEEK_END) {
-        // We need to know the file's actual size
-        // Temporarily get the OS's idea of file size
-        off_t fileSize = ::lseek(fd, 0, SEEK_END);
-        if (fileSize == static_cast<off_t>(-1)) {
-            // Error
-            return static_cast<off_t>(-1);
-        }
-        newOffset = fileSize + offset;
+        // The disk does not know about writes still in the cache
+        newOffset = file->inode->size.load(std::memory_order_relaxed) + offset;
     } else {
         errno = EINVAL;
-        return static_cast<off_t>(-1);
+        return trace.done(static_cast<off_t>(-1));
     }
 
     if (newOffset < 0) {
         errno = EINVAL;
-        return static_cast<off_t>(-1);
+        return trace.done(static_cast<off_t>(-1));
     }
 
-    it->second = newOffset;
-    return newOffset;
+    file->offset = newOffset;
+    return trace.done(newOffset);
 }
 
 int Lab2::fsync(fd_t fd) {
-    // 1) Flush dirty blocks for this fd in the cache
-    cacheWrapper_->cache_.flushFd(fd);
+    TraceScope trace(trace_.get(), TraceEvent::Op::FSYNC, fd);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+    return trace.done(syncFile(*file->inode, 0, 0, SyncLevel::FULL));
+}
 
-    // 2) Then call the OS fsync
-    if (::fsync(fd) < 0) {
+int Lab2::fdatasync(fd_t fd) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::FDATASYNC, fd);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+    return trace.done(syncFile(*file->inode, 0, 0, SyncLevel::DATA));
+}
+
+int Lab2::syncRange(fd_t fd, off_t offset, off_t nbytes, unsigned flags) {
+    TraceScope trace(trace_.get(), TraceEvent::Op::SYNC_RANGE, fd, offset, static_cast<uint64_t>(nbytes));
+    trace.setFlags(flags);
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return trace.done(-1);
+    }
+    if (offset < 0 || nbytes < 0 || (flags & LAB2_SYNC_RANGE_WRITE) == 0
+        || (flags & ~(LAB2_SYNC_RANGE_WRITE | LAB2_SYNC_RANGE_DATASYNC)) != 0) {
+        errno = EINVAL;
+        return trace.done(-1);
+    }
+    const SyncLevel level = (flags & LAB2_SYNC_RANGE_DATASYNC) != 0 ? SyncLevel::DATA : SyncLevel::WRITE;
+    return trace.done(syncFile(*file->inode, offset, nbytes, level));
+}
+
+int Lab2::syncFile(Inode &inode, off_t offset, off_t nbytes, SyncLevel level) {
+    {
+        std::lock_guard<std::shared_mutex> fileLock(inode.mutex);
+        if (writeBackFile(inode, offset, nbytes) < 0) {
+            return -1;
+        }
+    }
+    // The device flush covers what was written above whoever runs it
+    return level == SyncLevel::WRITE ? 0 : flushFile(inode, level);
+}
+
+int Lab2::writeBackFile(Inode &inode, off_t offset, off_t nbytes) {
+    const fd_t fd = inode.cacheFd;
+    // 1) Write back the dirty blocks of the range; the cache keeps them, clean
+    const auto blockSize = static_cast<off_t>(inode.sizeClass->cache_.blockSize());
+    const off_t firstBlock = offset / blockSize;
+    const off_t lastBlock = nbytes == 0 || nbytes > std::numeric_limits<off_t>::max() - offset
+                                ? std::numeric_limits<off_t>::max()
+                                : (offset + nbytes - 1) / blockSize;
+    if (!inode.sizeClass->cache_.syncRange(fd, firstBlock, lastBlock)) {
+        return -1;
+    }
+
+    // 2) Write-back goes in aligned units, so the last one may have padded
+    //    the file past its logical size; cut that off
+    struct stat st {};
+    if (::fstat(fd, &st) < 0) {
+        return -1;
+    }
+    const off_t size = inode.size.load(std::memory_order_relaxed);
+    if (st.st_size != size && ::ftruncate(fd, size) < 0) {
         return -1;
     }
     return 0;
 }
 
+int Lab2::flushFile(Inode &inode, SyncLevel level) {
+    const fd_t fd = inode.cacheFd;
+    auto flush = [fd, level] { return level == SyncLevel::DATA ? ::fdatasync(fd) : ::fsync(fd); };
+    if (!groupCommit_) {
+        return flush();
+    }
+    return (level == SyncLevel::DATA ? inode.fdatasyncs : inode.fsyncs).sync(flush);
+}
+
+ReadaheadStats Lab2::readaheadStats() const {
+    ReadaheadStats stats;
+    cacheWrapper_->forEach([&stats](SizeClass &sizeClass) {
+        BlockCache::ReadaheadCounters &counters = sizeClass.cache_.readaheadCounters();
+        stats.issued += counters.issued.load(std::memory_order_relaxed);
+        stats.hits += counters.hits.load(std::memory_order_relaxed);
+        stats.misses += counters.misses.load(std::memory_order_relaxed);
+        stats.wasted += counters.wasted.load(std::memory_order_relaxed);
+    });
+    return stats;
+}
+
+WritebackStats Lab2::writebackStats() const {
+    WritebackStats stats;
+    cacheWrapper_->forEach([&stats](SizeClass &sizeClass) {
+        BlockCache::WritebackCounters &counters = sizeClass.cache_.writebackCounters();
+        stats.dirty += sizeClass.cache_.dirtyCount();
+        stats.blocks += counters.blocks.load(std::memory_order_relaxed);
+        stats.writes += counters.writes.load(std::memory_order_relaxed);
+    });
+    return stats;
+}
+
+CacheStats Lab2::stats() const {
+    CacheStats stats;
+    cacheWrapper_->forEach([&stats](SizeClass &sizeClass) { stats += sizeClass.cache_.stats(); });
+    return stats;
+}
+
+std::string Lab2::metrics() const {
+    const CacheStats cache = stats();
+    const ReadaheadStats readahead = readaheadStats();
+    const WritebackStats writeback = writebackStats();
+    std::ostringstream out;
+    out.precision(10); // Bucket bounds are whole nanoseconds
+    out << "# HELP lab2_cache_capacity_blocks Blocks the cache holds, by block size.\n"
+           "# TYPE lab2_cache_capacity_blocks gauge\n";
+    cacheWrapper_->forEach([&out](SizeClass &sizeClass) {
+        out << "lab2_cache_capacity_blocks{block_bytes=\"" << sizeClass.cache_.blockSize() << "\"} "
+            << sizeClass.cache_.capacity() << '\n';
+    });
+    writeMetric(out, "lab2_cache_dirty_blocks", "gauge", "Blocks modified and not yet written back.", writeback.dirty);
+    writeMetric(out, "lab2_cache_hits_total", "counter", "Block lookups served from the cache.", cache.hits);
+    writeMetric(out, "lab2_cache_misses_total", "counter", "Block lookups that had to load the block.", cache.misses);
+    writeMetric(out, "lab2_cache_evictions_total", "counter", "Blocks evicted to make room for others.", cache.evictions);
+    writeMetric(out, "lab2_cache_writebacks_total", "counter", "Dirty blocks written back to disk.", cache.writebacks);
+    writeMetric(out, "lab2_cache_second_chances_total", "counter", "Referenced blocks the eviction policy passed over.",
+                cache.secondChances);
+    writeMetric(out, "lab2_tier_hits_total", "counter", "Misses served by the compressed tier.", cache.tierHits);
+    writeMetric(out, "lab2_tier_misses_total", "counter", "Misses the compressed tier could not serve.", cache.tierMisses);
+    writeMetric(out, "lab2_tier_stored_total", "counter", "Evicted blocks kept compressed.", cache.tierStored);
+    writeMetric(out, "lab2_tier_rejected_total", "counter", "Evicted blocks that compressed too poorly to keep.",
+                cache.tierRejected);
+    writeMetric(out, "lab2_tier_raw_bytes_total", "counter", "Size of the blocks kept compressed.", cache.tierRawBytes);
+    writeMetric(out, "lab2_tier_compressed_bytes_total", "counter", "Compressed size of the blocks kept.",
+                cache.tierCompressedBytes);
+    writeMetric(out, "lab2_disk_read_bytes_total", "counter", "Bytes read from disk.", cache.bytesRead);
+    writeMetric(out, "lab2_disk_written_bytes_total", "counter", "Bytes written to disk.", cache.bytesWritten);
+    writeMetric(out, "lab2_disk_punched_bytes_total", "counter", "Zero bytes punched out of files instead of written.",
+                cache.bytesPunched);
+    writeMetric(out, "lab2_hole_loads_total", "counter", "Blocks in holes zero-filled without a read.", cache.holeLoads);
+    writeMetric(out, "lab2_readahead_issued_total", "counter", "Blocks loaded ahead of the reader.", readahead.issued);
+    writeMetric(out, "lab2_readahead_hits_total", "counter", "Reads served by a prefetched block.", readahead.hits);
+    writeMetric(out, "lab2_readahead_misses_total", "counter", "Sequential reads that still had to go to disk.",
+                readahead.misses);
+    writeMetric(out, "lab2_readahead_wasted_total", "counter", "Prefetched blocks dropped without being read.",
+                readahead.wasted);
+    writeMetric(out, "lab2_flusher_blocks_total", "counter", "Blocks the background flusher wrote back.", writeback.blocks);
+    writeMetric(out, "lab2_flusher_writes_total", "counter", "Write calls the background flusher made.", writeback.writes);
+    const WarmUpStats warmUp = warmUpStats();
+    writeMetric(out, "lab2_warmup_files_total", "counter", "Files a manifest load warmed up.", warmUp.files);
+    writeMetric(out, "lab2_warmup_skipped_files_total", "counter", "Files a manifest load left out, mostly as changed.",
+                warmUp.skippedFiles);
+    writeMetric(out, "lab2_warmup_blocks_total", "counter", "Blocks a manifest load read in.", warmUp.blocks);
+    writeHistogram(out, "lab2_disk_read_seconds", "Time spent waiting for block reads.", cache.diskReads);
+    writeHistogram(out, "lab2_disk_write_seconds", "Time spent waiting for write-back.", cache.diskWrites);
+    return out.str();
+}
+
+int Lab2::saveManifest(const std::string &path) {
+    std::vector<std::shared_ptr<Inode>> inodes;
+    {
+        std::shared_lock<std::shared_mutex> lock(openFilesMutex_);
+        for (const auto &[key, inode] : inodes_) {
+            inodes.push_back(inode);
+        }
+    }
+
+    std::vector<ManifestFile> files;
+    std::unordered_map<fd_t, size_t> fileOfFd;
+    for (const std::shared_ptr<Inode> &inode : inodes) {
+        std::lock_guard<std::shared_mutex> inodeLock(inode->mutex);
+        struct stat st {};
+        if (writeBackFile(*inode, 0, 0) != 0 || ::fstat(inode->cacheFd, &st) < 0) {
+            continue; // What is cached may not match the file on disk
+        }
+        ManifestFile file;
+        file.path = inode->path;
+        file.dev = static_cast<uint64_t>(st.st_dev);
+        file.ino = static_cast<uint64_t>(st.st_ino);
+        file.size = st.st_size;
+        file.mtimeNs = mtimeNs(st);
+        file.blockSize = inode->sizeClass->cache_.blockSize();
+        fileOfFd[inode->cacheFd] = files.size();
+        files.push_back(std::move(file));
+    }
+
+    cacheWrapper_->forEach([&files, &fileOfFd](SizeClass &sizeClass) {
+        for (const BlockCache::ResidentBlock &block : sizeClass.cache_.residentBlocks()) {
+            auto it = fileOfFd.find(block.fd);
+            if (it != fileOfFd.end() && files[it->second].blockSize == sizeClass.cache_.blockSize()) {
+                files[it->second].blocks.push_back({block.blockIndex, block.heat});
+            }
+        }
+    });
+    std::erase_if(files, [](const ManifestFile &file) { return file.blocks.empty(); });
+    for (ManifestFile &file : files) {
+        std::sort(file.blocks.begin(), file.blocks.end(),
+                  [](const ManifestFile::Block &a, const ManifestFile::Block &b) { return a.blockIndex < b.blockIndex; });
+    }
+
+    try {
+        writeManifest(path, files);
+    } catch (const std::system_error &e) {
+        LAB2_LOG_WARN("{}", e.what());
+        errno = e.code().value();
+        return -1;
+    }
+    return 0;
+}
+
+int Lab2::loadManifest(const std::string &path) {
+    std::vector<ManifestFile> files;
+    try {
+        files = readManifest(path);
+    } catch (const std::system_error &e) {
+        errno = e.code().value();
+        return -1;
+    } catch (const std::runtime_error &e) {
+        LAB2_LOG_WARN("Not loading manifest: {}", e.what());
+        errno = EINVAL;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(warmUp_->mutex);
+    if (warmUp_->thread.joinable()) {
+        warmUp_->thread.join();
+    }
+    warmUp_->running.store(true, std::memory_order_relaxed);
+    warmUp_->thread = std::thread(&Lab2::warmUp, this, std::move(files));
+    return 0;
+}
+
+void Lab2::warmUp(std::vector<ManifestFile> files) {
+    // Each block size gets the hottest blocks recorded with it, as many as its cache holds
+    std::vector<std::vector<off_t>> wanted(files.size());
+    std::vector<SizeClass *> sizeClasses(files.size(), nullptr);
+    cacheWrapper_->forEach([&](SizeClass &sizeClass) {
+        struct Candidate {
+            uint32_t heat;
+            size_t file;
+            off_t blockIndex;
+        };
+        std::vector<Candidate> candidates;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (files[i].blockSize != sizeClass.cache_.blockSize()) {
+                continue;
+            }
+            sizeClasses[i] = &sizeClass;
+            for (const ManifestFile::Block &block : files[i].blocks) {
+                candidates.push_back({block.heat, i, static_cast<off_t>(block.blockIndex)});
+            }
+        }
+        const size_t keep = std::min(candidates.size(), sizeClass.cache_.capacity());
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const Candidate &a, const Candidate &b) { return a.heat > b.heat; });
+        for (size_t i = 0; i < keep; ++i) {
+            wanted[candidates[i].file].push_back(candidates[i].blockIndex);
+        }
+    });
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!wanted[i].empty()) {
+            order.push_back(i);
+        } else if (sizeClasses[i] == nullptr) {
+            warmUp_->skippedFiles.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (order.size() > maxIdleFiles_) {
+        // The rest would push each other off the idle list; keep the files with the most blocks
+        std::stable_sort(order.begin(), order.end(),
+                         [&wanted](size_t a, size_t b) { return wanted[a].size() > wanted[b].size(); });
+        warmUp_->skippedFiles.fetch_add(order.size() - maxIdleFiles_, std::memory_order_relaxed);
+        order.resize(maxIdleFiles_);
+    }
+    // Files in inode order, blocks in file order: the closest to disk order we know
+    std::sort(order.begin(), order.end(), [&files](size_t a, size_t b) {
+        return std::tie(files[a].dev, files[a].ino) < std::tie(files[b].dev, files[b].ino);
+    });
+
+    for (size_t i : order) {
+        if (warmUp_->stopping.load(std::memory_order_relaxed)) {
+            break;
+        }
+        std::sort(wanted[i].begin(), wanted[i].end());
+        if (warmUpFile(files[i], *sizeClasses[i], wanted[i])) {
+            warmUp_->files.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            warmUp_->skippedFiles.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    warmUp_->running.store(false, std::memory_order_relaxed);
+}
+
+bool Lab2::warmUpFile(const ManifestFile &file, SizeClass &sizeClass, std::span<const off_t> blocks) {
+    const fd_t fd = ::open(file.path.c_str(), O_RDWR | O_DIRECT);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0 || static_cast<uint64_t>(st.st_dev) != file.dev || static_cast<uint64_t>(st.st_ino) != file.ino
+        || st.st_size != file.size || mtimeNs(st) != file.mtimeNs) {
+        ::close(fd);
+        return false;
+    }
+
+    std::shared_ptr<Inode> inode;
+    std::shared_ptr<Inode> retired;
+    {
+        std::unique_lock<std::shared_mutex> lock(openFilesMutex_);
+        std::shared_ptr<Inode> &known = inodes_[{st.st_dev, st.st_ino}];
+        if (known) {
+            ::close(fd); // Opened meanwhile, or still cached from before
+            inode = known;
+        } else {
+            // Enters as if it had just been closed; this fd becomes its cache fd
+            known = std::make_shared<Inode>(file.path, st, fd, sizeClass);
+            known->closedMtime = st.st_mtim;
+            known->closedSize = st.st_size;
+            inode = known;
+            retired = parkIdle(inode);
+        }
+    }
+    if (retired) {
+        dropIdle(*retired);
+    }
+
+    // Load like a read of the file, under its mutex, while it is still the one cached and in this block size
+    std::shared_lock<std::shared_mutex> inodeLock(inode->mutex, std::defer_lock);
+    {
+        std::shared_lock<std::shared_mutex> lock(openFilesMutex_);
+        auto it = inodes_.find({inode->dev, inode->ino});
+        if (it == inodes_.end() || it->second != inode) {
+            return false;
+        }
+        inodeLock.lock();
+    }
+    if (inode->sizeClass != &sizeClass) {
+        return false;
+    }
+    warmUp_->blocks.fetch_add(sizeClass.cache_.preload(inode->cacheFd, blocks), std::memory_order_relaxed);
+    return true;
+}
+
+WarmUpStats Lab2::waitForWarmUp() {
+    {
+        std::lock_guard<std::mutex> lock(warmUp_->mutex);
+        if (warmUp_->thread.joinable()) {
+            warmUp_->thread.join();
+        }
+    }
+    return warmUpStats();
+}
+
+WarmUpStats Lab2::warmUpStats() const {
+    WarmUpStats stats;
+    stats.files = warmUp_->files.load(std::memory_order_relaxed);
+    stats.skippedFiles = warmUp_->skippedFiles.load(std::memory_order_relaxed);
+    stats.blocks = warmUp_->blocks.load(std::memory_order_relaxed);
+    stats.running = warmUp_->running.load(std::memory_order_relaxed);
+    return stats;
+}
+
 int Lab2::advice(fd_t fd, off_t offset, access_hint_t hint) {
-    // By assignment: not implemented or “tell the user to go away”
-    // We can just return -1 or throw
-    std::cerr << "advice(fd_t, off_t, access_hint_t) not implemented, ignoring hint = " << hint << "\n";
-    return -1;
+    return advice(fd, offset, 0, hint);
+}
+
+int Lab2::advice(fd_t fd, off_t offset, off_t len, access_hint_t hint) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return -1;
+    }
+    if (offset < 0 || len < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The block size may change under the file's lock; take it there
+    std::lock_guard<std::shared_mutex> fileLock(file->inode->mutex);
+    const fd_t cacheFd = file->inode->cacheFd;
+    SizeClass &sizeClass = *file->inode->sizeClass;
+    BlockCache &cache = sizeClass.cache_;
+    const off_t blockSize = static_cast<off_t>(cache.blockSize());
+    const off_t firstBlock = offset / blockSize;
+    // Like posix_fadvise(), a range past the largest offset runs to the end of the file
+    const off_t lastBlock = len == 0 || len > std::numeric_limits<off_t>::max() - offset
+                                ? std::numeric_limits<off_t>::max()
+                                : (offset + len - 1) / blockSize;
+
+    switch (hint) {
+    case LAB2_ADVICE_NORMAL:
+    case LAB2_ADVICE_SEQUENTIAL:
+    case LAB2_ADVICE_RANDOM: {
+        // Not while pinned blocks are in use: dropping them would wait for the views to go
+        if (cacheWrapper_->small_ && hint != LAB2_ADVICE_NORMAL && file->inode->mappings == 0
+            && file->inode->views.load(std::memory_order_acquire) == 0
+            && !moveFile(file->inode->cacheFd, *file, hint == LAB2_ADVICE_RANDOM ? *cacheWrapper_->small_ : *cacheWrapper_->large_)) {
+            return -1;
+        }
+        file->dropBehind = hint == LAB2_ADVICE_SEQUENTIAL;
+        file->readahead.setPattern(hint == LAB2_ADVICE_SEQUENTIAL ? StreamDetector::Pattern::SEQUENTIAL
+                                   : hint == LAB2_ADVICE_RANDOM   ? StreamDetector::Pattern::RANDOM
+                                                                  : StreamDetector::Pattern::NORMAL);
+        if (hint == LAB2_ADVICE_NORMAL) {
+            file->noReuseLast = -1;
+        }
+        return 0;
+    }
+    case LAB2_ADVICE_NOREUSE: {
+        file->noReuseFirst = firstBlock;
+        file->noReuseLast = lastBlock;
+        return 0;
+    }
+    case LAB2_ADVICE_WILLNEED: {
+        // The prefetcher skips blocks past EOF; never ask for more than the cache holds
+        off_t count = std::min<off_t>(lastBlock - firstBlock, static_cast<off_t>(cache.capacity()) - 1) + 1;
+        sizeClass.prefetcher_.submit(cacheFd, {firstBlock, static_cast<size_t>(count)});
+        return 0;
+    }
+    case LAB2_ADVICE_DONTNEED:
+        // Blocks whose write-back failed stay cached, dirty; errno is EIO
+        return cache.evictRange(cacheFd, firstBlock, lastBlock) ? 0 : -1;
+    default:
+        LAB2_LOG_WARN("advice(): unknown hint = {}", hint);
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+bool Lab2::moveFile(fd_t fd, OpenFile &file, SizeClass &target) {
+    SizeClass &source = *file.inode->sizeClass;
+    if (&source == &target) {
+        return true;
+    }
+    source.prefetcher_.cancel(fd);
+    if (!source.cache_.flushFd(fd)) {
+        return false; // Its dirty blocks are still in the source cache, so the file stays there
+    }
+
+    // NOREUSE advice keeps covering the same bytes, on every open of the file
+    const auto sourceSize = static_cast<off_t>(source.cache_.blockSize());
+    const auto targetSize = static_cast<off_t>(target.cache_.blockSize());
+    for (OpenFile *open : file.inode->opens) {
+        if (open->noReuseLast >= open->noReuseFirst) {
+            open->noReuseFirst = open->noReuseFirst * sourceSize / targetSize;
+            if (open->noReuseLast < std::numeric_limits<off_t>::max() / sourceSize) {
+                open->noReuseLast = ((open->noReuseLast + 1) * sourceSize - 1) / targetSize;
+            }
+        }
+        open->readahead = StreamDetector(target.maxReadahead());
+    }
+    file.inode->sizeClass = &target;
+    return true;
+}
+
+std::unique_ptr<Lab2::PinnedBlocks> Lab2::pinRange(fd_t fd, OpenFile &file, off_t offset, size_t len, bool readahead) {
+    BlockCache &cache = file.inode->sizeClass->cache_;
+    auto pins = std::make_unique<PinnedBlocks>();
+    if (len == 0) {
+        return pins;
+    }
+
+    const off_t firstBlock = offset / static_cast<off_t>(cache.blockSize());
+    const off_t lastBlock = (offset + static_cast<off_t>(len) - 1) / static_cast<off_t>(cache.blockSize());
+    const size_t count = static_cast<size_t>(lastBlock - firstBlock + 1);
+    // Leave the other half to everybody else, or their misses would find nothing to evict
+    if (count > std::max<size_t>(cache.capacity() / 2, 1)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    if (count > 1) {
+        cache.preload(fd, firstBlock, count);
+    }
+
+    pins->blocks.reserve(count);
+    for (off_t blockIndex = firstBlock; blockIndex <= lastBlock; ++blockIndex) {
+        BlockCache::Handle block = cache.acquire(fd, blockIndex, file.noReuse(blockIndex));
+        if (!block) {
+            return nullptr; // errno set by acquire(); the handles taken so far unpin
+        }
+        if (readahead) {
+            file.inode->sizeClass->prefetcher_.submit(fd, file.readahead.onAccess(blockIndex, block.lookup()));
+        }
+        pins->blocks.push_back(std::move(block));
+    }
+    return pins;
+}
+
+Lab2::ReadView Lab2::acquireRead(fd_t fd, off_t offset, size_t len) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return {};
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return {};
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    const off_t size = file->inode->size.load(std::memory_order_relaxed);
+    len = offset < size ? std::min<size_t>(len, size - offset) : 0;
+    ReadView view;
+    view.pins_ = pinRange(file->inode->cacheFd, *file, offset, len, /* readahead = */ true);
+    if (view.pins_) {
+        fillSpans(view.pins_->blocks, offset, len, file->inode->sizeClass->cache_.blockSize(), view.spans_);
+        view.size_ = len;
+        file->inode->views.fetch_add(1, std::memory_order_relaxed);
+        view.pins_->inode = file->inode;
+    }
+    return view;
+}
+
+Lab2::WriteView Lab2::acquireWrite(fd_t fd, off_t offset, size_t len) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return {};
+    }
+    if (offset < 0) {
+        errno = EINVAL;
+        return {};
+    }
+
+    std::shared_lock<std::shared_mutex> fileLock(file->inode->mutex);
+    WriteView view;
+    view.pins_ = pinRange(file->inode->cacheFd, *file, offset, len, /* readahead = */ false);
+    if (view.pins_) {
+        fillSpans(view.pins_->blocks, offset, len, file->inode->sizeClass->cache_.blockSize(), view.spans_);
+        view.size_ = len;
+        file->inode->views.fetch_add(1, std::memory_order_relaxed);
+        view.pins_->inode = file->inode;
+        if (len > 0) {
+            view.pins_->end = offset + static_cast<off_t>(len);
+        }
+    }
+    return view;
+}
+
+Lab2::MappedView Lab2::map(fd_t fd, off_t offset, size_t len) {
+    std::shared_ptr<OpenFile> file = findFile(fd);
+    if (!file) {
+        errno = EBADF;
+        return {};
+    }
+    if (offset < 0 || static_cast<size_t>(offset) % UserfaultMapper::pageSize() != 0) {
+        errno = EINVAL;
+        return {};
+    }
+
+    UserfaultMapper *mapper;
+    {
+        std::lock_guard<std::mutex> lock(mapperMutex_);
+        if (!mapper_) {
+            try {
+                mapper_ = std::make_unique<UserfaultMapper>();
+            } catch (const std::system_error &e) {
+                LAB2_LOG_WARN("{}", e.what());
+                errno = e.code().value();
+                return {};
+            }
+        }
+        mapper = mapper_.get();
+    }
+
+    std::lock_guard<std::shared_mutex> fileLock(file->inode->mutex);
+    BlockCache &cache = file->inode->sizeClass->cache_;
+    const off_t size = file->inode->size.load(std::memory_order_relaxed);
+    len = offset < size ? std::min<size_t>(len, size - offset) : 0;
+    if (len == 0 || cache.blockSize() % UserfaultMapper::pageSize() != 0) {
+        errno = EINVAL;
+        return {};
+    }
+    MappedView view;
+    view.region_ = mapper->map(cache, file->inode->cacheFd, offset, len);
+    if (view.region_) {
+        view.inode_ = file->inode;
+        view.mapper_ = mapper;
+        ++file->inode->mappings;
+    }
+    return view;
+}
+
+Lab2::MappedView::MappedView() = default;
+Lab2::MappedView::MappedView(MappedView &&other) noexcept = default;
+
+Lab2::MappedView &Lab2::MappedView::operator=(MappedView &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        region_ = std::move(other.region_);
+        inode_ = std::move(other.inode_);
+        mapper_ = other.mapper_;
+    }
+    return *this;
+}
+
+Lab2::MappedView::~MappedView() {
+    unmap();
+}
+
+char *Lab2::MappedView::data() const {
+    return region_ ? region_->base : nullptr;
+}
+
+size_t Lab2::MappedView::size() const {
+    return region_ ? region_->size : 0;
+}
+
+int Lab2::MappedView::sync() {
+    if (!region_) {
+        errno = EINVAL;
+        return -1;
+    }
+    // Like a write() of the pages
+    std::shared_lock<std::shared_mutex> fileLock(inode_->mutex);
+    return mapper_->sync(*region_) ? 0 : -1;
+}
+
+void Lab2::MappedView::unmap() {
+    if (!region_) {
+        return;
+    }
+    std::lock_guard<std::shared_mutex> fileLock(inode_->mutex);
+    if (!mapper_->sync(*region_)) {
+        LAB2_LOG_ERROR("Writes to a mapping of fd {} were lost on unmap.", inode_->cacheFd);
+    }
+    mapper_->unmap(*region_);
+    --inode_->mappings;
+    region_.reset();
+    inode_.reset();
+}
+
+Lab2::ReadView::ReadView() = default;
+Lab2::ReadView::ReadView(ReadView &&other) noexcept = default;
+Lab2::ReadView &Lab2::ReadView::operator=(ReadView &&other) noexcept = default;
+Lab2::ReadView::~ReadView() = default;
+
+void Lab2::ReadView::release() {
+    pins_.reset();
+    spans_.clear();
+    size_ = 0;
+}
+
+Lab2::WriteView::WriteView() = default;
+Lab2::WriteView::WriteView(WriteView &&other) noexcept = default;
+
+Lab2::WriteView &Lab2::WriteView::operator=(WriteView &&other) noexcept {
+    if (this != &other) {
+        release();
+        pins_ = std::move(other.pins_);
+        spans_ = std::move(other.spans_);
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+Lab2::WriteView::~WriteView() {
+    release();
+}
+
+void Lab2::WriteView::release() {
+    if (!pins_) {
+        return;
+    }
+    // Only the bytes of the range are written back, not the whole blocks
+    for (size_t i = 0; i < spans_.size(); ++i) {
+        BlockCache::Handle &block = pins_->blocks[i];
+        block.markDirty(static_cast<size_t>(spans_[i].data() - static_cast<char *>(block.data())), spans_[i].size());
+    }
+    if (pins_->end > 0) {
+        // Shared, like a write(): not while a sync cuts the file back to its size
+        std::shared_lock<std::shared_mutex> fileLock(pins_->inode->mutex);
+        pins_->inode->grow(pins_->end);
+    }
+    pins_.reset();
+    spans_.clear();
+    size_ = 0;
 }
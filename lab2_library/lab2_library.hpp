@@ -1,41 +1,439 @@
 #ifndef LAB2_LIBRARY_HPP
 #define LAB2_LIBRARY_HPP
+#include <cstdint>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <vector>
 
 // #include "BlockCache.hpp"
+#include "EvictionPolicy.hpp"
+#include "Statistics.hpp"
+
+class TraceWriter;
+struct ManifestFile;
+struct MappedRegion;
+class UserfaultMapper;
 
 using fd_t = int;
 using access_hint_t = long long;
 
 constexpr size_t LAB2_BLOCK_SIZE = 0x400000; // 4 MB
 
+// Access hints for Lab2::advice(), numbered like POSIX_FADV_*
+/// Default behaviour: readahead adapts to what it sees
+constexpr access_hint_t LAB2_ADVICE_NORMAL = 0;
+/// No readahead for this fd
+constexpr access_hint_t LAB2_ADVICE_RANDOM = 1;
+/// Wide readahead, and blocks read to the end go first on eviction
+constexpr access_hint_t LAB2_ADVICE_SEQUENTIAL = 2;
+/// Prefetch the range in the background
+constexpr access_hint_t LAB2_ADVICE_WILLNEED = 3;
+/// Write back and evict the range now
+constexpr access_hint_t LAB2_ADVICE_DONTNEED = 4;
+/// Blocks of the range do not get a reference bit, so they are evicted first
+constexpr access_hint_t LAB2_ADVICE_NOREUSE = 5;
+
+// Flags for Lab2::syncRange()
+/// Write the dirty cached bytes of the range to the file
+constexpr unsigned LAB2_SYNC_RANGE_WRITE = 1;
+/// Then flush the file's data, but not metadata it does not need, to stable storage, as fdatasync(2) does
+constexpr unsigned LAB2_SYNC_RANGE_DATASYNC = 2;
+
+/// Snapshot of the readahead counters, see Lab2::readaheadStats()
+struct ReadaheadStats {
+    /// Blocks loaded ahead of the reader
+    uint64_t issued = 0;
+    /// Reads served by a prefetched block
+    uint64_t hits = 0;
+    /// Reads in a sequential stream that still had to go to disk
+    uint64_t misses = 0;
+    /// Prefetched blocks evicted or dropped without being read
+    uint64_t wasted = 0;
+};
+
+/// Background write-back settings, see Lab2::Lab2()
+struct WritebackConfig {
+    /// Run the background flusher at all; without it dirty blocks are written on eviction, fsync and close
+    bool enabled = true;
+    /// Share of the cache that may be dirty before the flusher starts writing blocks back
+    double dirtyRatio = 0.25;
+    /// Blocks dirty for longer than this are written back whatever the ratio; 0 turns the limit off
+    uint32_t maxDirtyAgeMs = 3000;
+    /// How often the flusher looks for blocks past maxDirtyAgeMs
+    uint32_t intervalMs = 500;
+};
+
+/**
+ * A second, smaller block size, so that a small file or random access does
+ * not move and pin a whole large block per byte touched. Each fd uses one of
+ * the two sizes: small blocks if the file is small when opened, and after
+ * RANDOM advice; SEQUENTIAL advice moves it back to large blocks.
+ */
+struct SmallBlockConfig {
+    /// 0 for a single block size
+    size_t blockSize = 0;
+    /// Share of the memory budget that holds small blocks
+    double share = 0.25;
+    /// Files shorter than this when opened get small blocks; 0 means shorter than one large block
+    off_t fileSizeLimit = 0;
+};
+
+/// Cache construction settings, see Lab2::Lab2()
+struct CacheConfig {
+    /// Number of blocks the cache holds; see capacityBytes
+    size_t capacity = 0;
+    size_t blockSize = LAB2_BLOCK_SIZE;
+    /// How victims are chosen; the alternatives to Clock keep a scan from flushing the frequently used blocks
+    EvictionPolicy::Kind eviction = EvictionPolicy::Kind::CLOCK;
+    WritebackConfig writeback;
+    /// Records every open/read/write/lseek/fsync/close (and pread/pwrite) to this file, see TraceWriter; empty for none
+    std::string tracePath;
+    /// Memory for cached data, both block sizes together; 0 means capacity * blockSize
+    size_t capacityBytes = 0;
+    SmallBlockConfig smallBlocks;
+    /// Concurrent fsync/fdatasync/syncRange calls on one fd share a single device flush, see GroupCommit
+    bool groupCommit = false;
+    /// Closed files whose blocks stay cached for the next open; past that the least recently closed one is dropped
+    size_t maxIdleFiles = 64;
+    /// Memory for clean evicted blocks kept LZ4-compressed, on top of the cache's; 0 for none, see CompressedTier
+    size_t compressedTierBytes = 0;
+    /// Punch holes for all-zero blocks instead of writing them, and skip the read of blocks in holes;
+    /// see BlockCache::setSparseFiles()
+    bool sparseFiles = true;
+    /// Warm restart: a manifest loaded in the background on construction, if it exists, and saved on destruction;
+    /// empty for none, see Lab2::saveManifest()
+    std::string manifestPath;
+};
+
+/// Snapshot of the background write-back counters, see Lab2::writebackStats()
+struct WritebackStats {
+    /// Dirty blocks right now
+    uint64_t dirty = 0;
+    /// Blocks the flusher wrote back
+    uint64_t blocks = 0;
+    /// Write calls it took; adjacent blocks of a file share one pwritev
+    uint64_t writes = 0;
+};
+
+/// Progress of the load Lab2::loadManifest() started, see Lab2::warmUpStats()
+struct WarmUpStats {
+    /// Files whose blocks were loaded
+    uint64_t files = 0;
+    /// Files changed, replaced or gone since the manifest was written, cached with a block size no longer
+    /// used, or past CacheConfig::maxIdleFiles
+    uint64_t skippedFiles = 0;
+    /// Blocks loaded
+    uint64_t blocks = 0;
+    /// A load is still going on
+    bool running = false;
+};
+
+/// One positional read of Lab2::readBatch()
+struct ReadRequest {
+    fd_t fd = -1;
+    off_t offset = 0;
+    void *buffer = nullptr;
+    size_t length = 0;
+    /// Set by readBatch(): bytes read, fewer than length at EOF, or -errno
+    ssize_t result = 0;
+};
+
+/// Safe to share between threads; calls on one fd are serialized.
 class Lab2 {
+    struct PinnedBlocks; // Blocks held by a view, defined in the .cpp file
+    struct Inode; // Per-file state shared by every open of the file, defined in the .cpp file
+
 public:
-    explicit Lab2(size_t cacheCapacity, size_t blockSize);
+    /**
+     * A file range pinned in the cache, see acquireRead(). The spans point
+     * straight into the cached blocks, one per block, in file order. They
+     * stay valid until the view is released or destroyed; the blocks are not
+     * evicted meanwhile. Release views before closing their fd.
+     */
+    class ReadView {
+    public:
+        ReadView();
+        ReadView(ReadView &&other) noexcept;
+        ReadView &operator=(ReadView &&other) noexcept;
+        ~ReadView();
+
+        /// False if acquireRead() failed
+        explicit operator bool() const { return pins_ != nullptr; }
+        const std::vector<std::span<const char>> &spans() const { return spans_; }
+        /// Bytes covered; fewer than asked for at the end of the file
+        size_t size() const { return size_; }
+        /// Unpins the blocks early; the view becomes empty.
+        void release();
+
+    private:
+        friend class Lab2;
+        std::unique_ptr<PinnedBlocks> pins_;
+        std::vector<std::span<const char>> spans_;
+        size_t size_ = 0;
+    };
+
+    /**
+     * Like ReadView, writable, see acquireWrite(). When it is released the
+     * range is marked dirty and the file grows to cover it.
+     */
+    class WriteView {
+    public:
+        WriteView();
+        WriteView(WriteView &&other) noexcept;
+        WriteView &operator=(WriteView &&other) noexcept;
+        ~WriteView();
+
+        /// False if acquireWrite() failed
+        explicit operator bool() const { return pins_ != nullptr; }
+        const std::vector<std::span<char>> &spans() const { return spans_; }
+        size_t size() const { return size_; }
+        /// Marks the range dirty and unpins the blocks; the view becomes empty.
+        void release();
+
+    private:
+        friend class Lab2;
+        std::unique_ptr<PinnedBlocks> pins_;
+        std::vector<std::span<char>> spans_;
+        size_t size_ = 0;
+    };
+
+    /**
+     * A file range mapped into memory through the cache, see map(). Pages are
+     * filled from the cached blocks when first touched (userfaultfd(2)), so
+     * code that follows pointers reads the file without calling read().
+     * Writes to the pages are caught and reach the cache on sync() or unmap();
+     * fsync() after that makes them durable. A page once touched is a copy:
+     * later changes through write() or a view do not show in it. Unmap
+     * before closing the fd.
+     */
+    class MappedView {
+    public:
+        MappedView();
+        MappedView(MappedView &&other) noexcept;
+        MappedView &operator=(MappedView &&other) noexcept;
+        /// Unmaps, see unmap()
+        ~MappedView();
+
+        /// False if map() failed
+        explicit operator bool() const { return region_ != nullptr; }
+        char *data() const;
+        /// Bytes of the file mapped; fewer than asked for at the end of the file
+        size_t size() const;
+        /**
+         * Copies the pages written since the last sync into their blocks and
+         * marks those dirty, like msync(MS_ASYNC). Returns 0, or -1 with errno
+         * set if a block could not be had; its pages are tried again next time.
+         */
+        int sync();
+        /// sync(), then unmaps the range; the view becomes empty.
+        void unmap();
+
+    private:
+        friend class Lab2;
+        std::shared_ptr<MappedRegion> region_;
+        std::shared_ptr<Inode> inode_;
+        UserfaultMapper *mapper_ = nullptr;
+    };
+
+    explicit Lab2(size_t cacheCapacity, size_t blockSize, const WritebackConfig &writeback = WritebackConfig());
+    explicit Lab2(const CacheConfig &config);
 
     ~Lab2();
 
+    /// Opens of one file (same st_dev and st_ino, by any path) share its cached blocks and its size
     fd_t open(const std::string &filename);
 
+    /**
+     * Writes back and flushes the file; its blocks stay cached for the next
+     * open, see CacheConfig::maxIdleFiles. The fd is closed even if that
+     * fails, and -1 is returned with errno set like fsync() does.
+     */
     int close(fd_t fd);
 
+    /// Like read(2): a short count if a block cannot be had after part of the range, -1 with errno if at the first
     ssize_t read(fd_t fd, void *buf, size_t count);
-
+    /// Like write(2), short counts included; the file offset moves past what was written
     ssize_t write(fd_t fd, const void *buf, size_t count);
 
     off_t lseek(fd_t fd, off_t offset, int whence);
 
     int fsync(fd_t fd);
+    /// fsync() without flushing metadata the data does not need, like fdatasync(2)
+    int fdatasync(fd_t fd);
+    /**
+     * Writes back the dirty cached bytes of [offset, offset + nbytes) of fd,
+     * like sync_file_range(2); nbytes == 0 means up to the end of the file.
+     * Blocks outside the range stay dirty, and every block stays cached.
+     * flags is LAB2_SYNC_RANGE_WRITE, optionally with LAB2_SYNC_RANGE_DATASYNC
+     * to also make the file's data durable. Returns 0, or -1 with errno EBADF,
+     * EINVAL (bad range or flags) or EIO.
+     */
+    int syncRange(fd_t fd, off_t offset, off_t nbytes, unsigned flags);
 
-    static int advice(fd_t fd, off_t offset, access_hint_t hint);
+    /// read() and write() at offset; the file offset does not move.
+    ssize_t pread(fd_t fd, void *buf, size_t count, off_t offset);
+    ssize_t pwrite(fd_t fd, const void *buf, size_t count, off_t offset);
+    /// Scatter/gather like readv(2) and writev(2): stop at EOF or at the first failure.
+    ssize_t readv(fd_t fd, const iovec *iov, int iovcnt);
+    ssize_t writev(fd_t fd, const iovec *iov, int iovcnt);
+    ssize_t preadv(fd_t fd, const iovec *iov, int iovcnt, off_t offset);
+    ssize_t pwritev(fd_t fd, const iovec *iov, int iovcnt, off_t offset);
+    /**
+     * Serves many positional reads, on any mix of fds, in one call. Requests
+     * are grouped by block: each block is looked up once, and the missing
+     * ones are read from disk as a single batch per fd. Sets every request's
+     * result and returns how many succeeded.
+     */
+    size_t readBatch(ReadRequest *requests, size_t count);
+
+    /// Same as advice(fd, offset, 0, hint): the range runs to the end of the file.
+    int advice(fd_t fd, off_t offset, access_hint_t hint);
+
+    /**
+     * Tells the cache how [offset, offset + len) of fd is going to be used,
+     * like posix_fadvise(). len == 0 means up to the end of the file.
+     * SEQUENTIAL, RANDOM and NORMAL apply to the whole fd. With small blocks
+     * configured, RANDOM and SEQUENTIAL also move the fd to small or large
+     * blocks, unless the file is mapped; that writes back its cached blocks
+     * and waits for its views.
+     * Returns 0, or -1 with errno EBADF (unknown fd) or EINVAL (bad hint or range).
+     */
+    int advice(fd_t fd, off_t offset, off_t len, access_hint_t hint);
+
+    /**
+     * Pins [offset, offset + len) of fd, cut short at the end of the file,
+     * and returns a view of it in place of a copy. The file offset does not
+     * move. A view pins at most half the cache; on failure it is empty and
+     * errno is EBADF, EINVAL, ENOMEM (range too long, or no block to evict)
+     * or EIO.
+     */
+    ReadView acquireRead(fd_t fd, off_t offset, size_t len);
+    /**
+     * Pins [offset, offset + len) of fd for writing in place. The view starts
+     * out with the current contents (zeros past the end of the file). Fails
+     * like acquireRead().
+     */
+    WriteView acquireWrite(fd_t fd, off_t offset, size_t len);
+    /**
+     * Maps [offset, offset + len) of fd, cut short at the end of the file,
+     * see MappedView. offset and the file's block size must be multiples of
+     * the page size, and the file keeps its block size while it is mapped.
+     * On failure the view is empty and errno is EBADF, EINVAL (bad offset,
+     * block size, or nothing to map) or what userfaultfd(2) or mmap(2)
+     * failed with.
+     */
+    MappedView map(fd_t fd, off_t offset, size_t len);
+
+    ReadaheadStats readaheadStats() const;
+
+    WritebackStats writebackStats() const;
+
+    /// Hits, misses, evictions, write-backs and disk latencies of the cache so far
+    CacheStats stats() const;
+
+    /**
+     * stats(), readaheadStats() and writebackStats() in the Prometheus text
+     * exposition format, for a scrape endpoint or a file for node_exporter's
+     * textfile collector. Latencies are histograms in seconds.
+     */
+    std::string metrics() const;
+
+    /**
+     * Records which blocks of every file, open or idle, are cached and how hot
+     * each is, in a manifest at path (see Manifest.hpp), for loadManifest() in
+     * a later process. Dirty blocks are written back first, so that the sizes
+     * and mtimes it records are those on disk. Returns 0, or -1 with errno set.
+     */
+    int saveManifest(const std::string &path);
+    /**
+     * Starts loading what a manifest recorded, in the background: the hottest
+     * blocks that fit the cache, file by file in (st_dev, st_ino) order, each
+     * file's in block order as one batch. Files that changed (mtime or size),
+     * were replaced or are gone are skipped. The files stay open like closed
+     * ones, see CacheConfig::maxIdleFiles. A load still running is waited for
+     * first. Returns 0, or -1 with errno set if the manifest cannot be read
+     * (EINVAL if it is not one).
+     */
+    int loadManifest(const std::string &path);
+    /// Waits for the load loadManifest() started, if any
+    WarmUpStats waitForWarmUp();
+    WarmUpStats warmUpStats() const;
 
 private:
-    std::unordered_map<fd_t, off_t> fileOffsets_;
+    struct OpenFile; // Per-fd state, defined in the .cpp file
+    /// Guards the tables themselves and the open counts; each Inode has its own lock for the file's data
+    mutable std::shared_mutex openFilesMutex_;
+    std::unordered_map<fd_t, std::shared_ptr<OpenFile>> openFiles_;
+    /// (st_dev, st_ino) -> the file, open or idle
+    std::map<std::pair<dev_t, ino_t>, std::shared_ptr<Inode>> inodes_;
+    /// Files nobody has open whose blocks are kept, least recently closed first
+    std::list<std::shared_ptr<Inode>> idleInodes_;
+    size_t maxIdleFiles_;
+    struct SizeClass; // A cache of one block size, with its readahead and write-back
     struct BlockCacheWrapper; // Forward declaration
     std::unique_ptr<BlockCacheWrapper> cacheWrapper_; // Direct member
+    std::unique_ptr<TraceWriter> trace_; // Null unless CacheConfig::tracePath is set
+    bool groupCommit_ = false;
+    struct WarmUp; // The loadManifest() thread and its counters
+    std::unique_ptr<WarmUp> warmUp_;
+    std::string manifestPath_;
+    /// Created by the first map(); declared after the caches, whose blocks its thread copies, so it stops first
+    std::mutex mapperMutex_;
+    std::unique_ptr<UserfaultMapper> mapper_;
+
+    std::shared_ptr<OpenFile> findFile(fd_t fd) const;
+    /**
+     * Puts a file nobody has open on the idle list; the caller holds
+     * openFilesMutex_. Returns the file this pushed out of the list, if any,
+     * for dropIdle() once the lock is released.
+     */
+    std::shared_ptr<Inode> parkIdle(std::shared_ptr<Inode> inode);
+    void dropIdle(Inode &retired);
+    /// The body of the loadManifest() thread
+    void warmUp(std::vector<ManifestFile> files);
+    /// Checks that a file recorded in a manifest is unchanged and loads the given blocks of it; false if skipped
+    bool warmUpFile(const ManifestFile &file, SizeClass &sizeClass, std::span<const off_t> blocks);
+    /*
+     * The helpers below that take an fd_t with an OpenFile want the file's
+     * cache fd (Inode::cacheFd), which the cache keys its blocks by, not the
+     * caller's fd.
+     */
+    /**
+     * Moves a file whose mutex the caller holds to another block size, writing
+     * back and dropping its blocks. False with errno EIO if a write failed; the
+     * file then stays where it was.
+     */
+    bool moveFile(fd_t fd, OpenFile &file, SizeClass &target);
+    /// How far syncFile() goes after writing the dirty blocks back
+    enum class SyncLevel { WRITE, DATA, FULL };
+    /**
+     * Writes back the dirty blocks under [offset, offset + nbytes) (nbytes == 0:
+     * to the end), trims write alignment padding off the file, then flushes
+     * the device as asked. Takes the file's mutex for the write-back only, so
+     * that concurrent calls can share the flush.
+     */
+    int syncFile(Inode &inode, off_t offset, off_t nbytes, SyncLevel level);
+    /// The write-back part of syncFile(), for a file whose mutex the caller holds
+    int writeBackFile(Inode &inode, off_t offset, off_t nbytes);
+    /// fsync(2) or fdatasync(2) of the file, through its GroupCommit if CacheConfig::groupCommit is set
+    int flushFile(Inode &inode, SyncLevel level);
+    /// The bodies of read()/write() and their variants: the caller holds the file's mutex, offset advances
+    ssize_t readAt(fd_t fd, OpenFile &file, off_t &offset, void *buf, size_t count);
+    ssize_t writeAt(fd_t fd, OpenFile &file, off_t &offset, const void *buf, size_t count);
+    ssize_t transferv(fd_t fd, OpenFile &file, off_t &offset, const iovec *iov, int iovcnt, bool write);
+    /// readBatch() for the requests of one fd, given by index in offset order
+    size_t readBatchFile(fd_t fd, ReadRequest *requests, const size_t *order, size_t count);
+    /// Pins the blocks under [offset, offset + len) for a view; null with errno set on failure
+    std::unique_ptr<PinnedBlocks> pinRange(fd_t fd, OpenFile &file, off_t offset, size_t len, bool readahead);
 };
 
 #endif //LAB2_LIBRARY_HPP
@@ -0,0 +1,175 @@
+#include "Replayer.hpp"
+#include <algorithm>    // std::sort
+#include <chrono>       // std::chrono::steady_clock
+#include <filesystem>   // std::filesystem::path
+#include <iomanip>      // std::setw, std::setprecision
+#include <thread>       // std::this_thread::sleep_until
+#include <unordered_map>
+
+namespace {
+
+const char* opName(std::size_t op) {
+    static const char* const NAMES[ReplayReport::OP_COUNT] = {
+        "open", "close", "read", "write", "lseek", "fsync", "pread", "pwrite", "fdatasync", "sync_range"};
+    return NAMES[op];
+}
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double fraction) {
+    auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+/// Bytes in MiB
+double mebibytes(std::uint64_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+ReplayReport replayTrace(Lab2& lab2, TraceReader& reader, const ReplayOptions& options) {
+    ReplayReport report;
+    const CacheStats before = lab2.stats();
+    std::unordered_map<int, fd_t> fds;
+    // Written data is a pattern; what matters is where it goes
+    std::vector<char> buffer;
+
+    const auto start = std::chrono::steady_clock::now();
+    bool first = true;
+    std::uint64_t firstTimeNs = 0;
+    TraceEvent event;
+    while (reader.next(event)) {
+        ++report.events;
+        if (first) {
+            firstTimeNs = event.timeNs;
+            first = false;
+        }
+        if (options.originalTiming && event.timeNs > firstTimeNs) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(event.timeNs - firstTimeNs));
+        }
+
+        fd_t fd = -1;
+        if (event.op != TraceEvent::Op::OPEN) {
+            auto it = fds.find(event.fd);
+            if (it == fds.end()) {
+                ++report.mismatches;
+                continue;
+            }
+            fd = it->second;
+        }
+        if (buffer.size() < event.length && event.op != TraceEvent::Op::LSEEK && event.op != TraceEvent::Op::SYNC_RANGE) {
+            buffer.resize(event.length, 'r');
+        }
+
+        auto callStart = std::chrono::steady_clock::now();
+        std::int64_t result = 0;
+        switch (event.op) {
+        case TraceEvent::Op::OPEN: {
+            std::string path = event.path;
+            if (!options.directory.empty()) {
+                path = (std::filesystem::path(options.directory) / std::filesystem::path(path).filename()).string();
+            }
+            result = lab2.open(path);
+            break;
+        }
+        case TraceEvent::Op::CLOSE:
+            result = lab2.close(fd);
+            break;
+        case TraceEvent::Op::READ:
+            result = lab2.read(fd, buffer.data(), event.length);
+            break;
+        case TraceEvent::Op::WRITE:
+            result = lab2.write(fd, buffer.data(), event.length);
+            break;
+        case TraceEvent::Op::LSEEK:
+            result = lab2.lseek(fd, event.offset, static_cast<int>(event.length));
+            break;
+        case TraceEvent::Op::FSYNC:
+            result = lab2.fsync(fd);
+            break;
+        case TraceEvent::Op::PREAD:
+            result = lab2.pread(fd, buffer.data(), event.length, event.offset);
+            break;
+        case TraceEvent::Op::PWRITE:
+            result = lab2.pwrite(fd, buffer.data(), event.length, event.offset);
+            break;
+        case TraceEvent::Op::FDATASYNC:
+            result = lab2.fdatasync(fd);
+            break;
+        case TraceEvent::Op::SYNC_RANGE:
+            result = lab2.syncRange(fd, event.offset, static_cast<off_t>(event.length), event.flags);
+            break;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - callStart;
+        report.latencies[static_cast<std::size_t>(event.op)].push_back(
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+
+        if (event.op == TraceEvent::Op::OPEN) {
+            // The fd itself differs from run to run; only success counts
+            if (result >= 0) {
+                fds[static_cast<int>(event.result)] = static_cast<fd_t>(result);
+            }
+            if ((result < 0) != (event.result < 0)) {
+                ++report.mismatches;
+            }
+            continue;
+        }
+        if (event.op == TraceEvent::Op::CLOSE) {
+            fds.erase(event.fd);
+        }
+        if (result != event.result) {
+            ++report.mismatches;
+        }
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const CacheStats after = lab2.stats();
+    report.cache.hits = after.hits - before.hits;
+    report.cache.misses = after.misses - before.misses;
+    report.cache.bytesRead = after.bytesRead - before.bytesRead;
+    report.cache.bytesWritten = after.bytesWritten - before.bytesWritten;
+    report.cache.evictions = after.evictions - before.evictions;
+    report.cache.writebacks = after.writebacks - before.writebacks;
+    report.cache.tierHits = after.tierHits - before.tierHits;
+    report.cache.tierMisses = after.tierMisses - before.tierMisses;
+    report.cache.tierStored = after.tierStored - before.tierStored;
+    report.cache.tierRejected = after.tierRejected - before.tierRejected;
+    report.cache.tierRawBytes = after.tierRawBytes - before.tierRawBytes;
+    report.cache.tierCompressedBytes = after.tierCompressedBytes - before.tierCompressedBytes;
+    return report;
+}
+
+void printReport(std::ostream& out, ReplayReport& report) {
+    const std::uint64_t lookups = report.cache.hits + report.cache.misses;
+    out << std::fixed << std::setprecision(3);
+    out << "events:        " << report.events << " in " << report.seconds << " s";
+    if (report.mismatches > 0) {
+        out << " (" << report.mismatches << " with a different result than recorded)";
+    }
+    out << "\n";
+    out << "hit ratio:     " << (lookups > 0 ? static_cast<double>(report.cache.hits) / static_cast<double>(lookups) : 0.0)
+        << " (" << report.cache.hits << " hits, " << report.cache.misses << " misses)\n";
+    out << "evictions:     " << report.cache.evictions << " (" << report.cache.writebacks << " dirty blocks written back)\n";
+    const std::uint64_t tierLookups = report.cache.tierHits + report.cache.tierMisses;
+    if (tierLookups > 0 || report.cache.tierStored + report.cache.tierRejected > 0) {
+        out << "tier hit rate: " << (tierLookups > 0 ? static_cast<double>(report.cache.tierHits) / static_cast<double>(tierLookups) : 0.0)
+            << " (" << report.cache.tierStored << " blocks kept at "
+            << (report.cache.tierCompressedBytes > 0
+                    ? static_cast<double>(report.cache.tierRawBytes) / static_cast<double>(report.cache.tierCompressedBytes) : 0.0)
+            << ":1, " << report.cache.tierRejected << " incompressible)\n";
+    }
+    out << "disk read:     " << mebibytes(report.cache.bytesRead) << " MiB\n";
+    out << "disk written:  " << mebibytes(report.cache.bytesWritten) << " MiB\n";
+    out << "latency (us)     calls        p50        p99       p999\n";
+    for (std::size_t op = 0; op < ReplayReport::OP_COUNT; ++op) {
+        std::vector<std::uint64_t>& latencies = report.latencies[op];
+        if (latencies.empty()) {
+            continue;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        out << std::left << std::setw(10) << opName(op) << std::right
+            << std::setw(12) << latencies.size()
+            << std::setw(11) << static_cast<double>(percentile(latencies, 0.50)) / 1000.0
+            << std::setw(11) << static_cast<double>(percentile(latencies, 0.99)) / 1000.0
+            << std::setw(11) << static_cast<double>(percentile(latencies, 0.999)) / 1000.0 << "\n";
+    }
+}
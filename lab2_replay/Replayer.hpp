@@ -0,0 +1,43 @@
+#ifndef REPLAYER_HPP
+#define REPLAYER_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "lab2_library.hpp"
+#include "Trace.hpp"
+
+struct ReplayOptions {
+    /// Wait until each call is due, as in the trace, instead of issuing them back to back
+    bool originalTiming = false;
+    /// If set, files are opened in this directory under the file name the trace recorded
+    std::string directory;
+};
+
+struct ReplayReport {
+    static constexpr std::size_t OP_COUNT = static_cast<std::size_t>(TraceEvent::Op::SYNC_RANGE) + 1;
+
+    std::uint64_t events = 0;
+    /// Calls that returned something other than in the trace
+    std::uint64_t mismatches = 0;
+    double seconds = 0;
+    /// Counters of the cache over the replay
+    CacheStats cache;
+    /// Per-call latency by TraceEvent::Op, in nanoseconds
+    std::array<std::vector<std::uint64_t>, OP_COUNT> latencies;
+};
+
+/**
+ * Issues the calls of a trace on lab2, one after the other, on the calling
+ * thread. Trace fds are mapped to the fds the replayed opens return; calls on
+ * fds whose open failed are skipped.
+ */
+ReplayReport replayTrace(Lab2& lab2, TraceReader& reader, const ReplayOptions& options);
+
+/// Hit ratio, disk traffic and p50/p99/p999 latency per call type
+void printReport(std::ostream& out, ReplayReport& report);
+
+#endif // REPLAYER_HPP
@@ -0,0 +1,150 @@
+#include "TraceGenerators.hpp"
+#include <unistd.h>     // SEEK_SET
+#include <algorithm>    // std::lower_bound, std::shuffle
+#include <cmath>        // std::pow
+#include <numeric>      // std::iota
+#include <random>       // std::mt19937_64
+#include <vector>
+
+namespace {
+
+constexpr int TRACE_FD = 3;
+
+/**
+ * Stamps events with evenly spaced times and writes them; results are what
+ * a call on an intact file returns.
+ */
+class Emitter {
+public:
+    Emitter(TraceWriter& writer, const GeneratorOptions& options) : writer_(writer), options_(options) {}
+
+    void open() {
+        TraceEvent event = make(TraceEvent::Op::OPEN, 0, 0);
+        event.fd = -1;
+        event.result = TRACE_FD;
+        event.path = options_.file;
+        emit(event);
+    }
+    void close() { emit(make(TraceEvent::Op::CLOSE, 0, 0)); }
+    void fsync() { emit(make(TraceEvent::Op::FSYNC, 0, 0)); }
+    void lseek(std::int64_t offset) {
+        TraceEvent event = make(TraceEvent::Op::LSEEK, offset, SEEK_SET);
+        event.result = offset;
+        emit(event);
+    }
+    void transfer(TraceEvent::Op op, std::int64_t offset = 0) {
+        TraceEvent event = make(op, offset, options_.ioSize);
+        event.result = static_cast<std::int64_t>(options_.ioSize);
+        emit(event);
+    }
+
+    /// Writes the whole file once, so that the workload reads real data
+    void fill() {
+        lseek(0);
+        for (std::uint64_t i = 0; i < options_.extent; ++i) {
+            transfer(TraceEvent::Op::WRITE);
+        }
+        fsync();
+    }
+
+private:
+    TraceEvent make(TraceEvent::Op op, std::int64_t offset, std::uint64_t length) const {
+        TraceEvent event;
+        event.op = op;
+        event.fd = TRACE_FD;
+        event.offset = offset;
+        event.length = length;
+        return event;
+    }
+    void emit(TraceEvent event) {
+        event.timeNs = time_;
+        time_ += options_.intervalNs;
+        writer_.record(event);
+    }
+
+    TraceWriter& writer_;
+    const GeneratorOptions& options_;
+    std::uint64_t time_ = 0;
+};
+
+/// Draws ranks 0..n-1 with P(rank) proportional to 1 / (rank + 1)^theta, mapped to scattered units of the file
+class ZipfSampler {
+public:
+    ZipfSampler(std::uint64_t n, double theta, std::mt19937_64& rng) : cdf_(n), units_(n) {
+        double sum = 0;
+        for (std::uint64_t rank = 0; rank < n; ++rank) {
+            sum += 1.0 / std::pow(static_cast<double>(rank + 1), theta);
+            cdf_[rank] = sum;
+        }
+        for (double& value : cdf_) {
+            value /= sum;
+        }
+        std::iota(units_.begin(), units_.end(), 0);
+        std::shuffle(units_.begin(), units_.end(), rng);
+    }
+
+    std::uint64_t operator()(std::mt19937_64& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        auto rank = static_cast<std::size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        return units_[std::min(rank, units_.size() - 1)];
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::vector<std::uint64_t> units_;
+};
+
+std::int64_t offsetOf(std::uint64_t unit, const GeneratorOptions& options) {
+    return static_cast<std::int64_t>(unit * options.ioSize);
+}
+
+} // namespace
+
+void generateZipf(TraceWriter& writer, const GeneratorOptions& options) {
+    std::mt19937_64 rng(options.seed);
+    ZipfSampler zipf(options.extent, options.theta, rng);
+    Emitter emitter(writer, options);
+    emitter.open();
+    emitter.fill();
+    for (std::uint64_t i = 0; i < options.operations; ++i) {
+        emitter.transfer(TraceEvent::Op::PREAD, offsetOf(zipf(rng), options));
+    }
+    emitter.close();
+}
+
+void generateSequential(TraceWriter& writer, const GeneratorOptions& options) {
+    Emitter emitter(writer, options);
+    emitter.open();
+    emitter.fill();
+    emitter.lseek(0);
+    for (std::uint64_t i = 0; i < options.operations; ++i) {
+        if (i > 0 && i % options.extent == 0) {
+            emitter.lseek(0);
+        }
+        emitter.transfer(TraceEvent::Op::READ);
+    }
+    emitter.close();
+}
+
+void generateMixed(TraceWriter& writer, const GeneratorOptions& options) {
+    std::mt19937_64 rng(options.seed);
+    ZipfSampler zipf(options.extent, options.theta, rng);
+    std::bernoulli_distribution isWrite(options.writeRatio);
+    const std::uint64_t scanEvery = std::max<std::uint64_t>(options.operations / 10, 1);
+    const std::uint64_t scanLength = std::max<std::uint64_t>(options.extent / 4, 1);
+    Emitter emitter(writer, options);
+    emitter.open();
+    emitter.fill();
+    for (std::uint64_t i = 0; i < options.operations; ++i) {
+        if (i > 0 && i % scanEvery == 0) {
+            std::uint64_t start = std::uniform_int_distribution<std::uint64_t>(0, options.extent - scanLength)(rng);
+            emitter.lseek(offsetOf(start, options));
+            for (std::uint64_t unit = 0; unit < scanLength; ++unit) {
+                emitter.transfer(TraceEvent::Op::READ);
+            }
+        }
+        emitter.transfer(isWrite(rng) ? TraceEvent::Op::PWRITE : TraceEvent::Op::PREAD, offsetOf(zipf(rng), options));
+    }
+    emitter.fsync();
+    emitter.close();
+}
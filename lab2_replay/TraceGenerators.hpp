@@ -0,0 +1,36 @@
+#ifndef TRACE_GENERATORS_HPP
+#define TRACE_GENERATORS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Trace.hpp"
+
+/// Shape of a synthetic trace; every generator fills the file first, then runs its workload on it
+struct GeneratorOptions {
+    /// File the trace opens
+    std::string file = "lab2_replay.data";
+    /// File size, in units of ioSize
+    std::uint64_t extent = 16384;
+    /// Bytes per read or write
+    std::size_t ioSize = 4096;
+    /// Calls in the workload, not counting the fill
+    std::uint64_t operations = 100000;
+    /// Zipf skew: 0 is uniform, around 1 a few blocks take most accesses
+    double theta = 0.99;
+    /// Share of writes in the mixed workload
+    double writeRatio = 0.3;
+    /// Time between two calls when replayed with the original timing
+    std::uint64_t intervalNs = 10000;
+    std::uint64_t seed = 1;
+};
+
+/// Random preads with Zipf-distributed offsets; the hottest ranks are scattered over the file
+void generateZipf(TraceWriter& writer, const GeneratorOptions& options);
+/// Sequential reads from the start of the file, starting over at its end
+void generateSequential(TraceWriter& writer, const GeneratorOptions& options);
+/// Zipf preads and pwrites (writeRatio of them writes), with a sequential scan of a quarter of the file after every tenth of the calls
+void generateMixed(TraceWriter& writer, const GeneratorOptions& options);
+
+#endif // TRACE_GENERATORS_HPP
@@ -0,0 +1,160 @@
+#include <cstdlib>      // std::strtoull, std::strtod
+#include <cstring>      // strcmp
+#include <exception>    // std::exception
+#include <iostream>
+#include <string>
+
+#include "lab2_library.hpp"
+#include "Replayer.hpp"
+#include "Trace.hpp"
+#include "TraceGenerators.hpp"
+
+namespace {
+
+void usage() {
+    std::cerr <<
+        "Usage:\n"
+        "  lab2_replay generate zipf|sequential|mixed TRACE [--file PATH] [--extent UNITS] [--io-size BYTES]\n"
+        "              [--ops N] [--theta X] [--write-ratio X] [--interval-us N] [--seed N]\n"
+        "  lab2_replay replay TRACE [--capacity BLOCKS] [--block-size BYTES] [--policy clock|2q|arc|lru-k]\n"
+        "              [--timing fast|original] [--dir DIR] [--no-flusher] [--tier-bytes BYTES]\n";
+}
+
+bool parsePolicy(const std::string& name, EvictionPolicy::Kind& kind) {
+    if (name == "clock") {
+        kind = EvictionPolicy::Kind::CLOCK;
+    } else if (name == "2q") {
+        kind = EvictionPolicy::Kind::TWO_Q;
+    } else if (name == "arc") {
+        kind = EvictionPolicy::Kind::ARC;
+    } else if (name == "lru-k") {
+        kind = EvictionPolicy::Kind::LRU_K;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int generate(int argc, char** argv) {
+    if (argc < 4) {
+        usage();
+        return 2;
+    }
+    const std::string workload = argv[2];
+    GeneratorOptions options;
+    for (int i = 4; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 == argc) {
+            usage();
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (flag == "--file") {
+            options.file = value;
+        } else if (flag == "--extent") {
+            options.extent = std::strtoull(value, nullptr, 10);
+        } else if (flag == "--io-size") {
+            options.ioSize = std::strtoull(value, nullptr, 10);
+        } else if (flag == "--ops") {
+            options.operations = std::strtoull(value, nullptr, 10);
+        } else if (flag == "--theta") {
+            options.theta = std::strtod(value, nullptr);
+        } else if (flag == "--write-ratio") {
+            options.writeRatio = std::strtod(value, nullptr);
+        } else if (flag == "--interval-us") {
+            options.intervalNs = std::strtoull(value, nullptr, 10) * 1000;
+        } else if (flag == "--seed") {
+            options.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (options.extent == 0 || options.ioSize == 0) {
+        std::cerr << "--extent and --io-size must be positive\n";
+        return 2;
+    }
+
+    TraceWriter writer(argv[3]);
+    if (workload == "zipf") {
+        generateZipf(writer, options);
+    } else if (workload == "sequential") {
+        generateSequential(writer, options);
+    } else if (workload == "mixed") {
+        generateMixed(writer, options);
+    } else {
+        usage();
+        return 2;
+    }
+    return 0;
+}
+
+int replay(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+    CacheConfig config;
+    config.capacity = 4096;
+    config.blockSize = 4096;
+    ReplayOptions options;
+    for (int i = 3; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag == "--no-flusher") {
+            config.writeback.enabled = false;
+            continue;
+        }
+        if (i + 1 == argc) {
+            usage();
+            return 2;
+        }
+        const std::string value = argv[++i];
+        if (flag == "--capacity") {
+            config.capacity = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (flag == "--block-size") {
+            config.blockSize = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (flag == "--policy") {
+            if (!parsePolicy(value, config.eviction)) {
+                usage();
+                return 2;
+            }
+        } else if (flag == "--tier-bytes") {
+            config.compressedTierBytes = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (flag == "--timing") {
+            options.originalTiming = value == "original";
+        } else if (flag == "--dir") {
+            options.directory = value;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    TraceReader reader(argv[2]);
+    Lab2 lab2(config);
+    ReplayReport report = replayTrace(lab2, reader, options);
+    printReport(std::cout, report);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    try {
+        if (std::strcmp(argv[1], "generate") == 0) {
+            return generate(argc, argv);
+        }
+        if (std::strcmp(argv[1], "replay") == 0) {
+            return replay(argc, argv);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // errno, EIO
+#include <chrono>       // std::chrono::steady_clock
+#include <cstdint>      // INT64_MAX
+#include <cstring>      // memcmp, memset
+#include <fcntl.h>      // ::open
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <thread>       // std::this_thread::sleep_for
+#include <unistd.h>     // pread, close
+#include <vector>       // std::vector
+
+#include "BlockCache.hpp"
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+/// Writes `blocks` blocks of 'a', 'b', ... through a throwaway Lab2
+void writeBlocks(const std::string& path, size_t blocks) {
+    Lab2 writer(4, BLOCK);
+    fd_t fd = writer.open(path);
+    std::vector<char> block(BLOCK);
+    for (size_t b = 0; b < blocks; ++b) {
+        std::memset(block.data(), 'a' + static_cast<int>(b % 26), BLOCK);
+        writer.write(fd, block.data(), BLOCK);
+    }
+    writer.close(fd);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, RejectsBadArguments) {
+    Lab2 lab2(4, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+
+    ASSERT_EQ(lab2.advice(fd, -1, 0, LAB2_ADVICE_WILLNEED), -1);
+    ASSERT_EQ(errno, EINVAL);
+    ASSERT_EQ(lab2.advice(fd + 1000, 0, 0, LAB2_ADVICE_WILLNEED), -1);
+    ASSERT_EQ(errno, EBADF);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, RangesPastTheLargestOffsetRunToTheEnd) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeBlocks(tempFile, 4);
+
+    Lab2 lab2(8, BLOCK);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> buffer(4 * BLOCK);
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 0), static_cast<ssize_t>(buffer.size()));
+
+    // offset + len would overflow off_t
+    for (access_hint_t hint : {LAB2_ADVICE_WILLNEED, LAB2_ADVICE_NOREUSE, LAB2_ADVICE_DONTNEED}) {
+        ASSERT_EQ(lab2.advice(fd, INT64_MAX - 10, 100, hint), 0);
+    }
+    uint64_t before = lab2.stats().misses;
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 0), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(lab2.stats().misses, before) << "Nothing below the range should have been dropped.";
+
+    // Everything from block 1 on, as with len == 0
+    ASSERT_EQ(lab2.advice(fd, BLOCK, INT64_MAX, LAB2_ADVICE_DONTNEED), 0);
+    before = lab2.stats().misses;
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 0), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(lab2.stats().misses - before, 3u);
+    ASSERT_EQ(buffer[3 * BLOCK], 'd');
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, RandomDisablesReadahead) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeBlocks(tempFile, 16);
+
+    Lab2 lab2(16, BLOCK);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_EQ(lab2.advice(fd, 0, 0, LAB2_ADVICE_RANDOM), 0);
+
+    std::vector<char> buffer(BLOCK);
+    for (int b = 0; b < 16; ++b) {
+        ASSERT_EQ(lab2.read(fd, buffer.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+    }
+    ASSERT_EQ(lab2.readaheadStats().issued, 0u) << "RANDOM advice must turn readahead off.";
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, WillNeedPrefetchesRange) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeBlocks(tempFile, 8);
+
+    Lab2 lab2(16, BLOCK);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_EQ(lab2.advice(fd, 2 * BLOCK, 4 * BLOCK, LAB2_ADVICE_WILLNEED), 0);
+
+    // Prefetching is asynchronous
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (lab2.readaheadStats().issued < 4 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(lab2.readaheadStats().issued, 4u);
+
+    std::vector<char> buffer(BLOCK);
+    lab2.lseek(fd, 3 * BLOCK, SEEK_SET);
+    ASSERT_EQ(lab2.read(fd, buffer.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(buffer[0], 'd');
+    ASSERT_EQ(lab2.readaheadStats().hits, 1u);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, DontNeedWritesBackImmediately) {
+    Lab2 lab2(4, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    std::vector<char> data(BLOCK, 'z');
+    ASSERT_EQ(lab2.write(fd, data.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.advice(fd, 0, BLOCK, LAB2_ADVICE_DONTNEED), 0);
+
+    // No fsync or close: the data must already be on disk
+    int rawFd = ::open(tempFile.c_str(), O_RDONLY);
+    ASSERT_GE(rawFd, 0);
+    std::vector<char> onDisk(BLOCK);
+    ASSERT_EQ(::pread(rawFd, onDisk.data(), BLOCK, 0), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(std::memcmp(onDisk.data(), data.data(), BLOCK), 0);
+    ::close(rawFd);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, DontNeedKeepsBlocksItCannotWriteBack) {
+    CacheConfig config;
+    config.capacity = 4;
+    config.blockSize = BLOCK;
+    config.writeback.enabled = false;
+    Lab2 lab2(config);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> data(BLOCK, 'k');
+    ASSERT_EQ(lab2.pwrite(fd, data.data(), BLOCK, 2 * BLOCK), static_cast<ssize_t>(BLOCK));
+
+    int result;
+    int error;
+    {
+        FileSizeLimit limit(BLOCK);
+        result = lab2.advice(fd, 0, 0, LAB2_ADVICE_DONTNEED);
+        error = errno;
+    }
+    ASSERT_EQ(result, -1);
+    ASSERT_EQ(error, EIO);
+
+    // Still cached, and still dirty: the next sync gets it to disk
+    std::vector<char> buffer(BLOCK);
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, 2 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(buffer, data);
+    ASSERT_EQ(lab2.fsync(fd), 0);
+    int rawFd = ::open(tempFile.c_str(), O_RDONLY);
+    ASSERT_GE(rawFd, 0);
+    ASSERT_EQ(::pread(rawFd, buffer.data(), BLOCK, 2 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(buffer, data);
+    ::close(rawFd);
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, FlushReportsFailedWriteBackInsteadOfWaiting) {
+    const std::string tempFile = makeUniqueTempFile();
+    // Read-only: every write-back fails
+    int fd = ::open(tempFile.c_str(), O_RDONLY | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    BlockCache cache(4, BLOCK);
+    std::vector<char> data(BLOCK, 'f');
+    ASSERT_TRUE(cache.overwrite(fd, 0, data.data()));
+    ASSERT_FALSE(cache.flushFd(fd));
+    ASSERT_EQ(errno, EIO);
+    ASSERT_TRUE(cache.contains(fd, 0));
+    ASSERT_EQ(cache.dirtyCount(), 1u);
+
+    cache.discardFd(fd);
+    ASSERT_FALSE(cache.contains(fd, 0));
+    ASSERT_EQ(cache.dirtyCount(), 0u);
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(AdviceTests, NoReuseBlocksAreEvictedFirst) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeBlocks(tempFile, 3);
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    BlockCache cache(2, BLOCK);
+    cache.acquire(fd, 0);                        // hot block
+    cache.acquire(fd, 1, /* noReuse = */ true);  // streamed through once
+    cache.acquire(fd, 2);                        // needs a slot
+
+    ASSERT_TRUE(cache.contains(fd, 0)) << "The referenced block should survive.";
+    ASSERT_FALSE(cache.contains(fd, 1)) << "The NOREUSE block should be the victim.";
+    ASSERT_TRUE(cache.contains(fd, 2));
+
+    cache.flushFd(fd);
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
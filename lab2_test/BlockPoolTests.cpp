@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstdint>      // std::uintptr_t
+#include <cstring>      // memset, strlen
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+#include "BlockPool.hpp"
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+//------------------------------------------------------------------------------
+TEST(BlockPoolTests, BuffersAreAlignedAndDisjoint) {
+    // 5000 is not a multiple of the alignment, so the stride must round up
+    BlockPool pool(16, 5000, BlockPool::PageMode::NORMAL);
+    ASSERT_EQ(pool.stride(), 8192u);
+
+    for (std::size_t i = 0; i < pool.count(); ++i) {
+        auto address = reinterpret_cast<std::uintptr_t>(pool.buffer(i));
+        ASSERT_EQ(address % BlockPool::ALIGNMENT, 0u) << "Buffer " << i << " is not aligned.";
+        // Touch the whole buffer: ASan or a segfault would catch an overlap or short mapping
+        std::memset(pool.buffer(i), static_cast<int>(i), 5000);
+    }
+    for (std::size_t i = 0; i < pool.count(); ++i) {
+        ASSERT_EQ(static_cast<unsigned char*>(pool.buffer(i))[4999], static_cast<unsigned char>(i));
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockPoolTests, ExplicitHugePagesFallBack) {
+    // Works whether or not the machine has reserved huge pages
+    BlockPool pool(4, 4096, BlockPool::PageMode::EXPLICIT_HUGE);
+    std::memset(pool.buffer(3), 0xAB, 4096);
+    ASSERT_EQ(static_cast<unsigned char*>(pool.buffer(3))[4095], 0xAB);
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockPoolTests, ReusedBufferIsZeroFilledPastEof) {
+    // A single slot: the second file's block reuses the first file's buffer
+    Lab2 lab2(1, 4096);
+    const std::string fullFile = makeUniqueTempFile();
+    const std::string shortFile = makeUniqueTempFile();
+
+    fd_t fullFd = lab2.open(fullFile);
+    ASSERT_GE(fullFd, 0);
+    std::vector<char> junk(4096, 'x');
+    ASSERT_EQ(lab2.write(fullFd, junk.data(), junk.size()), 4096);
+
+    fd_t shortFd = lab2.open(shortFile);
+    ASSERT_GE(shortFd, 0);
+    const char *msg = "short";
+    ASSERT_EQ(lab2.write(shortFd, msg, std::strlen(msg)), static_cast<ssize_t>(std::strlen(msg)));
+    // Reads stop at EOF, so end the file with the block to see what lies between
+    ASSERT_EQ(lab2.lseek(shortFd, 4095, SEEK_SET), 4095);
+    ASSERT_EQ(lab2.write(shortFd, "!", 1), 1);
+
+    std::vector<char> buffer(4096, '?');
+    ASSERT_EQ(lab2.lseek(shortFd, 0, SEEK_SET), 0);
+    ASSERT_EQ(lab2.read(shortFd, buffer.data(), buffer.size()), 4096);
+    ASSERT_EQ(std::strncmp(buffer.data(), msg, std::strlen(msg)), 0);
+    ASSERT_EQ(buffer[4095], '!');
+    for (size_t i = std::strlen(msg); i < buffer.size() - 1; ++i) {
+        ASSERT_EQ(buffer[i], '\0') << "Stale data from the previous block at offset " << i;
+    }
+
+    lab2.close(shortFd);
+    lab2.close(fullFd);
+    std::filesystem::remove(shortFile);
+    std::filesystem::remove(fullFile);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // errno, EIO
+#include <cstring>      // memset
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t LARGE = 64 << 10;
+constexpr size_t SMALL = 4 << 10;
+
+/// 1 MiB shared half and half: 8 large blocks and 128 small ones
+CacheConfig twoSizes() {
+    CacheConfig config;
+    config.capacityBytes = 1 << 20;
+    config.blockSize = LARGE;
+    config.smallBlocks.blockSize = SMALL;
+    config.smallBlocks.share = 0.5;
+    config.writeback.enabled = false;
+    return config;
+}
+
+/// Fills a file of `bytes` through a throwaway Lab2, byte i being 'a' + i % 26
+void writeFile(const std::string& path, size_t bytes) {
+    Lab2 writer(4, LARGE);
+    fd_t fd = writer.open(path);
+    std::vector<char> data(bytes);
+    for (size_t i = 0; i < bytes; ++i) {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    writer.write(fd, data.data(), data.size());
+    writer.close(fd);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(BlockSizeTests, BudgetIsSplitInBytes) {
+    Lab2 lab2(twoSizes());
+    const std::string text = lab2.metrics();
+    ASSERT_NE(text.find("lab2_cache_capacity_blocks{block_bytes=\"65536\"} 8\n"), std::string::npos) << text;
+    ASSERT_NE(text.find("lab2_cache_capacity_blocks{block_bytes=\"4096\"} 128\n"), std::string::npos) << text;
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockSizeTests, SmallFilesReadSmallBlocks) {
+    const std::string smallFile = makeUniqueTempFile();
+    const std::string largeFile = makeUniqueTempFile();
+    writeFile(smallFile, 3 * SMALL);
+    writeFile(largeFile, 4 * LARGE);
+
+    Lab2 lab2(twoSizes());
+    std::vector<char> buffer(16);
+    fd_t small = lab2.open(smallFile);
+    ASSERT_GE(small, 0);
+    ASSERT_EQ(lab2.pread(small, buffer.data(), 1, 5000), 1);
+    ASSERT_EQ(buffer[0], 'a' + 5000 % 26);
+    ASSERT_EQ(lab2.stats().bytesRead, SMALL);
+
+    fd_t large = lab2.open(largeFile);
+    ASSERT_GE(large, 0);
+    ASSERT_EQ(lab2.pread(large, buffer.data(), 1, 100000), 1);
+    ASSERT_EQ(buffer[0], 'a' + 100000 % 26);
+    ASSERT_EQ(lab2.stats().bytesRead, SMALL + LARGE);
+
+    ASSERT_EQ(lab2.close(small), 0);
+    ASSERT_EQ(lab2.close(large), 0);
+    std::filesystem::remove(smallFile);
+    std::filesystem::remove(largeFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockSizeTests, AdviceMovesTheFileWithItsData) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeFile(tempFile, 4 * LARGE);
+
+    Lab2 lab2(twoSizes());
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    // Dirty in a large block, then moved to small ones
+    ASSERT_EQ(lab2.pwrite(fd, "XYZ", 3, LARGE + 10), 3);
+    ASSERT_EQ(lab2.advice(fd, 0, LAB2_ADVICE_RANDOM), 0);
+
+    const uint64_t before = lab2.stats().bytesRead;
+    char buffer[3];
+    ASSERT_EQ(lab2.pread(fd, buffer, 3, LARGE + 10), 3);
+    ASSERT_EQ(std::memcmp(buffer, "XYZ", 3), 0);
+    ASSERT_EQ(lab2.stats().bytesRead - before, SMALL);
+
+    // And back to large blocks for streaming
+    ASSERT_EQ(lab2.pwrite(fd, "Q", 1, 3 * LARGE), 1);
+    ASSERT_EQ(lab2.advice(fd, 0, LAB2_ADVICE_SEQUENTIAL), 0);
+    ASSERT_EQ(lab2.pread(fd, buffer, 1, 3 * LARGE), 1);
+    ASSERT_EQ(buffer[0], 'Q');
+    ASSERT_EQ(lab2.pread(fd, buffer, 3, LARGE + 10), 3);
+    ASSERT_EQ(std::memcmp(buffer, "XYZ", 3), 0);
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockSizeTests, AdviceLeavesAFileWithViewsWhereItIs) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeFile(tempFile, 4 * LARGE);
+
+    Lab2 lab2(twoSizes());
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    // Moving the file would wait for the view's pins forever
+    Lab2::ReadView view = lab2.acquireRead(fd, LARGE, 16);
+    ASSERT_TRUE(view);
+    ASSERT_EQ(lab2.advice(fd, 0, LAB2_ADVICE_RANDOM), 0);
+    ASSERT_EQ(view.spans()[0][0], static_cast<char>('a' + LARGE % 26));
+
+    char buffer[1];
+    uint64_t before = lab2.stats().bytesRead;
+    ASSERT_EQ(lab2.pread(fd, buffer, 1, 2 * LARGE), 1);
+    ASSERT_EQ(lab2.stats().bytesRead - before, LARGE) << "The file should still be in large blocks.";
+
+    // Once the view is gone the advice takes effect
+    view.release();
+    ASSERT_EQ(lab2.advice(fd, 0, LAB2_ADVICE_RANDOM), 0);
+    before = lab2.stats().bytesRead;
+    ASSERT_EQ(lab2.pread(fd, buffer, 1, 3 * LARGE), 1);
+    ASSERT_EQ(buffer[0], static_cast<char>('a' + 3 * LARGE % 26));
+    ASSERT_EQ(lab2.stats().bytesRead - before, SMALL);
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(BlockSizeTests, FailedMoveLeavesTheFileWhereItIs) {
+    const std::string tempFile = makeUniqueTempFile();
+    writeFile(tempFile, 4 * LARGE);
+
+    Lab2 lab2(twoSizes());
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(lab2.pwrite(fd, "XYZ", 3, 2 * LARGE + 10), 3);
+
+    int result;
+    int error;
+    {
+        FileSizeLimit limit(LARGE);
+        result = lab2.advice(fd, 0, LAB2_ADVICE_RANDOM);
+        error = errno;
+    }
+    ASSERT_EQ(result, -1);
+    ASSERT_EQ(error, EIO);
+
+    // Still in large blocks, with the write
+    char buffer[3];
+    const uint64_t before = lab2.stats().bytesRead;
+    ASSERT_EQ(lab2.pread(fd, buffer, 3, 2 * LARGE + 10), 3);
+    ASSERT_EQ(std::memcmp(buffer, "XYZ", 3), 0);
+    ASSERT_EQ(lab2.pread(fd, buffer, 1, 3 * LARGE), 1);
+    ASSERT_EQ(lab2.stats().bytesRead - before, LARGE);
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
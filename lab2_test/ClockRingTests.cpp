@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <set>          // std::set
+
+#include "ClockRing.hpp"
+
+//------------------------------------------------------------------------------
+TEST(ClockRingTests, InsertUntilFull) {
+    ClockRing ring(130); // spans three bitmap words
+
+    std::set<std::size_t> slots;
+    for (std::size_t i = 0; i < ring.capacity(); ++i) {
+        std::size_t slot = ring.insert();
+        ASSERT_NE(slot, ClockRing::npos);
+        ASSERT_TRUE(slots.insert(slot).second) << "Slot " << slot << " handed out twice.";
+    }
+    ASSERT_TRUE(ring.full());
+    ASSERT_EQ(ring.insert(), ClockRing::npos) << "Full ring must not hand out a slot.";
+
+    ring.remove(77);
+    ASSERT_EQ(ring.insert(), 77u) << "Freed slot should be reused.";
+}
+
+//------------------------------------------------------------------------------
+TEST(ClockRingTests, SecondChance) {
+    ClockRing ring(4);
+    for (int i = 0; i < 4; ++i) {
+        ring.insert(/* referenced = */ true);
+    }
+
+    // Everything referenced: the first sweep clears all bits and stops at slot 0
+    ASSERT_EQ(ring.nextVictim(), 0u);
+    ASSERT_FALSE(ring.isReferenced(3));
+
+    // Slot 1 is touched again, so it survives the next sweep
+    ring.reference(1);
+    ASSERT_EQ(ring.nextVictim(), 2u);
+    ASSERT_FALSE(ring.isReferenced(1));
+}
+
+//------------------------------------------------------------------------------
+TEST(ClockRingTests, VictimSkipsFreeSlots) {
+    ClockRing ring(200);
+    for (int i = 0; i < 200; ++i) {
+        ring.insert(/* referenced = */ false);
+    }
+    for (std::size_t slot = 0; slot < 199; ++slot) {
+        ring.remove(slot);
+    }
+    ASSERT_EQ(ring.size(), 1u);
+    ASSERT_EQ(ring.nextVictim(), 199u);
+    ring.remove(199);
+    ASSERT_EQ(ring.nextVictim(), ClockRing::npos);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <cstring>      // memcmp
+#include <fcntl.h>      // ::open
+#include <filesystem>   // std::filesystem::remove
+#include <random>       // std::mt19937
+#include <string>       // std::string
+#include <unistd.h>     // pwrite, close
+#include <vector>       // std::vector
+
+#include "BlockCache.hpp"
+#include "Compression.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+/// Text-like contents that LZ4 shrinks well, different for every seed
+std::vector<char> compressibleBlock(unsigned seed) {
+    std::vector<char> data(BLOCK);
+    const std::string line = "block " + std::to_string(seed) + ": the quick brown fox jumps over the lazy dog\n";
+    for (size_t i = 0; i < BLOCK; ++i) {
+        data[i] = line[i % line.size()];
+    }
+    return data;
+}
+
+std::vector<char> randomBlock(unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<char> data(BLOCK);
+    for (char& c : data) {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+bool roundTrips(const std::vector<char>& data) {
+    std::vector<unsigned char> compressed(compressBound(data.size()));
+    const size_t size = compressBlock(data.data(), data.size(), compressed.data(), compressed.size());
+    if (size == 0) {
+        return false;
+    }
+    std::vector<char> restored(data.size());
+    return decompressBlock(compressed.data(), size, restored.data(), restored.size()) && restored == data;
+}
+
+/// A cache of two blocks over a file of `blocks` written with the given contents
+struct TierFixture {
+    std::string path = makeUniqueTempFile();
+    int fd = ::open(path.c_str(), O_RDWR | O_DIRECT);
+    BlockCache cache{2, BLOCK, BlockCache::DEFAULT_SHARD_COUNT, BlockPool::PageMode::NORMAL, IoBackend::Kind::SYNC};
+
+    explicit TierFixture(const std::vector<std::vector<char>>& blocks) {
+        int plainFd = ::open(path.c_str(), O_WRONLY);
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            (void) ::pwrite(plainFd, blocks[i].data(), BLOCK, static_cast<off_t>(i * BLOCK));
+        }
+        ::close(plainFd);
+        cache.setCompressedTier(64 * BLOCK);
+    }
+
+    ~TierFixture() {
+        cache.flushFd(fd);
+        ::close(fd);
+        std::filesystem::remove(path);
+    }
+
+    /// Reads every block once, so that all but the last two are evicted
+    void readAll(size_t blocks) {
+        for (size_t i = 0; i < blocks; ++i) {
+            ASSERT_TRUE(cache.acquire(fd, static_cast<off_t>(i)));
+        }
+    }
+
+    bool holds(off_t blockIndex, const std::vector<char>& expected) {
+        BlockCache::Handle handle = cache.acquire(fd, blockIndex);
+        return handle && std::memcmp(handle.data(), expected.data(), BLOCK) == 0;
+    }
+};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(CompressedTierTests, CodecRoundTrips) {
+    ASSERT_TRUE(roundTrips({}));
+    for (size_t size = 1; size < 40; ++size) {
+        ASSERT_TRUE(roundTrips(std::vector<char>(size, 'z'))) << size;
+    }
+    ASSERT_TRUE(roundTrips(std::vector<char>(1 << 20, 0)));
+    ASSERT_TRUE(roundTrips(compressibleBlock(1)));
+    ASSERT_TRUE(roundTrips(randomBlock(1)));
+
+    // Matches longer than their offset, literals and matches long enough for extra length bytes
+    std::vector<char> mixed = randomBlock(2);
+    mixed.insert(mixed.end(), 1000, 'a');
+    std::vector<char> pattern = compressibleBlock(3);
+    mixed.insert(mixed.end(), pattern.begin(), pattern.end());
+    ASSERT_TRUE(roundTrips(mixed));
+}
+
+//------------------------------------------------------------------------------
+TEST(CompressedTierTests, CodecRefusesWhatDoesNotFit) {
+    const std::vector<char> random = randomBlock(4);
+    std::vector<unsigned char> compressed(BLOCK * 3 / 4);
+    ASSERT_EQ(compressBlock(random.data(), random.size(), compressed.data(), compressed.size()), 0u);
+
+    const std::vector<char> text = compressibleBlock(5);
+    const size_t size = compressBlock(text.data(), text.size(), compressed.data(), compressed.size());
+    ASSERT_GT(size, 0u);
+    ASSERT_LT(size, BLOCK / 4);
+
+    std::vector<char> restored(BLOCK);
+    ASSERT_FALSE(decompressBlock(compressed.data(), size - 1, restored.data(), restored.size()));
+    ASSERT_FALSE(decompressBlock(compressed.data(), size, restored.data(), restored.size() - 1));
+}
+
+//------------------------------------------------------------------------------
+TEST(CompressedTierTests, EvictedBlocksComeBackWithoutDiskReads) {
+    constexpr size_t BLOCKS = 6;
+    std::vector<std::vector<char>> blocks;
+    for (unsigned i = 0; i < BLOCKS; ++i) {
+        blocks.push_back(compressibleBlock(i));
+    }
+    TierFixture fixture(blocks);
+    fixture.readAll(BLOCKS);
+    const CacheStats before = fixture.cache.stats();
+    ASSERT_EQ(before.tierStored, BLOCKS - 2);
+    ASSERT_GT(before.tierRawBytes, 4 * before.tierCompressedBytes);
+
+    for (off_t i = 0; i < static_cast<off_t>(BLOCKS); ++i) {
+        ASSERT_TRUE(fixture.holds(i, blocks[static_cast<size_t>(i)])) << "Block " << i;
+    }
+    const CacheStats after = fixture.cache.stats();
+    ASSERT_EQ(after.bytesRead, before.bytesRead) << "Every miss should have been served by the tier.";
+    ASSERT_EQ(after.tierHits, BLOCKS);
+    ASSERT_EQ(after.misses - before.misses, BLOCKS);
+}
+
+//------------------------------------------------------------------------------
+TEST(CompressedTierTests, IncompressibleBlocksAreNotKept) {
+    constexpr size_t BLOCKS = 4;
+    std::vector<std::vector<char>> blocks;
+    for (unsigned i = 0; i < BLOCKS; ++i) {
+        blocks.push_back(randomBlock(i));
+    }
+    TierFixture fixture(blocks);
+    fixture.readAll(BLOCKS);
+    ASSERT_EQ(fixture.cache.stats().tierRejected, BLOCKS - 2);
+    ASSERT_EQ(fixture.cache.compressedTier()->size(), 0u);
+
+    ASSERT_TRUE(fixture.holds(0, blocks[0]));
+    const CacheStats stats = fixture.cache.stats();
+    ASSERT_EQ(stats.tierHits, 0u);
+    ASSERT_EQ(stats.bytesRead, (BLOCKS + 1) * BLOCK);
+}
+
+//------------------------------------------------------------------------------
+TEST(CompressedTierTests, DroppedAndOverwrittenBlocksLeaveTheTier) {
+    constexpr size_t BLOCKS = 4;
+    std::vector<std::vector<char>> blocks;
+    for (unsigned i = 0; i < BLOCKS; ++i) {
+        blocks.push_back(compressibleBlock(i));
+    }
+    TierFixture fixture(blocks);
+    fixture.readAll(BLOCKS);
+    ASSERT_EQ(fixture.cache.compressedTier()->size(), BLOCKS - 2);
+
+    // A whole-block write replaces what the tier holds; the block evicted to make room takes its place there
+    const std::vector<char> replacement = compressibleBlock(100);
+    ASSERT_TRUE(fixture.cache.overwrite(fixture.fd, 0, replacement.data()));
+    ASSERT_EQ(fixture.cache.compressedTier()->size(), BLOCKS - 2);
+    fixture.readAll(BLOCKS);
+    ASSERT_TRUE(fixture.holds(0, replacement));
+
+    // After a drop, a change made behind the cache's back shows
+    fixture.cache.flushFd(fixture.fd);
+    ASSERT_EQ(fixture.cache.compressedTier()->size(), 0u);
+    const std::vector<char> changed = compressibleBlock(200);
+    int plainFd = ::open(fixture.path.c_str(), O_WRONLY);
+    ASSERT_EQ(::pwrite(plainFd, changed.data(), BLOCK, BLOCK), static_cast<ssize_t>(BLOCK));
+    ::close(plainFd);
+    ASSERT_TRUE(fixture.holds(1, changed));
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <atomic>       // std::atomic
+#include <cstring>      // memcmp
+#include <fcntl.h>      // ::open
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <thread>       // std::thread
+#include <unistd.h>     // pwrite, close
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t STRESS_BLOCK_SIZE = 4096;
+
+void fillPattern(std::vector<char>& buffer, int thread, int block) {
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<char>(thread * 31 + block * 7 + i);
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(ConcurrencyTests, ThreadsOnDistinctFilesShareOneCache) {
+    constexpr int THREADS = 8;
+    constexpr int BLOCKS_PER_THREAD = 24;
+    // Far fewer slots than blocks in flight, so threads keep evicting each other
+    Lab2 lab2(8, STRESS_BLOCK_SIZE);
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&lab2, &failures, t] {
+            const std::string tempFile = makeUniqueTempFile();
+            fd_t fd = lab2.open(tempFile);
+            if (fd < 0) {
+                ++failures;
+                return;
+            }
+
+            std::vector<char> expected(STRESS_BLOCK_SIZE);
+            std::vector<char> actual(STRESS_BLOCK_SIZE);
+            for (int b = 0; b < BLOCKS_PER_THREAD; ++b) {
+                fillPattern(expected, t, b);
+                if (lab2.write(fd, expected.data(), expected.size()) != static_cast<ssize_t>(expected.size())) {
+                    ++failures;
+                }
+            }
+
+            // Read back twice, in reverse order, while the other threads churn the cache
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int b = BLOCKS_PER_THREAD - 1; b >= 0; --b) {
+                    fillPattern(expected, t, b);
+                    lab2.lseek(fd, static_cast<off_t>(b) * STRESS_BLOCK_SIZE, SEEK_SET);
+                    if (lab2.read(fd, actual.data(), actual.size()) != static_cast<ssize_t>(actual.size())
+                        || std::memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+                        ++failures;
+                    }
+                }
+            }
+
+            if (lab2.close(fd) != 0) {
+                ++failures;
+            }
+            std::filesystem::remove(tempFile);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(failures.load(), 0) << "Some thread read back data it did not write.";
+}
+
+//------------------------------------------------------------------------------
+TEST(ConcurrencyTests, WritesOnSharedFdDoNotInterleave) {
+    constexpr int THREADS = 4;
+    constexpr int RECORDS_PER_THREAD = 64;
+    constexpr size_t RECORD_SIZE = 1000; // records straddle block boundaries
+    Lab2 lab2(4, STRESS_BLOCK_SIZE);
+    const std::string tempFile = makeUniqueTempFile();
+
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0) << "Failed to open temp file for shared fd test.";
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&lab2, fd, t] {
+            std::vector<char> record(RECORD_SIZE, static_cast<char>('A' + t));
+            for (int r = 0; r < RECORDS_PER_THREAD; ++r) {
+                lab2.write(fd, record.data(), record.size());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Every record must be made of a single thread's byte
+    const size_t total = THREADS * RECORDS_PER_THREAD * RECORD_SIZE;
+    std::vector<char> buffer(total);
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(lab2.read(fd, buffer.data(), total), static_cast<ssize_t>(total));
+
+    std::vector<int> recordsPerThread(THREADS, 0);
+    for (size_t offset = 0; offset < total; offset += RECORD_SIZE) {
+        char owner = buffer[offset];
+        ASSERT_GE(owner, 'A');
+        ASSERT_LT(owner, 'A' + THREADS);
+        for (size_t i = 1; i < RECORD_SIZE; ++i) {
+            ASSERT_EQ(buffer[offset + i], owner) << "Record at offset " << offset << " is interleaved.";
+        }
+        ++recordsPerThread[owner - 'A'];
+    }
+    for (int t = 0; t < THREADS; ++t) {
+        ASSERT_EQ(recordsPerThread[t], RECORDS_PER_THREAD);
+    }
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ConcurrencyTests, PreadsOnOneFileFromManyThreads) {
+    constexpr int THREADS = 8;
+    constexpr int BLOCKS = 64;
+    const std::string tempFile = makeUniqueTempFile();
+    {
+        int rawFd = ::open(tempFile.c_str(), O_WRONLY);
+        ASSERT_GE(rawFd, 0);
+        std::vector<char> block(STRESS_BLOCK_SIZE);
+        for (int b = 0; b < BLOCKS; ++b) {
+            fillPattern(block, 0, b);
+            ASSERT_EQ(::pwrite(rawFd, block.data(), block.size(), static_cast<off_t>(b) * STRESS_BLOCK_SIZE),
+                      static_cast<ssize_t>(block.size()));
+        }
+        ::close(rawFd);
+    }
+
+    // Fewer slots than blocks, so that the threads keep missing while the others read
+    Lab2 lab2(16, STRESS_BLOCK_SIZE);
+    fd_t sharedFd = lab2.open(tempFile);
+    ASSERT_GE(sharedFd, 0);
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&lab2, &failures, &tempFile, sharedFd, t] {
+            // Half the threads share one fd; the others open the file again
+            const fd_t fd = t % 2 == 0 ? sharedFd : lab2.open(tempFile);
+            std::vector<char> expected(STRESS_BLOCK_SIZE);
+            std::vector<char> actual(STRESS_BLOCK_SIZE);
+            for (int pass = 0; pass < 4; ++pass) {
+                for (int i = 0; i < BLOCKS; ++i) {
+                    const int b = (i * 7 + t * 5 + pass) % BLOCKS;
+                    fillPattern(expected, 0, b);
+                    if (lab2.pread(fd, actual.data(), actual.size(), static_cast<off_t>(b) * STRESS_BLOCK_SIZE)
+                            != static_cast<ssize_t>(actual.size())
+                        || std::memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+                        ++failures;
+                    }
+                }
+            }
+            if (fd != sharedFd && lab2.close(fd) != 0) {
+                ++failures;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(failures.load(), 0) << "Some pread() returned the wrong bytes.";
+    ASSERT_GT(lab2.stats().misses, 0u);
+    ASSERT_EQ(lab2.close(sharedFd), 0);
+    std::filesystem::remove(tempFile);
+}
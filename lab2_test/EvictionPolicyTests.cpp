@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>      // open, O_DIRECT
+#include <unistd.h>     // close
+#include <cstring>      // memset
+#include <filesystem>   // std::filesystem::remove
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937
+#include <set>          // std::set
+#include <string>       // std::string
+#include <unordered_map>
+#include <vector>       // std::vector
+
+#include "BlockCache.hpp"
+#include "EvictionPolicy.hpp"
+#include "PolicyLists.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+std::string kindName(const testing::TestParamInfo<EvictionPolicy::Kind>& info) {
+    switch (info.param) {
+    case EvictionPolicy::Kind::CLOCK:
+        return "Clock";
+    case EvictionPolicy::Kind::TWO_Q:
+        return "TwoQ";
+    case EvictionPolicy::Kind::ARC:
+        return "Arc";
+    default:
+        return "LruK";
+    }
+}
+
+/// Drives a policy the way BlockCache does, without any blocks behind it
+class Simulation {
+public:
+    Simulation(EvictionPolicy::Kind kind, size_t capacity)
+        : policy_(EvictionPolicy::create(kind, capacity)), keys_(capacity) {}
+
+    /// Returns whether key was cached
+    bool access(off_t block) {
+        CacheKey key{3, block};
+        auto it = slots_.find(key);
+        if (it != slots_.end()) {
+            policy_->reference(it->second);
+            return true;
+        }
+        size_t slot = policy_->insert(key);
+        if (slot == EvictionPolicy::npos) {
+            slot = policy_->nextVictim();
+            slots_.erase(keys_[slot]);
+            policy_->replace(slot, key);
+        }
+        keys_[slot] = key;
+        slots_[key] = slot;
+        return false;
+    }
+
+private:
+    std::unique_ptr<EvictionPolicy> policy_;
+    std::vector<CacheKey> keys_;
+    std::unordered_map<CacheKey, size_t> slots_;
+};
+
+} // namespace
+
+class EvictionPolicyTests : public testing::TestWithParam<EvictionPolicy::Kind> {};
+
+//------------------------------------------------------------------------------
+TEST_P(EvictionPolicyTests, HandsOutEverySlotOnce) {
+    std::unique_ptr<EvictionPolicy> policy = EvictionPolicy::create(GetParam(), 70);
+
+    std::set<size_t> slots;
+    for (off_t block = 0; block < 70; ++block) {
+        size_t slot = policy->insert({1, block});
+        ASSERT_LT(slot, 70u);
+        ASSERT_TRUE(slots.insert(slot).second) << "Slot " << slot << " handed out twice.";
+    }
+    ASSERT_EQ(policy->size(), 70u);
+    ASSERT_EQ(policy->insert({1, 70}), EvictionPolicy::npos) << "Full policy must not hand out a slot.";
+
+    policy->remove(42);
+    ASSERT_EQ(policy->size(), 69u);
+    ASSERT_EQ(policy->insert({1, 71}), 42u) << "Freed slot should be reused.";
+}
+
+//------------------------------------------------------------------------------
+TEST_P(EvictionPolicyTests, CandidatesMoveOnUntilReplaced) {
+    std::unique_ptr<EvictionPolicy> policy = EvictionPolicy::create(GetParam(), 8);
+    ASSERT_EQ(policy->nextVictim(), EvictionPolicy::npos);
+    for (off_t block = 0; block < 8; ++block) {
+        policy->insert({1, block});
+    }
+
+    // BlockCache passes over pinned candidates and asks again
+    std::set<size_t> candidates;
+    for (int i = 0; i < 8; ++i) {
+        size_t slot = policy->nextVictim();
+        ASSERT_LT(slot, 8u);
+        candidates.insert(slot);
+    }
+    ASSERT_GT(candidates.size(), 1u) << "The same candidate came back every time.";
+
+    size_t slot = policy->nextVictim();
+    policy->replace(slot, {1, 100});
+    ASSERT_EQ(policy->size(), 8u);
+    policy->remove(slot);
+    ASSERT_EQ(policy->insert({1, 101}), slot);
+}
+
+//------------------------------------------------------------------------------
+TEST_P(EvictionPolicyTests, HotSetSurvivesScans) {
+    constexpr size_t CAPACITY = 64;
+    constexpr off_t HOT = 16;
+    if (GetParam() == EvictionPolicy::Kind::CLOCK) {
+        GTEST_SKIP() << "Clock is not scan-resistant; it is here for the other tests";
+    }
+    Simulation simulation(GetParam(), CAPACITY);
+
+    // Each round touches the hot set and a few blocks never seen again; every
+    // eighth round is followed by a scan twice the size of the cache
+    off_t cold = 1000;
+    size_t hotHits = 0;
+    size_t hotAfterScan = 0;
+    for (int round = 0; round < 64; ++round) {
+        bool afterScan = round > 8 && round % 8 == 1;
+        for (off_t block = 0; block < HOT; ++block) {
+            bool hit = simulation.access(block);
+            hotAfterScan += afterScan;
+            hotHits += afterScan && hit;
+        }
+        size_t coldCount = round % 8 == 0 ? 2 * CAPACITY : HOT;
+        for (size_t i = 0; i < coldCount; ++i) {
+            simulation.access(cold++);
+        }
+    }
+
+    double hitRatio = static_cast<double>(hotHits) / static_cast<double>(hotAfterScan);
+    ASSERT_GE(hitRatio, 0.9) << "The scans pushed the hot set out.";
+}
+
+//------------------------------------------------------------------------------
+TEST_P(EvictionPolicyTests, CacheStaysCorrectUnderEviction) {
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+    constexpr off_t BLOCKS = 32;
+
+    BlockCache cache(6, BLOCK, BlockCache::DEFAULT_SHARD_COUNT, BlockPool::PageMode::NORMAL,
+                     IoBackend::Kind::SYNC, GetParam());
+    ASSERT_EQ(cache.evictionPolicy().capacity(), 6u);
+    std::vector<char> data(BLOCK);
+    for (off_t block = 0; block < BLOCKS; ++block) {
+        std::memset(data.data(), 'a' + static_cast<int>(block % 26), BLOCK);
+        ASSERT_TRUE(cache.overwrite(fd, block, data.data()));
+    }
+
+    std::mt19937 rng(5);
+    for (int i = 0; i < 500; ++i) {
+        off_t block = static_cast<off_t>(rng() % BLOCKS);
+        BlockCache::Handle handle = cache.acquire(fd, block);
+        ASSERT_TRUE(handle);
+        ASSERT_EQ(static_cast<const char*>(handle.data())[BLOCK / 2], 'a' + static_cast<char>(block % 26))
+            << "Block " << block << " came back with the wrong data.";
+    }
+    cache.flushFd(fd);
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+INSTANTIATE_TEST_SUITE_P(Policies, EvictionPolicyTests,
+                         testing::Values(EvictionPolicy::Kind::CLOCK, EvictionPolicy::Kind::TWO_Q,
+                                         EvictionPolicy::Kind::ARC, EvictionPolicy::Kind::LRU_K),
+                         kindName);
+
+//------------------------------------------------------------------------------
+TEST(GhostListTests, KeepsTheNewestKeysUpToItsCapacity) {
+    GhostList ghosts(4);
+    for (off_t block = 0; block < 6; ++block) {
+        ghosts.pushBack({1, block}, static_cast<std::uint64_t>(100 + block));
+    }
+    ASSERT_EQ(ghosts.size(), 4u);
+    ASSERT_FALSE(ghosts.contains({1, 0}));
+    ASSERT_FALSE(ghosts.contains({1, 1}));
+
+    // Pushed again, a key becomes the newest
+    ghosts.pushBack({1, 2}, 7);
+    ghosts.pushBack({1, 6});
+    ASSERT_FALSE(ghosts.contains({1, 3}));
+    std::uint64_t value = 0;
+    ASSERT_TRUE(ghosts.erase({1, 2}, &value));
+    ASSERT_EQ(value, 7u);
+    ASSERT_FALSE(ghosts.erase({1, 2}));
+
+    // Long churn reuses the same entries
+    for (off_t block = 1000; block < 5000; ++block) {
+        ghosts.pushBack({2, block}, static_cast<std::uint64_t>(block));
+        if (block % 3 == 0) {
+            ghosts.popFront();
+        }
+    }
+    ASSERT_LE(ghosts.size(), 4u);
+    ASSERT_TRUE(ghosts.erase({2, 4999}, &value));
+    ASSERT_EQ(value, 4999u);
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>      // open, O_DIRECT
+#include <unistd.h>     // close
+#include <cerrno>       // EBADF
+#include <cstring>      // memset, memcmp
+#include <filesystem>   // std::filesystem::remove
+#include <memory>       // std::unique_ptr
+#include <string>       // std::string
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include "BlockCache.hpp"
+#include "BlockPool.hpp"
+#include "IoBackend.hpp"
+#include "IoUringBackend.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+constexpr size_t BLOCKS = 48;
+
+std::string kindName(const testing::TestParamInfo<IoBackend::Kind>& info) {
+    switch (info.param) {
+    case IoBackend::Kind::SYNC:
+        return "Sync";
+    case IoBackend::Kind::THREAD_POOL:
+        return "ThreadPool";
+    case IoBackend::Kind::IO_URING:
+        return "IoUring";
+    default:
+        return "Auto";
+    }
+}
+
+} // namespace
+
+class IoBackendTests : public testing::TestWithParam<IoBackend::Kind> {
+protected:
+    /// IoBackend::create hands out the thread pool when io_uring is unavailable
+    bool fellBack(const IoBackend& io) const {
+        return GetParam() == IoBackend::Kind::IO_URING && std::string(io.name()) != "io_uring";
+    }
+};
+
+//------------------------------------------------------------------------------
+TEST_P(IoBackendTests, BatchedWritesAndReadsRoundTrip) {
+    // Aligned buffers for O_DIRECT; the pool is also what io_uring registers
+    BlockPool pool(2 * BLOCKS, BLOCK, BlockPool::PageMode::NORMAL);
+    std::unique_ptr<IoBackend> io = IoBackend::create(GetParam(), 8, pool.buffer(0), pool.count() * pool.stride());
+    if (fellBack(*io)) {
+        GTEST_SKIP() << "io_uring is not available here";
+    }
+
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    // More requests than the queue depth, submitted in reverse file order
+    std::vector<IoRequest> writes(BLOCKS);
+    for (size_t i = 0; i < BLOCKS; ++i) {
+        std::memset(pool.buffer(i), static_cast<int>(i + 1), BLOCK);
+        writes[i] = {IoRequest::Op::WRITE, fd, pool.buffer(i), BLOCK, static_cast<off_t>((BLOCKS - 1 - i) * BLOCK)};
+    }
+    io->execute(writes.data(), writes.size());
+    for (const IoRequest& write : writes) {
+        ASSERT_EQ(write.result, static_cast<ssize_t>(BLOCK));
+    }
+
+    std::vector<IoRequest> reads(BLOCKS);
+    for (size_t i = 0; i < BLOCKS; ++i) {
+        reads[i] = {IoRequest::Op::READ, fd, pool.buffer(BLOCKS + i), BLOCK, static_cast<off_t>((BLOCKS - 1 - i) * BLOCK)};
+    }
+    io->execute(reads.data(), reads.size());
+    for (size_t i = 0; i < BLOCKS; ++i) {
+        ASSERT_EQ(reads[i].result, static_cast<ssize_t>(BLOCK));
+        ASSERT_EQ(std::memcmp(pool.buffer(i), pool.buffer(BLOCKS + i), BLOCK), 0) << "Block " << i << " differs.";
+    }
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST_P(IoBackendTests, ReportsShortReadsAndErrors) {
+    // Buffers outside any registered memory take the unregistered path
+    BlockPool pool(3, BLOCK, BlockPool::PageMode::NORMAL);
+    std::unique_ptr<IoBackend> io = IoBackend::create(GetParam(), 4);
+    if (fellBack(*io)) {
+        GTEST_SKIP() << "io_uring is not available here";
+    }
+
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    IoRequest write{IoRequest::Op::WRITE, fd, pool.buffer(0), BLOCK, 0};
+    ASSERT_EQ(io->execute(write), static_cast<ssize_t>(BLOCK));
+
+    std::vector<IoRequest> requests = {
+        {IoRequest::Op::READ, fd, pool.buffer(1), BLOCK, static_cast<off_t>(BLOCK)},  // At EOF
+        {IoRequest::Op::READ, -1, pool.buffer(2), BLOCK, 0},                           // Bad fd
+    };
+    io->execute(requests.data(), requests.size());
+    ASSERT_EQ(requests[0].result, 0);
+    ASSERT_EQ(requests[1].result, -EBADF);
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST_P(IoBackendTests, CacheLoadsAndWritesBackInBatches) {
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    {
+        BlockCache cache(16, BLOCK, BlockCache::DEFAULT_SHARD_COUNT, BlockPool::PageMode::NORMAL, GetParam());
+        if (fellBack(cache.ioBackend())) {
+            ::close(fd);
+            std::filesystem::remove(tempFile);
+            GTEST_SKIP() << "io_uring is not available here";
+        }
+        for (off_t block = 0; block < 8; ++block) {
+            BlockCache::Handle handle = cache.acquire(fd, block);
+            ASSERT_TRUE(handle);
+            std::memset(handle.data(), 'a' + static_cast<int>(block), BLOCK);
+            handle.markDirty();
+        }
+        cache.flushFd(fd);
+        ASSERT_FALSE(cache.contains(fd, 0));
+    }
+
+    BlockCache cache(16, BLOCK, BlockCache::DEFAULT_SHARD_COUNT, BlockPool::PageMode::NORMAL, GetParam());
+    ASSERT_EQ(cache.preload(fd, 0, 8), 8u);
+    for (off_t block = 0; block < 8; ++block) {
+        ASSERT_TRUE(cache.contains(fd, block));
+        BlockCache::Handle handle = cache.acquire(fd, block);
+        ASSERT_EQ(handle.lookup(), BlockCache::Lookup::HIT);
+        ASSERT_EQ(static_cast<const char*>(handle.data())[BLOCK - 1], 'a' + static_cast<char>(block));
+    }
+    // Preloaded blocks are not readahead
+    ASSERT_EQ(cache.readaheadCounters().issued.load(), 0u);
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST_P(IoBackendTests, ManyCallersShareABoundedSetOfRings) {
+    const size_t threads = 4 * std::max(std::thread::hardware_concurrency(), 1u);
+    constexpr size_t PER_THREAD = 4;
+    BlockPool pool(threads * PER_THREAD, BLOCK, BlockPool::PageMode::NORMAL);
+    std::unique_ptr<IoBackend> io = IoBackend::create(GetParam(), 4, pool.buffer(0), pool.count() * pool.stride());
+    if (fellBack(*io)) {
+        GTEST_SKIP() << "io_uring is not available here";
+    }
+
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    // Each thread writes its own blocks in one batch, all at once
+    std::vector<std::vector<IoRequest>> batches(threads);
+    std::vector<std::thread> callers;
+    for (size_t t = 0; t < threads; ++t) {
+        for (size_t i = 0; i < PER_THREAD; ++i) {
+            const size_t block = t * PER_THREAD + i;
+            std::memset(pool.buffer(block), static_cast<int>(block % 251 + 1), BLOCK);
+            batches[t].push_back({IoRequest::Op::WRITE, fd, pool.buffer(block), BLOCK, static_cast<off_t>(block * BLOCK)});
+        }
+        callers.emplace_back([&io, &batches, t] { io->execute(batches[t].data(), batches[t].size()); });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+    for (const std::vector<IoRequest>& batch : batches) {
+        for (const IoRequest& write : batch) {
+            ASSERT_EQ(write.result, static_cast<ssize_t>(BLOCK));
+        }
+    }
+
+    if (auto* uring = dynamic_cast<IoUringBackend*>(io.get())) {
+        ASSERT_GE(uring->ringCount(), 1u);
+        ASSERT_LE(uring->ringCount(), uring->maxRings());
+    }
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoBackendTests,
+                         testing::Values(IoBackend::Kind::SYNC, IoBackend::Kind::THREAD_POOL,
+                                         IoBackend::Kind::IO_URING),
+                         kindName);
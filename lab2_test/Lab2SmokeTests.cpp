@@ -4,36 +4,12 @@
 #include <fcntl.h>      // O_RDWR, etc.
 #include <unistd.h>     // close
 #include <cstring>      // memset, strlen
+#include <fstream>      // std::ofstream
 #include <string>       // std::string
+#include <vector>       // std::vector
 
 #include "lab2_library.hpp"
-
-// Helper function to create a unique temporary file path and return it as a std::string.
-static std::string makeUniqueTempFile() {
-    // Get the system temp directory (e.g., /tmp on Linux)
-    std::filesystem::path tempDir = std::filesystem::temp_directory_path();
-
-    // We’ll create a pattern for mkstemp, which replaces "XXXXXX" with random characters
-    // Example: /tmp/lab2_test_XXXXXX
-    std::filesystem::path templatePath = tempDir / "lab2_test_XXXXXX";
-    std::string templateStr = templatePath.string();
-
-    // mkstemp needs a modifiable char array
-    std::vector<char> modifiable(templateStr.begin(), templateStr.end());
-    modifiable.push_back('\0'); // null-terminate
-
-    // mkstemp replaces "XXXXXX" in-place and creates the file with O_RDWR
-    int fd = ::mkstemp(modifiable.data());
-    if (fd == -1) {
-        throw std::runtime_error("Could not create temp file with mkstemp!");
-    }
-
-    // We only want the name; we’ll close the file here
-    ::close(fd);
-
-    // Return the actual file path that mkstemp created
-    return std::string(modifiable.data());
-}
+#include "TestUtils.hpp"
 
 //------------------------------------------------------------------------------
 TEST(Lab2SmokeTests, SanityTest) {
@@ -148,6 +124,34 @@ TEST(Lab2Tests, LseekBeyondWrite) {
     std::filesystem::remove(tempFile);
 }
 
+//------------------------------------------------------------------------------
+TEST(Lab2Tests, ReadStopsAtEndOfFile) {
+    Lab2 lab2(4, LAB2_BLOCK_SIZE);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+
+    const char *msg = "Twenty-two bytes long\n";
+    const size_t length = std::strlen(msg);
+    ASSERT_EQ(lab2.write(fd, msg, length), static_cast<ssize_t>(length));
+
+    // Still only in the cache, yet SEEK_END knows the size
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_END), static_cast<off_t>(length));
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_SET), 0);
+    std::vector<char> buffer(100, 'x');
+    ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(length));
+    ASSERT_EQ(buffer[length], 'x') << "Nothing past the end should be copied.";
+    ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), 0);
+
+    // Flushed in aligned units, then cut back to the exact size
+    ASSERT_EQ(lab2.fsync(fd), 0);
+    ASSERT_EQ(std::filesystem::file_size(tempFile), length);
+    ASSERT_EQ(lab2.close(fd), 0);
+    ASSERT_EQ(std::filesystem::file_size(tempFile), length);
+
+    std::filesystem::remove(tempFile);
+}
+
 //------------------------------------------------------------------------------
 TEST(Lab2Tests, AdviceCallShouldFail) {
     Lab2 lab2(4, LAB2_BLOCK_SIZE);
@@ -156,13 +160,120 @@ TEST(Lab2Tests, AdviceCallShouldFail) {
     fd_t fd = lab2.open(tempFile);
     ASSERT_GE(fd, 0) << "Failed to open temp file for Advice test.";
 
-    // Since we’re not implementing this in a real sense,
-    // we expect it to return -1 or throw.
+    // advice() understands the LAB2_ADVICE_* hints only; anything else is rejected
     int ret = lab2.advice(fd, /*offset=*/0, /*hint=*/0xBADC0FFEE);
-    // By assignment: "user can go away" or "return -1" or "throw"
-    // If you choose to throw, wrap in try/catch.
-    ASSERT_EQ(ret, -1) << "Expected advice() to return -1 for unimplemented method.";
+    ASSERT_EQ(ret, -1) << "Expected advice() to return -1 for an unknown hint.";
+    ASSERT_EQ(errno, EINVAL);
 
     lab2.close(fd);
     std::filesystem::remove(tempFile);
 }
+
+//------------------------------------------------------------------------------
+TEST(Lab2Tests, OpensOfOneFileShareBlocks) {
+    Lab2 lab2(4, LAB2_BLOCK_SIZE);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t writer = lab2.open(tempFile);
+    fd_t reader = lab2.open(tempFile);
+    ASSERT_GE(writer, 0);
+    ASSERT_GE(reader, 0);
+    ASSERT_NE(writer, reader);
+
+    // Seen through the other fd while still only in the cache
+    const std::string msg = "written through one fd";
+    ASSERT_EQ(lab2.write(writer, msg.data(), msg.size()), static_cast<ssize_t>(msg.size()));
+    std::string buffer(msg.size(), 'x');
+    ASSERT_EQ(lab2.read(reader, buffer.data(), buffer.size()), static_cast<ssize_t>(msg.size()));
+    ASSERT_EQ(buffer, msg);
+    ASSERT_EQ(lab2.stats().bytesRead, 0u) << "Both fds should use the one cached block.";
+
+    // Offsets stay per open; closing one leaves the other working
+    ASSERT_EQ(lab2.lseek(writer, 0, SEEK_CUR), static_cast<off_t>(msg.size()));
+    ASSERT_EQ(lab2.close(writer), 0);
+    ASSERT_EQ(lab2.pread(reader, buffer.data(), buffer.size(), 0), static_cast<ssize_t>(msg.size()));
+    ASSERT_EQ(buffer, msg);
+    ASSERT_EQ(lab2.close(reader), 0);
+
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(Lab2Tests, BlocksStayCachedAcrossCloseAndReopen) {
+    Lab2 lab2(4, LAB2_BLOCK_SIZE);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> data(2 * LAB2_BLOCK_SIZE, 'a');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    ASSERT_EQ(lab2.close(fd), 0);
+    ASSERT_EQ(std::filesystem::file_size(tempFile), data.size()) << "close() should still write back.";
+
+    const CacheStats before = lab2.stats();
+    fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> buffer(data.size());
+    ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(buffer, data);
+    const CacheStats after = lab2.stats();
+    ASSERT_EQ(after.misses, before.misses);
+    ASSERT_EQ(after.bytesRead, before.bytesRead);
+    ASSERT_EQ(lab2.close(fd), 0);
+
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(Lab2Tests, ReopenSeesChangesMadeWhileClosed) {
+    Lab2 lab2(4, LAB2_BLOCK_SIZE);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    const std::string before = "cached contents";
+    ASSERT_EQ(lab2.write(fd, before.data(), before.size()), static_cast<ssize_t>(before.size()));
+    ASSERT_EQ(lab2.close(fd), 0);
+
+    // Behind the cache's back
+    const std::string changed = "changed on disk, and longer";
+    std::ofstream(tempFile, std::ios::binary | std::ios::trunc) << changed;
+
+    fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::string buffer(changed.size() + 8, 'x');
+    ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(changed.size()));
+    ASSERT_EQ(buffer.substr(0, changed.size()), changed);
+    ASSERT_EQ(lab2.close(fd), 0);
+
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(Lab2Tests, IdleFilesPastTheLimitAreDropped) {
+    CacheConfig config;
+    config.capacity = 8;
+    config.maxIdleFiles = 1;
+    Lab2 lab2(config);
+    const std::string first = makeUniqueTempFile();
+    const std::string second = makeUniqueTempFile();
+    std::vector<char> data(LAB2_BLOCK_SIZE, 'b');
+    for (const std::string &path : {first, second}) {
+        fd_t fd = lab2.open(path);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+        ASSERT_EQ(lab2.close(fd), 0);
+    }
+
+    // The second is the one idle file kept; the first went to make room
+    std::vector<char> buffer(data.size());
+    for (const std::string &path : {second, first}) {
+        const CacheStats before = lab2.stats();
+        fd_t fd = lab2.open(path);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(buffer.size()));
+        ASSERT_EQ(buffer, data);
+        ASSERT_EQ(lab2.stats().misses - before.misses, path == first ? 1u : 0u) << path;
+        ASSERT_EQ(lab2.close(fd), 0);
+    }
+
+    std::filesystem::remove(first);
+    std::filesystem::remove(second);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <filesystem>   // std::filesystem::remove
+#include <fstream>      // std::ifstream
+#include <sstream>      // std::stringstream
+#include <string>       // std::string
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include "Log.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(LogTests, RecordRendersItsArguments) {
+    LogRecord record;
+    record.timeNs = 1234567890123456789ull;
+    record.level = LogLevel::WARN;
+    record.format = "fd={} block={} ratio={} {} path={} {}";
+    const std::string path = "/tmp/file";
+    record.add(3);
+    record.add(std::size_t{42});
+    record.add(0.5);
+    record.add(true);
+    record.add(path);
+    record.add(static_cast<const char*>(nullptr));
+
+    std::string line;
+    record.render(line);
+    ASSERT_EQ(line, "1234567890.123456 WARN fd=3 block=42 ratio=0.5 true path=/tmp/file (null)\n");
+
+    // Missing arguments leave their placeholders; long strings are cut short
+    LogRecord longRecord;
+    longRecord.format = "{} {}";
+    longRecord.add(std::string(2 * LogRecord::TEXT_BYTES, 'x'));
+    line.clear();
+    longRecord.render(line);
+    ASSERT_NE(line.find(std::string(LogRecord::TEXT_BYTES, 'x') + " {}\n"), std::string::npos);
+}
+
+//------------------------------------------------------------------------------
+TEST(LogTests, RingLoggerWritesOrDropsEveryRecord) {
+    const std::string logFile = makeUniqueTempFile();
+    const int fd = ::open(logFile.c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_GE(fd, 0);
+
+    constexpr int THREADS = 4;
+    constexpr int RECORDS = 2000;
+    std::uint64_t dropped;
+    {
+        RingLogger logger(fd, 64, std::chrono::milliseconds(1));
+        Log::attach(&logger);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([t] {
+                for (int i = 0; i < RECORDS; ++i) {
+                    Log::write(LogLevel::ERROR, "thread {} record {}", t, i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        dropped = logger.dropped();
+    }
+    ::close(fd);
+
+    // The destructor detached the logger and wrote out what was left
+    const std::string text = readFile(logFile);
+    std::uint64_t lines = 0;
+    for (char c : text) {
+        lines += c == '\n';
+    }
+    ASSERT_EQ(lines + dropped, static_cast<std::uint64_t>(THREADS * RECORDS));
+    ASSERT_NE(text.find(" ERROR thread "), std::string::npos);
+    std::filesystem::remove(logFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(LogTests, LevelsFilterAtRunTime) {
+    const std::string logFile = makeUniqueTempFile();
+    const int fd = ::open(logFile.c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_GE(fd, 0);
+    const LogLevel saved = Log::level();
+    {
+        RingLogger logger(fd);
+        Log::attach(&logger);
+        Log::setLevel(LogLevel::ERROR);
+        Log::write(LogLevel::WARN, "hidden");
+        Log::write(LogLevel::ERROR, "shown");
+        Log::setLevel(saved);
+    }
+    ::close(fd);
+
+    const std::string text = readFile(logFile);
+    ASSERT_EQ(text.find("hidden"), std::string::npos);
+    ASSERT_NE(text.find(" ERROR shown\n"), std::string::npos);
+    std::filesystem::remove(logFile);
+}
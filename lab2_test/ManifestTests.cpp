@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // ENOENT
+#include <cstdint>      // INT64_MAX, UINT64_MAX
+#include <fcntl.h>      // ::open
+#include <sys/stat.h>   // stat
+#include <unistd.h>     // pwrite, close
+#include <filesystem>   // std::filesystem::remove
+#include <stdexcept>    // runtime_error
+#include <string>       // std::string
+#include <system_error> // std::system_error
+#include <vector>       // std::vector
+
+#include "BinaryFormat.hpp"
+#include "lab2_library.hpp"
+#include "Manifest.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+constexpr size_t FILE_BLOCKS = 8;
+
+/// A temporary file of FILE_BLOCKS blocks, written behind the cache's back
+struct DataFile {
+    std::string path = makeUniqueTempFile();
+
+    DataFile() {
+        int fd = ::open(path.c_str(), O_WRONLY);
+        const std::vector<char> block(BLOCK, 'm');
+        for (size_t b = 0; b < FILE_BLOCKS; ++b) {
+            (void) ::pwrite(fd, block.data(), BLOCK, static_cast<off_t>(b * BLOCK));
+        }
+        ::close(fd);
+    }
+
+    ~DataFile() { std::filesystem::remove(path); }
+};
+
+/// A manifest of one file whose blocks are the given gaps, written byte by byte
+void writeGaps(const std::string &path, const std::vector<uint64_t> &gaps) {
+    std::vector<uint8_t> data(MANIFEST_MAGIC, MANIFEST_MAGIC + sizeof(MANIFEST_MAGIC));
+    putVarint(data, 1);      // Files
+    putVarint(data, 1);      // Path length
+    data.push_back('f');
+    for (int field = 0; field < 4; ++field) {
+        putVarint(data, 0);  // dev, ino, size, mtime
+    }
+    putVarint(data, BLOCK);
+    putVarint(data, gaps.size());
+    for (uint64_t gap : gaps) {
+        putVarint(data, gap);
+        putVarint(data, 0);  // Heat
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_TRUNC);
+    (void) ::pwrite(fd, data.data(), data.size(), 0);
+    ::close(fd);
+}
+
+CacheConfig manifestConfig(size_t capacity, const std::string &manifestPath) {
+    CacheConfig config;
+    config.capacity = capacity;
+    config.blockSize = BLOCK;
+    config.manifestPath = manifestPath;
+    return config;
+}
+
+/// Disk bytes it takes to read the given blocks of path
+uint64_t bytesToRead(Lab2 &lab2, const std::string &path, const std::vector<off_t> &blocks) {
+    const uint64_t before = lab2.stats().bytesRead;
+    fd_t fd = lab2.open(path);
+    std::vector<char> buffer(BLOCK);
+    for (off_t block : blocks) {
+        EXPECT_EQ(lab2.pread(fd, buffer.data(), BLOCK, block * static_cast<off_t>(BLOCK)), static_cast<ssize_t>(BLOCK));
+    }
+    lab2.close(fd);
+    return lab2.stats().bytesRead - before;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(ManifestTests, RoundTrips) {
+    const std::string path = makeUniqueTempFile();
+    std::vector<ManifestFile> files(2);
+    files[0].path = "/data/a";
+    files[0].dev = 2049;
+    files[0].ino = 1234567;
+    files[0].size = 1 << 30;
+    files[0].mtimeNs = 1'700'000'000'123'456'789;
+    files[0].blockSize = BLOCK;
+    files[0].blocks = {{0, 1}, {1, 0}, {1000, 2}, {1'000'000, 1}};
+    files[1].path = "/data/b";
+    files[1].mtimeNs = -5;
+    writeManifest(path, files);
+
+    const std::vector<ManifestFile> read = readManifest(path);
+    ASSERT_EQ(read.size(), 2u);
+    ASSERT_EQ(read[0].path, "/data/a");
+    ASSERT_EQ(read[0].dev, 2049u);
+    ASSERT_EQ(read[0].ino, 1234567u);
+    ASSERT_EQ(read[0].size, 1 << 30);
+    ASSERT_EQ(read[0].mtimeNs, files[0].mtimeNs);
+    ASSERT_EQ(read[0].blockSize, BLOCK);
+    ASSERT_EQ(read[0].blocks.size(), 4u);
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_EQ(read[0].blocks[i].blockIndex, files[0].blocks[i].blockIndex);
+        ASSERT_EQ(read[0].blocks[i].heat, files[0].blocks[i].heat);
+    }
+    ASSERT_EQ(read[1].mtimeNs, -5);
+    ASSERT_TRUE(read[1].blocks.empty());
+
+    ASSERT_THROW(readManifest(path + ".missing"), std::system_error);
+    const std::string other = makeUniqueTempFile(); // Empty
+    ASSERT_THROW(readManifest(other), std::runtime_error);
+    std::filesystem::remove(path);
+    std::filesystem::remove(other);
+}
+
+//------------------------------------------------------------------------------
+TEST(ManifestTests, GapsPastTheLastBlockIndexAreRejected) {
+    const std::string path = makeUniqueTempFile();
+    writeGaps(path, {0, INT64_MAX - 1});
+    const std::vector<ManifestFile> read = readManifest(path);
+    ASSERT_EQ(read.at(0).blocks.size(), 2u);
+    ASSERT_EQ(read[0].blocks[1].blockIndex, INT64_MAX);
+
+    // One past it would overflow the index or turn it negative
+    writeGaps(path, {0, INT64_MAX});
+    ASSERT_THROW(readManifest(path), std::runtime_error);
+    writeGaps(path, {static_cast<uint64_t>(INT64_MAX) + 1});
+    ASSERT_THROW(readManifest(path), std::runtime_error);
+    writeGaps(path, {UINT64_MAX});
+    ASSERT_THROW(readManifest(path), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+TEST(ManifestTests, RestartLoadsWhatWasCached) {
+    DataFile data;
+    const std::string manifest = makeUniqueTempFile();
+    std::filesystem::remove(manifest); // The first instance finds none
+    {
+        Lab2 lab2(manifestConfig(16, manifest));
+        ASSERT_EQ(lab2.waitForWarmUp().files, 0u);
+        ASSERT_EQ(bytesToRead(lab2, data.path, {0, 2, 4}), 3 * BLOCK);
+    }
+
+    Lab2 lab2(manifestConfig(16, manifest));
+    const WarmUpStats warmUp = lab2.waitForWarmUp();
+    ASSERT_EQ(warmUp.files, 1u);
+    ASSERT_EQ(warmUp.blocks, 3u);
+    ASSERT_EQ(warmUp.skippedFiles, 0u);
+    ASSERT_FALSE(warmUp.running);
+    ASSERT_EQ(bytesToRead(lab2, data.path, {0, 2, 4}), 0u) << "The blocks should have been loaded before the reads.";
+    ASSERT_EQ(bytesToRead(lab2, data.path, {1}), BLOCK);
+    std::filesystem::remove(manifest);
+}
+
+//------------------------------------------------------------------------------
+TEST(ManifestTests, ChangedFilesAreSkipped) {
+    DataFile data;
+    const std::string manifest = makeUniqueTempFile();
+    {
+        Lab2 lab2(manifestConfig(16, ""));
+        ASSERT_EQ(bytesToRead(lab2, data.path, {0, 3}), 2 * BLOCK);
+        ASSERT_EQ(lab2.saveManifest(manifest), 0);
+    }
+
+    // Grown by someone else
+    int fd = ::open(data.path.c_str(), O_WRONLY);
+    const std::vector<char> block(BLOCK, 'x');
+    ASSERT_EQ(::pwrite(fd, block.data(), BLOCK, FILE_BLOCKS * BLOCK), static_cast<ssize_t>(BLOCK));
+    ::close(fd);
+
+    Lab2 lab2(manifestConfig(16, ""));
+    ASSERT_EQ(lab2.loadManifest(manifest), 0);
+    const WarmUpStats warmUp = lab2.waitForWarmUp();
+    ASSERT_EQ(warmUp.files, 0u);
+    ASSERT_EQ(warmUp.skippedFiles, 1u);
+    ASSERT_EQ(warmUp.blocks, 0u);
+    ASSERT_EQ(bytesToRead(lab2, data.path, {0}), BLOCK);
+
+    ASSERT_EQ(lab2.loadManifest(manifest + ".missing"), -1);
+    ASSERT_EQ(errno, ENOENT);
+    std::filesystem::remove(manifest);
+}
+
+//------------------------------------------------------------------------------
+TEST(ManifestTests, OnlyTheHottestBlocksThatFitAreLoaded) {
+    DataFile data;
+    struct stat st {};
+    ASSERT_EQ(::stat(data.path.c_str(), &st), 0);
+    std::vector<ManifestFile> files(1);
+    files[0].path = data.path;
+    files[0].dev = st.st_dev;
+    files[0].ino = st.st_ino;
+    files[0].size = st.st_size;
+    files[0].mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+    files[0].blockSize = BLOCK;
+    files[0].blocks = {{0, 0}, {1, 2}, {2, 0}, {3, 1}, {4, 0}, {5, 2}};
+    const std::string manifest = makeUniqueTempFile();
+    writeManifest(manifest, files);
+
+    Lab2 lab2(manifestConfig(3, ""));
+    ASSERT_EQ(lab2.loadManifest(manifest), 0);
+    ASSERT_EQ(lab2.waitForWarmUp().blocks, 3u);
+    ASSERT_EQ(bytesToRead(lab2, data.path, {1, 3, 5}), 0u);
+    std::filesystem::remove(manifest);
+}
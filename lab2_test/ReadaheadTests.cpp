@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <chrono>       // std::chrono::steady_clock
+#include <cstring>      // memcmp
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <thread>       // std::this_thread::sleep_for
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "Readahead.hpp"
+#include "TestUtils.hpp"
+
+using Lookup = StreamDetector::Lookup;
+
+//------------------------------------------------------------------------------
+TEST(ReadaheadTests, DetectsSequentialRun) {
+    StreamDetector detector(16);
+
+    // A single block is not a stream yet
+    ASSERT_EQ(detector.onAccess(10, Lookup::MISS).count, 0u);
+
+    // The second consecutive block starts readahead of the next window
+    StreamDetector::Range range = detector.onAccess(11, Lookup::MISS);
+    ASSERT_EQ(range.first, 12);
+    ASSERT_EQ(range.count, StreamDetector::INITIAL_WINDOW);
+
+    // Re-reading the same block changes nothing
+    ASSERT_EQ(detector.onAccess(11, Lookup::HIT).count, 0u);
+
+    // Next block was prefetched: window doubles, only new blocks are requested
+    range = detector.onAccess(12, Lookup::READAHEAD_HIT);
+    ASSERT_EQ(detector.window(), 2 * StreamDetector::INITIAL_WINDOW);
+    ASSERT_EQ(range.first, 16);
+    ASSERT_EQ(range.first + static_cast<off_t>(range.count) - 1, 12 + static_cast<off_t>(detector.window()));
+}
+
+//------------------------------------------------------------------------------
+TEST(ReadaheadTests, WindowShrinksOnMissAndResetsOnJump) {
+    StreamDetector detector(64);
+    detector.onAccess(0, Lookup::MISS);
+    detector.onAccess(1, Lookup::MISS);
+    detector.onAccess(2, Lookup::READAHEAD_HIT);
+    detector.onAccess(3, Lookup::READAHEAD_HIT);
+    ASSERT_EQ(detector.window(), 4 * StreamDetector::INITIAL_WINDOW);
+
+    // Block 4 should have been prefetched but was not
+    ASSERT_TRUE(detector.expected(4));
+    detector.onAccess(4, Lookup::MISS);
+    ASSERT_EQ(detector.window(), 2 * StreamDetector::INITIAL_WINDOW);
+
+    // Random access ends the stream
+    ASSERT_EQ(detector.onAccess(100, Lookup::MISS).count, 0u);
+    ASSERT_FALSE(detector.sequential());
+    ASSERT_EQ(detector.window(), StreamDetector::INITIAL_WINDOW);
+}
+
+//------------------------------------------------------------------------------
+TEST(ReadaheadTests, WindowIsCapped) {
+    StreamDetector detector(6);
+    for (off_t block = 0; block < 20; ++block) {
+        detector.onAccess(block, Lookup::READAHEAD_HIT);
+        ASSERT_LE(detector.window(), 6u);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(ReadaheadTests, SequentialScanIssuesReadahead) {
+    constexpr size_t BLOCK = 4096;
+    constexpr size_t BLOCKS = 64;
+    const std::string tempFile = makeUniqueTempFile();
+
+    std::vector<char> content(BLOCKS * BLOCK);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 13 + i / BLOCK);
+    }
+    {
+        Lab2 writer(8, BLOCK);
+        fd_t fd = writer.open(tempFile);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(writer.write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+        ASSERT_EQ(writer.close(fd), 0);
+    }
+
+    // Fresh cache: everything comes from disk, block by block
+    Lab2 lab2(32, BLOCK);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> buffer(BLOCK);
+    for (size_t b = 0; b < BLOCKS; ++b) {
+        ASSERT_EQ(lab2.read(fd, buffer.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+        ASSERT_EQ(std::memcmp(buffer.data(), content.data() + b * BLOCK, BLOCK), 0)
+            << "Block " << b << " differs from what was written.";
+
+        if (b == 1) {
+            // The second block starts readahead; prefetching is asynchronous, and on
+            // a busy machine the reader could otherwise finish before it is scheduled
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (lab2.readaheadStats().issued == 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    ReadaheadStats stats = lab2.readaheadStats();
+    ASSERT_GT(stats.issued, 0u) << "A sequential scan should trigger readahead.";
+    ASSERT_LE(stats.hits, stats.issued);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ReadaheadTests, ForcedPatterns) {
+    StreamDetector detector(8);
+
+    detector.setPattern(StreamDetector::Pattern::SEQUENTIAL);
+    StreamDetector::Range range = detector.onAccess(40, Lookup::MISS);
+    ASSERT_EQ(range.first, 41) << "SEQUENTIAL starts readahead on the first access.";
+    ASSERT_EQ(range.count, 16u) << "SEQUENTIAL doubles the maximum window.";
+
+    detector.setPattern(StreamDetector::Pattern::RANDOM);
+    for (off_t block = 0; block < 10; ++block) {
+        ASSERT_EQ(detector.onAccess(block, Lookup::MISS).count, 0u);
+    }
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <cstddef>      // std::size_t
+#include <random>       // std::mt19937_64
+#include <unordered_map> // std::unordered_map
+#include <unordered_set> // std::unordered_set
+
+#include "SlotTable.hpp"
+
+//------------------------------------------------------------------------------
+TEST(SlotTableTests, InsertFindErase) {
+    SlotTable table;
+    ASSERT_EQ(table.find({3, 7}), SlotTable::npos);
+
+    table.insert({3, 7}, 11);
+    table.insert({4, 7}, 12);
+    ASSERT_EQ(table.size(), 2u);
+    ASSERT_EQ(table.find({3, 7}), 11u);
+    ASSERT_EQ(table.find({4, 7}), 12u);
+    ASSERT_FALSE(table.contains({3, 8}));
+
+    ASSERT_TRUE(table.erase({3, 7}));
+    ASSERT_FALSE(table.erase({3, 7}));
+    ASSERT_EQ(table.find({3, 7}), SlotTable::npos);
+    ASSERT_EQ(table.find({4, 7}), 12u);
+    ASSERT_EQ(table.size(), 1u);
+}
+
+//------------------------------------------------------------------------------
+TEST(SlotTableTests, GrowsPastItsReservation) {
+    SlotTable table(16);
+    const std::size_t buckets = table.bucketCount();
+    constexpr std::size_t KEYS = 10000;
+    for (std::size_t i = 0; i < KEYS; ++i) {
+        table.insert({static_cast<int>(i % 7), static_cast<off_t>(i)}, i);
+    }
+    ASSERT_GT(table.bucketCount(), buckets);
+    ASSERT_EQ(table.size(), KEYS);
+    for (std::size_t i = 0; i < KEYS; ++i) {
+        ASSERT_EQ(table.find({static_cast<int>(i % 7), static_cast<off_t>(i)}), i);
+    }
+
+    std::size_t visited = 0;
+    table.forEach([&](const CacheKey& key, std::size_t slot) {
+        ASSERT_EQ(static_cast<std::size_t>(key.blockIndex), slot);
+        ++visited;
+    });
+    ASSERT_EQ(visited, KEYS);
+}
+
+//------------------------------------------------------------------------------
+// Cache-like churn at a steady size: tombstones must neither lose keys nor
+// make the table grow without bound
+TEST(SlotTableTests, ChurnMatchesUnorderedMap) {
+    constexpr std::size_t LIVE = 1000;
+    SlotTable table(LIVE);
+    std::unordered_map<CacheKey, std::size_t> expected;
+    std::mt19937_64 rng(7);
+
+    for (std::size_t step = 0; step < 200000; ++step) {
+        CacheKey key{static_cast<int>(rng() % 4), static_cast<off_t>(rng() % 5000)};
+        auto it = expected.find(key);
+        ASSERT_EQ(table.find(key), it == expected.end() ? SlotTable::npos : it->second);
+        if (it != expected.end()) {
+            ASSERT_TRUE(table.erase(key));
+            expected.erase(it);
+        } else if (expected.size() < LIVE) {
+            table.insert(key, step);
+            expected.emplace(key, step);
+        }
+        ASSERT_EQ(table.size(), expected.size());
+    }
+    ASSERT_LE(table.bucketCount(), 4 * LIVE);
+
+    std::unordered_set<std::size_t> slots;
+    table.forEach([&](const CacheKey& key, std::size_t slot) {
+        ASSERT_EQ(expected.at(key), slot);
+        slots.insert(slot);
+    });
+    ASSERT_EQ(slots.size(), expected.size());
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>      // ::open
+#include <sys/stat.h>   // stat
+#include <unistd.h>     // pread, pwrite, ftruncate, lseek, close
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+#include "ZeroScan.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+CacheConfig sparseConfig(size_t capacity) {
+    CacheConfig config;
+    config.capacity = capacity;
+    config.blockSize = BLOCK;
+    config.writeback.enabled = false;
+    return config;
+}
+
+/// A file of `blocks` blocks that is one hole but for block `dataBlock`, full of `fill`
+std::string sparseFile(size_t blocks, off_t dataBlock, char fill) {
+    const std::string path = makeUniqueTempFile();
+    int fd = ::open(path.c_str(), O_WRONLY);
+    (void) ::ftruncate(fd, static_cast<off_t>(blocks * BLOCK));
+    const std::vector<char> block(BLOCK, fill);
+    (void) ::pwrite(fd, block.data(), BLOCK, dataBlock * static_cast<off_t>(BLOCK));
+    ::close(fd);
+    return path;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(SparseTests, ZeroScanFindsEveryNonZeroByte) {
+    // A few whole 64-byte lines and a tail
+    std::vector<unsigned char> data(4 * 64 + 37, 0);
+    ASSERT_TRUE(isZero(data.data(), data.size()));
+    ASSERT_TRUE(isZero(data.data(), 0));
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = 0x80;
+        ASSERT_FALSE(isZero(data.data(), data.size())) << "at " << i;
+        ASSERT_TRUE(isZero(data.data(), i));
+        data[i] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(SparseTests, ZeroBlocksArePunchedNotWritten) {
+    const std::string path = makeUniqueTempFile();
+    Lab2 lab2(sparseConfig(16));
+    fd_t fd = lab2.open(path);
+    ASSERT_GE(fd, 0);
+
+    // Data, six zero blocks, data: the zeros end up a hole between the two
+    std::vector<char> block(BLOCK, 'a');
+    ASSERT_EQ(lab2.pwrite(fd, block.data(), BLOCK, 0), static_cast<ssize_t>(BLOCK));
+    const std::vector<char> zeros(6 * BLOCK, 0);
+    ASSERT_EQ(lab2.pwrite(fd, zeros.data(), zeros.size(), BLOCK), static_cast<ssize_t>(zeros.size()));
+    std::fill(block.begin(), block.end(), 'b');
+    ASSERT_EQ(lab2.pwrite(fd, block.data(), BLOCK, 7 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.fsync(fd), 0);
+
+    const CacheStats stats = lab2.stats();
+    ASSERT_EQ(stats.bytesPunched, 6 * BLOCK);
+    ASSERT_EQ(stats.bytesWritten, 2 * BLOCK);
+    struct stat st {};
+    ASSERT_EQ(::stat(path.c_str(), &st), 0);
+    ASSERT_EQ(st.st_size, static_cast<off_t>(8 * BLOCK));
+    ASSERT_LT(st.st_blocks * 512, static_cast<blkcnt_t>(8 * BLOCK)) << "The zeros should not take up space.";
+    ASSERT_EQ(byteOnDisk(path, 0), 'a');
+    ASSERT_EQ(byteOnDisk(path, 3 * BLOCK), '\0');
+    ASSERT_EQ(byteOnDisk(path, 7 * BLOCK), 'b');
+
+    // Zeros over data punch it out again
+    ASSERT_EQ(lab2.pwrite(fd, zeros.data(), BLOCK, 7 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.close(fd), 0);
+    ASSERT_EQ(lab2.stats().bytesPunched, 7 * BLOCK);
+    ASSERT_EQ(byteOnDisk(path, 7 * BLOCK), '\0');
+    ASSERT_EQ(::stat(path.c_str(), &st), 0);
+    ASSERT_EQ(st.st_size, static_cast<off_t>(8 * BLOCK));
+    std::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+TEST(SparseTests, HolesAreNotRead) {
+    const std::string path = sparseFile(64, 40, 'd');
+    Lab2 lab2(sparseConfig(64));
+    fd_t fd = lab2.open(path);
+    ASSERT_GE(fd, 0);
+
+    std::vector<char> buffer(BLOCK);
+    for (off_t block = 0; block < 64; ++block) {
+        ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, block * static_cast<off_t>(BLOCK)), static_cast<ssize_t>(BLOCK));
+        ASSERT_EQ(buffer[0], block == 40 ? 'd' : '\0') << "block " << block;
+        ASSERT_EQ(buffer[BLOCK - 1], buffer[0]);
+    }
+    const CacheStats stats = lab2.stats();
+    ASSERT_EQ(stats.holeLoads, 63u);
+    ASSERT_EQ(stats.bytesRead, BLOCK);
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+TEST(SparseTests, DataWrittenIntoAHoleIsReadBack) {
+    const std::string path = sparseFile(16, 15, 'e');
+    Lab2 lab2(sparseConfig(2));
+    fd_t fd = lab2.open(path);
+    ASSERT_GE(fd, 0);
+
+    std::vector<char> buffer(BLOCK, 'w');
+    ASSERT_EQ(lab2.pwrite(fd, buffer.data(), BLOCK, 5 * BLOCK), static_cast<ssize_t>(BLOCK));
+    // The miss on block 3 learns that blocks 3-14 are a hole, block 5 included
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, 3 * BLOCK), static_cast<ssize_t>(BLOCK));
+    // Evicted, and so written back, to make room for these
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, 8 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, 9 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(byteOnDisk(path, 5 * BLOCK), 'w');
+
+    const uint64_t before = lab2.stats().bytesRead;
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), BLOCK, 5 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(buffer[0], 'w');
+    ASSERT_EQ(lab2.stats().bytesRead - before, BLOCK) << "Block 5 is no hole any more and has to be read.";
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(path);
+}
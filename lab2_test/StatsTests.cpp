@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <chrono>       // std::chrono::nanoseconds
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "Statistics.hpp"
+#include "TestUtils.hpp"
+
+//------------------------------------------------------------------------------
+TEST(StatsTests, HistogramBucketsBoundTheirValues) {
+    for (std::uint64_t ns : {0ull, 7ull, 8ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        const std::size_t bucket = LatencyHistogram::bucketOf(ns);
+        ASSERT_LT(bucket, LatencyHistogram::BUCKET_COUNT);
+        ASSERT_GE(LatencyHistogram::upperBound(bucket), ns);
+        // A bucket is at most 1/SUB_BUCKETS of its values wide
+        ASSERT_LE(LatencyHistogram::upperBound(bucket) - ns, ns / LatencyHistogram::SUB_BUCKETS);
+        if (bucket > 0) {
+            ASSERT_LT(LatencyHistogram::upperBound(bucket - 1), ns);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(StatsTests, StripesAddUpAcrossThreads) {
+    StripedStats recorder;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&recorder, t] {
+            for (int i = 0; i < 1000; ++i) {
+                recorder.add(StripedStats::HITS);
+                recorder.recordRead(std::chrono::microseconds(10 * (t + 1)));
+            }
+            recorder.recordWrite(std::chrono::milliseconds(1), 3);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    CacheStats stats;
+    recorder.snapshot(stats);
+    ASSERT_EQ(stats.hits, 4000u);
+    ASSERT_EQ(stats.diskReads.count, 4000u);
+    ASSERT_EQ(stats.diskReads.sumNs, 1000u * (10 + 20 + 30 + 40) * 1000);
+    ASSERT_EQ(stats.diskWrites.count, 12u);
+    // Each thread contributed a quarter; quantiles land within a bucket of them
+    ASSERT_NEAR(static_cast<double>(stats.diskReads.quantile(0.1)), 10000, 10000 / 8.0);
+    ASSERT_NEAR(static_cast<double>(stats.diskReads.quantile(0.99)), 40000, 40000 / 8.0);
+    ASSERT_EQ(stats.diskReads.countAtMost(25000), 2000u);
+}
+
+//------------------------------------------------------------------------------
+TEST(StatsTests, CacheCountsEvictionsAndWritebacks) {
+    const std::string tempFile = makeUniqueTempFile();
+    CacheConfig config;
+    config.capacity = 4;
+    config.blockSize = 4096;
+    config.writeback.enabled = false;
+    Lab2 lab2(config);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+
+    std::vector<char> buffer(4096, 's');
+    for (int block = 0; block < 8; ++block) {
+        ASSERT_EQ(lab2.pwrite(fd, buffer.data(), buffer.size(), block * 4096), 4096);
+    }
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int block = 4; block < 8; ++block) {
+            ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), block * 4096), 4096);
+        }
+    }
+
+    CacheStats stats = lab2.stats();
+    ASSERT_EQ(stats.misses, 8u);
+    ASSERT_EQ(stats.hits, 8u);
+    // The first four blocks went out dirty to make room for the last four
+    ASSERT_EQ(stats.evictions, 4u);
+    ASSERT_EQ(stats.writebacks, 4u);
+    ASSERT_EQ(stats.bytesWritten, 4u * 4096);
+    ASSERT_EQ(stats.diskWrites.count, stats.writebacks);
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(StatsTests, MetricsUsePrometheusTextFormat) {
+    const std::string tempFile = makeUniqueTempFile();
+    CacheConfig config;
+    config.capacity = 4;
+    config.blockSize = 4096;
+    Lab2 lab2(config);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> buffer(4096, 'm');
+    ASSERT_EQ(lab2.pwrite(fd, buffer.data(), buffer.size(), 0), 4096);
+    ASSERT_EQ(lab2.fsync(fd), 0);
+    // fsync keeps the block cached, so this is a hit
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 0), 4096);
+
+    const std::string text = lab2.metrics();
+    ASSERT_NE(text.find("# TYPE lab2_cache_hits_total counter\nlab2_cache_hits_total 1\n"), std::string::npos) << text;
+    ASSERT_NE(text.find("# TYPE lab2_cache_capacity_blocks gauge\nlab2_cache_capacity_blocks{block_bytes=\"4096\"} 4\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("# TYPE lab2_disk_write_seconds histogram\n"), std::string::npos);
+    ASSERT_NE(text.find("lab2_disk_write_seconds_bucket{le=\"+Inf\"} 1\n"), std::string::npos) << text;
+    ASSERT_NE(text.find("lab2_disk_write_seconds_count 1\n"), std::string::npos);
+    ASSERT_EQ(text.back(), '\n');
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
@@ -0,0 +1,89 @@
+#ifndef LAB2_TEST_UTILS_HPP
+#define LAB2_TEST_UTILS_HPP
+
+#include <filesystem>   // for std::filesystem::temp_directory_path
+#include <csignal>      // std::signal, SIGXFSZ
+#include <cstdlib>      // for mkstemp
+#include <fcntl.h>      // open
+#include <stdexcept>    // runtime_error
+#include <sys/resource.h> // getrlimit, setrlimit, RLIMIT_FSIZE
+#include <unistd.h>     // close, pread
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+// Helper function to create a unique temporary file path and return it as a std::string.
+inline std::string makeUniqueTempFile() {
+    // Get the system temp directory (e.g., /tmp on Linux)
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path();
+
+    // We’ll create a pattern for mkstemp, which replaces "XXXXXX" with random characters
+    // Example: /tmp/lab2_test_XXXXXX
+    std::filesystem::path templatePath = tempDir / "lab2_test_XXXXXX";
+    std::string templateStr = templatePath.string();
+
+    // mkstemp needs a modifiable char array
+    std::vector<char> modifiable(templateStr.begin(), templateStr.end());
+    modifiable.push_back('\0'); // null-terminate
+
+    // mkstemp replaces "XXXXXX" in-place and creates the file with O_RDWR
+    int fd = ::mkstemp(modifiable.data());
+    if (fd == -1) {
+        throw std::runtime_error("Could not create temp file with mkstemp!");
+    }
+
+    // We only want the name; we’ll close the file here
+    ::close(fd);
+
+    // Return the actual file path that mkstemp created
+    return std::string(modifiable.data());
+}
+
+// The byte at `offset` in the file, read around any cache ('?' past its end).
+inline char byteOnDisk(const std::string& path, off_t offset) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    char byte = '?';
+    (void) ::pread(fd, &byte, 1, offset);
+    ::close(fd);
+    return byte;
+}
+
+// True if all `length` bytes at `offset` in the file are `expected`, read around any cache.
+inline bool blockOnDisk(const std::string& path, off_t offset, size_t length, char expected) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    std::vector<char> block(length);
+    bool read = ::pread(fd, block.data(), length, offset) == static_cast<ssize_t>(length);
+    ::close(fd);
+    return read && std::vector<char>(length, expected) == block;
+}
+
+// Caps the size of files this process may write until it goes out of scope,
+// so write-backs past `bytes` fail with EFBIG (instead of a SIGXFSZ).
+class FileSizeLimit {
+public:
+    explicit FileSizeLimit(rlim_t bytes) {
+        if (::getrlimit(RLIMIT_FSIZE, &old_) != 0) {
+            throw std::runtime_error("Could not read RLIMIT_FSIZE!");
+        }
+        oldHandler_ = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit = old_;
+        limit.rlim_cur = bytes;
+        if (::setrlimit(RLIMIT_FSIZE, &limit) != 0) {
+            std::signal(SIGXFSZ, oldHandler_);
+            throw std::runtime_error("Could not set RLIMIT_FSIZE!");
+        }
+    }
+
+    ~FileSizeLimit() {
+        ::setrlimit(RLIMIT_FSIZE, &old_);
+        std::signal(SIGXFSZ, oldHandler_);
+    }
+
+    FileSizeLimit(const FileSizeLimit&) = delete;
+    FileSizeLimit& operator=(const FileSizeLimit&) = delete;
+
+private:
+    rlimit old_ {};
+    void (*oldHandler_)(int) = SIG_DFL;
+};
+
+#endif // LAB2_TEST_UTILS_HPP
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // EBADF
+#include <filesystem>   // std::filesystem::remove
+#include <stdexcept>    // runtime_error
+#include <string>       // std::string
+#include <unistd.h>     // SEEK_SET, SEEK_END
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "Trace.hpp"
+#include "TestUtils.hpp"
+
+//------------------------------------------------------------------------------
+TEST(TraceTests, Lab2RecordsItsCalls) {
+    const std::string tempFile = makeUniqueTempFile();
+    const std::string traceFile = makeUniqueTempFile();
+    CacheConfig config;
+    config.capacity = 8;
+    config.blockSize = 4096;
+    config.tracePath = traceFile;
+    fd_t fd;
+    {
+        Lab2 lab2(config);
+        fd = lab2.open(tempFile);
+        ASSERT_GE(fd, 0);
+        std::vector<char> buffer(6000, 't');
+        ASSERT_EQ(lab2.write(fd, buffer.data(), buffer.size()), 6000);
+        ASSERT_EQ(lab2.lseek(fd, -100, SEEK_END), 5900);
+        ASSERT_EQ(lab2.read(fd, buffer.data(), 512), 100);
+        ASSERT_EQ(lab2.pread(fd, buffer.data(), 10, 4090), 10);
+        ASSERT_EQ(lab2.pwrite(fd, buffer.data(), 10, 8000), 10);
+        ASSERT_EQ(lab2.fsync(fd), 0);
+        ASSERT_EQ(lab2.syncRange(fd, 4096, 100, LAB2_SYNC_RANGE_WRITE | LAB2_SYNC_RANGE_DATASYNC), 0);
+        ASSERT_EQ(lab2.fdatasync(fd), 0);
+        ASSERT_EQ(lab2.read(fd + 100, buffer.data(), 1), -1);
+        ASSERT_EQ(lab2.close(fd), 0);
+        CacheStats stats = lab2.stats();
+        ASSERT_GE(stats.bytesWritten, 6010u);
+        ASSERT_GT(stats.hits, 0u);
+    }
+
+    struct Expected {
+        TraceEvent::Op op;
+        std::int64_t offset;
+        std::uint64_t length;
+        std::int64_t result;
+    };
+    const std::vector<Expected> expected = {
+        {TraceEvent::Op::OPEN, 0, 0, fd},
+        {TraceEvent::Op::WRITE, 0, 6000, 6000},
+        {TraceEvent::Op::LSEEK, -100, SEEK_END, 5900},
+        {TraceEvent::Op::READ, 0, 512, 100},
+        {TraceEvent::Op::PREAD, 4090, 10, 10},
+        {TraceEvent::Op::PWRITE, 8000, 10, 10},
+        {TraceEvent::Op::FSYNC, 0, 0, 0},
+        {TraceEvent::Op::SYNC_RANGE, 4096, 100, 0},
+        {TraceEvent::Op::FDATASYNC, 0, 0, 0},
+        {TraceEvent::Op::READ, 0, 1, -1},
+        {TraceEvent::Op::CLOSE, 0, 0, 0},
+    };
+
+    TraceReader reader(traceFile);
+    TraceEvent event;
+    std::uint64_t lastTime = 0;
+    for (const Expected& call : expected) {
+        ASSERT_TRUE(reader.next(event));
+        ASSERT_EQ(event.op, call.op);
+        ASSERT_EQ(event.offset, call.offset);
+        ASSERT_EQ(event.length, call.length);
+        ASSERT_EQ(event.result, call.result);
+        ASSERT_GE(event.timeNs, lastTime) << "Calls on one thread must be recorded in order.";
+        lastTime = event.timeNs;
+        if (call.op == TraceEvent::Op::OPEN) {
+            ASSERT_EQ(event.path, tempFile);
+        }
+        if (call.op == TraceEvent::Op::SYNC_RANGE) {
+            ASSERT_EQ(event.flags, LAB2_SYNC_RANGE_WRITE | LAB2_SYNC_RANGE_DATASYNC);
+        }
+    }
+    ASSERT_FALSE(reader.next(event));
+
+    std::filesystem::remove(tempFile);
+    std::filesystem::remove(traceFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(TraceTests, RejectsOtherFiles) {
+    const std::string notATrace = makeUniqueTempFile();
+    ASSERT_THROW(TraceReader reader(notATrace), std::runtime_error);
+    std::filesystem::remove(notATrace);
+}
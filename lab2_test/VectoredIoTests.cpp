@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // EBADF, EINVAL
+#include <cstring>      // memcmp, memset
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <sys/uio.h>    // iovec
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+/// Deterministic content, different for every byte of a block-sized period
+std::vector<char> pattern(size_t size, char seed) {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>(seed + i % 251);
+    }
+    return data;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(VectoredIoTests, PositionalCallsLeaveOffsetAlone) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    std::vector<char> data = pattern(2 * BLOCK, 'a');
+    ASSERT_EQ(lab2.pwrite(fd, data.data(), data.size(), 100), static_cast<ssize_t>(data.size()));
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_CUR), 0);
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_END), static_cast<off_t>(100 + data.size()));
+
+    std::vector<char> buffer(data.size());
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 100), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(buffer, data);
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 200), static_cast<ssize_t>(data.size() - 100));
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), -1), -1);
+    ASSERT_EQ(errno, EINVAL);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(VectoredIoTests, ScatterGatherAcrossBlocks) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    std::vector<char> head = pattern(BLOCK - 7, 'h');
+    std::vector<char> body = pattern(BLOCK + 13, 'b');
+    std::vector<char> tail = pattern(5, 't');
+    iovec out[] = {{head.data(), head.size()}, {body.data(), body.size()}, {tail.data(), tail.size()}};
+    const size_t total = head.size() + body.size() + tail.size();
+    ASSERT_EQ(lab2.writev(fd, out, 3), static_cast<ssize_t>(total));
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_CUR), static_cast<off_t>(total));
+
+    // Split differently, and one byte more than there is
+    std::vector<char> first(10), second(total - 10 + 1);
+    iovec in[] = {{first.data(), first.size()}, {second.data(), second.size()}};
+    ASSERT_EQ(lab2.preadv(fd, in, 2, 0), static_cast<ssize_t>(total));
+    std::vector<char> joined(first);
+    joined.insert(joined.end(), second.begin(), second.end() - 1);
+    std::vector<char> expected(head);
+    expected.insert(expected.end(), body.begin(), body.end());
+    expected.insert(expected.end(), tail.begin(), tail.end());
+    ASSERT_EQ(joined, expected);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(VectoredIoTests, ReadBatchServesManyRecords) {
+    Lab2 lab2(8, BLOCK);
+    const std::string fileA = makeUniqueTempFile();
+    const std::string fileB = makeUniqueTempFile();
+    fd_t fdA = lab2.open(fileA);
+    fd_t fdB = lab2.open(fileB);
+    std::vector<char> dataA = pattern(6 * BLOCK, 'A');
+    std::vector<char> dataB = pattern(2 * BLOCK, 'B');
+    ASSERT_EQ(lab2.write(fdA, dataA.data(), dataA.size()), static_cast<ssize_t>(dataA.size()));
+    ASSERT_EQ(lab2.write(fdB, dataB.data(), dataB.size()), static_cast<ssize_t>(dataB.size()));
+    // Cold cache: the batch has to load everything
+    ASSERT_EQ(lab2.fsync(fdA), 0);
+    ASSERT_EQ(lab2.fsync(fdB), 0);
+
+    struct Expected {
+        fd_t fd;
+        off_t offset;
+        size_t length;
+        ssize_t result;
+    };
+    const std::vector<Expected> cases = {
+        {fdA, 5 * BLOCK + 10, 64, 64},
+        {fdB, 100, 200, 200},
+        {fdA, 10, 64, 64},
+        {fdA, 40, 64, 64},                      // Same block as the one before
+        {fdA, BLOCK - 8, 16, 16},               // Straddles two blocks
+        {fdB, 2 * BLOCK - 50, 100, 50},         // Cut short at EOF
+        {fdA, 0, 5 * BLOCK, 5 * BLOCK},         // Longer than half the cache
+        {-42, 0, 10, -EBADF},
+        {fdA, -1, 10, -EINVAL},
+    };
+    std::vector<ReadRequest> requests(cases.size());
+    std::vector<std::vector<char>> buffers(cases.size());
+    for (size_t i = 0; i < cases.size(); ++i) {
+        buffers[i].assign(cases[i].length, '?');
+        requests[i] = {cases[i].fd, cases[i].offset, buffers[i].data(), cases[i].length};
+    }
+
+    ASSERT_EQ(lab2.readBatch(requests.data(), requests.size()), cases.size() - 2);
+    for (size_t i = 0; i < cases.size(); ++i) {
+        ASSERT_EQ(requests[i].result, cases[i].result) << "Request " << i;
+        if (cases[i].result > 0) {
+            const std::vector<char> &data = cases[i].fd == fdA ? dataA : dataB;
+            ASSERT_EQ(std::memcmp(buffers[i].data(), data.data() + cases[i].offset, cases[i].result), 0)
+                << "Request " << i;
+        }
+    }
+
+    lab2.close(fdA);
+    lab2.close(fdB);
+    std::filesystem::remove(fileA);
+    std::filesystem::remove(fileB);
+}
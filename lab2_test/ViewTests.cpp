@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+#include <cerrno>       // ENOMEM
+#include <sys/uio.h>    // iovec
+#include <cstring>      // memcmp, memset
+#include <filesystem>   // std::filesystem::remove, file_size
+#include <string>       // std::string
+#include <vector>       // std::vector
+
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, ReadViewSpansCachedBlocks) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    std::vector<char> content(3 * BLOCK);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(lab2.write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    // Crosses both block boundaries and runs past EOF
+    Lab2::ReadView view = lab2.acquireRead(fd, 100, 3 * BLOCK);
+    ASSERT_TRUE(view);
+    ASSERT_EQ(view.size(), 3 * BLOCK - 100);
+    ASSERT_EQ(view.spans().size(), 3u);
+    ASSERT_EQ(view.spans()[0].size(), BLOCK - 100);
+    ASSERT_EQ(view.spans()[1].size(), BLOCK);
+    ASSERT_EQ(view.spans()[2].size(), BLOCK);
+    size_t position = 100;
+    for (std::span<const char> span : view.spans()) {
+        ASSERT_EQ(std::memcmp(span.data(), content.data() + position, span.size()), 0);
+        position += span.size();
+    }
+
+    // No copy: a second view sees the same memory
+    Lab2::ReadView again = lab2.acquireRead(fd, BLOCK, 10);
+    ASSERT_EQ(again.spans()[0].data(), view.spans()[1].data());
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_CUR), static_cast<off_t>(content.size())) << "Views must not move the offset.";
+
+    view.release();
+    again.release();
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, WriteViewMarksRangeDirtyOnRelease) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    {
+        Lab2::WriteView view = lab2.acquireWrite(fd, BLOCK - 10, 20);
+        ASSERT_TRUE(view);
+        ASSERT_EQ(view.spans().size(), 2u);
+        for (std::span<char> span : view.spans()) {
+            std::memset(span.data(), 'w', span.size());
+        }
+        // The file grows once the data is in
+        ASSERT_EQ(lab2.lseek(fd, 0, SEEK_END), 0);
+    }
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_END), static_cast<off_t>(BLOCK + 10));
+
+    std::vector<char> buffer(BLOCK + 10);
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(lab2.read(fd, buffer.data(), buffer.size()), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(buffer[BLOCK - 11], '\0');
+    ASSERT_EQ(buffer[BLOCK - 10], 'w');
+    ASSERT_EQ(buffer[BLOCK + 9], 'w');
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    ASSERT_EQ(std::filesystem::file_size(tempFile), BLOCK + 10);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, PinnedBlocksSurviveEviction) {
+    Lab2 lab2(4, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    std::vector<char> block(BLOCK);
+    for (char fill = 'a'; fill < 'a' + 8; ++fill) {
+        std::memset(block.data(), fill, BLOCK);
+        ASSERT_EQ(lab2.write(fd, block.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+    }
+
+    Lab2::ReadView view = lab2.acquireRead(fd, 0, 2 * BLOCK);
+    ASSERT_TRUE(view);
+    const char *first = view.spans()[0].data();
+
+    // Cycle the rest of the file through the two slots left
+    for (off_t b = 2; b < 8; ++b) {
+        ASSERT_EQ(lab2.lseek(fd, b * static_cast<off_t>(BLOCK), SEEK_SET), b * static_cast<off_t>(BLOCK));
+        ASSERT_EQ(lab2.read(fd, block.data(), BLOCK), static_cast<ssize_t>(BLOCK));
+        ASSERT_EQ(block[0], 'a' + b);
+    }
+    ASSERT_EQ(view.spans()[0].data(), first);
+    ASSERT_EQ(first[BLOCK - 1], 'a');
+    ASSERT_EQ(view.spans()[1][0], 'b');
+
+    // More than half the cache cannot be pinned by one view
+    ASSERT_FALSE(lab2.acquireRead(fd, 0, 3 * BLOCK));
+    ASSERT_EQ(errno, ENOMEM);
+
+    view.release();
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, ReadFailsWhenNoBlockCanBeHad) {
+    Lab2 lab2(2, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    std::vector<char> block(3 * BLOCK, 'r');
+    ASSERT_EQ(lab2.write(fd, block.data(), block.size()), static_cast<ssize_t>(block.size()));
+
+    // Both slots pinned: block 2 cannot be loaded, and must not read as zeros
+    Lab2::ReadView first = lab2.acquireRead(fd, 0, BLOCK);
+    Lab2::ReadView second = lab2.acquireRead(fd, BLOCK, BLOCK);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    ASSERT_EQ(lab2.pread(fd, block.data(), BLOCK, 2 * BLOCK), -1);
+    ASSERT_EQ(errno, ENOMEM);
+    // Up to the block that failed
+    std::memset(block.data(), 0, block.size());
+    ASSERT_EQ(lab2.pread(fd, block.data(), 2 * BLOCK, BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(block[BLOCK - 1], 'r');
+
+    first.release();
+    second.release();
+    ASSERT_EQ(lab2.pread(fd, block.data(), BLOCK, 2 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(block[0], 'r');
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, WriteStopsShortWhenNoBlockCanBeHad) {
+    Lab2 lab2(2, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    std::vector<char> data(2 * BLOCK, 'w');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    Lab2::ReadView first = lab2.acquireRead(fd, 0, BLOCK);
+    Lab2::ReadView second = lab2.acquireRead(fd, BLOCK, BLOCK);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+
+    // Block 1 is cached, block 2 cannot be had: the offset stops between them
+    ASSERT_EQ(lab2.lseek(fd, BLOCK, SEEK_SET), static_cast<off_t>(BLOCK));
+    ASSERT_EQ(lab2.write(fd, data.data(), 2 * BLOCK), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_CUR), static_cast<off_t>(2 * BLOCK));
+    ASSERT_EQ(lab2.write(fd, data.data(), BLOCK), -1);
+    ASSERT_EQ(errno, ENOMEM);
+
+    // The same for a vector, the second buffer failing half way
+    ASSERT_EQ(lab2.lseek(fd, BLOCK, SEEK_SET), static_cast<off_t>(BLOCK));
+    iovec iov[2] = {{data.data(), BLOCK / 2}, {data.data(), BLOCK}};
+    ASSERT_EQ(lab2.writev(fd, iov, 2), static_cast<ssize_t>(BLOCK));
+    ASSERT_EQ(lab2.lseek(fd, 0, SEEK_CUR), static_cast<off_t>(2 * BLOCK));
+
+    first.release();
+    second.release();
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+/// map(), or a skip where the kernel does not let this process use userfaultfd
+#define MAP_OR_SKIP(view, lab2, fd, offset, len)                                        \
+    Lab2::MappedView view = (lab2).map((fd), (offset), (len));                          \
+    if (!view && (errno == EPERM || errno == ENOSYS)) {                                 \
+        GTEST_SKIP() << "userfaultfd is not available here";                            \
+    }                                                                                   \
+    ASSERT_TRUE(view)
+
+namespace {
+
+std::vector<char> patterned(size_t size) {
+    std::vector<char> content(size);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>('a' + i % 23);
+    }
+    return content;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, MappedViewReadsThroughTheCache) {
+    Lab2 lab2(8, 4 * BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    const std::vector<char> content = patterned(10 * BLOCK + 100);
+    ASSERT_EQ(lab2.write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    // From the second page to past EOF, across several blocks
+    MAP_OR_SKIP(view, lab2, fd, BLOCK, 20 * BLOCK);
+    ASSERT_EQ(view.size(), 9 * BLOCK + 100);
+    ASSERT_EQ(std::memcmp(view.data(), content.data() + BLOCK, view.size()), 0);
+    ASSERT_EQ(lab2.stats().bytesRead, 0u) << "Every page should have come from the cached blocks.";
+    view.unmap();
+    ASSERT_FALSE(view);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, MappedViewWritesReachTheFile) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    const std::vector<char> content = patterned(4 * BLOCK);
+    ASSERT_EQ(lab2.write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    ASSERT_EQ(lab2.fsync(fd), 0);
+
+    MAP_OR_SKIP(view, lab2, fd, 0, content.size());
+    ASSERT_EQ(view.data()[5], content[5]); // Read fault first, so the write below is a write-protect fault
+    view.data()[5] = '!';
+    view.data()[2 * BLOCK] = '?'; // Write fault on a missing page
+    ASSERT_EQ(view.sync(), 0);
+    ASSERT_EQ(lab2.writebackStats().dirty, 2u) << "Only the written pages' blocks should turn dirty.";
+
+    // The page is protected again after a sync; a second write is caught as well
+    view.data()[6] = '#';
+    view.unmap();
+    std::vector<char> expected = content;
+    expected[5] = '!';
+    expected[6] = '#';
+    expected[2 * BLOCK] = '?';
+    std::vector<char> buffer(content.size());
+    ASSERT_EQ(lab2.pread(fd, buffer.data(), buffer.size(), 0), static_cast<ssize_t>(buffer.size()));
+    ASSERT_EQ(buffer, expected);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(ViewTests, MapRejectsBadArguments) {
+    Lab2 lab2(8, BLOCK);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    const std::vector<char> content = patterned(BLOCK);
+    ASSERT_EQ(lab2.write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    ASSERT_FALSE(lab2.map(fd + 100, 0, BLOCK));
+    ASSERT_EQ(errno, EBADF);
+    ASSERT_FALSE(lab2.map(fd, 100, BLOCK));
+    ASSERT_EQ(errno, EINVAL);
+    ASSERT_FALSE(lab2.map(fd, BLOCK, BLOCK)) << "Nothing to map at EOF";
+    ASSERT_EQ(errno, EINVAL);
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
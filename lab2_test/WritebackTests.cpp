@@ -0,0 +1,326 @@
+#include <gtest/gtest.h>
+#include <algorithm>    // std::fill
+#include <atomic>       // std::atomic
+#include <cerrno>       // errno, EIO
+#include <chrono>       // std::chrono::steady_clock
+#include <cstdint>      // SIZE_MAX
+#include <cstring>      // memcmp, memset
+#include <fcntl.h>      // ::open
+#include <filesystem>   // std::filesystem::remove
+#include <string>       // std::string
+#include <thread>       // std::thread, std::this_thread::sleep_for
+#include <unistd.h>     // pread, pwrite, fsync, close
+#include <vector>       // std::vector
+
+#include "BlockCache.hpp"
+#include "lab2_library.hpp"
+#include "TestUtils.hpp"
+#include "Writeback.hpp"
+
+namespace {
+
+constexpr size_t BLOCK = 4096;
+
+/// Waits up to five seconds for the flusher thread
+template <typename Predicate>
+bool eventually(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, DirtyRatioWakesFlusher) {
+    WritebackConfig config;
+    config.dirtyRatio = 0.25;        // 4 of 16 blocks
+    config.maxDirtyAgeMs = 0;        // Only the ratio counts
+    config.intervalMs = 60 * 1000;   // Never times out during the test
+    Lab2 lab2(16, BLOCK, config);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    std::vector<char> data(8 * BLOCK, 'w');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+
+    // Counted once the writes have completed
+    ASSERT_TRUE(eventually([&] { return lab2.writebackStats().blocks >= 4; }))
+        << "The flusher should bring the dirty count back under the limit.";
+    WritebackStats stats = lab2.writebackStats();
+    ASSERT_LE(stats.dirty, 4u);
+    ASSERT_LT(stats.writes, stats.blocks) << "Adjacent blocks should share a write.";
+    // Oldest first: the first block written is among those on disk
+    ASSERT_TRUE(blockOnDisk(tempFile, 0, BLOCK, 'w'));
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, AgeLimitWritesBackIdleBlocks) {
+    WritebackConfig config;
+    config.dirtyRatio = 1.0;         // Never crossed
+    config.maxDirtyAgeMs = 20;
+    config.intervalMs = 10;
+    Lab2 lab2(16, BLOCK, config);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+
+    std::vector<char> data(BLOCK, 'a');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+
+    ASSERT_TRUE(eventually([&] { return lab2.writebackStats().blocks == 1; }));
+    ASSERT_EQ(lab2.writebackStats().dirty, 0u);
+    ASSERT_TRUE(blockOnDisk(tempFile, 0, BLOCK, 'a')) << "No fsync, yet the block should have been written back.";
+
+    lab2.close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, WriteBackCoalescesAdjacentBlocks) {
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    BlockCache cache(16, BLOCK);
+    for (off_t block : {0, 1, 2, 3, 4, 5, 10}) {
+        BlockCache::Handle handle = cache.acquire(fd, block);
+        std::memset(handle.data(), 'a' + static_cast<int>(block), BLOCK);
+        handle.markDirty();
+    }
+    ASSERT_EQ(cache.dirtyCount(), 7u);
+
+    ASSERT_EQ(cache.writeBack(std::chrono::steady_clock::time_point::max(), SIZE_MAX), 7u);
+    ASSERT_EQ(cache.writebackCounters().writes.load(), 2u) << "Blocks 0-5 should go out as one pwritev.";
+    ASSERT_EQ(cache.dirtyCount(), 0u);
+    ASSERT_TRUE(cache.contains(fd, 3)) << "Write-back must not evict.";
+    ASSERT_TRUE(blockOnDisk(tempFile, 3 * BLOCK, BLOCK, 'd'));
+    ASSERT_TRUE(blockOnDisk(tempFile, 10 * BLOCK, BLOCK, 'k'));
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, EvictionPrefersCleanVictims) {
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    BlockCache cache(4, BLOCK);
+    int kicks = 0;
+    cache.setDirtyLimit(SIZE_MAX, [&kicks] { ++kicks; });
+    cache.acquire(fd, 0).markDirty();
+    cache.acquire(fd, 1);
+    cache.acquire(fd, 2);
+    cache.acquire(fd, 3);
+
+    // Block 0 is first in line, but dirty: it is left to the flusher
+    cache.acquire(fd, 4);
+    ASSERT_TRUE(cache.contains(fd, 0));
+    ASSERT_FALSE(cache.contains(fd, 1));
+    ASSERT_EQ(kicks, 1);
+    ASSERT_EQ(cache.dirtyCount(), 1u);
+
+    cache.flushFd(fd);
+    ASSERT_EQ(cache.dirtyCount(), 0u);
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, SubBlockWriteSendsOnlyDirtySectors) {
+    constexpr size_t LARGE_BLOCK = 2 * BLOCK;
+    const std::string tempFile = makeUniqueTempFile();
+    int fd = ::open(tempFile.c_str(), O_RDWR | O_DIRECT);
+    ASSERT_GE(fd, 0);
+    int rawFd = ::open(tempFile.c_str(), O_RDWR);
+    std::vector<char> original(LARGE_BLOCK, 'x');
+    ASSERT_EQ(::pwrite(rawFd, original.data(), LARGE_BLOCK, 0), static_cast<ssize_t>(LARGE_BLOCK));
+
+    BlockCache cache(4, LARGE_BLOCK);
+    BlockCache::Handle handle = cache.acquire(fd, 0);
+    ASSERT_TRUE(handle);
+    std::memset(static_cast<char*>(handle.data()) + 100, 'y', 100);
+    handle.markDirty(100, 100);
+    handle.release();
+
+    // Changed behind the cache's back; a full-block write-back would undo this
+    std::vector<char> outside(BLOCK, 'z');
+    ASSERT_EQ(::pwrite(rawFd, outside.data(), BLOCK, BLOCK), static_cast<ssize_t>(BLOCK));
+    ::fsync(rawFd);
+
+    ASSERT_EQ(cache.writeBack(std::chrono::steady_clock::time_point::max(), SIZE_MAX), 1u);
+    ASSERT_EQ(cache.writebackCounters().writes.load(), 1u);
+    std::vector<char> disk(LARGE_BLOCK);
+    ASSERT_EQ(::pread(rawFd, disk.data(), LARGE_BLOCK, 0), static_cast<ssize_t>(LARGE_BLOCK));
+    ASSERT_EQ(disk[99], 'x');
+    ASSERT_EQ(disk[100], 'y');
+    ASSERT_EQ(disk[199], 'y');
+    ASSERT_EQ(disk[200], 'x');
+    ASSERT_EQ(std::memcmp(disk.data() + BLOCK, outside.data(), BLOCK), 0) << "Clean sectors must not be written.";
+
+    ::close(rawFd);
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, FullBlockOverwriteSkipsRead) {
+    const std::string tempFile = makeUniqueTempFile();
+    // Write-only: any read from disk would fail
+    int fd = ::open(tempFile.c_str(), O_WRONLY | O_DIRECT);
+    ASSERT_GE(fd, 0);
+
+    BlockCache cache(4, BLOCK);
+    cache.setSparseFiles(false); // The empty file is a hole, which would be zero-filled without a read
+    ASSERT_FALSE(cache.acquire(fd, 1));
+
+    std::vector<char> data(BLOCK, 'o');
+    ASSERT_TRUE(cache.overwrite(fd, 0, data.data()));
+    ASSERT_EQ(cache.dirtyCount(), 1u);
+    BlockCache::Handle handle = cache.acquire(fd, 0);
+    ASSERT_EQ(handle.lookup(), BlockCache::Lookup::HIT);
+    ASSERT_EQ(std::memcmp(handle.data(), data.data(), BLOCK), 0);
+    handle.release();
+
+    ASSERT_EQ(cache.writeBack(std::chrono::steady_clock::time_point::max(), SIZE_MAX), 1u);
+    ASSERT_TRUE(blockOnDisk(tempFile, 0, BLOCK, 'o'));
+
+    ::close(fd);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, FsyncWritesOnlyItsFileAndKeepsBlocks) {
+    WritebackConfig config;
+    config.enabled = false;
+    Lab2 lab2(16, BLOCK, config);
+    const std::string synced = makeUniqueTempFile();
+    const std::string other = makeUniqueTempFile();
+    fd_t fd = lab2.open(synced);
+    fd_t otherFd = lab2.open(other);
+    ASSERT_GE(fd, 0);
+    ASSERT_GE(otherFd, 0);
+
+    std::vector<char> data(4 * BLOCK, 's');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    std::fill(data.begin(), data.end(), 'o');
+    ASSERT_EQ(lab2.write(otherFd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+
+    ASSERT_EQ(lab2.fsync(fd), 0);
+    ASSERT_TRUE(blockOnDisk(synced, 3 * BLOCK, BLOCK, 's'));
+    ASSERT_FALSE(blockOnDisk(other, 0, BLOCK, 'o')) << "fsync must leave other files' blocks alone.";
+
+    // Nothing was dropped: reading the synced file back is all hits
+    const CacheStats before = lab2.stats();
+    ASSERT_EQ(lab2.pread(fd, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+    ASSERT_EQ(data[BLOCK], 's');
+    ASSERT_EQ(lab2.stats().misses, before.misses);
+
+    ASSERT_EQ(lab2.close(fd), 0);
+    ASSERT_EQ(lab2.close(otherFd), 0);
+    ASSERT_TRUE(blockOnDisk(other, 0, BLOCK, 'o'));
+    std::filesystem::remove(synced);
+    std::filesystem::remove(other);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, SyncRangeWritesOnlyTheRange) {
+    WritebackConfig config;
+    config.enabled = false;
+    Lab2 lab2(16, BLOCK, config);
+    const std::string tempFile = makeUniqueTempFile();
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> data(4 * BLOCK, 'r');
+    ASSERT_EQ(lab2.write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+
+    ASSERT_EQ(lab2.syncRange(fd, 0, 0, 0), -1);
+    ASSERT_EQ(errno, EINVAL);
+    ASSERT_EQ(lab2.syncRange(fd, -1, 1, LAB2_SYNC_RANGE_WRITE), -1);
+    ASSERT_EQ(errno, EINVAL);
+
+    // The last bytes of block 1 and the first of block 2
+    ASSERT_EQ(lab2.syncRange(fd, 2 * BLOCK - 10, 20, LAB2_SYNC_RANGE_WRITE | LAB2_SYNC_RANGE_DATASYNC), 0);
+    ASSERT_FALSE(blockOnDisk(tempFile, 0, BLOCK, 'r'));
+    ASSERT_TRUE(blockOnDisk(tempFile, BLOCK, BLOCK, 'r'));
+    ASSERT_TRUE(blockOnDisk(tempFile, 2 * BLOCK, BLOCK, 'r'));
+    ASSERT_FALSE(blockOnDisk(tempFile, 3 * BLOCK, BLOCK, 'r'));
+
+    ASSERT_EQ(lab2.fdatasync(fd), 0);
+    ASSERT_TRUE(blockOnDisk(tempFile, 0, BLOCK, 'r'));
+    ASSERT_TRUE(blockOnDisk(tempFile, 3 * BLOCK, BLOCK, 'r'));
+    ASSERT_EQ(lab2.close(fd), 0);
+    std::filesystem::remove(tempFile);
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, GroupCommitSharesFlushes) {
+    constexpr int THREADS = 8;
+    GroupCommit commits;
+    std::atomic<int> flushes{0};
+    std::atomic<bool> fail{false};
+    auto flush = [&] {
+        flushes.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (fail.load()) {
+            errno = EIO;
+            return -1;
+        }
+        return 0;
+    };
+
+    for (bool failing : {false, true}) {
+        fail.store(failing);
+        flushes.store(0);
+        std::atomic<int> failures{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&] {
+                if (commits.sync(flush) != 0) {
+                    failures.fetch_add(errno == EIO);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        ASSERT_LT(flushes.load(), THREADS) << "Callers that came in during a flush should share the next one.";
+        ASSERT_EQ(failures.load(), failing ? THREADS : 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(WritebackTests, CloseReportsFailedWriteBack) {
+    const std::string tempFile = makeUniqueTempFile();
+    CacheConfig config;
+    config.capacity = 8;
+    config.blockSize = BLOCK;
+    config.writeback.enabled = false;
+    Lab2 lab2(config);
+    fd_t fd = lab2.open(tempFile);
+    ASSERT_GE(fd, 0);
+    std::vector<char> data(BLOCK, 'c');
+    ASSERT_EQ(lab2.pwrite(fd, data.data(), BLOCK, 4 * BLOCK), static_cast<ssize_t>(BLOCK));
+
+    int result;
+    int error;
+    {
+        FileSizeLimit limit(BLOCK);
+        result = lab2.close(fd);
+        error = errno;
+    }
+
+    ASSERT_EQ(result, -1);
+    ASSERT_EQ(error, EIO); // As fsync() would report it
+    ASSERT_EQ(lab2.close(fd), -1) << "The fd is gone even though the write-back failed.";
+    std::filesystem::remove(tempFile);
+}